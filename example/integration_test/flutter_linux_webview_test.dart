@@ -69,6 +69,7 @@ import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:integration_test/integration_test.dart';
 import 'package:webview_flutter/webview_flutter.dart';
+import 'package:webview_flutter_platform_interface/webview_flutter_platform_interface.dart';
 import 'package:flutter_linux_webview/flutter_linux_webview.dart';
 
 Future<void> main() async {
@@ -1423,6 +1424,167 @@ Future<void> main() async {
     // TODO(bparrishMines): Unskip once https://github.com/flutter/plugins/pull/5086 lands and is published.
     skip: Platform.isAndroid,
   );
+
+  group('Linux extensions', () {
+    // Builds a WebView showing [url] and returns its Linux controller once the
+    // page has finished loading.
+    Future<WebViewLinuxPlatformController> pumpLinuxWebView(
+        WidgetTester tester, String url) async {
+      final Completer<WebViewLinuxPlatformController> controllerCompleter =
+          Completer<WebViewLinuxPlatformController>();
+      final Completer<void> pageFinished = Completer<void>();
+      final WebViewPlatform previousPlatform = WebView.platform;
+      WebView.platform = LinuxWebView(
+          onLinuxControllerCreated: (WebViewLinuxPlatformController c) {
+        controllerCompleter.complete(c);
+      });
+      addTearDown(() => WebView.platform = previousPlatform);
+      await tester.pumpWidget(
+        Directionality(
+          textDirection: TextDirection.ltr,
+          child: WebView(
+            key: GlobalKey(),
+            initialUrl: url,
+            onPageFinished: (_) {
+              if (!pageFinished.isCompleted) {
+                pageFinished.complete();
+              }
+            },
+          ),
+        ),
+      );
+      final WebViewLinuxPlatformController controller =
+          await controllerCompleter.future;
+      await pageFinished.future;
+      return controller;
+    }
+
+    // Lets the browser paint and Flutter draw a few frames.
+    Future<void> waitForFrames(WidgetTester tester) async {
+      for (int i = 0; i < 10; ++i) {
+        await Future<void>.delayed(const Duration(milliseconds: 50));
+        await tester.pump();
+      }
+    }
+
+    testWidgets('setFrameRate', (WidgetTester tester) async {
+      final WebViewLinuxPlatformController controller =
+          await pumpLinuxWebView(tester, primaryUrl);
+      await controller.setFrameRate(30);
+      await controller.setFrameRate(60, adaptive: true, minFrameRate: 10);
+      // The page keeps working at the new rate.
+      expect(controller.runJavascriptReturningResult('1 + 1'),
+          completion(_webviewString('2')));
+      await expectLater(
+          controller.setFrameRate(0), throwsA(isA<PlatformException>()));
+      await expectLater(
+          controller.setFrameRate(61), throwsA(isA<PlatformException>()));
+    });
+
+    testWidgets('getRenderStats', (WidgetTester tester) async {
+      await LinuxWebViewPlugin.setRenderStatsEnabled(true);
+      addTearDown(() => LinuxWebViewPlugin.setRenderStatsEnabled(false));
+      final WebViewLinuxPlatformController controller =
+          await pumpLinuxWebView(tester, primaryUrl);
+      await controller.runJavascript('document.body.style.background = "red"');
+      await waitForFrames(tester);
+
+      final Map<String, Map<String, int>> stats =
+          await controller.getRenderStats();
+      for (final String histogram in <String>[
+        'paintDurationUs',
+        'paintIntervalUs',
+        'uploadedBytes',
+        'dirtyRects',
+        'uploadedRects',
+        'notifyLatencyUs',
+        'presentLatencyUs',
+      ]) {
+        expect(stats[histogram], isNotNull, reason: histogram);
+        expect(stats[histogram]!.keys,
+            containsAll(<String>['count', 'min', 'max', 'p50', 'p99']));
+      }
+      expect(stats['paintDurationUs']!['count'], greaterThan(0));
+      expect(stats['frames']!['published'], greaterThan(0));
+      expect(stats['frames']!.keys,
+          containsAll(<String>['presented', 'superseded', 'skippedPaints']));
+    });
+
+    testWidgets('startRecording and stopRecording',
+        (WidgetTester tester) async {
+      final WebViewLinuxPlatformController controller =
+          await pumpLinuxWebView(tester, primaryUrl);
+      final Directory directory =
+          await Directory.systemTemp.createTemp('flutter_linux_webview_test');
+      addTearDown(() => directory.delete(recursive: true));
+      final String path = '${directory.path}/session.fwvrec';
+
+      await controller.startRecording(path);
+      // A WebView is recorded only once at a time.
+      await expectLater(controller.startRecording('${directory.path}/other'),
+          throwsA(isA<PlatformException>()));
+      await controller.runJavascript('document.body.style.background = "red"');
+      await waitForFrames(tester);
+      final Map<String, int> totals = await controller.stopRecording();
+
+      // The recording starts with the whole view.
+      expect(totals['frames'], greaterThan(0));
+      expect(totals['droppedFrames'], isNotNull);
+      expect(totals['bytes'], File(path).lengthSync());
+      expect(totals['bytes'], greaterThan(0));
+    });
+
+    testWidgets('createHeadless', (WidgetTester tester) async {
+      final _PageFinishedHandler handler = _PageFinishedHandler();
+      final WebViewLinuxPlatformController controller =
+          await WebViewLinuxPlatformController.createHeadless(
+              callbacksHandler: handler,
+              initialUrl: primaryUrl,
+              width: 320,
+              height: 240);
+      addTearDown(controller.dispose);
+      expect(await handler.pageFinished.future, primaryUrl);
+      expect(controller.currentUrl(), completion(primaryUrl));
+      expect(controller.runJavascriptReturningResult('window.innerWidth'),
+          completion('320'));
+
+      // Navigates like a WebView with a widget.
+      handler.pageFinished = Completer<String>();
+      await controller.loadUrl(secondaryUrl, null);
+      expect(await handler.pageFinished.future, secondaryUrl);
+
+      // Has nothing to draw, so has no render statistics.
+      await expectLater(
+          controller.getRenderStats(), throwsA(isA<PlatformException>()));
+    });
+  });
+}
+
+// Completes [pageFinished] with the URL of the next page finished by a
+// headless WebView.
+class _PageFinishedHandler implements WebViewPlatformCallbacksHandler {
+  Completer<String> pageFinished = Completer<String>();
+
+  @override
+  FutureOr<bool> onNavigationRequest(
+          {required String url, required bool isForMainFrame}) =>
+      true;
+
+  @override
+  void onPageStarted(String url) {}
+
+  @override
+  void onPageFinished(String url) {
+    if (!pageFinished.isCompleted) {
+      pageFinished.complete(url);
+    }
+  }
+
+  @override
+  void onProgress(int progress) {}
+
+  @override
+  void onWebResourceError(WebResourceError error) {}
 }
 
 // JavaScript booleans evaluate to different string values on Android and iOS.
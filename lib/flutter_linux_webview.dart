@@ -31,4 +31,5 @@ library flutter_linux_webview;
 export 'src/webview_linux_cookie_manager.dart';
 export 'src/linux_webview_plugin.dart';
 export 'src/webview_linux.dart';
+export 'src/webview_linux_frame_tap.dart';
 export 'src/webview_linux_widget.dart';
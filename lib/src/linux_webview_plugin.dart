@@ -35,6 +35,52 @@ import 'package:path/path.dart' as path;
 
 import 'webview_linux_widget.dart';
 
+/// Specifies how the browser rendering is uploaded to the Flutter textures.
+///
+/// See [LinuxWebViewPlugin.setTextureUploadMode].
+enum TextureUploadMode {
+  /// Uses [pixelBufferObject] if it uploads faster than [direct] on this GL
+  /// implementation, which the plugin measures once when it starts, or
+  /// [direct] otherwise. This is the default.
+  auto,
+
+  /// Updates the textures directly from the pixel buffers painted by the
+  /// browser. The browser's UI thread waits for the driver to copy the pixels
+  /// on every frame.
+  direct,
+
+  /// Copies the dirty regions into a ring of pixel buffer objects and updates
+  /// the textures from them, so that the pixel transfer runs asynchronously.
+  /// Falls back to [direct] if the GL context does not support pixel buffer
+  /// objects.
+  pixelBufferObject,
+}
+
+/// Specifies what the browser rendering is drawn to.
+///
+/// See [LinuxWebViewPlugin.setTextureBackend].
+enum TextureBackend {
+  /// Uses [gl] if the plugin could create a GL context, otherwise
+  /// [pixelBuffer]. This is the default.
+  auto,
+
+  /// Uploads the browser rendering to GL textures with a GL context shared
+  /// with Flutter.
+  gl,
+
+  /// Copies the browser rendering to CPU images that Flutter uploads itself.
+  /// Works without a GL context in the plugin, e.g. on software-rendered
+  /// virtual machines and thin clients, at the cost of an extra copy.
+  pixelBuffer,
+
+  /// Copies the browser rendering to CPU images, which are uploaded to GL
+  /// textures on Flutter's raster thread when Flutter draws them. The browser
+  /// thread, which also handles input and navigation, makes no GL call. Needs
+  /// a GL context in the plugin. Webviews drawn this way are not tiled,
+  /// mirrored or packed into texture atlases.
+  rasterUpload,
+}
+
 enum _PluginState {
   uninitialized,
   initializing,
@@ -137,6 +183,117 @@ class LinuxWebViewPlugin {
     log.fine('LinuxWebViewPlugin initialization done.');
   }
 
+  /// Sets how the browser rendering is uploaded to the Flutter textures.
+  ///
+  /// The [mode] applies to all existing WebViews and WebViews created
+  /// afterwards. The default is [TextureUploadMode.auto].
+  static Future<void> setTextureUploadMode(TextureUploadMode mode) async {
+    await (await channel).invokeMethod<void>(
+        'setTextureUploadMode', <String, dynamic>{'mode': mode.index});
+  }
+
+  /// Sets what the browser rendering of the WebViews created afterwards is
+  /// drawn to. The default is [TextureBackend.auto].
+  ///
+  /// Throws a [PlatformException] for [TextureBackend.gl] and
+  /// [TextureBackend.rasterUpload] if the plugin could not create a GL context.
+  static Future<void> setTextureBackend(TextureBackend backend) async {
+    await (await channel).invokeMethod<void>(
+        'setTextureBackend', <String, dynamic>{'backend': backend.index});
+  }
+
+  /// Sets whether small WebViews are drawn to texture atlases shared with
+  /// other small WebViews, rather than to textures of their own. The default
+  /// is false.
+  ///
+  /// Each WebView no larger than 512 x 512 pixels is given a region of an
+  /// atlas when it is resized, and WebViews are moved around in their atlas
+  /// to make room. The paints of all the WebViews in an atlas are uploaded
+  /// together, with a single GL context switch, which saves work on
+  /// dashboards of many small WebViews. A WebView that has mirrors stays out
+  /// of the atlases, and a WebView in an atlas cannot be mirrored.
+  ///
+  /// Applies to each WebView from its next resize. Throws a
+  /// [PlatformException] if [enabled] is true and the plugin could not create
+  /// a GL context.
+  static Future<void> setTextureAtlasEnabled(bool enabled) async {
+    await (await channel).invokeMethod<void>(
+        'setTextureAtlasEnabled', <String, dynamic>{'enabled': enabled});
+  }
+
+  /// Returns the statistics of the pool that recycles the textures of disposed
+  /// WebViews for new ones:
+  ///
+  /// * `hits`: the number of WebViews created with a pooled texture, out of
+  ///   which `sizeMatchedHits` got one of about the same size.
+  /// * `misses`: the number of WebViews created with new textures.
+  /// * `deleted`: the number of textures deleted because the pool was full.
+  /// * `pooled`: the number of textures currently in the pool.
+  /// * `pending`: the number of textures of disposed WebViews waiting to be
+  ///   pooled or deleted.
+  static Future<Map<String, int>> getTexturePoolStats() async {
+    final Map<String, int>? result = await (await channel)
+        .invokeMapMethod<String, int>('getTexturePoolStats');
+    return result!;
+  }
+
+  /// Sets the number of bytes of GPU memory that the WebView textures should
+  /// stay within, or 0 for no limit, which is the default.
+  ///
+  /// Over the budget, the pooled textures of disposed WebViews are deleted
+  /// first. Then the hidden WebViews, whose widget or window is not visible,
+  /// shrink their textures to a single transparent pixel, starting with the
+  /// one shown least recently, until the textures fit in the budget. Such a
+  /// WebView repaints its whole view when it is shown again. The textures of
+  /// visible WebViews are never shrunk, so the budget may still be exceeded.
+  ///
+  /// Applies only to the WebViews drawn to GL textures by the plugin.
+  static Future<void> setTextureMemoryBudget(int bytes) async {
+    await (await channel).invokeMethod<void>(
+        'setTextureMemoryBudget', <String, dynamic>{'bytes': bytes});
+  }
+
+  /// Returns the GPU memory held by the WebView textures:
+  ///
+  /// * `currentBytes`: the bytes of texture storage now.
+  /// * `peakBytes`: the largest `currentBytes` since the application started.
+  /// * `budgetBytes`: the budget set by [setTextureMemoryBudget], 0 if none.
+  /// * `evictions`: the number of times a hidden WebView shrank its textures
+  ///   to meet the budget.
+  static Future<Map<String, int>> getTextureMemoryStats() async {
+    final Map<String, int>? result = await (await channel)
+        .invokeMapMethod<String, int>('getTextureMemoryStats');
+    return result!;
+  }
+
+  /// Sets the directory where the WebViews created with a
+  /// [WebViewLinuxWidget.snapshotKey] keep a snapshot of their last frame, or
+  /// disables the snapshots if [path] is null or empty, which is the default.
+  ///
+  /// A WebView shows the snapshot stored under its key by the previous run of
+  /// the application from its creation until the browser paints for the first
+  /// time, instead of its background color. The snapshot is stored when the
+  /// WebView is disposed or the plugin is terminated by [terminate]. The
+  /// directory is created if it does not exist.
+  ///
+  /// This must be called before the WebViews to be shown from their snapshots
+  /// are created.
+  static Future<void> setSnapshotDirectory(String? path) async {
+    await (await channel).invokeMethod<void>(
+        'setSnapshotDirectory', <String, dynamic>{'path': path ?? ''});
+  }
+
+  /// Enables or disables the collection of the frame pipeline statistics of
+  /// all WebViews returned by
+  /// [WebViewLinuxPlatformController.getRenderStats].
+  ///
+  /// The statistics are disabled by default, in which case collecting them
+  /// costs nothing. Enabling them clears the statistics collected so far.
+  static Future<void> setRenderStatsEnabled(bool enabled) async {
+    await (await channel).invokeMethod<void>(
+        'setRenderStatsEnabled', <String, dynamic>{'enabled': enabled});
+  }
+
   /// Terminates the plugin. **In Flutter 3.10 or later, this method must be
   /// called before the application exits. Prior to Flutter 3.10, this method
   /// does not need to be called.** because the plugin automatically exits.
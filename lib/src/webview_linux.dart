@@ -36,6 +36,29 @@ import 'package:webview_flutter_platform_interface/webview_flutter_platform_inte
 import 'webview_linux_widget.dart';
 
 class LinuxWebView implements WebViewPlatform {
+  /// [onLinuxControllerCreated] is called with the controller of each WebView
+  /// built by this platform, which provides the Linux-specific APIs such as
+  /// [WebViewLinuxPlatformController.getRenderCounters].
+  ///
+  /// If [externalBeginFrame] is true, the browsers of the WebViews built by
+  /// this platform paint once per Flutter frame, in phase with it, instead of
+  /// on their own 60 Hz timer. See [WebViewLinuxWidget.externalBeginFrame].
+  ///
+  /// [snapshotKeyOf] returns the [WebViewLinuxWidget.snapshotKey] of the
+  /// WebView built with the given creation parameters, or null if it has no
+  /// snapshot.
+  LinuxWebView(
+      {this.onLinuxControllerCreated,
+      this.externalBeginFrame = false,
+      this.snapshotKeyOf});
+
+  final void Function(WebViewLinuxPlatformController controller)?
+      onLinuxControllerCreated;
+
+  final bool externalBeginFrame;
+
+  final String? Function(CreationParams creationParams)? snapshotKeyOf;
+
   @override
   Widget build({
     required BuildContext context,
@@ -46,10 +69,17 @@ class LinuxWebView implements WebViewPlatform {
     Set<Factory<OneSequenceGestureRecognizer>>? gestureRecognizers,
   }) {
     return WebViewLinuxWidget(
-      onWebViewPlatformCreated: onWebViewPlatformCreated,
+      onWebViewPlatformCreated: (WebViewPlatformController? controller) {
+        if (controller is WebViewLinuxPlatformController) {
+          onLinuxControllerCreated?.call(controller);
+        }
+        onWebViewPlatformCreated?.call(controller);
+      },
       callbacksHandler: webViewPlatformCallbacksHandler,
       javascriptChannelRegistry: javascriptChannelRegistry,
       creationParams: creationParams,
+      externalBeginFrame: externalBeginFrame,
+      snapshotKey: snapshotKeyOf?.call(creationParams),
     );
   }
 
@@ -0,0 +1,299 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+import 'dart:async';
+import 'dart:ffi';
+import 'dart:typed_data';
+import 'dart:ui' show Rect;
+
+import 'linux_webview_plugin.dart';
+import 'logging.dart';
+
+typedef _MmapNative = Pointer<Void> Function(Pointer<Void> address,
+    IntPtr length, Int32 prot, Int32 flags, Int32 fd, Int64 offset);
+typedef _Mmap = Pointer<Void> Function(
+    Pointer<Void> address, int length, int prot, int flags, int fd, int offset);
+typedef _MunmapNative = Int32 Function(Pointer<Void> address, IntPtr length);
+typedef _Munmap = int Function(Pointer<Void> address, int length);
+typedef _CloseNative = Int32 Function(Int32 fd);
+typedef _Close = int Function(int fd);
+
+/// The libc functions mapping the shared memory the frames are written to.
+class _LibC {
+  _LibC._();
+
+  static final DynamicLibrary _process = DynamicLibrary.process();
+  static final _Mmap mmap =
+      _process.lookupFunction<_MmapNative, _Mmap>('mmap');
+  static final _Munmap munmap =
+      _process.lookupFunction<_MunmapNative, _Munmap>('munmap');
+  static final _Close close =
+      _process.lookupFunction<_CloseNative, _Close>('close');
+
+  static const int protRead = 0x1;
+  static const int mapShared = 0x01;
+  // MAP_FAILED
+  static const int mapFailed = -1;
+}
+
+/// A shared memory buffer holding the slots of a frame tap, mapped read-only.
+///
+/// The native side replaces the buffer when the WebView grows beyond it. The
+/// mapping of a replaced buffer is kept until the frames in it are released.
+class _FrameTapBuffer {
+  _FrameTapBuffer(this.generation, this.address, this.size);
+
+  final int generation;
+  final Pointer<Uint8> address;
+  final int size;
+
+  int heldFrames = 0;
+  bool retired = false;
+  bool _unmapped = false;
+
+  /// Maps the buffer given by the file descriptor [fd], which is closed.
+  static _FrameTapBuffer? map(int generation, int fd, int size) {
+    final Pointer<Void> address = _LibC.mmap(
+        nullptr, size, _LibC.protRead, _LibC.mapShared, fd, 0);
+    _LibC.close(fd);
+    if (address.address == _LibC.mapFailed) {
+      log.warning('Failed to map the frame tap buffer of $size bytes');
+      return null;
+    }
+    return _FrameTapBuffer(generation, address.cast<Uint8>(), size);
+  }
+
+  void unmapIfUnused() {
+    if (retired && heldFrames == 0 && !_unmapped) {
+      _unmapped = true;
+      _LibC.munmap(address.cast<Void>(), size);
+    }
+  }
+}
+
+/// A frame of a WebView published by a [LinuxWebViewFrameTap]. Linux only.
+///
+/// [pixels] is a view of the shared memory the browser painted the frame to,
+/// not a copy. The frame's memory is not written again until [release] is
+/// called, after which [pixels] must no longer be used. Frames that are not
+/// released make the tap drop the following paints once all its slots are
+/// held.
+class LinuxWebViewFrame {
+  LinuxWebViewFrame._(
+    this._tap,
+    this._buffer,
+    this._slot, {
+    required this.sequence,
+    required this.width,
+    required this.height,
+    required this.stride,
+    required this.dirtyRects,
+    required this.droppedFrames,
+    required this.pixels,
+  });
+
+  final LinuxWebViewFrameTap _tap;
+  final _FrameTapBuffer _buffer;
+  final int _slot;
+  bool _released = false;
+
+  /// The number of the browser's paint this frame comes from, counting from
+  /// the subscription. Skips the paints that were decimated or dropped.
+  final int sequence;
+
+  final int width;
+  final int height;
+
+  /// The number of bytes between two rows of [pixels].
+  final int stride;
+
+  /// The regions in pixels that differ from the previous frame of the tap.
+  /// The whole frame for the first frame and after a resize.
+  final List<Rect> dirtyRects;
+
+  /// The number of paints dropped just before this frame because all the
+  /// slots were held.
+  final int droppedFrames;
+
+  /// The BGRA pixels of the frame, top row first, [stride] bytes per row.
+  final Uint8List pixels;
+
+  /// Gives the frame's memory back to the tap. Calling it again does nothing.
+  void release() {
+    if (_released) return;
+    _released = true;
+    _tap._release(_buffer, _slot);
+  }
+}
+
+/// Streams the frames painted by the browser of a WebView through shared
+/// memory, without copying them into Dart. Linux only.
+///
+/// Created by [WebViewLinuxPlatformController.tapFrames]. A WebView keeps
+/// painting while it has a frame tap, even when it is hidden or headless.
+/// Popups such as `<select>` lists are not included in the frames.
+class LinuxWebViewFrameTap {
+  LinuxWebViewFrameTap._(this._webviewId, this._tapId);
+
+  static final Map<int, LinuxWebViewFrameTap> _taps =
+      <int, LinuxWebViewFrameTap>{};
+  static int _nextTapId = 0;
+
+  final int _webviewId;
+  final int _tapId;
+  final StreamController<LinuxWebViewFrame> _frames =
+      StreamController<LinuxWebViewFrame>();
+  _FrameTapBuffer? _buffer;
+  bool _cancelled = false;
+
+  /// The frames in the order they were painted. Frames delivered while the
+  /// stream is paused are buffered and keep holding their slots.
+  Stream<LinuxWebViewFrame> get frames => _frames.stream;
+
+  /// An internal method that users should not use. Use
+  /// [WebViewLinuxPlatformController.tapFrames] instead.
+  static Future<LinuxWebViewFrameTap> subscribe(
+      int webviewId, int decimation, int slotCount) async {
+    final LinuxWebViewFrameTap tap =
+        LinuxWebViewFrameTap._(webviewId, _nextTapId++);
+    // Registered first, since frames may come before the response.
+    _taps[tap._tapId] = tap;
+    try {
+      await (await LinuxWebViewPlugin.channel)
+          .invokeMethod<void>('subscribeFrames', <String, dynamic>{
+        'webviewId': webviewId,
+        'tapId': tap._tapId,
+        'slotCount': slotCount,
+        'decimation': decimation,
+      });
+    } catch (_) {
+      tap._close();
+      rethrow;
+    }
+    return tap;
+  }
+
+  /// An internal method that users should not use. Handles the
+  /// `onFrameTapped` method calls coming from the native side.
+  static void onFrameTapped(Map<dynamic, dynamic> arguments) {
+    final LinuxWebViewFrameTap? tap = _taps[arguments['tapId'] as int];
+    if (tap == null) {
+      // Sent before the tap was cancelled. The native tap is gone with its
+      // slots, but a new buffer's descriptor must still be closed.
+      final int? fd = arguments['fd'] as int?;
+      if (fd != null) {
+        _LibC.close(fd);
+      }
+      return;
+    }
+    tap._onFrame(arguments);
+  }
+
+  /// Stops the tap. The frames not released yet stay valid until they are.
+  Future<void> cancel() async {
+    if (_cancelled) return;
+    _close();
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod<void>('unsubscribeFrames', <String, dynamic>{
+      'webviewId': _webviewId,
+    });
+  }
+
+  void _close() {
+    _cancelled = true;
+    _taps.remove(_tapId);
+    _retireBuffer();
+    _frames.close();
+  }
+
+  void _retireBuffer() {
+    final _FrameTapBuffer? buffer = _buffer;
+    if (buffer != null) {
+      buffer.retired = true;
+      buffer.unmapIfUnused();
+      _buffer = null;
+    }
+  }
+
+  void _onFrame(Map<dynamic, dynamic> arguments) {
+    final int generation = arguments['generation'] as int;
+    final int slot = arguments['slot'] as int;
+    final int? fd = arguments['fd'] as int?;
+    if (fd != null) {
+      _retireBuffer();
+      _buffer = _FrameTapBuffer.map(
+          generation, fd, arguments['bufferSize'] as int);
+    }
+    final _FrameTapBuffer? buffer = _buffer;
+    if (buffer == null || buffer.generation != generation) {
+      // The buffer could not be mapped.
+      _sendRelease(generation, slot);
+      return;
+    }
+
+    final int height = arguments['height'] as int;
+    final int stride = arguments['stride'] as int;
+    final Int32List rects = arguments['dirtyRects'] as Int32List;
+    final Pointer<Uint8> pixels = Pointer<Uint8>.fromAddress(
+        buffer.address.address + slot * (arguments['slotSize'] as int));
+    buffer.heldFrames++;
+    _frames.add(LinuxWebViewFrame._(
+      this,
+      buffer,
+      slot,
+      sequence: arguments['sequence'] as int,
+      width: arguments['width'] as int,
+      height: height,
+      stride: stride,
+      dirtyRects: <Rect>[
+        for (int i = 0; i + 3 < rects.length; i += 4)
+          Rect.fromLTWH(rects[i].toDouble(), rects[i + 1].toDouble(),
+              rects[i + 2].toDouble(), rects[i + 3].toDouble()),
+      ],
+      droppedFrames: arguments['droppedFrames'] as int,
+      pixels: pixels.asTypedList(stride * height),
+    ));
+  }
+
+  void _release(_FrameTapBuffer buffer, int slot) {
+    buffer.heldFrames--;
+    buffer.unmapIfUnused();
+    if (!_cancelled && !buffer.retired) {
+      _sendRelease(buffer.generation, slot);
+    }
+  }
+
+  Future<void> _sendRelease(int generation, int slot) async {
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod<void>('releaseTappedFrame', <String, dynamic>{
+      'webviewId': _webviewId,
+      'generation': generation,
+      'slot': slot,
+    });
+  }
+}
@@ -42,6 +42,7 @@ import 'instance_manager.dart';
 import 'linux_webview_plugin.dart';
 import 'logging.dart';
 import 'webview_linux_cookie_manager.dart';
+import 'webview_linux_frame_tap.dart';
 import 'cef_types.dart';
 import 'native_key_code.dart';
 import 'windows_key_code.dart';
@@ -55,11 +56,33 @@ class WebViewLinuxWidget extends StatefulWidget {
     required this.callbacksHandler,
     required this.javascriptChannelRegistry,
     this.onWebViewPlatformCreated,
+    this.externalBeginFrame = false,
+    this.snapshotKey,
   }) : super(key: key);
 
   final int initialWidth;
   final int initialHeight;
 
+  /// Whether the browser paints only when Flutter produces a frame, instead of
+  /// on its own timer, which is unrelated to Flutter's frame clock.
+  ///
+  /// A begin frame is sent to the browser at the start of each Flutter frame,
+  /// so that the browser produces at most one frame per Flutter frame and
+  /// Flutter shows each of them. This cannot be changed after the WebView is
+  /// created. [WebViewLinuxPlatformController.setFrameRate] makes such a
+  /// WebView skip the begin frames that come sooner than its frame rate
+  /// allows.
+  final bool externalBeginFrame;
+
+  /// The key under which the snapshot of the last frame of this WebView is
+  /// stored in the directory set by [LinuxWebViewPlugin.setSnapshotDirectory].
+  ///
+  /// The WebView shows the snapshot stored under this key by the previous run
+  /// of the application until the browser paints for the first time. Each
+  /// WebView shown at the same time should have its own key. If null, the
+  /// WebView has no snapshot.
+  final String? snapshotKey;
+
   /// Initial parameters used to setup the WebView.
   ///
   /// Most of the [WebView](https://pub.dev/documentation/webview_flutter/3.0.4/webview_flutter/WebView-class.html)'s
@@ -88,16 +111,23 @@ class WebViewLinuxWidget extends StatefulWidget {
   State<WebViewLinuxWidget> createState() => _WebViewLinuxWidgetState();
 }
 
-class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
+class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget>
+    with _BrowserInputHandler<WebViewLinuxWidget> {
   static const kTextureUninitialized = 0;
 
   late final WebViewLinuxPlatformController _controller;
   int _textureId = kTextureUninitialized;
 
-  /// The [PointerEvent.buttons] saved for future comparison of differences.
-  int _prevButtons = 0;
+  @override
+  WebViewLinuxPlatformController get _inputController => _controller;
 
-  final FocusNode _focusNode = FocusNode();
+  /// The textures of the tiles of a browser larger than a texture can hold,
+  /// laid out in a browser of [_tiledBrowserSize]. Null if the browser is
+  /// drawn to [_textureId] alone.
+  List<_TextureTile>? _tiles;
+  Size _tiledBrowserSize = Size.zero;
+
+  bool _visibilityCheckScheduled = false;
 
   @override
   void initState() {
@@ -109,9 +139,14 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
     );
 
     WebViewCookieManagerPlatform.instance ??= WebViewLinuxCookieManager();
+    _controller._atlasRegion.addListener(_onAtlasRegionChanged);
     _initController();
   }
 
+  void _onAtlasRegionChanged() {
+    setState(() {});
+  }
+
   void _initController() async {
     // set all the given cookies.
     await Future.forEach(widget.creationParams.cookies,
@@ -126,7 +161,9 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
         widget.creationParams.initialUrl,
         widget.creationParams.backgroundColor,
         widget.initialWidth,
-        widget.initialHeight);
+        widget.initialHeight,
+        externalBeginFrame: widget.externalBeginFrame,
+        snapshotKey: widget.snapshotKey);
 
     if (!mounted) {
       // this widget was disposed during WebView creation
@@ -134,6 +171,11 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
       return;
     }
 
+    final int? webviewId = _controller._webviewId;
+    if (widget.externalBeginFrame && webviewId != null) {
+      _ExternalBeginFrameScheduler.instance.add(webviewId);
+    }
+
     setState(() {
       _textureId = textureId ?? kTextureUninitialized;
     });
@@ -142,6 +184,8 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
       widget.onWebViewPlatformCreated!(_controller);
     }
 
+    _scheduleVisibilityCheck();
+
     // resize the browser when the widget is rendered
     WidgetsBinding.instance.addPostFrameCallback((_) {
       if (!mounted) return;
@@ -151,13 +195,119 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
       }
 
       log.fine('resize: context.size: ${context.size}');
-      _controller._resize(
+      _resizeBrowser(
           context.size!.width.toInt(), context.size!.height.toInt());
     });
   }
 
+  /// Resizes the browser, and shows the tiles it is split into if it has
+  /// become larger than a texture can hold.
+  Future<void> _resizeBrowser(int width, int height) async {
+    final List<_TextureTile>? tiles = await _controller._resize(width, height);
+    if (!mounted || (tiles == null && _tiles == null)) return;
+    setState(() {
+      _tiles = tiles;
+      _tiledBrowserSize = Size(width.toDouble(), height.toDouble());
+    });
+  }
+
+  /// Lays out the tile textures, scaled from the browser to the widget.
+  Widget _buildTiles(List<_TextureTile> tiles) {
+    return LayoutBuilder(
+        builder: (BuildContext context, BoxConstraints constraints) {
+      final double scaleX = constraints.maxWidth / _tiledBrowserSize.width;
+      final double scaleY = constraints.maxHeight / _tiledBrowserSize.height;
+      return Stack(
+        children: <Widget>[
+          for (final _TextureTile tile in tiles)
+            Positioned(
+              left: tile.x * scaleX,
+              top: tile.y * scaleY,
+              width: tile.width * scaleX,
+              height: tile.height * scaleY,
+              child: Texture(textureId: tile.textureId),
+            ),
+        ],
+      );
+    });
+  }
+
+  /// Shows the region of the texture atlas the browser is drawn to, scaled
+  /// from the browser to the widget. The rest of the atlas is clipped out.
+  Widget _buildAtlasRegion(_AtlasRegion region) {
+    return LayoutBuilder(
+        builder: (BuildContext context, BoxConstraints constraints) {
+      final Size browserSize = _controller._browserSize;
+      final double scaleX = constraints.maxWidth / browserSize.width;
+      final double scaleY = constraints.maxHeight / browserSize.height;
+      return ClipRect(
+        child: Stack(
+          children: <Widget>[
+            Positioned(
+              left: -region.x * scaleX,
+              top: -region.y * scaleY,
+              width: region.atlasWidth * scaleX,
+              height: region.atlasHeight * scaleY,
+              child: Texture(textureId: region.textureId),
+            ),
+          ],
+        ),
+      );
+    });
+  }
+
+  /// Checks whether the WebView is visible after every frame, which does not
+  /// schedule frames by itself. Nothing can change the visibility without a
+  /// new frame.
+  void _scheduleVisibilityCheck() {
+    if (_visibilityCheckScheduled) return;
+    _visibilityCheckScheduled = true;
+    WidgetsBinding.instance.addPostFrameCallback((_) {
+      _visibilityCheckScheduled = false;
+      if (!mounted) return;
+      _controller._setWidgetVisible(_isVisible());
+      _scheduleVisibilityCheck();
+    });
+  }
+
+  /// Returns whether any part of the WebView is on the screen, i.e. it is not
+  /// offstage, under another route, or clipped out by the scrollable
+  /// viewports it is in.
+  bool _isVisible() {
+    if (!TickerMode.of(context)) return false;
+    final RenderObject? renderObject = context.findRenderObject();
+    if (renderObject is! RenderBox ||
+        !renderObject.attached ||
+        !renderObject.hasSize) {
+      return false;
+    }
+
+    Rect globalBounds(RenderBox box) => MatrixUtils.transformRect(
+        box.getTransformTo(null), Offset.zero & box.size);
+
+    Rect visibleRect = globalBounds(renderObject);
+    final Size? screenSize = MediaQuery.maybeOf(context)?.size;
+    if (screenSize != null) {
+      visibleRect = visibleRect.intersect(Offset.zero & screenSize);
+    }
+    RenderObject? ancestor = renderObject.parent as RenderObject?;
+    while (ancestor != null) {
+      if (ancestor is RenderOffstage && ancestor.offstage) return false;
+      if (ancestor is RenderBox && ancestor is RenderAbstractViewport) {
+        visibleRect = visibleRect.intersect(globalBounds(ancestor));
+      }
+      ancestor = ancestor.parent as RenderObject?;
+    }
+    return visibleRect.width > 0 && visibleRect.height > 0;
+  }
+
   @override
   void dispose() {
+    final int? webviewId = _controller._webviewId;
+    if (widget.externalBeginFrame && webviewId != null) {
+      _ExternalBeginFrameScheduler.instance.remove(webviewId);
+    }
+    _controller._atlasRegion.removeListener(_onAtlasRegionChanged);
     _controller._dispose();
     super.dispose();
   }
@@ -168,32 +318,13 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
       return const SizedBox.expand();
     }
 
-    final Widget texture = Texture(textureId: _textureId);
-
-    Widget webviewInputHandler(Widget screen) {
-      return KeyboardListener(
-        focusNode: _focusNode,
-        autofocus: true, // necessary
-        onKeyEvent: _onKeyEvent,
-        child: MouseRegion(
-          onExit: _onExit,
-          child: _SerialTapGestureDetector(
-            onSerialTapDown: _onSerialTapDown,
-            child: Listener(
-              onPointerDown: (PointerDownEvent event) {
-                log.fine(
-                    'onPointerDown: ${event.toString()}, buttons=${event.buttons}');
-              },
-              onPointerUp: _onPointerUp,
-              onPointerSignal: _onPointerSignal,
-              onPointerMove: _onPointerMove,
-              onPointerHover: _onPointerHover,
-              child: screen,
-            ),
-          ),
-        ),
-      );
-    }
+    final _AtlasRegion? atlasRegion = _controller._atlasRegion.value;
+    final List<_TextureTile>? tiles = _tiles;
+    final Widget texture = atlasRegion != null
+        ? _buildAtlasRegion(atlasRegion)
+        : tiles != null
+            ? _buildTiles(tiles)
+            : Texture(textureId: _textureId);
 
     bool onSizeChangedLayoutNotification(
         SizeChangedLayoutNotification notification) {
@@ -202,18 +333,193 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
         return true;
       }
       log.fine('resize: ${context.size}');
-      _controller._resize(
+      _resizeBrowser(
           context.size!.width.toInt(), context.size!.height.toInt());
       return true;
     }
 
     Widget resizeNotifier = NotificationListener<SizeChangedLayoutNotification>(
       onNotification: onSizeChangedLayoutNotification,
-      child: SizeChangedLayoutNotifier(child: webviewInputHandler(texture)),
+      child: SizeChangedLayoutNotifier(
+          child: _buildInputHandler(texture, autofocus: true)),
     );
 
     return resizeNotifier;
   }
+}
+
+/// Shows the browser of a WebView again, e.g. as a thumbnail, without
+/// creating a second browser. Linux only.
+///
+/// The mirror is drawn on the GPU from the textures of the browser of
+/// [controller], scaled to the size of this widget, so the page is rendered
+/// and uploaded once however many mirrors show it. The keyboard and pointer
+/// events of the mirror are sent to that browser, with the positions scaled to
+/// its size. The browser keeps painting while it has mirrors, even if its own
+/// widget is hidden. A mirror of a disposed WebView keeps its last frame.
+class WebViewLinuxMirror extends StatefulWidget {
+  const WebViewLinuxMirror({Key? key, required this.controller})
+      : super(key: key);
+
+  /// The controller of the WebView to show, which must not be headless.
+  final WebViewLinuxPlatformController controller;
+
+  @override
+  State<WebViewLinuxMirror> createState() => _WebViewLinuxMirrorState();
+}
+
+class _WebViewLinuxMirrorState extends State<WebViewLinuxMirror>
+    with _BrowserInputHandler<WebViewLinuxMirror> {
+  /// The ID of the mirror texture on the native side, given by the
+  /// [InstanceManager] of the WebViews.
+  int? _mirrorId;
+  int? _textureId;
+  Size _size = Size.zero;
+
+  @override
+  WebViewLinuxPlatformController get _inputController => widget.controller;
+
+  @override
+  Offset _toBrowserPosition(Offset localPosition) {
+    final Size browserSize = widget.controller._browserSize;
+    if (browserSize.isEmpty || _size.isEmpty) return localPosition;
+    return Offset(localPosition.dx * browserSize.width / _size.width,
+        localPosition.dy * browserSize.height / _size.height);
+  }
+
+  @override
+  void initState() {
+    super.initState();
+    // The mirror is created at the size of the widget, known after layout.
+    WidgetsBinding.instance.addPostFrameCallback((_) => _create());
+  }
+
+  Future<void> _create() async {
+    final int? webviewId = widget.controller._webviewId;
+    if (!mounted || context.size == null || webviewId == null) return;
+    final Size size = context.size!;
+    if (size.isEmpty) return;
+    final int? mirrorId =
+        WebViewLinuxPlatformController.instanceManager.tryAddInstance(this);
+    if (mirrorId == null) return;
+    _mirrorId = mirrorId;
+    _size = size;
+
+    log.fine('createBrowser called. mirrorId: $mirrorId of $webviewId');
+    final int? textureId = await (await LinuxWebViewPlugin.channel)
+        .invokeMethod('createBrowser', <String, dynamic>{
+      'webviewId': mirrorId,
+      'mirrorOf': webviewId,
+      'initialUrl': '',
+      'backgroundColor': Uint8List.fromList([]),
+      'initialWidth': size.width.ceil(),
+      'initialHeight': size.height.ceil(),
+      'headless': false,
+      'externalBeginFrame': false,
+    });
+    if (!mounted) {
+      // this widget was disposed during the mirror creation
+      _dispose();
+      return;
+    }
+    setState(() {
+      _textureId = textureId;
+    });
+  }
+
+  Future<void> _resize(Size size) async {
+    final int? mirrorId = _mirrorId;
+    if (mirrorId == null || size.isEmpty || size == _size) return;
+    _size = size;
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod('resize', <String, dynamic>{
+      'webviewId': mirrorId,
+      'width': size.width.ceil(),
+      'height': size.height.ceil(),
+    });
+  }
+
+  Future<void> _dispose() async {
+    final int? mirrorId = _mirrorId;
+    if (mirrorId == null) return;
+    _mirrorId = null;
+    log.fine('disposeBrowser called. mirrorId: $mirrorId');
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod('disposeBrowser', <String, dynamic>{
+      'webviewId': mirrorId,
+    });
+    WebViewLinuxPlatformController.instanceManager.removeInstance(this);
+  }
+
+  @override
+  void dispose() {
+    if (_textureId != null) {
+      _dispose();
+    }
+    super.dispose();
+  }
+
+  @override
+  Widget build(BuildContext context) {
+    final int? textureId = _textureId;
+    if (textureId == null) {
+      return const SizedBox.expand();
+    }
+
+    return NotificationListener<SizeChangedLayoutNotification>(
+      onNotification: (SizeChangedLayoutNotification notification) {
+        if (context.size != null) {
+          _resize(context.size!);
+        }
+        return true;
+      },
+      child: SizeChangedLayoutNotifier(
+          child: _buildInputHandler(Texture(textureId: textureId),
+              autofocus: false)),
+    );
+  }
+}
+
+/// Sends the keyboard and pointer events of a widget showing a browser to the
+/// browser of [_inputController].
+mixin _BrowserInputHandler<T extends StatefulWidget> on State<T> {
+  /// The [PointerEvent.buttons] saved for future comparison of differences.
+  int _prevButtons = 0;
+
+  final FocusNode _focusNode = FocusNode();
+
+  WebViewLinuxPlatformController get _inputController;
+
+  /// Converts a position in the widget to the browser's coordinates.
+  Offset _toBrowserPosition(Offset localPosition) => localPosition;
+
+  /// Wraps [screen] in the listeners that send the keyboard and pointer events
+  /// to the browser. [autofocus] is necessary for the WebView widget to get
+  /// the keyboard events before it is clicked.
+  Widget _buildInputHandler(Widget screen, {required bool autofocus}) {
+    return KeyboardListener(
+      focusNode: _focusNode,
+      autofocus: autofocus,
+      onKeyEvent: _onKeyEvent,
+      child: MouseRegion(
+        onExit: _onExit,
+        child: _SerialTapGestureDetector(
+          onSerialTapDown: _onSerialTapDown,
+          child: Listener(
+            onPointerDown: (PointerDownEvent event) {
+              log.fine(
+                  'onPointerDown: ${event.toString()}, buttons=${event.buttons}');
+            },
+            onPointerUp: _onPointerUp,
+            onPointerSignal: _onPointerSignal,
+            onPointerMove: _onPointerMove,
+            onPointerHover: _onPointerHover,
+            child: screen,
+          ),
+        ),
+      ),
+    );
+  }
 
   void _onKeyEvent(KeyEvent event) {
     log.fine(
@@ -264,11 +570,11 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
           ? CefKeyEventType.KEYEVENT_RAWKEYDOWN.value
           : CefKeyEventType.KEYEVENT_KEYDOWN.value;
 
-      _controller._sendKey(keyDownType, modifiers, windowsKeyCode.code,
+      _inputController._sendKey(keyDownType, modifiers, windowsKeyCode.code,
           nativeKeyCode, isSystemKey, character, unmodifiedCharacter);
 
       if (!isControlDown && character != 0) {
-        _controller._sendKey(
+        _inputController._sendKey(
             CefKeyEventType.KEYEVENT_CHAR.value,
             modifiers,
             windowsKeyCode.code,
@@ -279,7 +585,7 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
       }
     } else if (event is KeyUpEvent) {
       log.fine('KeyUpEvent: $event');
-      _controller._sendKey(
+      _inputController._sendKey(
           CefKeyEventType.KEYEVENT_KEYUP.value,
           modifiers,
           windowsKeyCode.code,
@@ -293,8 +599,9 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
   void _onExit(PointerExitEvent event) {
     log.finer('onExit: ${event.toString()}, buttons=${event.buttons}');
     int modifiers = _getModifiers(event.buttons);
-    _controller._sendMouseMove(event.localPosition.dx.toInt(),
-        event.localPosition.dy.toInt(), modifiers, true);
+    final Offset position = _toBrowserPosition(event.localPosition);
+    _inputController._sendMouseMove(
+        position.dx.toInt(), position.dy.toInt(), modifiers, true);
   }
 
   void _onSerialTapDown(SerialTapDownDetails details) {
@@ -316,10 +623,11 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
     List<CefMouseButtonType> buttons =
         _getButtonsStateChangedToDown(details.buttons, _prevButtons);
 
+    final Offset position = _toBrowserPosition(details.localPosition);
     for (CefMouseButtonType button in buttons) {
-      _controller._sendMouseClick(
-          details.localPosition.dx.toInt(),
-          details.localPosition.dy.toInt(),
+      _inputController._sendMouseClick(
+          position.dx.toInt(),
+          position.dy.toInt(),
           modifiers,
           button.value,
           false,
@@ -336,6 +644,7 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
         '  buttons: ${event.buttons}');
 
     int modifiers = _getModifiers(event.buttons);
+    final Offset position = _toBrowserPosition(event.localPosition);
 
     // If other mouse buttons are already pressed, a mouse up/down event is
     // detected by Listener.onPointerMove, not by Listener.onPointerUp/Down
@@ -346,9 +655,9 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
           _getButtonsStateChangedToUp(event.buttons, _prevButtons);
 
       for (CefMouseButtonType button in buttonsStateChangedToDown) {
-        _controller._sendMouseClick(
-            event.localPosition.dx.toInt(),
-            event.localPosition.dy.toInt(),
+        _inputController._sendMouseClick(
+            position.dx.toInt(),
+            position.dy.toInt(),
             modifiers,
             button.value,
             false,
@@ -358,13 +667,13 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
       }
 
       for (CefMouseButtonType button in buttonsStateChangedToUp) {
-        _controller._sendMouseClick(event.localPosition.dx.toInt(),
-            event.localPosition.dy.toInt(), modifiers, button.value, true, 1);
+        _inputController._sendMouseClick(position.dx.toInt(),
+            position.dy.toInt(), modifiers, button.value, true, 1);
       }
     }
 
-    _controller._sendMouseMove(event.localPosition.dx.toInt(),
-        event.localPosition.dy.toInt(), modifiers, false);
+    _inputController._sendMouseMove(
+        position.dx.toInt(), position.dy.toInt(), modifiers, false);
 
     _prevButtons = event.buttons; // save it for mouseUp
   }
@@ -378,10 +687,11 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
     List<CefMouseButtonType> buttons =
         _getButtonsStateChangedToUp(event.buttons, _prevButtons);
     int modifiers = _getModifiers(event.buttons);
+    final Offset position = _toBrowserPosition(event.localPosition);
 
     for (CefMouseButtonType button in buttons) {
-      _controller._sendMouseClick(event.localPosition.dx.toInt(),
-          event.localPosition.dy.toInt(), modifiers, button.value, true, 1);
+      _inputController._sendMouseClick(position.dx.toInt(),
+          position.dy.toInt(), modifiers, button.value, true, 1);
     }
 
     _prevButtons = event.buttons;
@@ -393,8 +703,9 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
         '  kind: ${event.kind}\n'
         '  buttons: ${event.buttons}');
     int modifiers = _getModifiers(event.buttons);
-    _controller._sendMouseMove(event.localPosition.dx.toInt(),
-        event.localPosition.dy.toInt(), modifiers, false);
+    final Offset position = _toBrowserPosition(event.localPosition);
+    _inputController._sendMouseMove(
+        position.dx.toInt(), position.dy.toInt(), modifiers, false);
 
     _prevButtons = event.buttons; // save it for mouseUp
   }
@@ -408,10 +719,11 @@ class _WebViewLinuxWidgetState extends State<WebViewLinuxWidget> {
           .register(event, (PointerSignalEvent event) {});
 
       int modifiers = _getModifiers(event.buttons);
+      final Offset position = _toBrowserPosition(event.localPosition);
 
-      _controller._sendMouseWheel(
-          event.localPosition.dx.toInt(),
-          event.localPosition.dy.toInt(),
+      _inputController._sendMouseWheel(
+          position.dx.toInt(),
+          position.dy.toInt(),
           modifiers,
           -event.scrollDelta.dx.toInt(),
           -event.scrollDelta.dy.toInt());
@@ -611,6 +923,123 @@ class _JavascriptResult {
   });
 }
 
+/// A texture showing a part of a browser larger than a texture can hold, at
+/// ([x], [y]) of the browser in pixels.
+class _TextureTile {
+  final int textureId;
+  final int x;
+  final int y;
+  final int width;
+  final int height;
+
+  _TextureTile({
+    required this.textureId,
+    required this.x,
+    required this.y,
+    required this.width,
+    required this.height,
+  });
+}
+
+/// The region of a texture atlas a small browser is drawn to, at ([x], [y]) of
+/// an [atlasWidth] x [atlasHeight] atlas in pixels. The region has the size of
+/// the browser.
+class _AtlasRegion {
+  final int textureId;
+  final int x;
+  final int y;
+  final int atlasWidth;
+  final int atlasHeight;
+
+  _AtlasRegion({
+    required this.textureId,
+    required this.x,
+    required this.y,
+    required this.atlasWidth,
+    required this.atlasHeight,
+  });
+
+  factory _AtlasRegion.fromMap(Map<Object?, Object?> map) {
+    return _AtlasRegion(
+      textureId: map['textureId']! as int,
+      x: map['x']! as int,
+      y: map['y']! as int,
+      atlasWidth: map['atlasWidth']! as int,
+      atlasHeight: map['atlasHeight']! as int,
+    );
+  }
+}
+
+/// Sends begin frames to the browsers of the WebViews created with
+/// [WebViewLinuxWidget.externalBeginFrame].
+///
+/// A begin frame is sent at the start of every Flutter frame. The frame the
+/// browser paints makes its texture available, which schedules the next
+/// Flutter frame, so an animating page stays locked to Flutter's frame clock.
+/// Once Flutter has been idle for a couple of frames, a timer keeps sending
+/// begin frames at [_idleInterval], since a browser receiving none would never
+/// paint the change that wakes Flutter up again. The native side drops the
+/// begin frames that come sooner than the frame rate of a WebView, so this
+/// sends them at Flutter's rate regardless.
+class _ExternalBeginFrameScheduler {
+  _ExternalBeginFrameScheduler._();
+
+  static final _ExternalBeginFrameScheduler instance =
+      _ExternalBeginFrameScheduler._();
+
+  static const Duration _idleInterval = Duration(microseconds: 16667);
+
+  final Set<int> _webviewIds = <int>{};
+  bool _frameCallbackAdded = false;
+  Timer? _idleTimer;
+
+  /// The time since the begin frame sent by the last Flutter frame.
+  final Stopwatch _sinceLastFrame = Stopwatch();
+
+  void add(int webviewId) {
+    _webviewIds.add(webviewId);
+    if (!_frameCallbackAdded) {
+      _frameCallbackAdded = true;
+      // Persistent frame callbacks cannot be removed, so it does nothing while
+      // no WebView needs begin frames.
+      WidgetsBinding.instance.addPersistentFrameCallback(_onFrame);
+    }
+    _idleTimer ??= Timer.periodic(_idleInterval, (_) => _onIdleTimer());
+    _sendBeginFrame();
+  }
+
+  void remove(int webviewId) {
+    _webviewIds.remove(webviewId);
+    if (_webviewIds.isEmpty) {
+      _idleTimer?.cancel();
+      _idleTimer = null;
+    }
+  }
+
+  void _onFrame(Duration timeStamp) {
+    if (_webviewIds.isEmpty) return;
+    _sinceLastFrame
+      ..reset()
+      ..start();
+    _sendBeginFrame();
+  }
+
+  void _onIdleTimer() {
+    if (_sinceLastFrame.isRunning &&
+        _sinceLastFrame.elapsed < _idleInterval * 2) {
+      return;
+    }
+    _sendBeginFrame();
+  }
+
+  Future<void> _sendBeginFrame() async {
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod<void>('sendExternalBeginFrame', <String, dynamic>{
+      'webviewIds': _webviewIds.toList(),
+    });
+  }
+}
+
 /// To operate in the int32 range for CefProcessMessage to carry int on the C++ side.
 typedef _JsRunId = int;
 
@@ -695,6 +1124,17 @@ class WebViewLinuxPlatformController extends WebViewPlatformController {
         controller.callbacksHandler
             .onPageStarted(call.arguments['url'] as String);
         return null;
+      case 'onFrameTapped':
+        LinuxWebViewFrameTap.onFrameTapped(
+            call.arguments as Map<dynamic, dynamic>);
+        return null;
+      case 'onAtlasRegionChanged':
+        // Moved to make room for another browser in the same atlas.
+        WebViewLinuxPlatformController controller =
+            _getControllerByWebviewId(call.arguments['webviewId'] as int);
+        controller._atlasRegion.value = _AtlasRegion.fromMap(
+            call.arguments['region'] as Map<Object?, Object?>);
+        return null;
       case 'onWebResourceError':
         WebViewLinuxPlatformController controller =
             _getControllerByWebviewId(call.arguments['webviewId']);
@@ -731,16 +1171,69 @@ class WebViewLinuxPlatformController extends WebViewPlatformController {
       // the comment in the WebViewPlatformController class.
       : super(callbacksHandler);
 
+  /// Creates a headless WebView, which has no texture and is never drawn, for
+  /// background work such as scraping and automation.
+  ///
+  /// Page events are delivered to [callbacksHandler] as for a WebView widget.
+  /// [width] and [height] give the size of the page's layout viewport. Call
+  /// [dispose] when the WebView is no longer needed.
+  static Future<WebViewLinuxPlatformController> createHeadless({
+    required WebViewPlatformCallbacksHandler callbacksHandler,
+    String? initialUrl,
+    int width = 1280,
+    int height = 720,
+  }) async {
+    final CreationParams creationParams =
+        CreationParams(initialUrl: initialUrl);
+    final WebViewLinuxPlatformController controller =
+        WebViewLinuxPlatformController(
+      callbacksHandler: callbacksHandler,
+      javascriptChannelRegistry:
+          JavascriptChannelRegistry(<JavascriptChannel>{}),
+      creationParams: creationParams,
+    );
+    await controller._create(initialUrl, null, width, height, headless: true);
+    return controller;
+  }
+
   final WebViewPlatformCallbacksHandler callbacksHandler;
   final JavascriptChannelRegistry javascriptChannelRegistry;
   int? _webviewId;
 
+  /// The visibility set by [setVisible].
+  bool _visible = true;
+
+  /// The visibility of the widget reported after each frame.
+  bool _widgetVisible = true;
+
+  bool _muteAudioWhenHidden = false;
+
+  /// The last visibility sent to the native side, which starts visible.
+  bool _sentVisible = true;
+  bool _sentMuteAudio = false;
+
+  LinuxWebViewFrameTap? _frameTap;
+
+  /// The size of the browser, to which the positions on its mirrors are
+  /// scaled.
+  Size _browserSize = Size.zero;
+
+  /// The region of a texture atlas the browser is drawn to, if it is drawn to
+  /// an atlas. See [LinuxWebViewPlugin.setTextureAtlasEnabled].
+  final ValueNotifier<_AtlasRegion?> _atlasRegion =
+      ValueNotifier<_AtlasRegion?>(null);
+
   /// create a browser.
   Future<int?> _create(String? initialUrl, Color? backgroundColor,
-      int initialWidth, int initialHeight) async {
+      int initialWidth, int initialHeight,
+      {bool headless = false,
+      bool externalBeginFrame = false,
+      String? snapshotKey}) async {
     final int? webviewId = instanceManager.tryAddInstance(this);
     if (webviewId != null) {
       _webviewId = webviewId;
+      _browserSize =
+          Size(initialWidth.toDouble(), initialHeight.toDouble());
       log.fine('createBrowser called. webviewId: $webviewId');
       final int? textureId = await (await LinuxWebViewPlugin.channel)
           .invokeMethod('createBrowser', <String, dynamic>{
@@ -756,6 +1249,9 @@ class WebViewLinuxPlatformController extends WebViewPlatformController {
             : Uint8List.fromList([]),
         'initialWidth': initialWidth,
         'initialHeight': initialHeight,
+        'headless': headless,
+        'externalBeginFrame': externalBeginFrame,
+        'snapshotKey': snapshotKey ?? '',
       });
       log.fine('return from createBrowser: textureId=$textureId');
 
@@ -764,11 +1260,18 @@ class WebViewLinuxPlatformController extends WebViewPlatformController {
     return null;
   }
 
+  /// Closes the browser of a WebView created by [createHeadless].
+  ///
+  /// A WebView widget closes its browser by itself when it is disposed.
+  Future<void> dispose() => _dispose();
+
   /// close the browser
   Future<void> _dispose() async {
     final int? webviewId = instanceManager.getInstanceId(this);
     log.fine('disposeBrowser called. webviewId: $webviewId');
     if (webviewId != null) {
+      await _frameTap?.cancel();
+      _frameTap = null;
       await (await LinuxWebViewPlugin.channel)
           .invokeMethod('disposeBrowser', <String, dynamic>{
         'webviewId': webviewId,
@@ -858,17 +1361,38 @@ class WebViewLinuxPlatformController extends WebViewPlatformController {
   }
 
   /// Request a browser resolution change.
-  Future<void> _resize(int width, int height) async {
+  ///
+  /// Returns the tiles the browser is drawn to if it is larger than a texture
+  /// can hold, or null if it is drawn to a single texture. A browser drawn to
+  /// a texture atlas has its region in [_atlasRegion] instead.
+  Future<List<_TextureTile>?> _resize(int width, int height) async {
     final int? webviewId = instanceManager.getInstanceId(this);
     if (webviewId == null) {
       throw 'Failed to get the webview instance';
     }
-    await (await LinuxWebViewPlugin.channel)
-        .invokeMethod('resize', <String, dynamic>{
+    _browserSize = Size(width.toDouble(), height.toDouble());
+    final Object? layout = await (await LinuxWebViewPlugin.channel)
+        .invokeMethod<Object?>('resize', <String, dynamic>{
       'webviewId': webviewId,
       'width': width,
       'height': height,
     });
+    if (layout is Map<Object?, Object?>) {
+      _atlasRegion.value = _AtlasRegion.fromMap(layout);
+      return null;
+    }
+    _atlasRegion.value = null;
+    final List<Object?>? tiles = layout as List<Object?>?;
+    return tiles?.map((Object? tile) {
+      final Map<Object?, Object?> map = tile! as Map<Object?, Object?>;
+      return _TextureTile(
+        textureId: map['textureId']! as int,
+        x: map['x']! as int,
+        y: map['y']! as int,
+        width: map['width']! as int,
+        height: map['height']! as int,
+      );
+    }).toList();
   }
 
   /// See [WebViewController.loadFile](https://pub.dev/documentation/webview_flutter/3.0.4/webview_flutter/WebViewController/loadFile.html)
@@ -1268,6 +1792,241 @@ class WebViewLinuxPlatformController extends WebViewPlatformController {
     return result;
   }
 
+  /// Sets the maximum number of frames per second the browser paints this
+  /// WebView at, from 1 to 60 (the default). Linux only.
+  ///
+  /// If [adaptive] is true, the rate is lowered step by step down to
+  /// [minFrameRate] while the page paints little, which saves CPU on mostly
+  /// static pages. The full rate is restored as soon as an input event is sent
+  /// to the WebView or a large part of it is repainted.
+  ///
+  /// For a WebView created with [WebViewLinuxWidget.externalBeginFrame], the
+  /// rate limits the begin frames the browser takes from Flutter's frames.
+  Future<void> setFrameRate(int frameRate,
+      {bool adaptive = false, int minFrameRate = 5}) async {
+    final int? webviewId = instanceManager.getInstanceId(this);
+    if (webviewId == null) {
+      throw 'Failed to get the webview instance';
+    }
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod('setFrameRate', <String, dynamic>{
+      'webviewId': webviewId,
+      'frameRate': frameRate,
+      'adaptive': adaptive,
+      'minFrameRate': minFrameRate < frameRate ? minFrameRate : frameRate,
+    });
+  }
+
+  /// Sets whether the damage reported by the browser for each paint of this
+  /// WebView is checked against the previous frame. Disabled by default.
+  /// Linux only.
+  ///
+  /// The browser often reports the whole view as dirty, e.g. after a scroll,
+  /// a CSS animation or a resize, even when most of it is unchanged. When
+  /// enabled, the dirty region is compared with a copy of the previous frame
+  /// in 64 x 64 tiles, and only the tiles that changed are uploaded. This
+  /// costs a copy of the view in memory and a comparison of each dirty pixel.
+  /// The `refinedFrames`, `unchangedFrames`, `comparedTiles` and
+  /// `unchangedTiles` counters of [getRenderCounters] tell whether it pays
+  /// off.
+  Future<void> setDamageRefinementEnabled(bool enabled) async {
+    final int? webviewId = instanceManager.getInstanceId(this);
+    if (webviewId == null) {
+      throw 'Failed to get the webview instance';
+    }
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod('setDamageRefinementEnabled', <String, dynamic>{
+      'webviewId': webviewId,
+      'enabled': enabled,
+    });
+  }
+
+  /// Sets whether this WebView is visible to the user. Linux only.
+  ///
+  /// The WebView widget already reports itself hidden while it is scrolled out
+  /// of view, offstage or under another route, and the plugin hides all
+  /// WebViews while the window is minimized. Use this method for the cases the
+  /// widget cannot detect, e.g. when it is covered by another widget.
+  ///
+  /// A hidden WebView stops painting and its renderer process runs at a lower
+  /// priority, so only the visible WebViews cost CPU. A WebView that has a
+  /// frame tap or is recorded keeps painting, but is not drawn.
+  Future<void> setVisible(bool visible) async {
+    _visible = visible;
+    await _updateVisibility();
+  }
+
+  /// Sets whether the audio of this WebView is muted while it is hidden.
+  /// Defaults to false. Linux only.
+  Future<void> setMuteAudioWhenHidden(bool mute) async {
+    _muteAudioWhenHidden = mute;
+    await _updateVisibility();
+  }
+
+  void _setWidgetVisible(bool visible) {
+    if (_widgetVisible == visible) return;
+    log.fine('widget visibility changed: $visible');
+    _widgetVisible = visible;
+    _updateVisibility();
+  }
+
+  Future<void> _updateVisibility() async {
+    final bool visible = _visible && _widgetVisible;
+    if (visible == _sentVisible && _muteAudioWhenHidden == _sentMuteAudio) {
+      return;
+    }
+    final int? webviewId = instanceManager.getInstanceId(this);
+    if (webviewId == null) {
+      // Not created yet or already disposed.
+      return;
+    }
+    _sentVisible = visible;
+    _sentMuteAudio = _muteAudioWhenHidden;
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod('setVisibility', <String, dynamic>{
+      'webviewId': webviewId,
+      'visible': visible,
+      'muteAudio': _muteAudioWhenHidden,
+    });
+  }
+
+  /// Returns the counters of the texture updates of this WebView. Linux only.
+  ///
+  /// The counters are accumulated since the WebView was created:
+  ///
+  /// * `partialUpdates`: the number of frames that updated only their dirty
+  ///   rectangles.
+  /// * `dirtyRects`: the number of dirty rectangles painted by the browser.
+  /// * `uploadedRects`: the number of rectangles uploaded to the texture after
+  ///   merging nearby and overlapping ones.
+  /// * `mergedRects`: `dirtyRects - uploadedRects`.
+  /// * `boundingBoxUpdates`: the number of frames uploaded as the single
+  ///   bounding box of their dirty rectangles.
+  /// * `uploadCallCostNs` and `uploadByteCostPs`: the measured cost of a
+  ///   texture update call in nanoseconds and of each byte in picoseconds,
+  ///   which decide when rectangles are merged.
+  /// * `frameRate`: the current frame rate of the browser. See [setFrameRate].
+  /// * `refinedFrames`: the number of paints whose damage was compared with
+  ///   the previous frame, out of which `unchangedFrames` had not changed at
+  ///   all and were not drawn. See [setDamageRefinementEnabled].
+  /// * `comparedTiles`: the number of tiles compared, out of which
+  ///   `unchangedTiles` had not changed and were left out of the upload.
+  Future<Map<String, int>> getRenderCounters() async {
+    final int? webviewId = instanceManager.getInstanceId(this);
+    if (webviewId == null) {
+      throw 'Failed to get the webview instance';
+    }
+    Map<String, int>? result = await (await LinuxWebViewPlugin.channel)
+        .invokeMapMethod<String, int>('getRenderCounters', <String, dynamic>{
+      'webviewId': webviewId,
+    });
+    return result!;
+  }
+
+  /// Returns the frame pipeline statistics of this WebView, collected while
+  /// [LinuxWebViewPlugin.setRenderStatsEnabled] is enabled. Linux only.
+  ///
+  /// Each histogram is summarized as a map with the keys `count`, `min`,
+  /// `max`, `mean`, `p50`, `p90`, `p99` and `p999`. The percentiles are
+  /// accurate to within 12.5%.
+  ///
+  /// * `paintDurationUs`: the time the browser's paints of the view take on
+  ///   the CEF UI thread, in microseconds.
+  /// * `paintIntervalUs`: the time between two paints of the view.
+  /// * `uploadedBytes`, `dirtyRects` and `uploadedRects`: the bytes, the dirty
+  ///   rectangles and the rectangles after merging, per paint.
+  /// * `gpuUploadUs`: the GPU time of the uploads of a paint. Empty if the GL
+  ///   context does not support timer queries.
+  /// * `notifyLatencyUs`: the time from a frame being published to Flutter
+  ///   being told that a new frame is available.
+  /// * `presentLatencyUs`: the time from a frame being published to Flutter
+  ///   taking it to draw.
+  /// * `frames`: not a histogram but the counters `published`, `presented`,
+  ///   `superseded` (published but replaced by a newer frame before Flutter
+  ///   took it), `skippedPaints` (painted while the WebView was hidden) and
+  ///   `deferredPaints` (held back until Flutter took the previous frame).
+  Future<Map<String, Map<String, int>>> getRenderStats() async {
+    final int? webviewId = instanceManager.getInstanceId(this);
+    if (webviewId == null) {
+      throw 'Failed to get the webview instance';
+    }
+    final MethodChannel channel = await LinuxWebViewPlugin.channel;
+    final Map<String, dynamic>? result = await channel
+        .invokeMapMethod<String, dynamic>('getRenderStats', <String, dynamic>{
+      'webviewId': webviewId,
+    });
+    return result!.map((String key, dynamic value) =>
+        MapEntry<String, Map<String, int>>(
+            key, Map<String, int>.from(value as Map<dynamic, dynamic>)));
+  }
+
+  /// Starts streaming the frames painted by the browser of this WebView to
+  /// Dart through shared memory, e.g. for OCR, thumbnails or remote display.
+  /// Linux only.
+  ///
+  /// Only every [decimation]th paint is published. The frames are written to
+  /// [slotCount] slots (1 to 8) of shared memory, and each frame holds its slot
+  /// until [LinuxWebViewFrame.release] is called. A paint that finds every
+  /// slot held is dropped, and its damage is reported with the next frame.
+  ///
+  /// The WebView keeps painting while it has a tap, even when it is hidden or
+  /// headless. Replaces the tap started before, if any. Nothing is copied for
+  /// the taps while none is active.
+  Future<LinuxWebViewFrameTap> tapFrames(
+      {int decimation = 1, int slotCount = 3}) async {
+    final int? webviewId = instanceManager.getInstanceId(this);
+    if (webviewId == null) {
+      throw 'Failed to get the webview instance';
+    }
+    await _frameTap?.cancel();
+    _frameTap = null;
+    final LinuxWebViewFrameTap tap =
+        await LinuxWebViewFrameTap.subscribe(webviewId, decimation, slotCount);
+    _frameTap = tap;
+    return tap;
+  }
+
+  /// Starts recording the paints of this WebView to the file at [path]. Linux
+  /// only.
+  ///
+  /// The file holds the damaged rectangles of each paint, written by a
+  /// background thread. A paint is dropped rather than stalling the browser
+  /// when the thread falls behind. The WebView keeps painting while it is
+  /// recorded, even when it is hidden or headless. Convert the file to a video
+  /// with the `flutter_webview_recording_convert` tool described in
+  /// `linux/README.md`.
+  ///
+  /// Throws a [PlatformException] if the file cannot be created or this
+  /// WebView is already being recorded.
+  Future<void> startRecording(String path) async {
+    final int? webviewId = instanceManager.getInstanceId(this);
+    if (webviewId == null) {
+      throw 'Failed to get the webview instance';
+    }
+    await (await LinuxWebViewPlugin.channel)
+        .invokeMethod<void>('startRecording', <String, dynamic>{
+      'webviewId': webviewId,
+      'path': path,
+    });
+  }
+
+  /// Stops the recording started by [startRecording] and waits until the file
+  /// is complete. Linux only.
+  ///
+  /// Returns the totals of the recording: `frames` written, `droppedFrames`
+  /// and the file size in `bytes`.
+  Future<Map<String, int>> stopRecording() async {
+    final int? webviewId = instanceManager.getInstanceId(this);
+    if (webviewId == null) {
+      throw 'Failed to get the webview instance';
+    }
+    Map<String, int>? result = await (await LinuxWebViewPlugin.channel)
+        .invokeMapMethod<String, int>('stopRecording', <String, dynamic>{
+      'webviewId': webviewId,
+    });
+    return result!;
+  }
+
   /// Not implemented on Linux. Will be supported in the future.
   ///
   /// See [WebViewController.scrollTo](https://pub.dev/documentation/webview_flutter/3.0.4/webview_flutter/WebViewController/scrollTo.html)
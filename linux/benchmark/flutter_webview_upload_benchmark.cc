@@ -0,0 +1,782 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measures the texture upload path of FlutterWebviewHandler::OnPaint with
+// synthetic BGRA frames and dirty-rectangle patterns, for each upload
+// strategy. See CMakeLists.txt for how to build it.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_gl_utils.h"
+#include "flutter_webview_rect_coalescer.h"
+#include "flutter_webview_render_stats.h"
+#include "flutter_webview_texture_format.h"
+#include "flutter_webview_texture_ring.h"
+#include "flutter_webview_texture_uploader.h"
+#include "flutter_webview_tile_grid.h"
+
+namespace {
+
+constexpr int kBytesPerPixel = 4;
+
+// GL call counting
+//
+// Each function below is linked with -Wl,--wrap, so the calls made by the
+// plugin code go through a __wrap_ function that counts them while a strategy
+// is being measured.
+
+bool g_counting_gl_calls = false;
+std::map<std::string, int64_t> g_gl_call_counts;
+
+void CountGLCall(const char* name) {
+  if (g_counting_gl_calls) {
+    g_gl_call_counts[name]++;
+  }
+}
+
+}  // namespace
+
+#define COUNTED_GL_FUNCTION(ret, name, params, args) \
+  extern "C" ret __real_##name params;               \
+  extern "C" ret __wrap_##name params {              \
+    CountGLCall(#name);                              \
+    return __real_##name args;                       \
+  }
+
+COUNTED_GL_FUNCTION(void,
+                    glBindBuffer,
+                    (GLenum target, GLuint buffer),
+                    (target, buffer))
+COUNTED_GL_FUNCTION(void,
+                    glBindFramebuffer,
+                    (GLenum target, GLuint framebuffer),
+                    (target, framebuffer))
+COUNTED_GL_FUNCTION(void,
+                    glBindTexture,
+                    (GLenum target, GLuint texture),
+                    (target, texture))
+COUNTED_GL_FUNCTION(void,
+                    glBlitFramebuffer,
+                    (GLint src_x0,
+                     GLint src_y0,
+                     GLint src_x1,
+                     GLint src_y1,
+                     GLint dst_x0,
+                     GLint dst_y0,
+                     GLint dst_x1,
+                     GLint dst_y1,
+                     GLbitfield mask,
+                     GLenum filter),
+                    (src_x0,
+                     src_y0,
+                     src_x1,
+                     src_y1,
+                     dst_x0,
+                     dst_y0,
+                     dst_x1,
+                     dst_y1,
+                     mask,
+                     filter))
+COUNTED_GL_FUNCTION(void,
+                    glBufferData,
+                    (GLenum target,
+                     GLsizeiptr size,
+                     const void* data,
+                     GLenum usage),
+                    (target, size, data, usage))
+COUNTED_GL_FUNCTION(void,
+                    glBufferStorage,
+                    (GLenum target,
+                     GLsizeiptr size,
+                     const void* data,
+                     GLbitfield flags),
+                    (target, size, data, flags))
+COUNTED_GL_FUNCTION(GLenum,
+                    glClientWaitSync,
+                    (GLsync sync, GLbitfield flags, GLuint64 timeout),
+                    (sync, flags, timeout))
+COUNTED_GL_FUNCTION(void, glDeleteSync, (GLsync sync), (sync))
+COUNTED_GL_FUNCTION(GLsync,
+                    glFenceSync,
+                    (GLenum condition, GLbitfield flags),
+                    (condition, flags))
+COUNTED_GL_FUNCTION(void, glFlush, (), ())
+COUNTED_GL_FUNCTION(void,
+                    glFramebufferTexture2D,
+                    (GLenum target,
+                     GLenum attachment,
+                     GLenum textarget,
+                     GLuint texture,
+                     GLint level),
+                    (target, attachment, textarget, texture, level))
+COUNTED_GL_FUNCTION(void*,
+                    glMapBufferRange,
+                    (GLenum target,
+                     GLintptr offset,
+                     GLsizeiptr length,
+                     GLbitfield access),
+                    (target, offset, length, access))
+COUNTED_GL_FUNCTION(void,
+                    glPixelStorei,
+                    (GLenum pname, GLint param),
+                    (pname, param))
+COUNTED_GL_FUNCTION(void,
+                    glTexImage2D,
+                    (GLenum target,
+                     GLint level,
+                     GLint internal_format,
+                     GLsizei width,
+                     GLsizei height,
+                     GLint border,
+                     GLenum format,
+                     GLenum type,
+                     const void* pixels),
+                    (target,
+                     level,
+                     internal_format,
+                     width,
+                     height,
+                     border,
+                     format,
+                     type,
+                     pixels))
+COUNTED_GL_FUNCTION(void,
+                    glTexStorage2D,
+                    (GLenum target,
+                     GLsizei levels,
+                     GLenum internal_format,
+                     GLsizei width,
+                     GLsizei height),
+                    (target, levels, internal_format, width, height))
+COUNTED_GL_FUNCTION(void,
+                    glTexSubImage2D,
+                    (GLenum target,
+                     GLint level,
+                     GLint x_offset,
+                     GLint y_offset,
+                     GLsizei width,
+                     GLsizei height,
+                     GLenum format,
+                     GLenum type,
+                     const void* pixels),
+                    (target,
+                     level,
+                     x_offset,
+                     y_offset,
+                     width,
+                     height,
+                     format,
+                     type,
+                     pixels))
+COUNTED_GL_FUNCTION(GLboolean, glUnmapBuffer, (GLenum target), (target))
+COUNTED_GL_FUNCTION(void,
+                    glWaitSync,
+                    (GLsync sync, GLbitfield flags, GLuint64 timeout),
+                    (sync, flags, timeout))
+
+namespace {
+
+// Dirty-rectangle patterns
+
+// A sequence of paints of a |width| x |height| view, each given by its dirty
+// rectangles. The sequence is repeated as many times as needed.
+struct Pattern {
+  std::string name;
+  std::vector<std::vector<WebviewRect>> frames;
+};
+
+// The patterns recorded from typical pages, reproduced at any view size.
+std::vector<Pattern> GetBuiltinPatterns(int width, int height) {
+  std::vector<Pattern> patterns;
+
+  // A page repainted as a whole on every frame, e.g. a canvas animation.
+  patterns.push_back(Pattern{"full", {{WebviewRect{0, 0, width, height}}}});
+
+  // A text field with a blinking caret: a 1-pixel-wide caret and the few
+  // pixels of antialiasing around it, alternately drawn and erased.
+  patterns.push_back(Pattern{
+      "caret",
+      {{WebviewRect{width / 4, height / 3, 2, 18}},
+       {WebviewRect{width / 4, height / 3, 2, 18}}}});
+
+  // Scrolling with the mouse wheel: the whole viewport except the scrollbar is
+  // repainted, and the scrollbar thumb moves.
+  const int scrollbar_width = 15;
+  const int thumb_height = std::max(height / 8, 16);
+  Pattern scroll{"scroll", {}};
+  for (int i = 0; i < 30; ++i) {
+    const int thumb_y = (height - thumb_height) * i / 30;
+    scroll.frames.push_back(
+        {WebviewRect{0, 0, width - scrollbar_width, height},
+         WebviewRect{width - scrollbar_width, std::max(thumb_y - 4, 0),
+                     scrollbar_width,
+                     std::min(thumb_height + 8, height - thumb_y + 4)}});
+  }
+  patterns.push_back(scroll);
+
+  // A 16:9 video playing in half of the view, with its progress bar and
+  // elapsed time updated every few frames.
+  const int video_width = width / 2;
+  const int video_height = video_width * 9 / 16;
+  const int video_x = (width - video_width) / 2;
+  const int video_y = std::max((height - video_height) / 2 - 20, 0);
+  const WebviewRect video{video_x, video_y, video_width, video_height};
+  const WebviewRect progress{video_x + 8,
+                             std::min(video_y + video_height + 8, height - 6),
+                             video_width - 80, 6};
+  const WebviewRect elapsed{video_x + video_width - 64,
+                            std::min(video_y + video_height + 4, height - 14),
+                            56, 14};
+  Pattern video_pattern{"video", {}};
+  for (int i = 0; i < 6; ++i) {
+    if (i % 3 == 0) {
+      video_pattern.frames.push_back({video, progress, elapsed});
+    } else {
+      video_pattern.frames.push_back({video});
+    }
+  }
+  patterns.push_back(video_pattern);
+
+  // A dashboard of 8 x 6 cards, each with a loading spinner, a ticking value
+  // and the caret-sized tip of a sparkline, updated at different rates: dozens
+  // of small rectangles scattered over the view in every paint. The value and
+  // the tip of a card are close enough that merging them pays off, while
+  // merging distant cards uploads mostly unchanged pixels.
+  const WebviewRect view{0, 0, width, height};
+  const int card_width = std::max(width / 8, 1);
+  const int card_height = std::max(height / 6, 1);
+  Pattern scattered{"scattered", {}};
+  for (int i = 0; i < 12; ++i) {
+    std::vector<WebviewRect> rects;
+    for (int card = 0; card < 8 * 6; ++card) {
+      const int card_x = card % 8 * card_width;
+      const int card_y = card / 8 * card_height;
+      std::vector<WebviewRect> card_rects;
+      // Spinners turn on every paint.
+      if (card % 5 == 0) {
+        card_rects.push_back(WebviewRect{card_x + 8, card_y + 8, 16, 16});
+      }
+      // Values tick every other or every third paint.
+      if ((card + i) % (card % 2 == 0 ? 2 : 3) == 0) {
+        card_rects.push_back(
+            WebviewRect{card_x + 8, card_y + card_height / 2, 48, 14});
+        card_rects.push_back(
+            WebviewRect{card_x + 64, card_y + card_height / 2 - 4, 3, 22});
+      }
+      for (const WebviewRect& rect : card_rects) {
+        WebviewRect clipped;
+        if (FlutterWebviewTileGrid::Intersect(rect, view, &clipped)) {
+          rects.push_back(clipped);
+        }
+      }
+    }
+    scattered.frames.push_back(rects);
+  }
+  patterns.push_back(scattered);
+
+  return patterns;
+}
+
+// Reads a pattern recorded in |path|: one paint per line, each a list of
+// "x,y,width,height" rectangles separated by spaces. Empty lines and lines
+// starting with '#' are skipped. The rectangles are clipped to the view.
+bool ReadPattern(const std::string& path,
+                 int width,
+                 int height,
+                 Pattern* pattern) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Error: Could not open " << path << std::endl;
+    return false;
+  }
+  pattern->name = path.substr(path.find_last_of('/') + 1);
+  const WebviewRect view{0, 0, width, height};
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::vector<WebviewRect> rects;
+    std::istringstream stream(line);
+    std::string token;
+    while (stream >> token) {
+      WebviewRect rect;
+      if (std::sscanf(token.c_str(), "%d,%d,%d,%d", &rect.x, &rect.y,
+                      &rect.width, &rect.height) != 4) {
+        std::cerr << "Error: Malformed rectangle '" << token << "' in " << path
+                  << std::endl;
+        return false;
+      }
+      WebviewRect clipped;
+      if (FlutterWebviewTileGrid::Intersect(rect, view, &clipped)) {
+        rects.push_back(clipped);
+      }
+    }
+    if (!rects.empty()) {
+      pattern->frames.push_back(rects);
+    }
+  }
+  if (pattern->frames.empty()) {
+    std::cerr << "Error: No paint in " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Upload strategies
+
+struct Strategy {
+  const char* name;
+  TextureUploadMode mode;
+  bool coalesce;
+};
+
+constexpr std::array<Strategy, 4> kStrategies = {{
+    {"direct", TextureUploadMode::kDirect, false},
+    {"direct+coalesce", TextureUploadMode::kDirect, true},
+    {"pbo", TextureUploadMode::kPixelBufferObject, false},
+    {"pbo+coalesce", TextureUploadMode::kPixelBufferObject, true},
+}};
+
+// Draws the paints of a view to texture rings as FlutterWebviewHandler::OnPaint
+// does with the GL backend, without the browser and the popups, and takes the
+// newest frames as Flutter does.
+class BenchmarkView {
+ public:
+  BenchmarkView(int tile_size, const Strategy& strategy)
+      : tile_grid_(tile_size), coalesce_(strategy.coalesce) {
+    uploader_.SetMode(strategy.mode);
+    coalescer_.SetCostModel(FlutterWebviewTextureUploader::GetCostModel());
+  }
+
+  ~BenchmarkView() {
+    uploader_.ReleaseGLResources();
+    for (const auto& ring : rings_) {
+      ring->ReleaseFramebuffers();
+      ring->ReleaseTextures();
+    }
+  }
+
+  // Returns the number of bytes uploaded.
+  int64_t Paint(const uint8_t* buffer,
+                int width,
+                int height,
+                const std::vector<WebviewRect>& dirty_rects) {
+    const std::vector<WebviewRect> tiles = tile_grid_.GetTiles(width, height);
+    while (rings_.size() < tiles.size()) {
+      std::array<GLuint, FlutterWebviewTextureRing::kNumSlots> textures;
+      glGenTextures(textures.size(), textures.data());
+      rings_.push_back(std::make_unique<FlutterWebviewTextureRing>(
+          FlutterWebviewTextureRing::ChooseTarget(), textures));
+    }
+
+    std::vector<WebviewRect> damage;
+    if (tiles.size() != painted_tiles_) {
+      damage.push_back(WebviewRect{0, 0, width, height});
+    } else if (coalesce_) {
+      damage = coalescer_.Coalesce(dirty_rects);
+    } else {
+      damage = dirty_rects;
+    }
+    painted_tiles_ = tiles.size();
+
+    int64_t uploaded_bytes = 0;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+      uploaded_bytes +=
+          PaintTile(rings_[i].get(), tiles[i], buffer, width, height, damage);
+    }
+    return uploaded_bytes;
+  }
+
+  // Takes the newest frame of every tile.
+  void Present() {
+    for (const auto& ring : rings_) {
+      FlutterWebviewTextureRing::Frame frame;
+      ring->AcquireLatestFrame(&frame);
+    }
+  }
+
+ private:
+  // Follows FlutterWebviewHandler::PaintTile.
+  int64_t PaintTile(FlutterWebviewTextureRing* ring,
+                    const WebviewRect& tile,
+                    const uint8_t* buffer,
+                    int width,
+                    int height,
+                    const std::vector<WebviewRect>& damage) {
+    int frame_width, frame_height;
+    ring->GetLatestFrameSize(&frame_width, &frame_height);
+    std::vector<WebviewRect> tile_damage;
+    if (frame_width != tile.width || frame_height != tile.height) {
+      tile_damage.push_back(tile);
+    } else {
+      tile_damage = FlutterWebviewTileGrid::ClipRects(damage, tile);
+      if (tile_damage.empty()) {
+        return 0;
+      }
+    }
+
+    FlutterWebviewTextureRing::Frame frame = ring->BeginWrite();
+    if (frame.width != tile.width || frame.height != tile.height) {
+      frame = ring->ReserveStorage(tile.width, tile.height);
+    }
+    uploader_.UploadRects(ring->target(), frame.texture, buffer, width, height,
+                          tile_damage, -tile.x, -tile.y);
+
+    int64_t uploaded_bytes = 0;
+    for (WebviewRect& rect : tile_damage) {
+      uploaded_bytes +=
+          static_cast<int64_t>(rect.width) * rect.height * kBytesPerPixel;
+      rect.x -= tile.x;
+      rect.y -= tile.y;
+    }
+    ring->EndWrite(tile.width, tile.height, tile_damage);
+    return uploaded_bytes;
+  }
+
+  FlutterWebviewTileGrid tile_grid_;
+  bool coalesce_;
+  FlutterWebviewTextureUploader uploader_;
+  FlutterWebviewRectCoalescer coalescer_;
+  std::vector<std::unique_ptr<FlutterWebviewTextureRing>> rings_;
+  size_t painted_tiles_ = 0;
+};
+
+struct Result {
+  int64_t frames = 0;
+  int64_t uploaded_bytes = 0;
+  double elapsed_s = 0;
+  std::map<std::string, int64_t> latency_ns;
+  std::map<std::string, int64_t> gl_calls;
+};
+
+Result RunStrategy(const Strategy& strategy,
+                   const Pattern& pattern,
+                   const std::vector<uint8_t>& buffer,
+                   int width,
+                   int height,
+                   int tile_size,
+                   int warmup_frames,
+                   int frames) {
+  BenchmarkView view(tile_size, strategy);
+  FlutterWebviewHistogram latency;
+  Result result;
+
+  for (int i = 0; i < warmup_frames + frames; ++i) {
+    const bool measured = i >= warmup_frames;
+    if (i == warmup_frames) {
+      glFinish();
+      g_gl_call_counts.clear();
+      g_counting_gl_calls = true;
+    }
+    const std::vector<WebviewRect>& dirty_rects =
+        pattern.frames[i % pattern.frames.size()];
+
+    const auto start = std::chrono::steady_clock::now();
+    const int64_t uploaded_bytes =
+        view.Paint(buffer.data(), width, height, dirty_rects);
+    const auto end = std::chrono::steady_clock::now();
+    view.Present();
+
+    if (measured) {
+      const int64_t latency_ns =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+              .count();
+      latency.Record(latency_ns);
+      result.elapsed_s += latency_ns / 1e9;
+      result.uploaded_bytes += uploaded_bytes;
+      result.frames++;
+    }
+  }
+
+  // The uploads still queued on the GPU count for the throughput.
+  g_counting_gl_calls = false;
+  const auto finish_start = std::chrono::steady_clock::now();
+  glFinish();
+  result.elapsed_s += std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - finish_start)
+                          .count();
+
+  result.latency_ns = latency.Summarize();
+  result.gl_calls = g_gl_call_counts;
+  return result;
+}
+
+void PrintResults(const Pattern& pattern,
+                  int width,
+                  int height,
+                  const std::vector<std::pair<const Strategy*, Result>>&
+                      results) {
+  std::printf("\npattern=%s view=%dx%d paints/cycle=%zu\n",
+              pattern.name.c_str(), width, height, pattern.frames.size());
+  std::printf("%-16s %9s %9s %9s %9s %9s %9s %10s %10s %10s\n", "strategy",
+              "MB/s", "KB/frame", "p50_us", "p90_us", "p99_us", "max_us",
+              "gl/frame", "upload/fr", "blit/fr");
+  for (const auto& entry : results) {
+    const Result& result = entry.second;
+    auto per_frame = [&result](std::initializer_list<const char*> names) {
+      int64_t calls = 0;
+      for (const char* name : names) {
+        auto it = result.gl_calls.find(name);
+        if (it != result.gl_calls.end()) {
+          calls += it->second;
+        }
+      }
+      return static_cast<double>(calls) / result.frames;
+    };
+    int64_t total_calls = 0;
+    for (const auto& call : result.gl_calls) {
+      total_calls += call.second;
+    }
+    const double megabytes = result.uploaded_bytes / (1024.0 * 1024.0);
+    std::printf(
+        "%-16s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %10.2f %10.2f %10.2f\n",
+        entry.first->name, megabytes / result.elapsed_s,
+        result.uploaded_bytes / 1024.0 / result.frames, result.latency_ns.at("p50") / 1e3,
+        result.latency_ns.at("p90") / 1e3, result.latency_ns.at("p99") / 1e3,
+        result.latency_ns.at("max") / 1e3,
+        static_cast<double>(total_calls) / result.frames,
+        per_frame({"glTexSubImage2D", "glTexImage2D"}),
+        per_frame({"glBlitFramebuffer"}));
+  }
+}
+
+// GL context
+
+// Makes a desktop GL context current without any surface, on the Mesa
+// surfaceless platform if available so that no display is needed.
+bool MakeContextCurrent() {
+  auto get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  EGLDisplay display = EGL_NO_DISPLAY;
+  if (get_platform_display != nullptr) {
+    display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY) {
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (display == EGL_NO_DISPLAY ||
+      !eglInitialize(display, nullptr, nullptr)) {
+    std::cerr << "Error: Could not initialize EGL." << std::endl;
+    return false;
+  }
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    std::cerr << "Error: EGL does not support desktop OpenGL." << std::endl;
+    return false;
+  }
+
+  // The core profile that GDK creates for the plugin.
+  const EGLint context_attributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION,
+      3,
+      EGL_CONTEXT_MINOR_VERSION,
+      2,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE,
+  };
+  EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR,
+                                        EGL_NO_CONTEXT, context_attributes);
+  if (context == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    std::cerr << "Error: Could not make a surfaceless GL context current. "
+                 "EGL_KHR_no_config_context and EGL_KHR_surfaceless_context "
+                 "are required."
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void PrintUsage(const char* program) {
+  std::cerr
+      << "Usage: " << program << " [options]\n"
+      << "  --width=N         The width of the view. Default: 1920.\n"
+      << "  --height=N        The height of the view. Default: 1080.\n"
+      << "  --frames=N        The number of measured paints per strategy.\n"
+      << "                    Default: 300.\n"
+      << "  --warmup=N        The number of paints before measuring. "
+         "Default: 30.\n"
+      << "  --tile-size=N     Split the view into tiles of N pixels instead of\n"
+      << "                    the maximum texture size.\n"
+      << "  --pattern=NAME    Run only the built-in pattern NAME: full, caret,\n"
+      << "                    scroll, video or scattered.\n"
+      << "  --pattern-file=F  Run the pattern recorded in F instead: one paint\n"
+      << "                    per line, as space-separated x,y,width,height\n"
+      << "                    rectangles.\n"
+      << "  --strategy=NAME   Run only the strategy NAME: direct,\n"
+      << "                    direct+coalesce, pbo or pbo+coalesce.\n";
+}
+
+bool ParseIntFlag(const std::string& arg, const char* flag, int* value) {
+  const std::string prefix = std::string(flag) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = std::atoi(arg.c_str() + prefix.size());
+  return true;
+}
+
+bool ParseStringFlag(const std::string& arg,
+                     const char* flag,
+                     std::string* value) {
+  const std::string prefix = std::string(flag) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int width = 1920;
+  int height = 1080;
+  int frames = 300;
+  int warmup_frames = 30;
+  int tile_size = 0;
+  std::string pattern_name;
+  std::string pattern_file;
+  std::string strategy_name;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (ParseIntFlag(arg, "--width", &width) ||
+        ParseIntFlag(arg, "--height", &height) ||
+        ParseIntFlag(arg, "--frames", &frames) ||
+        ParseIntFlag(arg, "--warmup", &warmup_frames) ||
+        ParseIntFlag(arg, "--tile-size", &tile_size) ||
+        ParseStringFlag(arg, "--pattern", &pattern_name) ||
+        ParseStringFlag(arg, "--pattern-file", &pattern_file) ||
+        ParseStringFlag(arg, "--strategy", &strategy_name)) {
+      continue;
+    }
+    PrintUsage(argv[0]);
+    return arg == "--help" ? 0 : 1;
+  }
+  if (width <= 0 || height <= 0 || frames <= 0 || warmup_frames < 0) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  if (!MakeContextCurrent()) {
+    return 1;
+  }
+  const flutter_webview_gl::Capabilities& caps =
+      flutter_webview_gl::GetCapabilities();
+  if (tile_size <= 0) {
+    tile_size = FlutterWebviewTextureRing::GetMaxFrameSize(
+        FlutterWebviewTextureRing::ChooseTarget());
+  }
+  // Measured once per process, as in the plugin.
+  const UploadCostModel& cost_model =
+      FlutterWebviewTextureUploader::GetCostModel();
+  std::printf("GL_RENDERER: %s\nGL_VERSION: %s\n",
+              reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+              reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+  std::printf(
+      "target=%s format=%s tile_size=%d pbo=%d buffer_storage=%d "
+      "cost_model={per_call_ns=%.0f, per_byte_ns=%.3f} auto=%s\n",
+      FlutterWebviewTextureRing::ChooseTarget() == GL_TEXTURE_RECTANGLE
+          ? "GL_TEXTURE_RECTANGLE"
+          : "GL_TEXTURE_2D",
+      flutter_webview_gl::GetTextureFormat().name, tile_size,
+      caps.has_pixel_buffer_object, caps.has_buffer_storage,
+      cost_model.per_call_ns, cost_model.per_byte_ns,
+      FlutterWebviewTextureUploader::ArePixelBuffersFaster() ? "pbo"
+                                                             : "direct");
+
+  std::vector<Pattern> patterns;
+  if (!pattern_file.empty()) {
+    Pattern pattern;
+    if (!ReadPattern(pattern_file, width, height, &pattern)) {
+      return 1;
+    }
+    patterns.push_back(pattern);
+  } else {
+    for (const Pattern& pattern : GetBuiltinPatterns(width, height)) {
+      if (pattern_name.empty() || pattern.name == pattern_name) {
+        patterns.push_back(pattern);
+      }
+    }
+    if (patterns.empty()) {
+      std::cerr << "Error: Unknown pattern " << pattern_name << std::endl;
+      return 1;
+    }
+  }
+
+  // Any opaque content will do: the upload cost does not depend on it.
+  std::vector<uint8_t> buffer(static_cast<size_t>(width) * height *
+                              kBytesPerPixel);
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    buffer[i] = (i % kBytesPerPixel == 3) ? 0xff : static_cast<uint8_t>(i);
+  }
+
+  for (const Pattern& pattern : patterns) {
+    std::vector<std::pair<const Strategy*, Result>> results;
+    for (const Strategy& strategy : kStrategies) {
+      if (!strategy_name.empty() && strategy_name != strategy.name) {
+        continue;
+      }
+      if (strategy.mode == TextureUploadMode::kPixelBufferObject &&
+          !caps.has_pixel_buffer_object) {
+        continue;
+      }
+      results.emplace_back(
+          &strategy, RunStrategy(strategy, pattern, buffer, width, height,
+                                 tile_size, warmup_frames, frames));
+    }
+    if (results.empty()) {
+      std::cerr << "Error: Unknown strategy " << strategy_name << std::endl;
+      return 1;
+    }
+    PrintResults(pattern, width, height, results);
+  }
+  return 0;
+}
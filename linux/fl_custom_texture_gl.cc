@@ -28,6 +28,33 @@
 
 #include "flutter_linux_webview/fl_custom_texture_gl.h"
 
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "flutter_webview_render_stats.h"
+#include "flutter_webview_staging_buffer.h"
+#include "flutter_webview_texture_ring.h"
+
+namespace {
+
+// Records a populate call of |texture| from construction to destruction.
+class ScopedPopulate {
+ public:
+  explicit ScopedPopulate(FlCustomTextureGL* texture) : texture_(texture) {
+    texture_->populating.fetch_add(1);
+  }
+  ~ScopedPopulate() {
+    texture_->last_populate_ns.store(FlutterWebviewRenderStats::NowNs());
+    texture_->populating.fetch_sub(1);
+  }
+
+ private:
+  FlCustomTextureGL* texture_;
+};
+
+}  // namespace
+
 // FlCustomTextureGL: A class derived from the abstract class FlTextureGL
 
 G_DEFINE_TYPE(FlCustomTextureGL, fl_custom_texture_gl, fl_texture_gl_get_type())
@@ -36,6 +63,14 @@ static void fl_custom_texture_gl_dispose(GObject* object) {
   G_OBJECT_CLASS(fl_custom_texture_gl_parent_class)->dispose(object);
 }
 
+static void fl_custom_texture_gl_finalize(GObject* object) {
+  FlCustomTextureGL* self = FL_CUSTOM_TEXTURE_GL(object);
+  self->ring.~shared_ptr();
+  self->staging.~shared_ptr();
+
+  G_OBJECT_CLASS(fl_custom_texture_gl_parent_class)->finalize(object);
+}
+
 static gboolean fl_custom_texture_gl_populate(FlTextureGL* texture,
                                               uint32_t* target,
                                               uint32_t* name,
@@ -43,23 +78,54 @@ static gboolean fl_custom_texture_gl_populate(FlTextureGL* texture,
                                               uint32_t* height,
                                               GError** error) {
   FlCustomTextureGL* self = FL_CUSTOM_TEXTURE_GL(texture);
+  ScopedPopulate scoped_populate(self);
+
+  // On the raster thread, whose GL context is current, so the paints staged
+  // since the last frame are uploaded here.
+  FlutterWebviewStagingBuffer::Frame staged_frame;
+  if (self->staging &&
+      self->staging->UploadLatestFrame(self->target, &staged_frame)) {
+    *target = self->target;
+    *name = staged_frame.texture;
+    *width = staged_frame.width;
+    *height = staged_frame.height;
+    return TRUE;
+  }
+
+  // Show the newest frame whose upload has completed, or the initial texture
+  // until then. The textures of the frames are not shown before, since the
+  // browser may be writing them.
+  FlutterWebviewTextureRing::Frame frame;
+  if (!self->ring->AcquireLatestFrame(&frame)) {
+    frame.texture = self->ring->GetInitialTexture();
+    frame.width = self->width;
+    frame.height = self->height;
+  }
+
+  // If a newer frame exists but its upload has not completed yet, ask the
+  // frame notifier to mark this texture again so that Flutter comes back for
+  // it.
+  if (self->ring->HasUnpresentedFrame()) {
+    g_main_context_wakeup(nullptr);
+  }
 
   *target = self->target;
-  *name = self->native_texture_id;
-  *width = self->width;
-  *height = self->height;
+  *name = frame.texture;
+  *width = frame.width;
+  *height = frame.height;
 
   return TRUE;
 }
 
-FlCustomTextureGL* fl_custom_texture_gl_new(uint32_t target,
-                                            GLuint native_texture_id,
-                                            uint32_t width,
-                                            uint32_t height) {
+FlCustomTextureGL* fl_custom_texture_gl_new(
+    uint32_t target,
+    std::shared_ptr<FlutterWebviewTextureRing> ring,
+    uint32_t width,
+    uint32_t height) {
   auto r = FL_CUSTOM_TEXTURE_GL(
       g_object_new(fl_custom_texture_gl_get_type(), nullptr));
   r->target = target;
-  r->native_texture_id = native_texture_id;
+  r->ring = std::move(ring);
   r->width = width;
   r->height = height;
   return r;
@@ -67,7 +133,14 @@ FlCustomTextureGL* fl_custom_texture_gl_new(uint32_t target,
 
 static void fl_custom_texture_gl_class_init(FlCustomTextureGLClass* klass) {
   G_OBJECT_CLASS(klass)->dispose = fl_custom_texture_gl_dispose;
+  G_OBJECT_CLASS(klass)->finalize = fl_custom_texture_gl_finalize;
   FL_TEXTURE_GL_CLASS(klass)->populate = fl_custom_texture_gl_populate;
 }
 
-static void fl_custom_texture_gl_init(FlCustomTextureGL* self) {}
+static void fl_custom_texture_gl_init(FlCustomTextureGL* self) {
+  // GObject only zero-fills the instance, so construct the C++ members here.
+  new (&self->ring) std::shared_ptr<FlutterWebviewTextureRing>();
+  new (&self->staging) std::shared_ptr<FlutterWebviewStagingBuffer>();
+  new (&self->populating) std::atomic<int>(0);
+  new (&self->last_populate_ns) std::atomic<int64_t>(0);
+}
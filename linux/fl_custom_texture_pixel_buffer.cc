@@ -0,0 +1,84 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_linux_webview/fl_custom_texture_pixel_buffer.h"
+
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "flutter_webview_pixel_buffer.h"
+
+// FlCustomTexturePixelBuffer: A class derived from FlPixelBufferTexture, used
+// when the plugin cannot draw with a GL context of its own. The engine uploads
+// the image to a texture on the raster thread.
+
+G_DEFINE_TYPE(FlCustomTexturePixelBuffer,
+              fl_custom_texture_pixel_buffer,
+              fl_pixel_buffer_texture_get_type())
+
+static void fl_custom_texture_pixel_buffer_finalize(GObject* object) {
+  FlCustomTexturePixelBuffer* self = FL_CUSTOM_TEXTURE_PIXEL_BUFFER(object);
+  self->pixel_buffer.~shared_ptr();
+
+  G_OBJECT_CLASS(fl_custom_texture_pixel_buffer_parent_class)->finalize(object);
+}
+
+static gboolean fl_custom_texture_pixel_buffer_copy_pixels(
+    FlPixelBufferTexture* texture,
+    const uint8_t** buffer,
+    uint32_t* width,
+    uint32_t* height,
+    GError** error) {
+  FlCustomTexturePixelBuffer* self = FL_CUSTOM_TEXTURE_PIXEL_BUFFER(texture);
+
+  // The image stays untouched by the browser until the next call.
+  self->pixel_buffer->AcquireLatestFrame(buffer, width, height);
+  return TRUE;
+}
+
+FlCustomTexturePixelBuffer* fl_custom_texture_pixel_buffer_new(
+    std::shared_ptr<FlutterWebviewPixelBuffer> pixel_buffer) {
+  auto r = FL_CUSTOM_TEXTURE_PIXEL_BUFFER(
+      g_object_new(fl_custom_texture_pixel_buffer_get_type(), nullptr));
+  r->pixel_buffer = std::move(pixel_buffer);
+  return r;
+}
+
+static void fl_custom_texture_pixel_buffer_class_init(
+    FlCustomTexturePixelBufferClass* klass) {
+  G_OBJECT_CLASS(klass)->finalize = fl_custom_texture_pixel_buffer_finalize;
+  FL_PIXEL_BUFFER_TEXTURE_CLASS(klass)->copy_pixels =
+      fl_custom_texture_pixel_buffer_copy_pixels;
+}
+
+static void fl_custom_texture_pixel_buffer_init(
+    FlCustomTexturePixelBuffer* self) {
+  // GObject only zero-fills the instance, so construct the C++ member here.
+  new (&self->pixel_buffer) std::shared_ptr<FlutterWebviewPixelBuffer>();
+}
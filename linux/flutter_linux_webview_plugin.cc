@@ -31,13 +31,30 @@
 #include <flutter_linux/flutter_linux.h>
 #include <gtk/gtk.h>
 #include <sys/utsname.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 
+#include "flutter_linux_webview/fl_custom_texture_pixel_buffer.h"
 #include "flutter_linux_webview/flutter_webview_types.h"
 #include "flutter_webview_controller.h"
+#include "flutter_webview_frame_notifier.h"
+#include "flutter_webview_frame_rate_governor.h"
+#include "flutter_webview_frame_tap.h"
+#include "flutter_webview_pixel_buffer.h"
+#include "flutter_webview_render_stats.h"
+#include "flutter_webview_snapshot_cache.h"
+#include "flutter_webview_staging_buffer.h"
+#include "flutter_webview_texture_format.h"
 #include "flutter_webview_texture_manager.h"
+#include "flutter_webview_texture_ring.h"
+#include "flutter_webview_texture_uploader.h"
+#include "flutter_webview_tile_grid.h"
 #include "include/base/cef_callback.h"
 #include "include/wrapper/cef_closure_task.h"
 
@@ -49,9 +66,23 @@ struct _FlutterLinuxWebviewPlugin {
   GObject parent_instance;
 
   FlMethodChannel* method_channel;
+  // NULL if a GL context could not be created, in which case the webviews are
+  // drawn to pixel buffer textures.
   GdkGLContext* gdk_gl_context;
+  // The largest width and height of a texture. Larger webviews are split into
+  // tiles of this size. 0 without a GL context.
+  int tile_size;
+  // What the webviews created afterwards are drawn to.
+  TextureBackend texture_backend;
+  // Whether the small webviews are drawn to texture atlases. Applied to each
+  // webview when it is resized.
+  bool texture_atlas_enabled;
+  // Where the webviews created with a snapshot key keep their snapshots. Null
+  // until a directory is set.
+  std::shared_ptr<FlutterWebviewSnapshotCache> snapshot_cache;
   FlPluginRegistrar* plugin_registrar;
   std::unique_ptr<FlutterWebviewTextureManager> texture_manager;
+  std::unique_ptr<FlutterWebviewFrameNotifier> frame_notifier;
 };
 
 G_DEFINE_TYPE(FlutterLinuxWebviewPlugin,
@@ -252,6 +283,37 @@ bool get_arg_string_list(FlValue* map,
   return true;
 }
 
+// Retrieves an FL_VALUE_TYPE_LIST value which consists of FL_VALUE_TYPE_INT
+// values from the |map| by the |key| and outputs it as an std::vector<int64_t>
+// value. Returns false and outputs |out_error| in case of error.
+bool get_arg_int64_list(FlValue* map,
+                        const char* key,
+                        std::vector<int64_t>* out_int_vec,
+                        FlMethodResponse** out_error) {
+  FlValue* arg = fl_value_lookup_string(map, key);
+  if (fl_value_get_type(arg) != FL_VALUE_TYPE_LIST) {
+    *out_error = FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kBadArgumentsError, (std::string(key) + " must be List<int>").c_str(),
+        nullptr));
+    return false;
+  }
+  size_t len = fl_value_get_length(arg);
+  std::vector<int64_t> buf;
+  buf.reserve(len);
+  for (size_t i = 0; i < len; ++i) {
+    FlValue* int_value = fl_value_get_list_value(arg, i);
+    if (fl_value_get_type(int_value) != FL_VALUE_TYPE_INT) {
+      *out_error = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          kBadArgumentsError,
+          (std::string(key) + " must be List<int>").c_str(), nullptr));
+      return false;
+    }
+    buf.push_back(fl_value_get_int(int_value));
+  }
+  *out_int_vec = std::move(buf);
+  return true;
+}
+
 // Retrieves an FL_VALUE_TYPE_MAP value which maps FL_VALUE_TYPE_STRING to
 // FL_VALUE_TYPE_STRING from the |map| by the |key| and outputs it as T type
 // (map family type is expected). Returns false and outputs |out_error| in case
@@ -346,6 +408,20 @@ class ReplyFuncAccessor {
     return fl_value_new_int(value);
   }
 
+  static FlValue* convert_to_fl_value(
+      const std::map<std::string, int64_t>& value) {
+#if defined(FLUTTER_WEBVIEW_DEBUG)
+    std::cerr << __func__ << "(const std::map<std::string, int64_t>&)"
+              << std::endl;
+#endif
+    FlValue* map = fl_value_new_map();
+    for (const auto& entry : value) {
+      fl_value_set_string_take(map, entry.first.c_str(),
+                               fl_value_new_int(entry.second));
+    }
+    return map;
+  }
+
   class ReplyFuncVoid {
    public:
     explicit ReplyFuncVoid(FlMethodCall* method_call)
@@ -424,11 +500,13 @@ class ReplyFuncAccessor {
   using ReplyCallbackVoid = ReplyFuncVoid;
   using ReplyCallbackString = ReplyFunc<std::string>;
   using ReplyCallbackBool = ReplyFunc<bool>;
+  using ReplyCallbackIntMap = ReplyFunc<std::map<std::string, int64_t>>;
 };
 
 using ReplyCallbackVoid = ReplyFuncAccessor::ReplyCallbackVoid;
 using ReplyCallbackString = ReplyFuncAccessor::ReplyCallbackString;
 using ReplyCallbackBool = ReplyFuncAccessor::ReplyCallbackBool;
+using ReplyCallbackIntMap = ReplyFuncAccessor::ReplyCallbackIntMap;
 
 }  // namespace
 
@@ -640,6 +718,25 @@ static FlMethodResponse* plugin_on_send_key_async(
   return nullptr;
 }
 
+// Returns the map telling the Dart side where a webview is drawn in a texture
+// atlas.
+static FlValue* new_atlas_region_value(
+    FlutterLinuxWebviewPlugin* plugin,
+    const FlutterWebviewTextureManager::AtlasRegion& region) {
+  FlValue* value = fl_value_new_map();
+  fl_value_set_string_take(
+      value, "textureId",
+      fl_value_new_int(plugin->texture_manager->GetTextureId(
+          FL_TEXTURE(region.texture))));
+  fl_value_set_string_take(value, "x", fl_value_new_int(region.rect.x));
+  fl_value_set_string_take(value, "y", fl_value_new_int(region.rect.y));
+  fl_value_set_string_take(value, "atlasWidth",
+                           fl_value_new_int(region.atlas->width()));
+  fl_value_set_string_take(value, "atlasHeight",
+                           fl_value_new_int(region.atlas->height()));
+  return value;
+}
+
 // resize
 static FlMethodResponse* plugin_on_resize_async(
     FlutterLinuxWebviewPlugin* plugin,
@@ -665,11 +762,135 @@ static FlMethodResponse* plugin_on_resize_async(
     return error_response;
   }
 
+  // A view larger than a texture is drawn to a texture per tile, which the
+  // Dart side lays out in a grid. The response is null for a single tile.
+  // A mirror is scaled to a single texture, and so is a view uploaded by the
+  // raster thread.
+  WebviewId mirrored_webview_id;
+  const bool is_mirror = plugin->texture_manager->GetMirroredWebview(
+      webviewId, &mirrored_webview_id);
+  FlCustomTextureGL* gl_texture =
+      plugin->texture_manager->GetTexture(webviewId);
+  const bool is_staged = gl_texture != nullptr && gl_texture->staging;
+  std::vector<std::shared_ptr<FlutterWebviewTextureRing>> tile_rings;
+  FlValue* tiles = nullptr;
+  const FlutterWebviewTileGrid tile_grid(plugin->tile_size);
+  const std::vector<WebviewRect> tile_rects =
+      tile_grid.GetTiles(width, height);
+
+  // With the texture atlas enabled, a small view is drawn to a region of a
+  // texture shared with other small views instead. The response is then the
+  // map of the region, and the views moved to make room are told by
+  // onAtlasRegionChanged. A mirrored view stays out of the atlases since the
+  // mirrors copy from its own textures, and so does a view uploaded by the
+  // raster thread since the atlases are drawn on the CEF UI thread.
+  FlutterWebviewTextureManager::AtlasRegion atlas_region{
+      nullptr, nullptr, WebviewRect{0, 0, 0, 0}};
+  std::vector<std::pair<WebviewId, FlutterWebviewTextureManager::AtlasRegion>>
+      moved_atlas_regions;
+  bool in_atlas = false;
+  if (!is_mirror) {
+    if (plugin->texture_atlas_enabled && !is_staged &&
+        !plugin->texture_manager->HasMirrors(webviewId)) {
+      in_atlas = plugin->texture_manager->PlaceInAtlas(
+          webviewId, plugin->gdk_gl_context,
+          fl_plugin_registrar_get_texture_registrar(plugin->plugin_registrar),
+          width, height, plugin->tile_size, &atlas_region,
+          &moved_atlas_regions);
+    } else {
+      plugin->texture_manager->RemoveFromAtlas(webviewId);
+    }
+  }
+  for (const auto& moved : moved_atlas_regions) {
+    CefPostTask(TID_UI,
+                base::BindOnce(&FlutterWebviewController::SetAtlasRegion,
+                               moved.first, moved.second.atlas,
+                               moved.second.rect));
+    g_autoptr(FlValue) event_args = fl_value_new_map();
+    fl_value_set_string_take(event_args, "webviewId",
+                             fl_value_new_int(moved.first));
+    fl_value_set_string_take(event_args, "region",
+                             new_atlas_region_value(plugin, moved.second));
+    fl_method_channel_invoke_method(plugin->method_channel,
+                                    "onAtlasRegionChanged", event_args, NULL,
+                                    NULL, NULL);
+  }
+  if (in_atlas) {
+    tiles = new_atlas_region_value(plugin, atlas_region);
+  } else if (!is_mirror && !is_staged && tile_rects.size() > 1 &&
+             gl_texture != nullptr) {
+    std::vector<FlCustomTextureGL*> textures =
+        plugin->texture_manager->EnsureTileTextures(
+            webviewId, plugin->gdk_gl_context,
+            fl_plugin_registrar_get_texture_registrar(
+                plugin->plugin_registrar),
+            tile_rects.size(), plugin->tile_size);
+    if (textures.empty()) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          kPluginError, "TextureManager::EnsureTileTextures() failed.",
+          nullptr));
+    }
+    tiles = fl_value_new_list();
+    for (size_t i = 0; i < textures.size(); ++i) {
+      if (i > 0) {
+        tile_rings.push_back(textures[i]->ring);
+      }
+      FlValue* tile = fl_value_new_map();
+      fl_value_set_string_take(
+          tile, "textureId",
+          fl_value_new_int(plugin->texture_manager->GetTextureId(
+              FL_TEXTURE(textures[i]))));
+      fl_value_set_string_take(tile, "x", fl_value_new_int(tile_rects[i].x));
+      fl_value_set_string_take(tile, "y", fl_value_new_int(tile_rects[i].y));
+      fl_value_set_string_take(tile, "width",
+                               fl_value_new_int(tile_rects[i].width));
+      fl_value_set_string_take(tile, "height",
+                               fl_value_new_int(tile_rects[i].height));
+      fl_value_append_take(tiles, tile);
+    }
+  }
+
   // prevent release
   g_object_ref(method_call);
-  ReplyCallbackVoid reply_cb{method_call};
-  CefPostTask(TID_UI, base::BindOnce(&FlutterWebviewController::Resize,
-                                     webviewId, width, height, reply_cb));
+  using DoneCBVoid = FlutterWebviewController::DoneCBVoid;
+  DoneCBVoid callback = [method_call, tiles](Nullable<WebviewError> error) {
+    // On the CEF UI thread
+    struct Data {
+      FlMethodCall* method_call;
+      FlValue* tiles;
+      Nullable<WebviewError> error;
+    };
+
+    GSourceFunc func = [](gpointer user_data) -> gboolean {
+      // On the plugin main thread
+      std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+      g_autoptr(FlMethodCall) method_call = data->method_call;
+      g_autoptr(FlValue) tiles = data->tiles;
+      if (!data->error.is_null()) {
+        respond_with_webview_error(method_call, data->error.value());
+        return FALSE;
+      }
+      respond_with_value(method_call, tiles);
+      return FALSE;
+    };
+
+    std::unique_ptr<Data> data(
+        new Data{method_call, tiles, std::move(error)});
+    g_idle_add(func, data.release());
+  };
+  if (is_mirror) {
+    CefPostTask(TID_UI,
+                base::BindOnce(&FlutterWebviewController::ResizeMirror,
+                               mirrored_webview_id, webviewId, width, height,
+                               callback));
+    return nullptr;
+  }
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::SetAtlasRegion,
+                             webviewId, atlas_region.atlas, atlas_region.rect));
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::Resize, webviewId,
+                             width, height, std::move(tile_rings), callback));
   // Will respond later.
   return nullptr;
 }
@@ -1017,8 +1238,8 @@ static FlMethodResponse* plugin_on_clear_cookies_async(
   return nullptr;
 }
 
-// createBrowser
-static FlMethodResponse* plugin_on_create_browser_async(
+// setTextureUploadMode
+static FlMethodResponse* plugin_on_set_texture_upload_mode_async(
     FlutterLinuxWebviewPlugin* plugin,
     FlMethodCall* method_call,
     FlValue* args) {
@@ -1028,153 +1249,596 @@ static FlMethodResponse* plugin_on_create_browser_async(
     return error_response;
   }
 
-  int64_t webviewId;
-  std::string initialUrl;
-  std::vector<uint8_t> backgroundColor;
-  int initialWidth;
-  int initialHeight;
+  int mode;
 
-  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+  if (!get_arg_int64_to_int(args, "mode", &mode, &error_response)) {
     return error_response;
   }
-  if (!get_arg_string(args, "initialUrl", &initialUrl, &error_response)) {
-    return error_response;
+  if (mode < static_cast<int>(TextureUploadMode::kAuto) ||
+      static_cast<int>(TextureUploadMode::kPixelBufferObject) < mode) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kBadArgumentsError, "mode must be an index of TextureUploadMode",
+        nullptr));
   }
-  if (!get_arg_uint8_list(args, "backgroundColor", &backgroundColor,
-                          &error_response)) {
+
+  // prevent release
+  g_object_ref(method_call);
+  ReplyCallbackVoid reply_cb{method_call};
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::SetTextureUploadMode,
+                             static_cast<TextureUploadMode>(mode), reply_cb));
+  // Will respond later.
+  return nullptr;
+}
+
+// setTextureBackend
+static FlMethodResponse* plugin_on_set_texture_backend(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
     return error_response;
   }
-  if (!get_arg_int64_to_int(args, "initialWidth", &initialWidth,
-                            &error_response)) {
+
+  int backend;
+
+  if (!get_arg_int64_to_int(args, "backend", &backend, &error_response)) {
     return error_response;
   }
-  if (!get_arg_int64_to_int(args, "initialHeight", &initialHeight,
-                            &error_response)) {
+  if (backend < static_cast<int>(TextureBackend::kAuto) ||
+      static_cast<int>(TextureBackend::kRasterUpload) < backend) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kBadArgumentsError, "backend must be an index of TextureBackend",
+        nullptr));
+  }
+  if (static_cast<TextureBackend>(backend) == TextureBackend::kGL &&
+      plugin->gdk_gl_context == NULL) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kPluginError,
+        "TextureBackend.gl needs a GL context, which could not be created.",
+        nullptr));
+  }
+  if (static_cast<TextureBackend>(backend) == TextureBackend::kRasterUpload &&
+      plugin->gdk_gl_context == NULL) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kPluginError,
+        "TextureBackend.rasterUpload needs a GL context, which could not be "
+        "created.",
+        nullptr));
+  }
+
+  // Only read on the platform thread when a browser is created.
+  plugin->texture_backend = static_cast<TextureBackend>(backend);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// setTextureAtlasEnabled
+static FlMethodResponse* plugin_on_set_texture_atlas_enabled(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
     return error_response;
   }
 
-  FlCustomTextureGL* texture =
-      plugin->texture_manager->CreateAndRegisterTexture(
-          webviewId, plugin->gdk_gl_context,
-          fl_plugin_registrar_get_texture_registrar(plugin->plugin_registrar),
-          initialWidth, initialHeight);
-  if (texture == nullptr) {
+  bool enabled;
+
+  if (!get_arg_bool(args, "enabled", &enabled, &error_response)) {
+    return error_response;
+  }
+  if (enabled && plugin->gdk_gl_context == NULL) {
     return FL_METHOD_RESPONSE(fl_method_error_response_new(
-        kPluginError, "TextureManager::CreateAndRegisterTexture() failed.",
+        kPluginError,
+        "The texture atlas needs a GL context, which could not be created.",
         nullptr));
   }
 
-  auto on_paint_begin = [plugin](WebviewId webview_id) {
-    // On the CEF UI thread
-    if (!is_plugin_alive(plugin)) {
-      return;
-    }
-    gdk_gl_context_make_current(plugin->gdk_gl_context);
-  };
+  // Only read on the platform thread when a browser is resized.
+  plugin->texture_atlas_enabled = enabled;
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
 
-  auto on_paint_end = [plugin](WebviewId webview_id) {
-    // On the CEF UI thread
-    if (!is_plugin_alive(plugin)) {
-      return;
-    }
-    gdk_gl_context_clear_current();
+// setFrameRate
+static FlMethodResponse* plugin_on_set_frame_rate_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
 
-    struct Data {
-      FlutterLinuxWebviewPlugin* plugin;
-      WebviewId webview_id;
-    };
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
 
-    GSourceFunc func = [](gpointer user_data) -> gboolean {
-      // On the plugin main thread
-      std::unique_ptr<Data> data(static_cast<Data*>(user_data));
-      if (!is_plugin_alive(data->plugin)) {
-        return FALSE;
-      }
-      FlCustomTextureGL* texture =
-          data->plugin->texture_manager->GetTexture(data->webview_id);
-      if (texture == nullptr) {
-        std::cerr << "Warning: Could not get the texture for webview_id="
-                  << data->webview_id << std::endl;
-        return FALSE;
-      }
-      if (!fl_texture_registrar_mark_texture_frame_available(
-              fl_plugin_registrar_get_texture_registrar(
-                  data->plugin->plugin_registrar),
-              FL_TEXTURE(texture))) {
-        std::cerr
-            << "Error: fl_texture_registrar_mark_texture_frame_available() "
-               "failed."
-            << std::endl;
-        return FALSE;
-      }
-      return FALSE;
-    };
+  int64_t webviewId;
+  int frameRate;
+  bool adaptive;
+  int minFrameRate;
 
-    std::unique_ptr<Data> data(new Data{plugin, webview_id});
-    g_idle_add(func, data.release());
-  };
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64_to_int(args, "frameRate", &frameRate, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_bool(args, "adaptive", &adaptive, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64_to_int(args, "minFrameRate", &minFrameRate,
+                            &error_response)) {
+    return error_response;
+  }
+  if (frameRate < FlutterWebviewFrameRateGovernor::kMinFrameRate ||
+      FlutterWebviewFrameRateGovernor::kMaxFrameRate < frameRate ||
+      minFrameRate < FlutterWebviewFrameRateGovernor::kMinFrameRate ||
+      frameRate < minFrameRate) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kBadArgumentsError,
+        "frameRate must be from 1 to 60 and minFrameRate from 1 to frameRate",
+        nullptr));
+  }
 
-  WebviewCreationParams::PageStartedCallback on_page_started =
-      [plugin](WebviewId webview_id, const std::string& url) {
-        // On the CEF UI thread
-        struct Data {
-          FlutterLinuxWebviewPlugin* plugin;
-          WebviewId webview_id;
-          std::string url;
-        };
+  // prevent release
+  g_object_ref(method_call);
+  ReplyCallbackVoid reply_cb{method_call};
+  CefPostTask(TID_UI, base::BindOnce(&FlutterWebviewController::SetFrameRate,
+                                     webviewId, frameRate, adaptive,
+                                     minFrameRate, reply_cb));
+  // Will respond later.
+  return nullptr;
+}
 
-        GSourceFunc func = [](gpointer user_data) -> gboolean {
-          // On the plugin main thread
-          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
-          if (!is_plugin_alive(data->plugin)) {
-            return FALSE;
-          }
-          g_autoptr(FlValue) args = fl_value_new_map();
-          fl_value_set_string_take(args, "webviewId",
-                                   fl_value_new_int(data->webview_id));
-          fl_value_set_string_take(
-              args, "url",
-              fl_value_new_string_sized(data->url.c_str(), data->url.size()));
-          fl_method_channel_invoke_method(data->plugin->method_channel,
-                                          "onPageStarted", args, NULL, NULL,
-                                          NULL);
-          return FALSE;
-        };
+// setDamageRefinementEnabled
+static FlMethodResponse* plugin_on_set_damage_refinement_enabled_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
 
-        std::unique_ptr<Data> data(new Data{plugin, webview_id, url});
-        g_idle_add(func, data.release());
-      };
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
 
-  WebviewCreationParams::PageFinishedCallback on_page_finished =
-      [plugin](WebviewId webview_id, const std::string& url) {
-        // On the CEF UI thread
-        struct Data {
-          FlutterLinuxWebviewPlugin* plugin;
-          WebviewId webview_id;
-          std::string url;
-        };
+  int64_t webviewId;
+  bool enabled;
 
-        GSourceFunc func = [](gpointer user_data) -> gboolean {
-          // On the plugin main thread
-          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
-          if (!is_plugin_alive(data->plugin)) {
-            return FALSE;
-          }
-          g_autoptr(FlValue) args = fl_value_new_map();
-          fl_value_set_string_take(args, "webviewId",
-                                   fl_value_new_int(data->webview_id));
-          fl_value_set_string_take(
-              args, "url",
-              fl_value_new_string_sized(data->url.c_str(), data->url.size()));
-          fl_method_channel_invoke_method(data->plugin->method_channel,
-                                          "onPageFinished", args, NULL, NULL,
-                                          NULL);
-          return FALSE;
-        };
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_bool(args, "enabled", &enabled, &error_response)) {
+    return error_response;
+  }
 
-        std::unique_ptr<Data> data(new Data{plugin, webview_id, url});
-        g_idle_add(func, data.release());
-      };
+  // prevent release
+  g_object_ref(method_call);
+  ReplyCallbackVoid reply_cb{method_call};
+  CefPostTask(
+      TID_UI,
+      base::BindOnce(&FlutterWebviewController::SetDamageRefinementEnabled,
+                     webviewId, enabled, reply_cb));
+  // Will respond later.
+  return nullptr;
+}
+
+// Brings the native textures within the memory budget, if they exceed it, by
+// deleting the pooled textures and then shrinking the textures of the hidden
+// webviews presented least recently.
+static void evict_textures_on_cef_ui(FlutterLinuxWebviewPlugin* plugin) {
+  // On the CEF UI thread
+  if (!is_plugin_alive(plugin) || plugin->gdk_gl_context == NULL ||
+      !plugin->texture_manager->IsOverMemoryBudget()) {
+    return;
+  }
+  if (plugin->texture_manager->GetPoolStats().pooled > 0) {
+    gdk_gl_context_make_current(plugin->gdk_gl_context);
+    plugin->texture_manager->ReclaimTextures(/* keep_pooled= */ true);
+    gdk_gl_context_clear_current();
+  }
+
+  // Does nothing if no webview is hidden.
+  FlutterWebviewTextureManager* texture_manager =
+      plugin->texture_manager.get();
+  FlutterWebviewController::EvictTextures(
+      [texture_manager](const std::vector<WebviewTextureUsage>& usages) {
+        return texture_manager->ChooseEvictions(usages);
+      });
+}
+
+// setVisibility
+static FlMethodResponse* plugin_on_set_visibility_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  int64_t webviewId;
+  bool visible;
+  bool muteAudio;
+
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_bool(args, "visible", &visible, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_bool(args, "muteAudio", &muteAudio, &error_response)) {
+    return error_response;
+  }
+
+  // prevent release
+  g_object_ref(method_call);
+  ReplyCallbackVoid reply_cb{method_call};
+  CefPostTask(TID_UI, base::BindOnce(&FlutterWebviewController::SetVisibility,
+                                     webviewId, visible, muteAudio, reply_cb));
+  if (!visible) {
+    // The textures of the webview may now be evicted.
+    CefPostTask(TID_UI, base::BindOnce(&evict_textures_on_cef_ui, plugin));
+  }
+  // Will respond later.
+  return nullptr;
+}
+
+// sendExternalBeginFrame
+static FlMethodResponse* plugin_on_send_external_begin_frame(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  std::vector<int64_t> webviewIds;
+
+  if (!get_arg_int64_list(args, "webviewIds", &webviewIds, &error_response)) {
+    return error_response;
+  }
+
+  // Sent once per Flutter frame, so respond without waiting for the CEF UI
+  // thread.
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::SendExternalBeginFrame,
+                             std::move(webviewIds)));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// getRenderCounters
+static FlMethodResponse* plugin_on_get_render_counters_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  int64_t webviewId;
+
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+
+  // prevent release
+  g_object_ref(method_call);
+  ReplyCallbackIntMap reply_cb{method_call};
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::GetRenderCounters,
+                             webviewId, reply_cb));
+  // Will respond later.
+  return nullptr;
+}
+
+// Recycles or deletes the native textures of the disposed webviews that
+// Flutter has stopped populating, and comes back later for the others.
+static void reclaim_textures_on_cef_ui(FlutterLinuxWebviewPlugin* plugin) {
+  // On the CEF UI thread
+  if (!is_plugin_alive(plugin) || plugin->gdk_gl_context == NULL) {
+    return;
+  }
+  gdk_gl_context_make_current(plugin->gdk_gl_context);
+  const bool pending =
+      plugin->texture_manager->ReclaimTextures(/* keep_pooled= */ true);
+  gdk_gl_context_clear_current();
+  if (pending) {
+    CefPostDelayedTask(TID_UI,
+                       base::BindOnce(&reclaim_textures_on_cef_ui, plugin),
+                       FlutterWebviewTextureManager::kReclaimDelayMs);
+  }
+}
+
+// createBrowser
+// Creates a texture for |mirror_id| showing the view of the webview
+// |webview_id|, for createBrowser with mirrorOf.
+static FlMethodResponse* plugin_create_mirror_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    WebviewId mirror_id,
+    WebviewId webview_id,
+    int width,
+    int height) {
+  FlTextureRegistrar* texture_registrar =
+      fl_plugin_registrar_get_texture_registrar(plugin->plugin_registrar);
+  FlCustomTextureGL* texture =
+      plugin->texture_manager->CreateAndRegisterTexture(
+          mirror_id, plugin->gdk_gl_context, texture_registrar, width, height);
+  if (texture == nullptr) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kPluginError, "TextureManager::CreateAndRegisterTexture() failed.",
+        nullptr));
+  }
+  plugin->texture_manager->AddMirror(mirror_id, webview_id);
+  const int64_t fl_texture_id =
+      plugin->texture_manager->GetTextureId(FL_TEXTURE(texture));
+
+  // prevent release
+  g_object_ref(method_call);
+  using DoneCBVoid = FlutterWebviewController::DoneCBVoid;
+  DoneCBVoid callback = [method_call, plugin, mirror_id,
+                         fl_texture_id](Nullable<WebviewError> error) {
+    // On the CEF UI thread
+    struct Data {
+      FlMethodCall* method_call;
+      FlutterLinuxWebviewPlugin* plugin;
+      WebviewId mirror_id;
+      int64_t fl_texture_id;
+      Nullable<WebviewError> error;
+    };
+
+    GSourceFunc func = [](gpointer user_data) -> gboolean {
+      // On the plugin main thread
+      std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+      g_autoptr(FlMethodCall) method_call = data->method_call;
+      if (!is_plugin_alive(data->plugin)) {
+        return FALSE;
+      }
+      if (!data->error.is_null()) {
+        // Nothing draws to the texture, so it can go back to the pool.
+        data->plugin->texture_manager->UnregisterAndDestroyTexture(
+            data->mirror_id, fl_plugin_registrar_get_texture_registrar(
+                                 data->plugin->plugin_registrar));
+        CefPostDelayedTask(
+            TID_UI, base::BindOnce(&reclaim_textures_on_cef_ui, data->plugin),
+            FlutterWebviewTextureManager::kReclaimDelayMs);
+        respond_with_webview_error(method_call, data->error.value());
+        return FALSE;
+      }
+      g_autoptr(FlValue) result = fl_value_new_int(data->fl_texture_id);
+      respond_with_value(method_call, result);
+      return FALSE;
+    };
+
+    std::unique_ptr<Data> data(new Data{method_call, plugin, mirror_id,
+                                        fl_texture_id, std::move(error)});
+    g_idle_add(func, data.release());
+  };
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::AddMirror, webview_id,
+                             mirror_id, texture->ring, width, height,
+                             callback));
+  // Will respond later.
+  return nullptr;
+}
+
+static FlMethodResponse* plugin_on_create_browser_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  int64_t webviewId;
+  std::string initialUrl;
+  std::vector<uint8_t> backgroundColor;
+  int initialWidth;
+  int initialHeight;
+  bool headless;
+  bool externalBeginFrame;
+
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_string(args, "initialUrl", &initialUrl, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_uint8_list(args, "backgroundColor", &backgroundColor,
+                          &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64_to_int(args, "initialWidth", &initialWidth,
+                            &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64_to_int(args, "initialHeight", &initialHeight,
+                            &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_bool(args, "headless", &headless, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_bool(args, "externalBeginFrame", &externalBeginFrame,
+                    &error_response)) {
+    return error_response;
+  }
+
+  const bool use_gl =
+      plugin->texture_backend == TextureBackend::kGL ||
+      (plugin->texture_backend == TextureBackend::kAuto &&
+       plugin->gdk_gl_context != NULL);
+  // The textures are created with the plugin's GL context, but only Flutter's
+  // raster thread makes GL calls for the paints.
+  const bool raster_upload =
+      plugin->texture_backend == TextureBackend::kRasterUpload;
+
+  // A mirror of an existing webview gets a texture but no browser of its own.
+  FlValue* mirror_of = fl_value_lookup_string(args, "mirrorOf");
+  if (mirror_of != nullptr &&
+      fl_value_get_type(mirror_of) == FL_VALUE_TYPE_INT) {
+    if (!use_gl || headless) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          kPluginError, "A mirror requires the GL texture backend.", nullptr));
+    }
+    return plugin_create_mirror_async(plugin, method_call, webviewId,
+                                      fl_value_get_int(mirror_of),
+                                      initialWidth, initialHeight);
+  }
+
+  // A webview with a snapshot key is shown from its snapshot of the previous
+  // run until it paints.
+  std::shared_ptr<FlutterWebviewSnapshotCache> snapshot_cache;
+  std::string snapshotKey;
+  FlValue* snapshot_key = fl_value_lookup_string(args, "snapshotKey");
+  if (snapshot_key != nullptr &&
+      fl_value_get_type(snapshot_key) == FL_VALUE_TYPE_STRING && !headless) {
+    snapshotKey = fl_value_get_string(snapshot_key);
+    if (!snapshotKey.empty()) {
+      snapshot_cache = plugin->snapshot_cache;
+    }
+  }
+
+  FlTextureRegistrar* texture_registrar =
+      fl_plugin_registrar_get_texture_registrar(plugin->plugin_registrar);
+  FlTexture* texture = nullptr;
+  std::shared_ptr<FlutterWebviewTextureRing> texture_ring;
+  std::shared_ptr<FlutterWebviewPixelBuffer> pixel_buffer;
+  std::shared_ptr<FlutterWebviewStagingBuffer> staging_buffer;
+  if (headless) {
+    // Never displayed, so it gets no texture and is never drawn.
+    plugin->texture_manager->AddHeadlessWebview(webviewId);
+  } else if (use_gl || raster_upload) {
+    if (raster_upload) {
+      staging_buffer = std::make_shared<FlutterWebviewStagingBuffer>();
+    }
+    FlCustomTextureGL* gl_texture =
+        plugin->texture_manager->CreateAndRegisterTexture(
+            webviewId, plugin->gdk_gl_context, texture_registrar,
+            initialWidth, initialHeight, staging_buffer);
+    if (gl_texture == nullptr) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          kPluginError, "TextureManager::CreateAndRegisterTexture() failed.",
+          nullptr));
+    }
+    texture = FL_TEXTURE(gl_texture);
+    if (!raster_upload) {
+      texture_ring = gl_texture->ring;
+    }
+  } else {
+    FlCustomTexturePixelBuffer* pixel_buffer_texture =
+        plugin->texture_manager->CreateAndRegisterPixelBufferTexture(
+            webviewId, texture_registrar);
+    if (pixel_buffer_texture == nullptr) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          kPluginError,
+          "TextureManager::CreateAndRegisterPixelBufferTexture() failed.",
+          nullptr));
+    }
+    texture = FL_TEXTURE(pixel_buffer_texture);
+    pixel_buffer = pixel_buffer_texture->pixel_buffer;
+  }
+
+  auto on_paint_begin = [plugin, use_gl](WebviewId webview_id) {
+    // On the CEF UI thread
+    if (!is_plugin_alive(plugin)) {
+      return;
+    }
+    if (use_gl) {
+      gdk_gl_context_make_current(plugin->gdk_gl_context);
+    }
+  };
+
+  auto on_paint_end = [plugin, use_gl](WebviewId webview_id) {
+    // On the CEF UI thread
+    if (!is_plugin_alive(plugin)) {
+      return;
+    }
+    if (use_gl) {
+      gdk_gl_context_clear_current();
+    }
+
+    // The frame notifier marks the texture as frame-available on the platform
+    // thread, together with the other textures painted in the meantime.
+    plugin->frame_notifier->Wakeup();
+
+    // The paint may have grown the textures beyond the memory budget. Only
+    // growth can call for more evictions, so the paints that leave the
+    // storage as it is do not look for them.
+    if (use_gl && plugin->texture_manager->HasGrownOverMemoryBudget()) {
+      CefPostTask(TID_UI, base::BindOnce(&evict_textures_on_cef_ui, plugin));
+    }
+  };
+
+  WebviewCreationParams::PageStartedCallback on_page_started =
+      [plugin](WebviewId webview_id, const std::string& url) {
+        // On the CEF UI thread
+        struct Data {
+          FlutterLinuxWebviewPlugin* plugin;
+          WebviewId webview_id;
+          std::string url;
+        };
+
+        GSourceFunc func = [](gpointer user_data) -> gboolean {
+          // On the plugin main thread
+          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+          if (!is_plugin_alive(data->plugin)) {
+            return FALSE;
+          }
+          g_autoptr(FlValue) args = fl_value_new_map();
+          fl_value_set_string_take(args, "webviewId",
+                                   fl_value_new_int(data->webview_id));
+          fl_value_set_string_take(
+              args, "url",
+              fl_value_new_string_sized(data->url.c_str(), data->url.size()));
+          fl_method_channel_invoke_method(data->plugin->method_channel,
+                                          "onPageStarted", args, NULL, NULL,
+                                          NULL);
+          return FALSE;
+        };
+
+        std::unique_ptr<Data> data(new Data{plugin, webview_id, url});
+        g_idle_add(func, data.release());
+      };
+
+  WebviewCreationParams::PageFinishedCallback on_page_finished =
+      [plugin](WebviewId webview_id, const std::string& url) {
+        // On the CEF UI thread
+        struct Data {
+          FlutterLinuxWebviewPlugin* plugin;
+          WebviewId webview_id;
+          std::string url;
+        };
+
+        GSourceFunc func = [](gpointer user_data) -> gboolean {
+          // On the plugin main thread
+          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+          if (!is_plugin_alive(data->plugin)) {
+            return FALSE;
+          }
+          g_autoptr(FlValue) args = fl_value_new_map();
+          fl_value_set_string_take(args, "webviewId",
+                                   fl_value_new_int(data->webview_id));
+          fl_value_set_string_take(
+              args, "url",
+              fl_value_new_string_sized(data->url.c_str(), data->url.size()));
+          fl_method_channel_invoke_method(data->plugin->method_channel,
+                                          "onPageFinished", args, NULL, NULL,
+                                          NULL);
+          return FALSE;
+        };
+
+        std::unique_ptr<Data> data(new Data{plugin, webview_id, url});
+        g_idle_add(func, data.release());
+      };
 
   WebviewCreationParams::PageLoadingCallback on_progress =
       [plugin](WebviewId webview_id, int progress) {
@@ -1185,166 +1849,614 @@ static FlMethodResponse* plugin_on_create_browser_async(
           int progress;
         };
 
-        GSourceFunc func = [](gpointer user_data) -> gboolean {
-          // On the plugin main thread
-          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
-          if (!is_plugin_alive(data->plugin)) {
-            return FALSE;
-          }
-          g_autoptr(FlValue) args = fl_value_new_map();
-          fl_value_set_string_take(args, "webviewId",
-                                   fl_value_new_int(data->webview_id));
-          fl_value_set_string_take(args, "progress",
-                                   fl_value_new_int(data->progress));
-          fl_method_channel_invoke_method(data->plugin->method_channel,
-                                          "onProgress", args, NULL, NULL, NULL);
-          return FALSE;
-        };
+        GSourceFunc func = [](gpointer user_data) -> gboolean {
+          // On the plugin main thread
+          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+          if (!is_plugin_alive(data->plugin)) {
+            return FALSE;
+          }
+          g_autoptr(FlValue) args = fl_value_new_map();
+          fl_value_set_string_take(args, "webviewId",
+                                   fl_value_new_int(data->webview_id));
+          fl_value_set_string_take(args, "progress",
+                                   fl_value_new_int(data->progress));
+          fl_method_channel_invoke_method(data->plugin->method_channel,
+                                          "onProgress", args, NULL, NULL, NULL);
+          return FALSE;
+        };
+
+        std::unique_ptr<Data> data(new Data{plugin, webview_id, progress});
+        g_idle_add(func, data.release());
+      };
+
+  WebviewCreationParams::WebResourceErrorCallback on_web_resource_error =
+      [plugin](WebviewId webview_id, int errorCode,
+               const std::string& description, const std::string& failingUrl) {
+        // On the CEF UI thread
+        struct Data {
+          FlutterLinuxWebviewPlugin* plugin;
+          WebviewId webview_id;
+          int errorCode;
+          std::string description;
+          std::string failingUrl;
+        };
+
+        GSourceFunc func = [](gpointer user_data) -> gboolean {
+          // On the plugin main thread
+          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+          if (!is_plugin_alive(data->plugin)) {
+            return FALSE;
+          }
+          g_autoptr(FlValue) args = fl_value_new_map();
+          fl_value_set_string_take(args, "webviewId",
+                                   fl_value_new_int(data->webview_id));
+          fl_value_set_string_take(args, "errorCode",
+                                   fl_value_new_int(data->errorCode));
+          fl_value_set_string_take(
+              args, "description",
+              fl_value_new_string_sized(data->description.c_str(),
+                                        data->description.size()));
+          fl_value_set_string_take(
+              args, "failingUrl",
+              fl_value_new_string_sized(data->failingUrl.c_str(),
+                                        data->failingUrl.size()));
+          fl_method_channel_invoke_method(data->plugin->method_channel,
+                                          "onWebResourceError", args, NULL,
+                                          NULL, NULL);
+          return FALSE;
+        };
+
+        std::unique_ptr<Data> data(
+            new Data{plugin, webview_id, errorCode, description, failingUrl});
+        g_idle_add(func, data.release());
+      };
+
+  WebviewCreationParams::JavascriptResultCallback on_javascript_result =
+      [plugin](WebviewId webview_id, int js_run_id, bool was_executed,
+               bool is_exception, const std::string& result,
+               bool is_undefined) {
+        // On the CEF UI thread
+        struct Data {
+          FlutterLinuxWebviewPlugin* plugin;
+          WebviewId webview_id;
+          int js_run_id;
+          bool was_executed;
+          bool is_exception;
+          std::string result;
+          bool is_undefined;
+        };
+
+        GSourceFunc func = [](gpointer user_data) -> gboolean {
+          // On the plugin main thread
+          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+          if (!is_plugin_alive(data->plugin)) {
+            return FALSE;
+          }
+          g_autoptr(FlValue) args = fl_value_new_map();
+          fl_value_set_string_take(args, "webviewId",
+                                   fl_value_new_int(data->webview_id));
+          fl_value_set_string_take(args, "jsRunId",
+                                   fl_value_new_int(data->js_run_id));
+          fl_value_set_string_take(args, "wasExecuted",
+                                   fl_value_new_bool(data->was_executed));
+          fl_value_set_string_take(args, "isException",
+                                   fl_value_new_bool(data->is_exception));
+          fl_value_set_string_take(
+              args, "result",
+              fl_value_new_string_sized(data->result.c_str(),
+                                        data->result.size()));
+          fl_value_set_string_take(args, "isUndefined",
+                                   fl_value_new_bool(data->is_undefined));
+          fl_method_channel_invoke_method(data->plugin->method_channel,
+                                          "javascriptResult", args, NULL, NULL,
+                                          NULL);
+          return FALSE;
+        };
+
+        std::unique_ptr<Data> data(new Data{plugin, webview_id, js_run_id,
+                                            was_executed, is_exception, result,
+                                            is_undefined});
+        g_idle_add(func, data.release());
+      };
+
+  const WebviewCreationParams params{
+      std::move(texture_ring),           // texture_ring
+      std::move(pixel_buffer),           // pixel_buffer
+      std::move(staging_buffer),         // staging_buffer
+      use_gl ? plugin->tile_size : 0,    // tile_size
+      externalBeginFrame && !headless,   // external_begin_frame
+      std::move(snapshot_cache),         // snapshot_cache
+      std::move(snapshotKey),            // snapshot_key
+      initialWidth,                      // width
+      initialHeight,                     // height
+      std::move(on_paint_begin),         // on_paint_begin
+      std::move(on_paint_end),           // on_paint_end
+      std::move(initialUrl),             // url
+      std::move(backgroundColor),        // background_color
+      std::move(on_page_started),        // on_page_started
+      std::move(on_page_finished),       // on_page_finished
+      std::move(on_progress),            // on_progress
+      std::move(on_web_resource_error),  // on_web_resource_error
+      std::move(on_javascript_result),   // on_javascript_result
+  };
+
+  // A headless webview responds with no texture ID.
+  int64_t fl_texture_id =
+      headless ? 0 : plugin->texture_manager->GetTextureId(texture);
+
+  // prevent release
+  g_object_ref(method_call);
+  using DoneCBVoid = FlutterWebviewController::DoneCBVoid;
+  DoneCBVoid callback = [method_call,
+                         fl_texture_id](Nullable<WebviewError> error) {
+    // On the CEF UI thread
+    struct Data {
+      FlMethodCall* method_call;
+      int64_t fl_texture_id;
+      Nullable<WebviewError> error;
+    };
+
+    GSourceFunc func = [](gpointer user_data) -> gboolean {
+      // On the plugin main thread
+      std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+      g_autoptr(FlMethodCall) method_call = data->method_call;
+      if (!data->error.is_null()) {
+        respond_with_webview_error(method_call, data->error.value());
+        return FALSE;
+      }
+      // respond fl_texture_id to the Dart side
+      if (data->fl_texture_id == 0) {
+        respond_with_value(method_call, nullptr);
+        return FALSE;
+      }
+      g_autoptr(FlValue) result = fl_value_new_int(data->fl_texture_id);
+      respond_with_value(method_call, result);
+      return FALSE;
+    };
+
+    std::unique_ptr<Data> data(
+        new Data{method_call, fl_texture_id, std::move(error)});
+    g_idle_add(func, data.release());
+  };
+  CefPostTask(TID_UI, base::BindOnce(&FlutterWebviewController::CreateBrowser,
+                                     webviewId, params, callback));
+  // Will respond later.
+  return nullptr;
+}
+
+// Deletes the queued textures that Flutter has stopped populating, and comes
+// back later for the others. Must be called after CEF is shut down.
+static gboolean delete_textures_on_main(gpointer user_data) {
+  // On the plugin main thread
+  FlutterLinuxWebviewPlugin* plugin =
+      static_cast<FlutterLinuxWebviewPlugin*>(user_data);
+  if (!is_plugin_alive(plugin) || !plugin->texture_manager) {
+    return G_SOURCE_REMOVE;
+  }
+  gdk_gl_context_make_current(plugin->gdk_gl_context);
+  const bool pending =
+      plugin->texture_manager->ReclaimTextures(/* keep_pooled= */ false);
+  gdk_gl_context_clear_current();
+  return pending ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+// Unregisters and deletes all the textures, including the pooled ones. Must be
+// called after CEF is shut down, when the GL context is no longer used on the
+// CEF UI thread. The textures Flutter may still populate are deleted later.
+static void destroy_all_textures(FlutterLinuxWebviewPlugin* plugin,
+                                 bool skip_unregister_texture) {
+  plugin->texture_manager->UnregisterAndDestroyAllTextures(
+      fl_plugin_registrar_get_texture_registrar(plugin->plugin_registrar),
+      skip_unregister_texture);
+  if (plugin->gdk_gl_context == NULL) {
+    // Only pixel buffer textures have been created.
+    return;
+  }
+  if (delete_textures_on_main(plugin) == G_SOURCE_CONTINUE) {
+    g_timeout_add(FlutterWebviewTextureManager::kReclaimDelayMs,
+                  delete_textures_on_main, plugin);
+  }
+}
+
+// getTexturePoolStats
+static FlMethodResponse* plugin_on_get_texture_pool_stats(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  const FlutterWebviewTextureManager::PoolStats stats =
+      plugin->texture_manager->GetPoolStats();
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "hits", fl_value_new_int(stats.hits));
+  fl_value_set_string_take(result, "sizeMatchedHits",
+                           fl_value_new_int(stats.size_matched_hits));
+  fl_value_set_string_take(result, "misses", fl_value_new_int(stats.misses));
+  fl_value_set_string_take(result, "deleted", fl_value_new_int(stats.deleted));
+  fl_value_set_string_take(result, "pooled", fl_value_new_int(stats.pooled));
+  fl_value_set_string_take(result, "pending", fl_value_new_int(stats.pending));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// setTextureMemoryBudget
+static FlMethodResponse* plugin_on_set_texture_memory_budget(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  int64_t bytes;
+
+  if (!get_arg_int64(args, "bytes", &bytes, &error_response)) {
+    return error_response;
+  }
+  if (bytes < 0) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kBadArgumentsError, "bytes must not be negative", nullptr));
+  }
+
+  plugin->texture_manager->SetMemoryBudget(bytes);
+  // Fails without harm if CEF is not running, when there is no texture.
+  CefPostTask(TID_UI, base::BindOnce(&evict_textures_on_cef_ui, plugin));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// getTextureMemoryStats
+static FlMethodResponse* plugin_on_get_texture_memory_stats(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  const FlutterWebviewTextureManager::MemoryStats stats =
+      plugin->texture_manager->GetMemoryStats();
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "currentBytes",
+                           fl_value_new_int(stats.current_bytes));
+  fl_value_set_string_take(result, "peakBytes",
+                           fl_value_new_int(stats.peak_bytes));
+  fl_value_set_string_take(result, "budgetBytes",
+                           fl_value_new_int(stats.budget_bytes));
+  fl_value_set_string_take(result, "evictions",
+                           fl_value_new_int(stats.evictions));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// setSnapshotDirectory
+static FlMethodResponse* plugin_on_set_snapshot_directory(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  std::string path;
+
+  if (!get_arg_string(args, "path", &path, &error_response)) {
+    return error_response;
+  }
+
+  if (path.empty()) {
+    plugin->snapshot_cache.reset();
+  } else if (!plugin->snapshot_cache ||
+             plugin->snapshot_cache->directory() != path) {
+    // The existing webviews keep storing their snapshots to the previous
+    // directory.
+    plugin->snapshot_cache =
+        std::make_shared<FlutterWebviewSnapshotCache>(path);
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// setRenderStatsEnabled
+static FlMethodResponse* plugin_on_set_render_stats_enabled(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  bool enabled;
+
+  if (!get_arg_bool(args, "enabled", &enabled, &error_response)) {
+    return error_response;
+  }
+
+  if (enabled && !FlutterWebviewRenderStats::IsEnabled()) {
+    // Start from scratch rather than mixing in the stats of a previous run.
+    for (const auto& entry : plugin->texture_manager->GetTextures()) {
+      entry.second->ring->render_stats().Reset();
+      if (entry.second->staging) {
+        entry.second->staging->render_stats().Reset();
+      }
+    }
+    for (const auto& entry :
+         plugin->texture_manager->GetPixelBufferTextures()) {
+      entry.second->pixel_buffer->render_stats().Reset();
+    }
+  }
+  FlutterWebviewRenderStats::SetEnabled(enabled);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// getRenderStats
+static FlMethodResponse* plugin_on_get_render_stats(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  int64_t webviewId;
+
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+
+  // The stats are kept with the textures, so they can be read here without
+  // going through the CEF UI thread.
+  FlCustomTextureGL* texture = plugin->texture_manager->GetTexture(webviewId);
+  FlCustomTexturePixelBuffer* pixel_buffer_texture =
+      plugin->texture_manager->GetPixelBufferTexture(webviewId);
+  WebviewRenderStats stats;
+  if (texture != nullptr && texture->staging) {
+    stats = texture->staging->render_stats().Snapshot();
+  } else if (texture != nullptr) {
+    stats = texture->ring->render_stats().Snapshot();
+  } else if (pixel_buffer_texture != nullptr) {
+    stats = pixel_buffer_texture->pixel_buffer->render_stats().Snapshot();
+  } else {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        WebviewError::kInvalidWebviewId,
+        WebviewError::kInvalidWebviewIdErrorMessage, nullptr));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  for (const auto& histogram : stats) {
+    FlValue* summary = fl_value_new_map();
+    for (const auto& entry : histogram.second) {
+      fl_value_set_string_take(summary, entry.first.c_str(),
+                               fl_value_new_int(entry.second));
+    }
+    fl_value_set_string_take(result, histogram.first.c_str(), summary);
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// subscribeFrames
+static FlMethodResponse* plugin_on_subscribe_frames_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
 
-        std::unique_ptr<Data> data(new Data{plugin, webview_id, progress});
-        g_idle_add(func, data.release());
-      };
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
 
-  WebviewCreationParams::WebResourceErrorCallback on_web_resource_error =
-      [plugin](WebviewId webview_id, int errorCode,
-               const std::string& description, const std::string& failingUrl) {
+  int64_t webviewId;
+  int64_t tapId;
+  int slotCount;
+  int decimation;
+
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64(args, "tapId", &tapId, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64_to_int(args, "slotCount", &slotCount, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64_to_int(args, "decimation", &decimation,
+                            &error_response)) {
+    return error_response;
+  }
+  if (slotCount < FlutterWebviewFrameTap::kMinSlots ||
+      FlutterWebviewFrameTap::kMaxSlots < slotCount || decimation < 1) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        kBadArgumentsError,
+        "slotCount must be from 1 to 8 and decimation at least 1", nullptr));
+  }
+
+  FlutterWebviewHandler::FrameTappedCallback on_frame_tapped =
+      [plugin, webviewId, tapId](const FlutterWebviewFrameTap::Frame& frame) {
         // On the CEF UI thread
         struct Data {
           FlutterLinuxWebviewPlugin* plugin;
           WebviewId webview_id;
-          int errorCode;
-          std::string description;
-          std::string failingUrl;
+          int64_t tap_id;
+          FlutterWebviewFrameTap::Frame frame;
         };
 
         GSourceFunc func = [](gpointer user_data) -> gboolean {
           // On the plugin main thread
           std::unique_ptr<Data> data(static_cast<Data*>(user_data));
+          const FlutterWebviewFrameTap::Frame& frame = data->frame;
           if (!is_plugin_alive(data->plugin)) {
+            if (frame.fd >= 0) {
+              close(frame.fd);
+            }
             return FALSE;
           }
+          std::vector<int32_t> dirty_rects;
+          dirty_rects.reserve(frame.dirty_rects.size() * 4);
+          for (const WebviewRect& rect : frame.dirty_rects) {
+            dirty_rects.insert(dirty_rects.end(),
+                               {rect.x, rect.y, rect.width, rect.height});
+          }
           g_autoptr(FlValue) args = fl_value_new_map();
           fl_value_set_string_take(args, "webviewId",
                                    fl_value_new_int(data->webview_id));
-          fl_value_set_string_take(args, "errorCode",
-                                   fl_value_new_int(data->errorCode));
+          // Tells the frames of a replaced subscription apart.
+          fl_value_set_string_take(args, "tapId",
+                                   fl_value_new_int(data->tap_id));
+          fl_value_set_string_take(args, "sequence",
+                                   fl_value_new_int(frame.sequence));
+          fl_value_set_string_take(args, "generation",
+                                   fl_value_new_int(frame.generation));
+          fl_value_set_string_take(args, "slot", fl_value_new_int(frame.slot));
+          fl_value_set_string_take(args, "width",
+                                   fl_value_new_int(frame.width));
+          fl_value_set_string_take(args, "height",
+                                   fl_value_new_int(frame.height));
+          fl_value_set_string_take(args, "stride",
+                                   fl_value_new_int(frame.stride));
           fl_value_set_string_take(
-              args, "description",
-              fl_value_new_string_sized(data->description.c_str(),
-                                        data->description.size()));
+              args, "dirtyRects",
+              fl_value_new_int32_list(dirty_rects.data(), dirty_rects.size()));
+          fl_value_set_string_take(args, "droppedFrames",
+                                   fl_value_new_int(frame.dropped_frames));
+          // The Dart side maps the new buffer and closes the descriptor.
           fl_value_set_string_take(
-              args, "failingUrl",
-              fl_value_new_string_sized(data->failingUrl.c_str(),
-                                        data->failingUrl.size()));
+              args, "fd",
+              frame.fd >= 0 ? fl_value_new_int(frame.fd) : fl_value_new_null());
+          fl_value_set_string_take(args, "bufferSize",
+                                   fl_value_new_int(frame.buffer_size));
+          fl_value_set_string_take(args, "slotSize",
+                                   fl_value_new_int(frame.slot_size));
           fl_method_channel_invoke_method(data->plugin->method_channel,
-                                          "onWebResourceError", args, NULL,
-                                          NULL, NULL);
+                                          "onFrameTapped", args, NULL, NULL,
+                                          NULL);
           return FALSE;
         };
 
-        std::unique_ptr<Data> data(
-            new Data{plugin, webview_id, errorCode, description, failingUrl});
+        std::unique_ptr<Data> data(new Data{plugin, webviewId, tapId, frame});
         g_idle_add(func, data.release());
       };
 
-  WebviewCreationParams::JavascriptResultCallback on_javascript_result =
-      [plugin](WebviewId webview_id, int js_run_id, bool was_executed,
-               bool is_exception, const std::string& result,
-               bool is_undefined) {
-        // On the CEF UI thread
-        struct Data {
-          FlutterLinuxWebviewPlugin* plugin;
-          WebviewId webview_id;
-          int js_run_id;
-          bool was_executed;
-          bool is_exception;
-          std::string result;
-          bool is_undefined;
-        };
+  // prevent release
+  g_object_ref(method_call);
+  ReplyCallbackVoid reply_cb{method_call};
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::SubscribeFrames,
+                             webviewId, slotCount, decimation,
+                             std::move(on_frame_tapped), reply_cb));
+  // Will respond later.
+  return nullptr;
+}
 
-        GSourceFunc func = [](gpointer user_data) -> gboolean {
-          // On the plugin main thread
-          std::unique_ptr<Data> data(static_cast<Data*>(user_data));
-          if (!is_plugin_alive(data->plugin)) {
-            return FALSE;
-          }
-          g_autoptr(FlValue) args = fl_value_new_map();
-          fl_value_set_string_take(args, "webviewId",
-                                   fl_value_new_int(data->webview_id));
-          fl_value_set_string_take(args, "jsRunId",
-                                   fl_value_new_int(data->js_run_id));
-          fl_value_set_string_take(args, "wasExecuted",
-                                   fl_value_new_bool(data->was_executed));
-          fl_value_set_string_take(args, "isException",
-                                   fl_value_new_bool(data->is_exception));
-          fl_value_set_string_take(
-              args, "result",
-              fl_value_new_string_sized(data->result.c_str(),
-                                        data->result.size()));
-          fl_value_set_string_take(args, "isUndefined",
-                                   fl_value_new_bool(data->is_undefined));
-          fl_method_channel_invoke_method(data->plugin->method_channel,
-                                          "javascriptResult", args, NULL, NULL,
-                                          NULL);
-          return FALSE;
-        };
+// unsubscribeFrames
+static FlMethodResponse* plugin_on_unsubscribe_frames_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
 
-        std::unique_ptr<Data> data(new Data{plugin, webview_id, js_run_id,
-                                            was_executed, is_exception, result,
-                                            is_undefined});
-        g_idle_add(func, data.release());
-      };
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
 
-  const WebviewCreationParams params{
-      texture->native_texture_id,        // native_texture_id
-      initialWidth,                      // width
-      initialHeight,                     // height
-      std::move(on_paint_begin),         // on_paint_begin
-      std::move(on_paint_end),           // on_paint_end
-      std::move(initialUrl),             // url
-      std::move(backgroundColor),        // background_color
-      std::move(on_page_started),        // on_page_started
-      std::move(on_page_finished),       // on_page_finished
-      std::move(on_progress),            // on_progress
-      std::move(on_web_resource_error),  // on_web_resource_error
-      std::move(on_javascript_result),   // on_javascript_result
-  };
+  int64_t webviewId;
 
-  int64_t fl_texture_id =
-      plugin->texture_manager->GetTextureId(FL_TEXTURE(texture));
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
 
   // prevent release
   g_object_ref(method_call);
-  using DoneCBVoid = FlutterWebviewController::DoneCBVoid;
-  DoneCBVoid callback = [method_call,
-                         fl_texture_id](Nullable<WebviewError> error) {
-    // On the CEF UI thread
-    struct Data {
-      FlMethodCall* method_call;
-      int64_t fl_texture_id;
-      Nullable<WebviewError> error;
-    };
+  ReplyCallbackVoid reply_cb{method_call};
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::UnsubscribeFrames,
+                             webviewId, reply_cb));
+  // Will respond later.
+  return nullptr;
+}
 
-    GSourceFunc func = [](gpointer user_data) -> gboolean {
-      // On the plugin main thread
-      std::unique_ptr<Data> data(static_cast<Data*>(user_data));
-      g_autoptr(FlMethodCall) method_call = data->method_call;
-      if (!data->error.is_null()) {
-        respond_with_webview_error(method_call, data->error.value());
-        return FALSE;
-      }
-      // respond fl_texture_id to the Dart side
-      g_autoptr(FlValue) result = fl_value_new_int(data->fl_texture_id);
-      respond_with_value(method_call, result);
-      return FALSE;
-    };
+// releaseTappedFrame
+static FlMethodResponse* plugin_on_release_tapped_frame(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
 
-    std::unique_ptr<Data> data(
-        new Data{method_call, fl_texture_id, std::move(error)});
-    g_idle_add(func, data.release());
-  };
-  CefPostTask(TID_UI, base::BindOnce(&FlutterWebviewController::CreateBrowser,
-                                     webviewId, params, callback));
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  int64_t webviewId;
+  int64_t generation;
+  int slot;
+
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64(args, "generation", &generation, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_int64_to_int(args, "slot", &slot, &error_response)) {
+    return error_response;
+  }
+
+  // Sent for every frame, so respond without waiting for the CEF UI thread.
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::ReleaseTappedFrame,
+                             webviewId, generation, slot));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// startRecording
+static FlMethodResponse* plugin_on_start_recording_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  int64_t webviewId;
+  std::string path;
+
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+  if (!get_arg_string(args, "path", &path, &error_response)) {
+    return error_response;
+  }
+
+  // prevent release
+  g_object_ref(method_call);
+  ReplyCallbackVoid reply_cb{method_call};
+  CefPostTask(TID_UI,
+              base::BindOnce(&FlutterWebviewController::StartRecording,
+                             webviewId, path, reply_cb));
+  // Will respond later.
+  return nullptr;
+}
+
+// stopRecording
+static FlMethodResponse* plugin_on_stop_recording_async(
+    FlutterLinuxWebviewPlugin* plugin,
+    FlMethodCall* method_call,
+    FlValue* args) {
+  FlMethodResponse* error_response;
+
+  if (!check_args_is_map(args, &error_response)) {
+    return error_response;
+  }
+
+  int64_t webviewId;
+
+  if (!get_arg_int64(args, "webviewId", &webviewId, &error_response)) {
+    return error_response;
+  }
+
+  // prevent release
+  g_object_ref(method_call);
+  ReplyCallbackIntMap reply_cb{method_call};
+  CefPostTask(TID_UI, base::BindOnce(&FlutterWebviewController::StopRecording,
+                                     webviewId, reply_cb));
   // Will respond later.
   return nullptr;
 }
@@ -1405,6 +2517,11 @@ static FlMethodResponse* plugin_on_dispose_browser_async(
         method_call_respond(method_call, response);
         return FALSE;
       }
+      // Recycle the native textures where the GL context is used for painting,
+      // once Flutter has stopped populating them.
+      CefPostDelayedTask(
+          TID_UI, base::BindOnce(&reclaim_textures_on_cef_ui, data->plugin),
+          FlutterWebviewTextureManager::kReclaimDelayMs);
       respond_with_value(method_call, nullptr);
       return FALSE;
     };
@@ -1412,6 +2529,15 @@ static FlMethodResponse* plugin_on_dispose_browser_async(
         new Data{method_call, plugin, webviewId, std::move(error)});
     g_idle_add(func, data.release());
   };
+  WebviewId mirrored_webview_id;
+  if (plugin->texture_manager->GetMirroredWebview(webviewId,
+                                                  &mirrored_webview_id)) {
+    // A mirror has no browser to close.
+    CefPostTask(TID_UI,
+                base::BindOnce(&FlutterWebviewController::RemoveMirror,
+                               mirrored_webview_id, webviewId, callback));
+    return nullptr;
+  }
   CefPostTask(TID_UI, base::BindOnce(&FlutterWebviewController::CloseBrowser,
                                      webviewId, callback));
   // Will respond later.
@@ -1461,9 +2587,12 @@ static FlMethodResponse* plugin_on_shutdown_cef(
         error.code.c_str(), error.message.c_str(), nullptr));
   }
 
-  plugin->texture_manager->UnregisterAndDestroyAllTextures(
-      fl_plugin_registrar_get_texture_registrar(plugin->plugin_registrar),
-      /* skip_unregister_texture= */ false);
+  destroy_all_textures(plugin, /* skip_unregister_texture= */ false);
+  // The browsers have stored their snapshots while closing. Write them before
+  // the app exits.
+  if (plugin->snapshot_cache) {
+    plugin->snapshot_cache->Flush();
+  }
 
   return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
 }
@@ -1510,6 +2639,45 @@ static void flutter_linux_webview_plugin_handle_method_call(
     response = plugin_on_set_cookie_async(self, method_call, args);
   } else if (0 == strcmp(method, "clearCookies")) {
     response = plugin_on_clear_cookies_async(self, method_call, args);
+  } else if (0 == strcmp(method, "setTextureUploadMode")) {
+    response = plugin_on_set_texture_upload_mode_async(self, method_call, args);
+  } else if (0 == strcmp(method, "setTextureBackend")) {
+    response = plugin_on_set_texture_backend(self, method_call, args);
+  } else if (0 == strcmp(method, "setTextureAtlasEnabled")) {
+    response = plugin_on_set_texture_atlas_enabled(self, method_call, args);
+  } else if (0 == strcmp(method, "setFrameRate")) {
+    response = plugin_on_set_frame_rate_async(self, method_call, args);
+  } else if (0 == strcmp(method, "setDamageRefinementEnabled")) {
+    response = plugin_on_set_damage_refinement_enabled_async(self, method_call,
+                                                             args);
+  } else if (0 == strcmp(method, "setVisibility")) {
+    response = plugin_on_set_visibility_async(self, method_call, args);
+  } else if (0 == strcmp(method, "sendExternalBeginFrame")) {
+    response = plugin_on_send_external_begin_frame(self, method_call, args);
+  } else if (0 == strcmp(method, "getRenderCounters")) {
+    response = plugin_on_get_render_counters_async(self, method_call, args);
+  } else if (0 == strcmp(method, "getTexturePoolStats")) {
+    response = plugin_on_get_texture_pool_stats(self, method_call, args);
+  } else if (0 == strcmp(method, "setTextureMemoryBudget")) {
+    response = plugin_on_set_texture_memory_budget(self, method_call, args);
+  } else if (0 == strcmp(method, "getTextureMemoryStats")) {
+    response = plugin_on_get_texture_memory_stats(self, method_call, args);
+  } else if (0 == strcmp(method, "setSnapshotDirectory")) {
+    response = plugin_on_set_snapshot_directory(self, method_call, args);
+  } else if (0 == strcmp(method, "setRenderStatsEnabled")) {
+    response = plugin_on_set_render_stats_enabled(self, method_call, args);
+  } else if (0 == strcmp(method, "getRenderStats")) {
+    response = plugin_on_get_render_stats(self, method_call, args);
+  } else if (0 == strcmp(method, "subscribeFrames")) {
+    response = plugin_on_subscribe_frames_async(self, method_call, args);
+  } else if (0 == strcmp(method, "unsubscribeFrames")) {
+    response = plugin_on_unsubscribe_frames_async(self, method_call, args);
+  } else if (0 == strcmp(method, "releaseTappedFrame")) {
+    response = plugin_on_release_tapped_frame(self, method_call, args);
+  } else if (0 == strcmp(method, "startRecording")) {
+    response = plugin_on_start_recording_async(self, method_call, args);
+  } else if (0 == strcmp(method, "stopRecording")) {
+    response = plugin_on_stop_recording_async(self, method_call, args);
   } else if (0 == strcmp(method, "createBrowser")) {
     response = plugin_on_create_browser_async(self, method_call, args);
   } else if (0 == strcmp(method, "disposeBrowser")) {
@@ -1548,10 +2716,13 @@ static void flutter_linux_webview_plugin_dispose(GObject* object) {
   // non-existent texture", so it seems that the `fl_texture` s are already
   // automatically unregistered from the engine at this point.
   // Therefore we skip fl_texture_registrar_unregister_texture() here.
-  self->texture_manager->UnregisterAndDestroyAllTextures(
-      fl_plugin_registrar_get_texture_registrar(self->plugin_registrar),
-      /* skip_unregister_textures= */ true);
+  self->frame_notifier.reset();
+  destroy_all_textures(self, /* skip_unregister_texture= */ true);
   self->texture_manager.reset();
+  if (self->snapshot_cache) {
+    self->snapshot_cache->Flush();
+    self->snapshot_cache.reset();
+  }
   g_clear_object(&self->method_channel);
   g_clear_object(&self->gdk_gl_context);
   g_clear_object(&self->plugin_registrar);
@@ -1574,6 +2745,29 @@ static void method_call_cb(FlMethodChannel* channel,
   flutter_linux_webview_plugin_handle_method_call(plugin, method_call);
 }
 
+// Hides all the browsers while the toplevel window is minimized.
+static gboolean window_state_event_cb(GtkWidget* widget,
+                                      GdkEventWindowState* event,
+                                      gpointer user_data) {
+  constexpr GdkWindowState kHiddenStates = static_cast<GdkWindowState>(
+      GDK_WINDOW_STATE_ICONIFIED | GDK_WINDOW_STATE_WITHDRAWN);
+  if (event->changed_mask & kHiddenStates) {
+    bool visible = !(event->new_window_state & kHiddenStates);
+    // Fails without harm if CEF is not running, when there is no browser.
+    CefPostTask(TID_UI,
+                base::BindOnce(&FlutterWebviewController::SetWindowVisible,
+                               visible));
+    if (!visible) {
+      // The textures of all the webviews may now be evicted.
+      CefPostTask(TID_UI,
+                  base::BindOnce(&evict_textures_on_cef_ui,
+                                 FLUTTER_LINUX_WEBVIEW_PLUGIN(user_data)));
+    }
+  }
+  // Let the other handlers see the event.
+  return FALSE;
+}
+
 // Entry point of the Flutter Linux platform plugin
 void flutter_linux_webview_plugin_register_with_registrar(
     FlPluginRegistrar* registrar) {
@@ -1591,23 +2785,51 @@ void flutter_linux_webview_plugin_register_with_registrar(
   plugin->method_channel = FL_METHOD_CHANNEL(g_object_ref(channel));
 
   FlView* fl_view = fl_plugin_registrar_get_view(registrar);
+  GtkWidget* toplevel = gtk_widget_get_toplevel(GTK_WIDGET(fl_view));
+  if (GTK_IS_WINDOW(toplevel)) {
+    // Disconnected when the plugin is finalized.
+    g_signal_connect_object(toplevel, "window-state-event",
+                            G_CALLBACK(window_state_event_cb), plugin,
+                            static_cast<GConnectFlags>(0));
+  }
   GdkWindow* window = gtk_widget_get_parent_window(GTK_WIDGET(fl_view));
   g_autoptr(GError) gerror = NULL;
   g_autoptr(GdkGLContext) gl_context =
       gdk_window_create_gl_context(window, &gerror);
+  if (gerror == NULL) {
+    // A context that cannot be realized is not usable either.
+    gdk_gl_context_realize(gl_context, &gerror);
+  }
   if (gerror != NULL) {
-    std::cerr << "Error: gdk_window_create_gl_context() failed:"
-              << gerror->message << std::endl;
+    std::cerr << "Error: Could not create a GL context: " << gerror->message
+              << ". WebViews are drawn to pixel buffer textures." << std::endl;
     plugin->gdk_gl_context = NULL;
   } else {
     // Own the gl context
     plugin->gdk_gl_context = GDK_GL_CONTEXT(g_object_ref(gl_context));
+
+    gdk_gl_context_make_current(plugin->gdk_gl_context);
+    plugin->tile_size = FlutterWebviewTextureRing::GetMaxFrameSize(
+        FlutterWebviewTextureRing::ChooseTarget());
+    // Choose the texture format and measure the uploads here, once, rather
+    // than on the first upload, which may happen on Flutter's raster thread
+    // behind the back of its rasterizer with TextureBackend.rasterUpload.
+    flutter_webview_gl::GetTextureFormat();
+    FlutterWebviewTextureUploader::GetCostModel();
+    FlutterWebviewTextureUploader::ArePixelBuffersFaster();
+    gdk_gl_context_clear_current();
   }
 
+  plugin->texture_backend = TextureBackend::kAuto;
+  plugin->texture_atlas_enabled = false;
+
   // Own the plugin registrar to get a FlTextureRegistrar from it later.
   plugin->plugin_registrar = FL_PLUGIN_REGISTRAR(g_object_ref(registrar));
 
   plugin->texture_manager = std::make_unique<FlutterWebviewTextureManager>();
+  plugin->frame_notifier = std::make_unique<FlutterWebviewFrameNotifier>(
+      plugin->texture_manager.get(),
+      fl_plugin_registrar_get_texture_registrar(registrar));
 
   g_object_unref(plugin);
 }
@@ -0,0 +1,205 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_atlas_packer.h"
+
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <vector>
+
+FlutterWebviewAtlasPacker::FlutterWebviewAtlasPacker(int width,
+                                                     int height,
+                                                     int padding)
+    : width_(width), height_(height), padding_(padding) {
+  Reset();
+}
+
+bool FlutterWebviewAtlasPacker::Place(WebviewId webview_id,
+                                      int width,
+                                      int height,
+                                      std::vector<WebviewId>* moved) {
+  const int space_width = width + padding_;
+  const int space_height = height + padding_;
+  if (width <= 0 || height <= 0 || space_width > width_ ||
+      space_height > height_) {
+    return false;
+  }
+
+  auto it = regions_.find(webview_id);
+  if (it != regions_.end() && space_width <= it->second.space_width &&
+      space_height <= it->second.space_height) {
+    // Keep the space of the larger size, so that growing back is cheap too.
+    it->second.rect.width = width;
+    it->second.rect.height = height;
+    return true;
+  }
+
+  const std::map<WebviewId, Region> previous_regions = regions_;
+  if (it != regions_.end()) {
+    regions_.erase(it);
+  }
+  int x, y;
+  if (Allocate(space_width, space_height, &x, &y)) {
+    regions_[webview_id] =
+        Region{WebviewRect{x, y, width, height}, space_width, space_height};
+    return true;
+  }
+
+  const std::vector<SkylineSegment> previous_skyline = skyline_;
+  std::map<WebviewId, Region> packed = regions_;
+  packed[webview_id] =
+      Region{WebviewRect{0, 0, width, height}, space_width, space_height};
+  if (!Repack(&packed)) {
+    regions_ = previous_regions;
+    skyline_ = previous_skyline;
+    return false;
+  }
+  for (const auto& entry : packed) {
+    auto previous = regions_.find(entry.first);
+    if (previous != regions_.end() &&
+        (previous->second.rect.x != entry.second.rect.x ||
+         previous->second.rect.y != entry.second.rect.y)) {
+      moved->push_back(entry.first);
+    }
+  }
+  regions_.swap(packed);
+  return true;
+}
+
+void FlutterWebviewAtlasPacker::Remove(WebviewId webview_id) {
+  regions_.erase(webview_id);
+  if (regions_.empty()) {
+    Reset();
+  }
+}
+
+bool FlutterWebviewAtlasPacker::GetRegion(WebviewId webview_id,
+                                          WebviewRect* rect) const {
+  auto it = regions_.find(webview_id);
+  if (it == regions_.end()) {
+    return false;
+  }
+  *rect = it->second.rect;
+  return true;
+}
+
+bool FlutterWebviewAtlasPacker::Allocate(int width,
+                                         int height,
+                                         int* x,
+                                         int* y) {
+  // Try every segment as the left edge, and take the lowest bottom, then the
+  // narrowest segment, which leaves the wider ones for wider regions.
+  int best_bottom = INT_MAX;
+  int best_segment_width = INT_MAX;
+  for (size_t i = 0; i < skyline_.size(); ++i) {
+    const int left = skyline_[i].x;
+    if (left + width > width_) {
+      break;
+    }
+    int top = 0;
+    for (size_t j = i; j < skyline_.size() && skyline_[j].x < left + width;
+         ++j) {
+      top = std::max(top, skyline_[j].y);
+    }
+    if (top + height > height_) {
+      continue;
+    }
+    if (top + height < best_bottom ||
+        (top + height == best_bottom &&
+         skyline_[i].width < best_segment_width)) {
+      best_bottom = top + height;
+      best_segment_width = skyline_[i].width;
+      *x = left;
+      *y = top;
+    }
+  }
+  if (best_bottom == INT_MAX) {
+    return false;
+  }
+
+  // Raise the skyline over the new region, cutting the segments under it.
+  const int right = *x + width;
+  std::vector<SkylineSegment> skyline;
+  skyline.reserve(skyline_.size() + 2);
+  for (const SkylineSegment& segment : skyline_) {
+    const int segment_right = segment.x + segment.width;
+    if (segment_right <= *x || right <= segment.x) {
+      skyline.push_back(segment);
+      continue;
+    }
+    if (segment.x < *x) {
+      skyline.push_back(SkylineSegment{segment.x, segment.y, *x - segment.x});
+    }
+    if (skyline.empty() || skyline.back().x + skyline.back().width <= *x) {
+      skyline.push_back(SkylineSegment{*x, best_bottom, width});
+    }
+    if (right < segment_right) {
+      skyline.push_back(
+          SkylineSegment{right, segment.y, segment_right - right});
+    }
+  }
+
+  // Merge the neighbouring segments of the same height.
+  skyline_.clear();
+  for (const SkylineSegment& segment : skyline) {
+    if (!skyline_.empty() && skyline_.back().y == segment.y) {
+      skyline_.back().width += segment.width;
+    } else {
+      skyline_.push_back(segment);
+    }
+  }
+  return true;
+}
+
+bool FlutterWebviewAtlasPacker::Repack(std::map<WebviewId, Region>* regions) {
+  std::vector<Region*> order;
+  order.reserve(regions->size());
+  for (auto& entry : *regions) {
+    order.push_back(&entry.second);
+  }
+  std::stable_sort(order.begin(), order.end(), [](Region* a, Region* b) {
+    if (a->space_height != b->space_height) {
+      return a->space_height > b->space_height;
+    }
+    return a->space_width > b->space_width;
+  });
+
+  Reset();
+  for (Region* region : order) {
+    if (!Allocate(region->space_width, region->space_height, &region->rect.x,
+                  &region->rect.y)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void FlutterWebviewAtlasPacker::Reset() {
+  skyline_.assign(1, SkylineSegment{0, 0, width_});
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_ATLAS_PACKER_H_
+#define LINUX_FLUTTER_WEBVIEW_ATLAS_PACKER_H_
+
+#include <map>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+// Packs the regions of small webviews into a texture atlas.
+//
+// The regions are placed bottom-left along a skyline, i.e. the top edge of the
+// regions placed so far, each at the lowest spot where it fits. The space
+// freed by a removed or shrunk region is not tracked by the skyline; it is
+// reused when the regions are packed again from scratch, which is done
+// whenever a region does not fit in the remaining space.
+//
+// Every region is followed by |padding| pixels to the right and at the bottom,
+// so that filtering at its edges does not pick up its neighbours.
+class FlutterWebviewAtlasPacker {
+ public:
+  FlutterWebviewAtlasPacker(int width, int height, int padding);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // Returns whether no region is placed.
+  bool empty() const { return regions_.empty(); }
+
+  // Places the region of |webview_id| with a size of |width| x |height|, or
+  // resizes it if it is already placed. A resized region stays where it is if
+  // it still fits in the space it was given. Otherwise, it is placed in the
+  // remaining space, or, if there is none, all the regions are packed again.
+  // Returns false, leaving the regions unchanged, if they do not fit even
+  // then. The other webviews whose regions have moved are added to |moved|.
+  bool Place(WebviewId webview_id,
+             int width,
+             int height,
+             std::vector<WebviewId>* moved);
+
+  // Removes the region of |webview_id|, if any.
+  void Remove(WebviewId webview_id);
+
+  // Returns whether |webview_id| has a region, and if so, the region in
+  // |rect|.
+  bool GetRegion(WebviewId webview_id, WebviewRect* rect) const;
+
+ private:
+  struct Region {
+    WebviewRect rect;
+    // The space given to the region, including the padding.
+    int space_width;
+    int space_height;
+  };
+
+  // A horizontal segment of the skyline.
+  struct SkylineSegment {
+    int x;
+    int y;
+    int width;
+  };
+
+  // Finds the lowest spot where |width| x |height| fits above the skyline, and
+  // raises the skyline over it. Returns false if there is no such spot.
+  bool Allocate(int width, int height, int* x, int* y);
+
+  // Places all the |regions| again, tallest first, in an empty atlas. Returns
+  // false if they do not fit.
+  bool Repack(std::map<WebviewId, Region>* regions);
+
+  void Reset();
+
+  int width_;
+  int height_;
+  int padding_;
+  std::map<WebviewId, Region> regions_;
+  // From left to right, covering the whole width of the atlas.
+  std::vector<SkylineSegment> skyline_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_ATLAS_PACKER_H_
@@ -43,6 +43,7 @@
 
 #include "flutter_linux_webview/flutter_webview_types.h"
 #include "flutter_webview_app.h"
+#include "flutter_webview_frame_rate_governor.h"
 #include "flutter_webview_handler.h"
 #include "include/base/cef_callback.h"
 #include "include/base/cef_logging.h"
@@ -71,6 +72,9 @@ FlutterWebviewController::CefState FlutterWebviewController::cef_state_ =
     CefState::kUninitialized;
 FlutterWebviewController::DoneCBVoid FlutterWebviewController::start_cef_cb_;
 FlutterWebviewController::BrowserMap FlutterWebviewController::browser_map_;
+TextureUploadMode FlutterWebviewController::texture_upload_mode_ =
+    TextureUploadMode::kAuto;
+bool FlutterWebviewController::window_visible_ = true;
 
 
 // static
@@ -327,7 +331,8 @@ void FlutterWebviewController::CreateBrowser(
 
   // Specify CEF browser settings here.
   CefBrowserSettings browser_settings;
-  browser_settings.windowless_frame_rate = 60;
+  browser_settings.windowless_frame_rate =
+      FlutterWebviewFrameRateGovernor::kDefaultFrameRate;
 
   // Specify browser_settings.background_color, if any
   if (params.background_color.size() != 0) {
@@ -359,6 +364,8 @@ void FlutterWebviewController::CreateBrowser(
   // Information used when creating the native window.
   CefWindowInfo window_info;
   window_info.windowless_rendering_enabled = true;
+  // The browser then paints only on SendExternalBeginFrame().
+  window_info.external_begin_frame_enabled = params.external_begin_frame;
 
   CefRefPtr<FlutterWebviewHandler> handler(new FlutterWebviewHandler(
       webview_id, params, &OnAfterCreated,
@@ -366,6 +373,8 @@ void FlutterWebviewController::CreateBrowser(
         create_browser_cb(Nullable<WebviewError>());
       },
       &OnBeforeClose));
+  handler->SetTextureUploadMode(texture_upload_mode_);
+  handler->SetWindowVisible(window_visible_);
 
   // Create the browser window.
   CefBrowserHost::CreateBrowser(window_info, handler, initial_url,
@@ -416,6 +425,7 @@ void FlutterWebviewController::SendMouseMove(WebviewId webview_id,
 
   CefRefPtr<CefBrowserHost> host = browser->GetHost();
   host->SendMouseMoveEvent(mouse_event, mouseLeave);
+  static_cast<FlutterWebviewHandler*>(host->GetClient().get())->OnInputEvent();
   done_cb(Nullable<WebviewError>());
 }
 
@@ -444,6 +454,7 @@ void FlutterWebviewController::SendMouseWheel(WebviewId webview_id,
 
   CefRefPtr<CefBrowserHost> host = browser->GetHost();
   host->SendMouseWheelEvent(mouse_event, deltaX, deltaY);
+  static_cast<FlutterWebviewHandler*>(host->GetClient().get())->OnInputEvent();
   done_cb(Nullable<WebviewError>());
 }
 
@@ -490,6 +501,7 @@ void FlutterWebviewController::SendMouseClick(WebviewId webview_id,
 
   CefRefPtr<CefBrowserHost> host = browser->GetHost();
   host->SendMouseClickEvent(mouse_event, button_type, mouseUp, click_count);
+  static_cast<FlutterWebviewHandler*>(host->GetClient().get())->OnInputEvent();
   done_cb(Nullable<WebviewError>());
 }
 
@@ -549,14 +561,17 @@ void FlutterWebviewController::SendKey(WebviewId webview_id,
 
   CefRefPtr<CefBrowserHost> host = browser->GetHost();
   host->SendKeyEvent(key_event);
+  static_cast<FlutterWebviewHandler*>(host->GetClient().get())->OnInputEvent();
   done_cb(Nullable<WebviewError>());
 }
 
 // static
-void FlutterWebviewController::Resize(WebviewId webview_id,
-                                      int width,
-                                      int height,
-                                      const DoneCBVoid& done_cb) {
+void FlutterWebviewController::Resize(
+    WebviewId webview_id,
+    int width,
+    int height,
+    const std::vector<std::shared_ptr<FlutterWebviewTextureRing>>& tile_rings,
+    const DoneCBVoid& done_cb) {
   CEF_REQUIRE_UI_THREAD();
 
   if (width <= 0 || height <= 0) {
@@ -577,11 +592,113 @@ void FlutterWebviewController::Resize(WebviewId webview_id,
   CefRefPtr<CefBrowserHost> host = browser->GetHost();
   FlutterWebviewHandler* handler =
       static_cast<FlutterWebviewHandler*>(host->GetClient().get());
+  handler->SetTileRings(tile_rings);
   handler->SetViewRect(width, height);
   host->WasResized();
   done_cb(Nullable<WebviewError>());
 }
 
+// static
+void FlutterWebviewController::SetAtlasRegion(
+    WebviewId webview_id,
+    std::shared_ptr<FlutterWebviewTextureAtlas> atlas,
+    const WebviewRect& region) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    return;
+  }
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  handler->SetAtlasRegion(std::move(atlas), region);
+}
+
+// static
+void FlutterWebviewController::AddMirror(
+    WebviewId webview_id,
+    WebviewId mirror_id,
+    std::shared_ptr<FlutterWebviewTextureRing> ring,
+    int width,
+    int height,
+    const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (width <= 0 || height <= 0) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kBadArgumentsError,
+                     "width and height must be greater than 0."}));
+    return;
+  }
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kInvalidWebviewId,
+                     WebviewError::kInvalidWebviewIdErrorMessage}));
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  if (!handler->AddMirror(mirror_id, std::move(ring), width, height)) {
+    done_cb(Nullable<WebviewError>(WebviewError{
+        WebviewError::kRuntimeError,
+        "Only a webview drawn to GL textures outside a texture atlas can be "
+        "mirrored."}));
+    return;
+  }
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::ResizeMirror(WebviewId webview_id,
+                                            WebviewId mirror_id,
+                                            int width,
+                                            int height,
+                                            const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (width <= 0 || height <= 0) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kBadArgumentsError,
+                     "width and height must be greater than 0."}));
+    return;
+  }
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    // The mirror keeps its last frame after the browser is closed.
+    done_cb(Nullable<WebviewError>());
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  if (!handler->ResizeMirror(mirror_id, width, height)) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kInvalidWebviewId,
+                     WebviewError::kInvalidWebviewIdErrorMessage}));
+    return;
+  }
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::RemoveMirror(WebviewId webview_id,
+                                            WebviewId mirror_id,
+                                            const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (browser) {
+    FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+        browser->GetHost()->GetClient().get());
+    handler->RemoveMirror(mirror_id);
+  }
+  done_cb(Nullable<WebviewError>());
+}
+
 // static
 void FlutterWebviewController::LoadUrl(WebviewId webview_id,
                                        const std::string& url,
@@ -887,6 +1004,296 @@ void FlutterWebviewController::ClearCookies(
   }
 }
 
+// static
+void FlutterWebviewController::SetTextureUploadMode(TextureUploadMode mode,
+                                                    const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  texture_upload_mode_ = mode;
+  for (const auto& entry : browser_map_) {
+    FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+        entry.second->GetHost()->GetClient().get());
+    handler->SetTextureUploadMode(mode);
+  }
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::SetFrameRate(WebviewId webview_id,
+                                            int frame_rate,
+                                            bool adaptive,
+                                            int min_frame_rate,
+                                            const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kInvalidWebviewId,
+                     WebviewError::kInvalidWebviewIdErrorMessage}));
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  handler->SetFrameRate(frame_rate, adaptive, min_frame_rate);
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::SetDamageRefinementEnabled(
+    WebviewId webview_id,
+    bool enabled,
+    const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kInvalidWebviewId,
+                     WebviewError::kInvalidWebviewIdErrorMessage}));
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  handler->SetDamageRefinementEnabled(enabled);
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::SetVisibility(WebviewId webview_id,
+                                             bool visible,
+                                             bool mute_audio,
+                                             const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kInvalidWebviewId,
+                     WebviewError::kInvalidWebviewIdErrorMessage}));
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  handler->SetVisible(visible, mute_audio);
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::SendExternalBeginFrame(
+    const std::vector<WebviewId>& webview_ids) {
+  CEF_REQUIRE_UI_THREAD();
+
+  for (WebviewId webview_id : webview_ids) {
+    CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+    if (!browser) {
+      continue;
+    }
+    FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+        browser->GetHost()->GetClient().get());
+    handler->SendExternalBeginFrame();
+  }
+}
+
+// static
+void FlutterWebviewController::EvictTextures(
+    const std::function<std::vector<WebviewId>(
+        const std::vector<WebviewTextureUsage>& usages)>& choose_evictions) {
+  CEF_REQUIRE_UI_THREAD();
+
+  std::vector<WebviewTextureUsage> usages;
+  for (const auto& entry : browser_map_) {
+    FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+        entry.second->GetHost()->GetClient().get());
+    WebviewTextureUsage usage;
+    if (handler->GetEvictableTextureUsage(&usage)) {
+      usages.push_back(usage);
+    }
+  }
+  if (usages.empty()) {
+    return;
+  }
+
+  for (WebviewId webview_id : choose_evictions(usages)) {
+    CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+    if (!browser) {
+      continue;
+    }
+    FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+        browser->GetHost()->GetClient().get());
+    handler->EvictTextures();
+  }
+}
+
+// static
+void FlutterWebviewController::SetWindowVisible(bool visible) {
+  CEF_REQUIRE_UI_THREAD();
+  VLOG(1) << __func__ << ": visible=" << visible;
+
+  window_visible_ = visible;
+  for (const auto& entry : browser_map_) {
+    FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+        entry.second->GetHost()->GetClient().get());
+    handler->SetWindowVisible(visible);
+  }
+}
+
+// static
+void FlutterWebviewController::GetRenderCounters(
+    WebviewId webview_id,
+    const DoneCB<const WebviewRenderCounters&>& get_render_counters_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    get_render_counters_cb(
+        Nullable<WebviewError>(
+            WebviewError{WebviewError::kInvalidWebviewId,
+                         WebviewError::kInvalidWebviewIdErrorMessage}),
+        WebviewRenderCounters() /* don't care */);
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  get_render_counters_cb(Nullable<WebviewError>(),
+                         handler->GetRenderCounters());
+}
+
+// static
+void FlutterWebviewController::SubscribeFrames(
+    WebviewId webview_id,
+    int slot_count,
+    int decimation,
+    const FlutterWebviewHandler::FrameTappedCallback& on_frame_tapped,
+    const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kInvalidWebviewId,
+                     WebviewError::kInvalidWebviewIdErrorMessage}));
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  if (!handler->SubscribeFrames(slot_count, decimation, on_frame_tapped)) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kRuntimeError,
+                     "Failed to create the shared memory of the frames."}));
+    return;
+  }
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::UnsubscribeFrames(WebviewId webview_id,
+                                                 const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kInvalidWebviewId,
+                     WebviewError::kInvalidWebviewIdErrorMessage}));
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  handler->UnsubscribeFrames();
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::ReleaseTappedFrame(WebviewId webview_id,
+                                                  int64_t generation,
+                                                  int slot) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    return;
+  }
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  handler->ReleaseTappedFrame(generation, slot);
+}
+
+// static
+void FlutterWebviewController::StartRecording(WebviewId webview_id,
+                                              const std::string& path,
+                                              const DoneCBVoid& done_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kInvalidWebviewId,
+                     WebviewError::kInvalidWebviewIdErrorMessage}));
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  std::string error;
+  if (!handler->StartRecording(path, &error)) {
+    done_cb(Nullable<WebviewError>(
+        WebviewError{WebviewError::kRuntimeError, error}));
+    return;
+  }
+  done_cb(Nullable<WebviewError>());
+}
+
+// static
+void FlutterWebviewController::StopRecording(
+    WebviewId webview_id,
+    const DoneCB<const WebviewRecordingStats&>& stop_recording_cb) {
+  CEF_REQUIRE_UI_THREAD();
+
+  CefRefPtr<CefBrowser> browser = GetBrowserByWebviewId(webview_id);
+  if (!browser) {
+    stop_recording_cb(
+        Nullable<WebviewError>(
+            WebviewError{WebviewError::kInvalidWebviewId,
+                         WebviewError::kInvalidWebviewIdErrorMessage}),
+        WebviewRecordingStats() /* don't care */);
+    return;
+  }
+
+  FlutterWebviewHandler* handler = static_cast<FlutterWebviewHandler*>(
+      browser->GetHost()->GetClient().get());
+  auto on_stopped = [stop_recording_cb](
+                        bool succeeded,
+                        const FlutterWebviewRecorder::Stats& stats) {
+    // On the recorder's writer thread
+    if (!succeeded) {
+      stop_recording_cb(
+          Nullable<WebviewError>(WebviewError{
+              WebviewError::kRuntimeError, "Failed to write the recording."}),
+          WebviewRecordingStats() /* don't care */);
+      return;
+    }
+    stop_recording_cb(Nullable<WebviewError>(),
+                      WebviewRecordingStats{
+                          {"frames", stats.frames},
+                          {"droppedFrames", stats.dropped_frames},
+                          {"bytes", stats.bytes},
+                      });
+  };
+  if (!handler->StopRecording(on_stopped)) {
+    stop_recording_cb(
+        Nullable<WebviewError>(WebviewError{
+            WebviewError::kRuntimeError, "The webview is not being recorded."}),
+        WebviewRecordingStats() /* don't care */);
+  }
+}
+
 // static
 std::string FlutterWebviewController::GetCefStateName(
     const FlutterWebviewController::CefState state) {
@@ -124,11 +124,48 @@ class FlutterWebviewController {
                       const DoneCBVoid& done_cb);
 
   // Sets the rendering resolution of the browser with |webview_id| to |width|
-  // and |height|. |width| and |height| must be greater than 0.
-  static void Resize(WebviewId webview_id,
-                     int width,
-                     int height,
-                     const DoneCBVoid& done_cb);
+  // and |height|. |width| and |height| must be greater than 0. |tile_rings|
+  // are the rings of the tiles after the first one, for a view larger than a
+  // texture can hold.
+  static void Resize(
+      WebviewId webview_id,
+      int width,
+      int height,
+      const std::vector<std::shared_ptr<FlutterWebviewTextureRing>>&
+          tile_rings,
+      const DoneCBVoid& done_cb);
+
+  // Draws the view of the browser specified by |webview_id| to |region| of
+  // |atlas| instead of its own textures, or back to its own textures if
+  // |atlas| is null. Does nothing if the browser does not exist.
+  static void SetAtlasRegion(WebviewId webview_id,
+                             std::shared_ptr<FlutterWebviewTextureAtlas> atlas,
+                             const WebviewRect& region);
+
+  // Draws the view of the browser specified by |webview_id| to |ring| too,
+  // scaled to |width| x |height|, for the mirror texture |mirror_id|. The
+  // mirror has no browser of its own.
+  static void AddMirror(WebviewId webview_id,
+                        WebviewId mirror_id,
+                        std::shared_ptr<FlutterWebviewTextureRing> ring,
+                        int width,
+                        int height,
+                        const DoneCBVoid& done_cb);
+
+  // Changes the size the view of the browser specified by |webview_id| is
+  // scaled to for the mirror texture |mirror_id|.
+  static void ResizeMirror(WebviewId webview_id,
+                           WebviewId mirror_id,
+                           int width,
+                           int height,
+                           const DoneCBVoid& done_cb);
+
+  // Stops drawing the view of the browser specified by |webview_id| to the
+  // mirror texture |mirror_id|. Succeeds if the browser is already closed, so
+  // that the texture can be released.
+  static void RemoveMirror(WebviewId webview_id,
+                           WebviewId mirror_id,
+                           const DoneCBVoid& done_cb);
 
   // Loads the specified url on the main frame of the browser with |webview_id|.
   static void LoadUrl(WebviewId webview_id,
@@ -201,6 +238,93 @@ class FlutterWebviewController {
   // callback |clear_cookies_cb| whether cookies were present before cleaning.
   static void ClearCookies(const DoneCB<bool>& clear_cookies_cb);
 
+  // Sets how the rendering of the browsers is uploaded to their textures. The
+  // |mode| applies to all the existing browsers and the browsers created
+  // afterwards.
+  static void SetTextureUploadMode(TextureUploadMode mode,
+                                   const DoneCBVoid& done_cb);
+
+  // Set the windowless frame rate of the browser specified by |webview_id|. If
+  // |adaptive| is true, the rate is lowered down to |min_frame_rate| while the
+  // browser is idle.
+  static void SetFrameRate(WebviewId webview_id,
+                           int frame_rate,
+                           bool adaptive,
+                           int min_frame_rate,
+                           const DoneCBVoid& done_cb);
+
+  // Sets whether the damage of the view paints of the browser specified by
+  // |webview_id| is narrowed down to the tiles that have changed.
+  static void SetDamageRefinementEnabled(WebviewId webview_id,
+                                         bool enabled,
+                                         const DoneCBVoid& done_cb);
+
+  // Sets whether the widget showing the browser specified by |webview_id| is
+  // visible. A hidden browser stops painting. If |mute_audio| is true, its
+  // audio is also muted while it is hidden.
+  static void SetVisibility(WebviewId webview_id,
+                            bool visible,
+                            bool mute_audio,
+                            const DoneCBVoid& done_cb);
+
+  // Sets whether the window containing the Flutter view is visible, i.e. not
+  // minimized. All the browsers are hidden while the window is not visible.
+  static void SetWindowVisible(bool visible);
+
+  // Sends a begin frame to each browser of |webview_ids| that was created with
+  // WebviewCreationParams::external_begin_frame, so that it produces a frame.
+  // The IDs of closed browsers are ignored, since a webview may be disposed
+  // while its begin frame is in flight.
+  static void SendExternalBeginFrame(const std::vector<WebviewId>& webview_ids);
+
+  // Collects the texture memory of the hidden browsers that can release it,
+  // and has the browsers picked out of them by |choose_evictions| shrink their
+  // textures. The view of such a browser is repainted when it is shown.
+  static void EvictTextures(
+      const std::function<std::vector<WebviewId>(
+          const std::vector<WebviewTextureUsage>& usages)>& choose_evictions);
+
+  // Get the counters of the texture updates of the browser specified by
+  // |webview_id|. The counters are given as |result| in the callback
+  // |get_render_counters_cb|.
+  static void GetRenderCounters(
+      WebviewId webview_id,
+      const DoneCB<const WebviewRenderCounters&>& get_render_counters_cb);
+
+  // Starts publishing every |decimation|th paint of the browser specified by
+  // |webview_id| to |on_frame_tapped| through a shared memory ring of
+  // |slot_count| frames, replacing the previous subscription.
+  static void SubscribeFrames(
+      WebviewId webview_id,
+      int slot_count,
+      int decimation,
+      const FlutterWebviewHandler::FrameTappedCallback& on_frame_tapped,
+      const DoneCBVoid& done_cb);
+
+  // Stops publishing the paints of the browser specified by |webview_id|.
+  static void UnsubscribeFrames(WebviewId webview_id,
+                                const DoneCBVoid& done_cb);
+
+  // Gives back a frame published to the subscriber of the browser specified
+  // by |webview_id|. Ignored if the browser is closed or has unsubscribed,
+  // since the release may be in flight then.
+  static void ReleaseTappedFrame(WebviewId webview_id,
+                                 int64_t generation,
+                                 int slot);
+
+  // Starts recording the paints of the browser specified by |webview_id| to
+  // the file at |path|.
+  static void StartRecording(WebviewId webview_id,
+                             const std::string& path,
+                             const DoneCBVoid& done_cb);
+
+  // Stops the recording of the browser specified by |webview_id|. The
+  // callback |stop_recording_cb| is called, on the recorder's writer thread,
+  // with the totals of the recording as |result| once the file is complete.
+  static void StopRecording(
+      WebviewId webview_id,
+      const DoneCB<const WebviewRecordingStats&>& stop_recording_cb);
+
  private:
   enum class CefState {
     // The initial state
@@ -255,6 +379,8 @@ class FlutterWebviewController {
   static CefState cef_state_;
   static DoneCBVoid start_cef_cb_;
   static BrowserMap browser_map_;
+  static TextureUploadMode texture_upload_mode_;
+  static bool window_visible_;
 };
 
 #endif  // LINUX_FLUTTER_WEBVIEW_CONTROLLER_H_
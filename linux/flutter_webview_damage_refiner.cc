@@ -0,0 +1,144 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_damage_refiner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_pixel_conversion.h"
+
+namespace {
+
+constexpr int kBytesPerPixel = 4;
+
+}  // namespace
+
+constexpr int FlutterWebviewDamageRefiner::kTileSize;
+
+FlutterWebviewDamageRefiner::FlutterWebviewDamageRefiner()
+    : width_(0), height_(0) {}
+
+std::vector<WebviewRect> FlutterWebviewDamageRefiner::Refine(
+    const void* bgra,
+    int width,
+    int height,
+    const std::vector<WebviewRect>& dirty_rects) {
+  const uint8_t* pixels = static_cast<const uint8_t*>(bgra);
+  if (previous_frame_.empty() || width != width_ || height != height_) {
+    // Nothing to compare with. The browser's buffer holds the whole view, so
+    // it is all kept for the next frame.
+    previous_frame_.assign(
+        pixels, pixels + static_cast<size_t>(width) * height * kBytesPerPixel);
+    width_ = width;
+    height_ = height;
+    return dirty_rects;
+  }
+
+  counters_.frames++;
+  std::vector<WebviewRect> changed_rects;
+  for (const WebviewRect& rect : dirty_rects) {
+    const int left = std::max(rect.x, 0);
+    const int top = std::max(rect.y, 0);
+    const int right = std::min(rect.x + rect.width, width_);
+    const int bottom = std::min(rect.y + rect.height, height_);
+    if (left >= right || top >= bottom) {
+      continue;
+    }
+
+    for (int tile_top = top; tile_top < bottom;) {
+      const int tile_bottom =
+          std::min((tile_top / kTileSize + 1) * kTileSize, bottom);
+      // The changed tiles of a row are returned as runs.
+      int run_left = -1;
+      int run_right = -1;
+      for (int tile_left = left; tile_left < right;) {
+        const int tile_right =
+            std::min((tile_left / kTileSize + 1) * kTileSize, right);
+        counters_.compared_tiles++;
+        if (CompareAndCopy(pixels,
+                           WebviewRect{tile_left, tile_top,
+                                       tile_right - tile_left,
+                                       tile_bottom - tile_top})) {
+          if (run_left < 0) {
+            run_left = tile_left;
+          }
+          run_right = tile_right;
+        } else {
+          counters_.unchanged_tiles++;
+          if (run_left >= 0) {
+            changed_rects.push_back(WebviewRect{run_left, tile_top,
+                                                run_right - run_left,
+                                                tile_bottom - tile_top});
+            run_left = -1;
+          }
+        }
+        tile_left = tile_right;
+      }
+      if (run_left >= 0) {
+        changed_rects.push_back(WebviewRect{
+            run_left, tile_top, run_right - run_left, tile_bottom - tile_top});
+      }
+      tile_top = tile_bottom;
+    }
+  }
+
+  if (changed_rects.empty()) {
+    counters_.unchanged_frames++;
+  }
+  return changed_rects;
+}
+
+bool FlutterWebviewDamageRefiner::CompareAndCopy(const uint8_t* pixels,
+                                                 const WebviewRect& rect) {
+  const size_t stride = static_cast<size_t>(width_) * kBytesPerPixel;
+  const size_t offset = static_cast<size_t>(rect.x) * kBytesPerPixel;
+  for (int row = rect.y; row < rect.y + rect.height; ++row) {
+    const uint8_t* source = pixels + row * stride + offset;
+    uint8_t* previous = previous_frame_.data() + row * stride + offset;
+    if (flutter_webview_pixels::PixelsEqual(source, previous, rect.width)) {
+      continue;
+    }
+    // The rows above are already equal.
+    const size_t length = static_cast<size_t>(rect.width) * kBytesPerPixel;
+    for (; row < rect.y + rect.height; ++row) {
+      std::memcpy(previous_frame_.data() + row * stride + offset,
+                  pixels + row * stride + offset, length);
+    }
+    return true;
+  }
+  return false;
+}
+
+void FlutterWebviewDamageRefiner::Reset() {
+  std::vector<uint8_t>().swap(previous_frame_);
+  width_ = 0;
+  height_ = 0;
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_DAMAGE_REFINER_H_
+#define LINUX_FLUTTER_WEBVIEW_DAMAGE_REFINER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+// Narrows the dirty rectangles reported by the browser down to the pixels that
+// actually changed.
+//
+// CEF often reports the whole view as dirty, e.g. after a scroll, a CSS
+// animation or a resize, even when most of it is unchanged. The refiner keeps
+// a copy of the previous frame and compares the dirty rectangles with it in
+// kTileSize x kTileSize tiles, with the SIMD kernel of
+// flutter_webview_pixels::PixelsEqual(). Only the tiles that differ are
+// returned, and copied over the previous frame.
+class FlutterWebviewDamageRefiner {
+ public:
+  // The width and height of the tiles compared.
+  static constexpr int kTileSize = 64;
+
+  // Statistics accumulated over the calls to Refine.
+  struct Counters {
+    // The number of frames compared with the previous one.
+    int64_t frames = 0;
+    // The number of those whose dirty rectangles were all unchanged.
+    int64_t unchanged_frames = 0;
+    // The number of parts of a tile compared, out of which |unchanged_tiles|
+    // were found equal and left out.
+    int64_t compared_tiles = 0;
+    int64_t unchanged_tiles = 0;
+  };
+
+  FlutterWebviewDamageRefiner();
+
+  // Returns the parts of |dirty_rects| that differ from the previous frame,
+  // with horizontally adjacent changed tiles merged. |bgra| is the whole frame,
+  // |width| x |height| BGRA pixels. Returns |dirty_rects| as is when there is
+  // no previous frame of the same size, i.e. on the first call, after a resize
+  // and after Reset.
+  std::vector<WebviewRect> Refine(const void* bgra,
+                                  int width,
+                                  int height,
+                                  const std::vector<WebviewRect>& dirty_rects);
+
+  // Forgets the previous frame, so that the next frame is returned as
+  // reported, and frees its copy. Called when the destination needs the dirty
+  // pixels regardless of whether they changed.
+  void Reset();
+
+  const Counters& counters() const { return counters_; }
+
+ private:
+  // Compares |rect| of |pixels| with the previous frame and, if it differs,
+  // copies it from the first differing row. Returns whether it differed.
+  bool CompareAndCopy(const uint8_t* pixels, const WebviewRect& rect);
+
+  std::vector<uint8_t> previous_frame_;
+  int width_;
+  int height_;
+  Counters counters_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_DAMAGE_REFINER_H_
@@ -0,0 +1,157 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_frame_notifier.h"
+
+#include <flutter_linux/flutter_linux.h>
+#include <glib.h>
+
+#include <iostream>
+
+#include "flutter_linux_webview/fl_custom_texture_gl.h"
+#include "flutter_linux_webview/fl_custom_texture_pixel_buffer.h"
+#include "flutter_webview_pixel_buffer.h"
+#include "flutter_webview_staging_buffer.h"
+#include "flutter_webview_texture_manager.h"
+#include "flutter_webview_texture_ring.h"
+
+FlutterWebviewFrameNotifier::FlutterWebviewFrameNotifier(
+    FlutterWebviewTextureManager* texture_manager,
+    FlTextureRegistrar* texture_registrar)
+    : texture_manager_(texture_manager),
+      texture_registrar_(FL_TEXTURE_REGISTRAR(g_object_ref(texture_registrar))),
+      main_context_(g_main_context_ref(g_main_context_default())) {
+  static GSourceFuncs source_funcs = {Prepare, Check, Dispatch, nullptr,
+                                      nullptr, nullptr};
+  source_ = g_source_new(&source_funcs, sizeof(Source));
+  reinterpret_cast<Source*>(source_)->notifier = this;
+  // Dispatch before the redraws and the idle callbacks of GTK, so that the
+  // frames reach Flutter's next vsync.
+  g_source_set_priority(source_, G_PRIORITY_HIGH);
+  g_source_set_name(source_, "FlutterWebviewFrameNotifier");
+  g_source_attach(source_, main_context_);
+}
+
+FlutterWebviewFrameNotifier::~FlutterWebviewFrameNotifier() {
+  g_source_destroy(source_);
+  g_source_unref(source_);
+  g_main_context_unref(main_context_);
+  g_object_unref(texture_registrar_);
+}
+
+void FlutterWebviewFrameNotifier::Wakeup() {
+  g_main_context_wakeup(main_context_);
+}
+
+// static
+gboolean FlutterWebviewFrameNotifier::Prepare(GSource* source, gint* timeout) {
+  *timeout = -1;
+  return reinterpret_cast<Source*>(source)->notifier->HasFramesToNotify();
+}
+
+// static
+gboolean FlutterWebviewFrameNotifier::Check(GSource* source) {
+  return reinterpret_cast<Source*>(source)->notifier->HasFramesToNotify();
+}
+
+// static
+gboolean FlutterWebviewFrameNotifier::Dispatch(GSource* source,
+                                               GSourceFunc callback,
+                                               gpointer user_data) {
+  reinterpret_cast<Source*>(source)->notifier->NotifyFrames();
+  return G_SOURCE_CONTINUE;
+}
+
+bool FlutterWebviewFrameNotifier::HasFramesToNotify() const {
+  for (const auto& entry : texture_manager_->GetTextures()) {
+    FlCustomTextureGL* texture = entry.second;
+    if (texture->staging
+            ? texture->staging->NeedsFrameAvailableNotification()
+            : texture->ring->NeedsFrameAvailableNotification()) {
+      return true;
+    }
+  }
+  for (const auto& entry : texture_manager_->GetTileTextures()) {
+    for (FlCustomTextureGL* texture : entry.second) {
+      if (texture->ring->NeedsFrameAvailableNotification()) {
+        return true;
+      }
+    }
+  }
+  for (FlCustomTextureGL* texture : texture_manager_->GetAtlasTextures()) {
+    if (texture->ring->NeedsFrameAvailableNotification()) {
+      return true;
+    }
+  }
+  for (const auto& entry : texture_manager_->GetPixelBufferTextures()) {
+    if (entry.second->pixel_buffer->NeedsFrameAvailableNotification()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void FlutterWebviewFrameNotifier::NotifyFrames() {
+  for (const auto& entry : texture_manager_->GetTextures()) {
+    FlCustomTextureGL* texture = entry.second;
+    if (texture->staging
+            ? texture->staging->TakeFrameAvailableNotification()
+            : texture->ring->TakeFrameAvailableNotification()) {
+      MarkFrameAvailable(entry.first, FL_TEXTURE(texture));
+    }
+  }
+  for (const auto& entry : texture_manager_->GetTileTextures()) {
+    for (FlCustomTextureGL* texture : entry.second) {
+      if (texture->ring->TakeFrameAvailableNotification()) {
+        MarkFrameAvailable(entry.first, FL_TEXTURE(texture));
+      }
+    }
+  }
+  for (FlCustomTextureGL* texture : texture_manager_->GetAtlasTextures()) {
+    if (texture->ring->TakeFrameAvailableNotification()) {
+      // An atlas has no webview ID of its own.
+      MarkFrameAvailable(-1, FL_TEXTURE(texture));
+    }
+  }
+  for (const auto& entry : texture_manager_->GetPixelBufferTextures()) {
+    FlCustomTexturePixelBuffer* texture = entry.second;
+    if (texture->pixel_buffer->TakeFrameAvailableNotification()) {
+      MarkFrameAvailable(entry.first, FL_TEXTURE(texture));
+    }
+  }
+}
+
+void FlutterWebviewFrameNotifier::MarkFrameAvailable(WebviewId webview_id,
+                                                     FlTexture* texture) {
+  if (!fl_texture_registrar_mark_texture_frame_available(texture_registrar_,
+                                                         texture)) {
+    std::cerr << "Error: fl_texture_registrar_mark_texture_frame_available() "
+                 "failed for webview_id="
+              << webview_id << std::endl;
+  }
+}
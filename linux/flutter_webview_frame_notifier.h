@@ -0,0 +1,79 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_FRAME_NOTIFIER_H_
+#define LINUX_FLUTTER_WEBVIEW_FRAME_NOTIFIER_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <glib.h>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_texture_manager.h"
+
+// Tells Flutter which webview textures have new frames.
+//
+// A single GSource with a high priority is attached to the platform thread's
+// main context for the whole plugin. Painting a frame only wakes the main
+// context up (Wakeup() is callable from any thread); the source then marks
+// every texture with an unpresented frame as available in one dispatch. A
+// texture already marked is not marked again until Flutter has acquired a
+// frame from it, since Flutter takes the newest frame at that point anyway.
+class FlutterWebviewFrameNotifier {
+ public:
+  // |texture_manager| must outlive this notifier.
+  FlutterWebviewFrameNotifier(FlutterWebviewTextureManager* texture_manager,
+                              FlTextureRegistrar* texture_registrar);
+  ~FlutterWebviewFrameNotifier();
+
+  // Makes the source check the textures for new frames. May be called on any
+  // thread.
+  void Wakeup();
+
+ private:
+  struct Source {
+    GSource source;
+    FlutterWebviewFrameNotifier* notifier;
+  };
+
+  static gboolean Prepare(GSource* source, gint* timeout);
+  static gboolean Check(GSource* source);
+  static gboolean Dispatch(GSource* source,
+                           GSourceFunc callback,
+                           gpointer user_data);
+
+  bool HasFramesToNotify() const;
+  void NotifyFrames();
+  void MarkFrameAvailable(WebviewId webview_id, FlTexture* texture);
+
+  FlutterWebviewTextureManager* texture_manager_;
+  FlTextureRegistrar* texture_registrar_;
+  GMainContext* main_context_;
+  GSource* source_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_FRAME_NOTIFIER_H_
@@ -0,0 +1,93 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_frame_rate_governor.h"
+
+#include <algorithm>
+
+constexpr int FlutterWebviewFrameRateGovernor::kMinFrameRate;
+constexpr int FlutterWebviewFrameRateGovernor::kMaxFrameRate;
+constexpr int FlutterWebviewFrameRateGovernor::kDefaultFrameRate;
+constexpr int FlutterWebviewFrameRateGovernor::kDefaultMinAdaptiveFrameRate;
+constexpr int FlutterWebviewFrameRateGovernor::kPeriodMs;
+
+FlutterWebviewFrameRateGovernor::FlutterWebviewFrameRateGovernor()
+    : frame_rate_(kDefaultFrameRate),
+      adaptive_(false),
+      min_frame_rate_(kDefaultMinAdaptiveFrameRate),
+      current_frame_rate_(kDefaultFrameRate),
+      paints_in_period_(0) {}
+
+void FlutterWebviewFrameRateGovernor::SetFrameRate(int frame_rate,
+                                                   bool adaptive,
+                                                   int min_frame_rate) {
+  frame_rate_ = std::max(kMinFrameRate, std::min(frame_rate, kMaxFrameRate));
+  adaptive_ = adaptive;
+  min_frame_rate_ =
+      std::max(kMinFrameRate, std::min(min_frame_rate, frame_rate_));
+  paints_in_period_ = 0;
+  SetCurrentFrameRate(frame_rate_);
+}
+
+bool FlutterWebviewFrameRateGovernor::OnInput() {
+  return SetCurrentFrameRate(frame_rate_);
+}
+
+bool FlutterWebviewFrameRateGovernor::OnPaint(double damage_ratio) {
+  ++paints_in_period_;
+  if (adaptive_ && damage_ratio >= kLargeDamageRatio) {
+    return SetCurrentFrameRate(frame_rate_);
+  }
+  return false;
+}
+
+bool FlutterWebviewFrameRateGovernor::OnPeriodElapsed() {
+  if (!adaptive_) {
+    return false;
+  }
+
+  const double paints_per_second = paints_in_period_ * 1000.0 / kPeriodMs;
+  paints_in_period_ = 0;
+
+  if (paints_per_second >= current_frame_rate_ * kRaiseRatio) {
+    return SetCurrentFrameRate(std::min(current_frame_rate_ * 2, frame_rate_));
+  }
+  if (paints_per_second < current_frame_rate_ * kLowerRatio) {
+    return SetCurrentFrameRate(
+        std::max(current_frame_rate_ / 2, min_frame_rate_));
+  }
+  return false;
+}
+
+bool FlutterWebviewFrameRateGovernor::SetCurrentFrameRate(int frame_rate) {
+  if (frame_rate == current_frame_rate_) {
+    return false;
+  }
+  current_frame_rate_ = frame_rate;
+  return true;
+}
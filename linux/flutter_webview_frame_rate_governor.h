@@ -0,0 +1,90 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_FRAME_RATE_GOVERNOR_H_
+#define LINUX_FLUTTER_WEBVIEW_FRAME_RATE_GOVERNOR_H_
+
+// Decides the windowless frame rate of a browser.
+//
+// The frame rate is the one set with SetFrameRate unless the governor is
+// adaptive. An adaptive governor halves the rate, down to the minimum, while
+// the browser paints less than kLowerRatio of its frames, and doubles it while
+// the paints keep up with the rate. Input events and paints damaging at least
+// kLargeDamageRatio of the view restore the full rate at once, so that
+// interaction is not throttled.
+class FlutterWebviewFrameRateGovernor {
+ public:
+  // The range accepted by CefBrowserHost::SetWindowlessFrameRate.
+  static constexpr int kMinFrameRate = 1;
+  static constexpr int kMaxFrameRate = 60;
+  static constexpr int kDefaultFrameRate = 60;
+  static constexpr int kDefaultMinAdaptiveFrameRate = 5;
+
+  // The interval at which OnPeriodElapsed is expected to be called.
+  static constexpr int kPeriodMs = 1000;
+
+  FlutterWebviewFrameRateGovernor();
+
+  // Sets the full frame rate. If |adaptive| is true, the rate may be lowered
+  // down to |min_frame_rate| while the browser is idle.
+  void SetFrameRate(int frame_rate, bool adaptive, int min_frame_rate);
+
+  bool adaptive() const { return adaptive_; }
+
+  // The frame rate the browser should currently run at.
+  int current_frame_rate() const { return current_frame_rate_; }
+
+  // The following methods return whether current_frame_rate() has changed.
+
+  // Called when an input event is sent to the browser.
+  bool OnInput();
+
+  // Called when the browser paints the view. |damage_ratio| is the ratio of
+  // the damaged area to the area of the view.
+  bool OnPaint(double damage_ratio);
+
+  // Called every kPeriodMs while adaptive() is true.
+  bool OnPeriodElapsed();
+
+ private:
+  // The rate is lowered if fewer frames than this ratio of the current rate
+  // were painted in a period, and raised if more than kRaiseRatio were.
+  static constexpr double kLowerRatio = 0.4;
+  static constexpr double kRaiseRatio = 0.8;
+  static constexpr double kLargeDamageRatio = 0.25;
+
+  bool SetCurrentFrameRate(int frame_rate);
+
+  int frame_rate_;
+  bool adaptive_;
+  int min_frame_rate_;
+  int current_frame_rate_;
+  int paints_in_period_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_FRAME_RATE_GOVERNOR_H_
@@ -0,0 +1,258 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_frame_tap.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+namespace {
+
+// Above this number, the damage of a frame or the stale regions of a slot are
+// replaced with their bounding box.
+constexpr size_t kMaxDamageRects = 16;
+
+constexpr int kBytesPerPixel = 4;
+
+// Identifies the buffers of all the taps, so that a release sent for the
+// buffer of a previous tap of the same webview is ignored.
+int64_t last_generation = 0;
+
+WebviewRect BoundingBoxOf(const std::vector<WebviewRect>& rects) {
+  int left = rects[0].x;
+  int top = rects[0].y;
+  int right = rects[0].x + rects[0].width;
+  int bottom = rects[0].y + rects[0].height;
+  for (const WebviewRect& rect : rects) {
+    left = std::min(left, rect.x);
+    top = std::min(top, rect.y);
+    right = std::max(right, rect.x + rect.width);
+    bottom = std::max(bottom, rect.y + rect.height);
+  }
+  return WebviewRect{left, top, right - left, bottom - top};
+}
+
+void AddDamage(std::vector<WebviewRect>* damage,
+               const std::vector<WebviewRect>& rects) {
+  damage->insert(damage->end(), rects.begin(), rects.end());
+  if (damage->size() > kMaxDamageRects) {
+    damage->assign(1, BoundingBoxOf(*damage));
+  }
+}
+
+}  // namespace
+
+constexpr int FlutterWebviewFrameTap::kMinSlots;
+constexpr int FlutterWebviewFrameTap::kMaxSlots;
+
+// static
+std::unique_ptr<FlutterWebviewFrameTap> FlutterWebviewFrameTap::Create(
+    int slot_count,
+    int decimation,
+    int width,
+    int height) {
+  std::unique_ptr<FlutterWebviewFrameTap> tap(
+      new FlutterWebviewFrameTap(slot_count, decimation));
+  if (!tap->Allocate(static_cast<size_t>(width) * height * kBytesPerPixel)) {
+    return nullptr;
+  }
+  return tap;
+}
+
+FlutterWebviewFrameTap::FlutterWebviewFrameTap(int slot_count, int decimation)
+    : decimation_(decimation),
+      slots_(slot_count),
+      fd_(-1),
+      memory_(nullptr),
+      slot_size_(0),
+      generation_(0),
+      fd_sent_(false),
+      sequence_(0),
+      width_(0),
+      height_(0),
+      dropped_frames_(0) {}
+
+FlutterWebviewFrameTap::~FlutterWebviewFrameTap() {
+  // The subscriber keeps its own mapping, which stays valid after this.
+  if (memory_ != nullptr) {
+    munmap(memory_, slot_size_ * slots_.size());
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+bool FlutterWebviewFrameTap::Allocate(size_t slot_size) {
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  slot_size = std::max((slot_size + page_size - 1) / page_size * page_size,
+                       page_size);
+  const size_t buffer_size = slot_size * slots_.size();
+
+  const int fd = memfd_create("flutter_webview_frame_tap", MFD_CLOEXEC);
+  if (fd < 0) {
+    std::cerr << "Error: memfd_create() failed: " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+  if (ftruncate(fd, static_cast<off_t>(buffer_size)) != 0) {
+    std::cerr << "Error: ftruncate() of the frame tap buffer failed: "
+              << std::strerror(errno) << std::endl;
+    close(fd);
+    return false;
+  }
+  void* memory =
+      mmap(nullptr, buffer_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    std::cerr << "Error: mmap() of the frame tap buffer failed: "
+              << std::strerror(errno) << std::endl;
+    close(fd);
+    return false;
+  }
+
+  if (memory_ != nullptr) {
+    munmap(memory_, slot_size_ * slots_.size());
+    close(fd_);
+  }
+  fd_ = fd;
+  memory_ = static_cast<uint8_t*>(memory);
+  slot_size_ = slot_size;
+  generation_ = ++last_generation;
+  fd_sent_ = false;
+
+  // The slots held by the subscriber are in the previous buffer, and the new
+  // one holds nothing yet.
+  const WebviewRect whole{0, 0, width_, height_};
+  for (Slot& slot : slots_) {
+    slot.held = false;
+    slot.stale_rects.assign(1, whole);
+  }
+  return true;
+}
+
+bool FlutterWebviewFrameTap::Publish(
+    const void* buffer,
+    int width,
+    int height,
+    const std::vector<WebviewRect>& dirty_rects,
+    Frame* frame) {
+  ++sequence_;
+
+  if (width != width_ || height != height_) {
+    width_ = width;
+    height_ = height;
+    const WebviewRect whole{0, 0, width, height};
+    pending_damage_.assign(1, whole);
+    for (Slot& slot : slots_) {
+      slot.stale_rects.assign(1, whole);
+    }
+  } else {
+    AddDamage(&pending_damage_, dirty_rects);
+  }
+
+  if (sequence_ % decimation_ != 0) {
+    return false;
+  }
+
+  const size_t stride = static_cast<size_t>(width) * kBytesPerPixel;
+  if (stride * height > slot_size_ && !Allocate(stride * height)) {
+    // Keep the smaller buffer and try again on the next paint.
+    ++dropped_frames_;
+    return false;
+  }
+
+  auto slot_it = std::find_if(slots_.begin(), slots_.end(),
+                              [](const Slot& slot) { return !slot.held; });
+  if (slot_it == slots_.end()) {
+    ++dropped_frames_;
+    return false;
+  }
+
+  // Bring the slot up to date with this paint. CEF's buffer holds the whole
+  // view, so the regions the slot missed are copied from it too.
+  Slot& slot = *slot_it;
+  AddDamage(&slot.stale_rects, pending_damage_);
+  const uint8_t* src = static_cast<const uint8_t*>(buffer);
+  uint8_t* dst = memory_ + (slot_it - slots_.begin()) * slot_size_;
+  for (const WebviewRect& rect : slot.stale_rects) {
+    const size_t offset = rect.y * stride + rect.x * kBytesPerPixel;
+    const size_t row_size = static_cast<size_t>(rect.width) * kBytesPerPixel;
+    for (int row = 0; row < rect.height; ++row) {
+      std::memcpy(dst + offset + row * stride, src + offset + row * stride,
+                  row_size);
+    }
+  }
+  slot.stale_rects.clear();
+  slot.held = true;
+  for (Slot& other : slots_) {
+    if (&other != &slot) {
+      AddDamage(&other.stale_rects, pending_damage_);
+    }
+  }
+
+  frame->sequence = sequence_;
+  frame->generation = generation_;
+  frame->slot = static_cast<int>(slot_it - slots_.begin());
+  frame->width = width;
+  frame->height = height;
+  frame->stride = static_cast<int>(stride);
+  frame->dirty_rects.swap(pending_damage_);
+  pending_damage_.clear();
+  frame->dropped_frames = dropped_frames_;
+  dropped_frames_ = 0;
+  frame->fd = -1;
+  if (!fd_sent_) {
+    frame->fd = fcntl(fd_, F_DUPFD_CLOEXEC, 0);
+    if (frame->fd < 0) {
+      std::cerr << "Error: dup of the frame tap buffer failed: "
+                << std::strerror(errno) << std::endl;
+    } else {
+      fd_sent_ = true;
+    }
+  }
+  frame->buffer_size = static_cast<int64_t>(slot_size_ * slots_.size());
+  frame->slot_size = static_cast<int64_t>(slot_size_);
+  return true;
+}
+
+void FlutterWebviewFrameTap::Release(int64_t generation, int slot) {
+  if (generation != generation_ || slot < 0 ||
+      slot >= static_cast<int>(slots_.size())) {
+    return;
+  }
+  slots_[slot].held = false;
+}
@@ -0,0 +1,135 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_FRAME_TAP_H_
+#define LINUX_FLUTTER_WEBVIEW_FRAME_TAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+// Publishes the view paints of a webview to a subscriber, such as Dart code
+// doing OCR or streaming the view, through a ring of BGRA images in a memfd
+// shared memory buffer. The subscriber maps the buffer itself and reads the
+// frames in place, so a frame is copied once, from CEF's buffer to the shared
+// memory, and not at all when nobody subscribes, since no tap exists then.
+//
+// A published frame's slot belongs to the subscriber until it is released.
+// The tap writes only free slots; a paint that finds none is dropped, and its
+// damage is reported with the next published frame. As in
+// FlutterWebviewPixelBuffer, a slot being reused first gets the regions it
+// missed copied, here from CEF's buffer, so only damaged rows are copied.
+//
+// Accessed only on the CEF UI thread.
+class FlutterWebviewFrameTap {
+ public:
+  static constexpr int kMinSlots = 1;
+  static constexpr int kMaxSlots = 8;
+
+  // A frame written to the shared memory.
+  struct Frame {
+    // Increases by one for each view paint, including the dropped and
+    // decimated ones.
+    int64_t sequence;
+    // Identifies the shared memory buffer holding the frame.
+    int64_t generation;
+    int slot;
+    int width;
+    int height;
+    int stride;
+    // The regions that differ from the previous published frame. The whole
+    // frame if its size differs.
+    std::vector<WebviewRect> dirty_rects;
+    // The paints dropped since the previous published frame because every
+    // slot was held by the subscriber.
+    int dropped_frames;
+    // A new descriptor of the shared memory buffer, given with the first frame
+    // of each generation and owned by the receiver, or -1.
+    int fd;
+    // The size of the buffer and the offset between two slots, in bytes.
+    int64_t buffer_size;
+    int64_t slot_size;
+  };
+
+  // Returns a tap publishing every |decimation|th view paint of a |width| x
+  // |height| view through |slot_count| slots, or nullptr if the shared memory
+  // could not be created.
+  static std::unique_ptr<FlutterWebviewFrameTap> Create(int slot_count,
+                                                        int decimation,
+                                                        int width,
+                                                        int height);
+
+  ~FlutterWebviewFrameTap();
+
+  // Copies a paint of a |width| x |height| view in |buffer| to a free slot.
+  // Returns true and the frame in |frame| if it was published, or false if it
+  // was decimated or dropped.
+  bool Publish(const void* buffer,
+               int width,
+               int height,
+               const std::vector<WebviewRect>& dirty_rects,
+               Frame* frame);
+
+  // Gives back the |slot| of a frame of |generation| to the tap. The slots of
+  // older generations are ignored.
+  void Release(int64_t generation, int slot);
+
+ private:
+  struct Slot {
+    bool held = false;
+    // The regions where the slot differs from the latest published frame.
+    std::vector<WebviewRect> stale_rects;
+  };
+
+  FlutterWebviewFrameTap(int slot_count, int decimation);
+
+  // Replaces the shared memory buffer with one of at least |slot_size| bytes
+  // per slot. Returns false on failure.
+  bool Allocate(size_t slot_size);
+
+  const int decimation_;
+  std::vector<Slot> slots_;
+
+  int fd_;
+  uint8_t* memory_;
+  size_t slot_size_;
+  int64_t generation_;
+  bool fd_sent_;
+
+  int64_t sequence_;
+  int width_;
+  int height_;
+  // The damage of the paints since the previous published frame.
+  std::vector<WebviewRect> pending_damage_;
+  int dropped_frames_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_FRAME_TAP_H_
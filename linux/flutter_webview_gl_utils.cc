@@ -0,0 +1,163 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_gl_utils.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace flutter_webview_gl {
+
+namespace {
+
+Capabilities ProbeCapabilities() {
+  Capabilities caps;
+
+  const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  if (version == nullptr) {
+    std::cerr << "Error: glGetString(GL_VERSION) failed. Is a GL context "
+                 "current?"
+              << std::endl;
+    return caps;
+  }
+
+  // e.g. "4.6 (Core Profile) Mesa 21.2.6" or "OpenGL ES 3.2 Mesa 21.2.6"
+  constexpr char kGlesPrefix[] = "OpenGL ES";
+  if (std::strncmp(version, kGlesPrefix, sizeof(kGlesPrefix) - 1) == 0) {
+    caps.is_gles = true;
+  }
+  const char* digits = version;
+  while (*digits != '\0' && !std::isdigit(static_cast<unsigned char>(*digits)))
+    ++digits;
+  if (std::sscanf(digits, "%d.%d", &caps.major_version, &caps.minor_version) !=
+      2) {
+    std::cerr << "Warning: Could not parse GL_VERSION: " << version
+              << std::endl;
+  }
+
+  if (caps.major_version >= 3) {
+    // GL_EXTENSIONS cannot be queried with glGetString in core profiles.
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions; ++i) {
+      const char* extension =
+          reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+      if (extension != nullptr) {
+        caps.extensions.insert(extension);
+      }
+    }
+  } else {
+    const char* extensions =
+        reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (extensions != nullptr) {
+      std::istringstream stream(extensions);
+      std::string extension;
+      while (stream >> extension) {
+        caps.extensions.insert(extension);
+      }
+    }
+  }
+
+  if (caps.is_gles) {
+    caps.has_pixel_buffer_object = caps.IsAtLeast(3, 0);
+    caps.has_sync = caps.IsAtLeast(3, 0);
+    // EXT_buffer_storage is not used since libGL does not necessarily export
+    // its entry point.
+    caps.has_buffer_storage = false;
+    // Rectangle textures are not part of OpenGL ES.
+    caps.has_texture_rectangle = false;
+    caps.has_texture_storage = caps.IsAtLeast(3, 0);
+    // EXT_disjoint_timer_query is not used for the same reason as
+    // EXT_buffer_storage.
+    caps.has_timer_query = false;
+  } else {
+    caps.has_pixel_buffer_object =
+        caps.IsAtLeast(2, 1) || caps.HasExtension("GL_ARB_pixel_buffer_object");
+    caps.has_sync = caps.IsAtLeast(3, 2) || caps.HasExtension("GL_ARB_sync");
+    caps.has_buffer_storage =
+        caps.IsAtLeast(4, 4) || caps.HasExtension("GL_ARB_buffer_storage");
+    caps.has_texture_rectangle = caps.IsAtLeast(3, 1) ||
+                                 caps.HasExtension("GL_ARB_texture_rectangle");
+    caps.has_texture_storage =
+        caps.IsAtLeast(4, 2) || caps.HasExtension("GL_ARB_texture_storage");
+    caps.has_timer_query =
+        caps.IsAtLeast(3, 3) || caps.HasExtension("GL_ARB_timer_query");
+  }
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &caps.max_texture_size);
+  if (caps.has_texture_rectangle) {
+    glGetIntegerv(GL_MAX_RECTANGLE_TEXTURE_SIZE,
+                  &caps.max_rectangle_texture_size);
+  }
+
+#if FLUTTER_WEBVIEW_DEBUG
+  std::cerr << "GL_VERSION: " << version << std::endl
+            << "  has_pixel_buffer_object=" << caps.has_pixel_buffer_object
+            << ", has_buffer_storage=" << caps.has_buffer_storage
+            << ", has_sync=" << caps.has_sync
+            << ", has_texture_rectangle=" << caps.has_texture_rectangle
+            << ", has_texture_storage=" << caps.has_texture_storage
+            << ", has_timer_query=" << caps.has_timer_query
+            << ", max_texture_size=" << caps.max_texture_size
+            << std::endl;
+#endif  // FLUTTER_WEBVIEW_DEBUG
+
+  return caps;
+}
+
+}  // namespace
+
+bool Capabilities::IsAtLeast(int major, int minor) const {
+  return major_version > major ||
+         (major_version == major && minor_version >= minor);
+}
+
+bool Capabilities::HasExtension(const std::string& name) const {
+  return extensions.find(name) != extensions.end();
+}
+
+const Capabilities& GetCapabilities() {
+  static const Capabilities capabilities = ProbeCapabilities();
+  return capabilities;
+}
+
+void LogErrors(const char* file, int line) {
+  for (GLenum error = glGetError(); error != GL_NO_ERROR;
+       error = glGetError()) {
+    std::cerr << file << ":" << line << ": glGetError returned 0x" << std::hex
+              << error << std::dec << std::endl;
+  }
+}
+
+}  // namespace flutter_webview_gl
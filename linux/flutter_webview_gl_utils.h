@@ -0,0 +1,88 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_GL_UTILS_H_
+#define LINUX_FLUTTER_WEBVIEW_GL_UTILS_H_
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <string>
+#include <unordered_set>
+
+// Helpers shared by the code that draws to the webview textures with GL.
+namespace flutter_webview_gl {
+
+// The features of the GL implementation this plugin renders with.
+struct Capabilities {
+  // Whether the context is an OpenGL ES context.
+  bool is_gles = false;
+  int major_version = 0;
+  int minor_version = 0;
+
+  // Whether GL_PIXEL_UNPACK_BUFFER can be used as the source of texture
+  // uploads.
+  bool has_pixel_buffer_object = false;
+  // Whether glBufferStorage can create persistently mapped buffers.
+  bool has_buffer_storage = false;
+  // Whether fence sync objects (glFenceSync etc.) are available.
+  bool has_sync = false;
+  // Whether GL_TEXTURE_RECTANGLE textures can be created and sampled.
+  bool has_texture_rectangle = false;
+  // Whether glTexStorage2D can allocate immutable texture storage.
+  bool has_texture_storage = false;
+  int max_texture_size = 0;
+  int max_rectangle_texture_size = 0;
+  // Whether GL_TIME_ELAPSED queries can measure the GPU time of commands.
+  bool has_timer_query = false;
+
+  std::unordered_set<std::string> extensions;
+
+  bool IsAtLeast(int major, int minor) const;
+  bool HasExtension(const std::string& name) const;
+};
+
+// Returns the capabilities of the GL context current on the calling thread.
+// The result is probed on the first call and cached afterwards, since all the
+// contexts this plugin draws with are created for the same GDK display; the
+// first call must therefore be made with a context current.
+const Capabilities& GetCapabilities();
+
+// Logs the pending GL errors, if any, with the location of the caller.
+void LogErrors(const char* file, int line);
+
+}  // namespace flutter_webview_gl
+
+// Logs GL errors in debug builds.
+#if defined(NDEBUG)
+#define VERIFY_GL_NO_ERROR
+#else
+#define VERIFY_GL_NO_ERROR flutter_webview_gl::LogErrors(__FILE__, __LINE__)
+#endif  // defined(NDEBUG)
+
+#endif  // LINUX_FLUTTER_WEBVIEW_GL_UTILS_H_
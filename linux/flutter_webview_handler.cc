@@ -61,13 +61,16 @@
 
 #include "flutter_webview_handler.h"
 
-#include <GL/gl.h>
-
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_texture_format.h"
 #include "include/base/cef_callback.h"
 #include "include/base/cef_logging.h"
 #include "include/cef_app.h"
@@ -78,16 +81,32 @@
 #include "include/wrapper/cef_helpers.h"
 #include "subprocess/src/flutter_webview_process_messages.h"
 
-// DCHECK on gl errors.
-#if DCHECK_IS_ON()
-#define VERIFY_NO_ERROR                                                      \
-  {                                                                          \
-    int _gl_error = glGetError();                                            \
-    DCHECK(_gl_error == GL_NO_ERROR) << "glGetError returned " << _gl_error; \
+namespace {
+
+// CEF paints 32-bit BGRA pixels.
+constexpr int kBytesPerPixel = 4;
+
+// How long view paints are held back at most while Flutter has not taken the
+// previous frame.
+constexpr int64_t kMaxPaintDeferralMs = 100;
+
+constexpr int64_t kNanosecondsPerSecond = 1000000000;
+
+bool SameRects(const std::vector<WebviewRect>& a,
+               const std::vector<WebviewRect>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].width != b[i].width ||
+        a[i].height != b[i].height) {
+      return false;
+    }
   }
-#else
-#define VERIFY_NO_ERROR
-#endif  // DCHECK_IS_ON()
+  return true;
+}
+
+}  // namespace
 
 FlutterWebviewHandler::FlutterWebviewHandler(
     WebviewId webview_id,
@@ -111,9 +130,45 @@ FlutterWebviewHandler::FlutterWebviewHandler(
       webview_id_(webview_id),
       browser_state_(BrowserState::kBeforeCreated),
       browser_(nullptr),
-      native_texture_id_(params.native_texture_id),
+      texture_ring_(params.texture_ring),
+      pixel_buffer_(params.pixel_buffer),
+      staging_buffer_(params.staging_buffer),
+      tile_grid_(params.tile_size),
+      textures_evicted_(false),
+      atlas_region_{0, 0, 0, 0},
+      atlas_pixels_width_(0),
+      atlas_pixels_height_(0),
+      deferred_width_(0),
+      deferred_height_(0),
+      deferral_sequence_(0),
+      snapshot_cache_(params.snapshot_cache),
+      snapshot_key_(params.snapshot_key),
+      snapshot_drawn_(false),
+      damage_refinement_enabled_(false),
+      frame_rate_timer_running_(false),
+      external_begin_frame_(params.external_begin_frame),
+      last_external_begin_frame_ns_(0),
+      visible_(true),
+      window_visible_(true),
+      offscreen_(false),
+      hidden_(false),
+      mute_audio_when_hidden_(false),
+      audio_muted_(false),
       view_width_(params.width),
-      view_height_(params.height) {}
+      view_height_(params.height),
+      popup_texture_(0),
+      popup_texture_width_(0),
+      popup_texture_height_(0),
+      last_paint_time_ns_(-1) {
+  // Hide a headless browser for good, so that Chromium throttles its
+  // rendering.
+  UpdateHidden();
+
+  if (snapshot_cache_ && !IsHeadless()) {
+    // Shown while the browser starts and loads the page.
+    LoadSnapshot();
+  }
+}
 
 bool FlutterWebviewHandler::OnBeforePopup(
     CefRefPtr<CefBrowser> browser,
@@ -145,6 +200,13 @@ void FlutterWebviewHandler::OnAfterCreated(CefRefPtr<CefBrowser> browser) {
 
   browser_ = browser;
   browser_state_ = BrowserState::kCreated;
+  ApplyFrameRate();
+  if (hidden_) {
+    browser_->GetHost()->WasHidden(true);
+  }
+  if (audio_muted_) {
+    browser_->GetHost()->SetAudioMuted(true);
+  }
 
   on_after_created_(webview_id_, browser);
 }
@@ -184,6 +246,59 @@ void FlutterWebviewHandler::OnBeforeClose(CefRefPtr<CefBrowser> browser) {
   browser_ = nullptr;
   on_before_close_(webview_id_, browser);
 
+  frame_tap_.reset();
+  on_frame_tapped_ = nullptr;
+  // The writer thread completes the file by itself.
+  recorder_.reset();
+
+  if (snapshot_cache_) {
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+    if (ReadViewPixels(&pixels, &width, &height)) {
+      // Compressed and written by the writer thread of the cache.
+      snapshot_cache_->Store(snapshot_key_, std::move(pixels), width, height);
+    }
+  }
+
+  // Drop the draw queued to the atlas and the flushes waiting for Flutter,
+  // which hold references to this handler.
+  if (atlas_) {
+    atlas_->Cancel(webview_id_);
+    atlas_.reset();
+  }
+  deferred_damage_.clear();
+  if (texture_ring_) {
+    texture_ring_->CancelDeferral();
+  }
+  for (const auto& ring : tile_rings_) {
+    ring->CancelDeferral();
+  }
+
+  // No more paints come after this, so release the GL objects of the uploader
+  // and the ring's framebuffers while the GL context is bound. The textures
+  // are deleted with the FlCustomTextureGL on the platform thread.
+  if (texture_ring_) {
+    on_paint_begin_(webview_id_);
+    uploader_.ReleaseGLResources();
+    texture_ring_->ReleaseFramebuffers();
+    for (const auto& ring : tile_rings_) {
+      ring->ReleaseFramebuffers();
+    }
+    for (const auto& entry : mirrors_) {
+      entry.second.ring->ReleaseFramebuffers();
+    }
+    gpu_timer_.ReleaseQueries();
+    if (popup_texture_ != 0) {
+      glDeleteTextures(1, &popup_texture_);
+      popup_texture_ = 0;
+    }
+    on_paint_end_(webview_id_);
+  }
+
+  // The mirror textures keep showing the last frame until they are disposed.
+  mirrors_.clear();
+
   browser_state_ = BrowserState::kClosed;
 
   if (close_browser_cb_) {
@@ -233,6 +348,485 @@ void FlutterWebviewHandler::SetViewRect(int width, int height) {
   view_height_ = height;
 }
 
+void FlutterWebviewHandler::SetTileRings(
+    const std::vector<std::shared_ptr<FlutterWebviewTextureRing>>& rings) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (rings == tile_rings_) {
+    return;
+  }
+  for (const auto& ring : tile_rings_) {
+    ring->CancelDeferral();
+  }
+  tile_rings_ = rings;
+  // The new rings hold nothing of this view yet.
+  painted_tiles_.clear();
+  deferred_damage_.clear();
+  InvalidateView();
+}
+
+void FlutterWebviewHandler::SetAtlasRegion(
+    std::shared_ptr<FlutterWebviewTextureAtlas> atlas,
+    const WebviewRect& region) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (atlas == atlas_ && region.x == atlas_region_.x &&
+      region.y == atlas_region_.y) {
+    // Resized in place, or still out of an atlas. The paints at the new size
+    // are drawn in full.
+    atlas_region_ = region;
+    return;
+  }
+
+  if (atlas_ && atlas != atlas_) {
+    atlas_->Cancel(webview_id_);
+  }
+  const bool was_in_atlas = atlas_ != nullptr;
+  atlas_ = std::move(atlas);
+  atlas_region_ = region;
+
+  if (!atlas_) {
+    atlas_pixels_.clear();
+    atlas_pixels_width_ = 0;
+    atlas_pixels_height_ = 0;
+    atlas_damage_.clear();
+    // The rings of the tiles have not been drawn to since the view went to
+    // the atlas.
+    painted_tiles_.clear();
+    InvalidateView();
+    return;
+  }
+
+  if (!was_in_atlas) {
+    // The paints held back for the rings of the tiles are not needed anymore.
+    deferred_damage_.clear();
+    if (texture_ring_) {
+      texture_ring_->CancelDeferral();
+    }
+    for (const auto& ring : tile_rings_) {
+      ring->CancelDeferral();
+    }
+  }
+  if (!atlas_pixels_.empty()) {
+    atlas_damage_.assign(
+        1, WebviewRect{0, 0, atlas_pixels_width_, atlas_pixels_height_});
+    QueueAtlasDraw();
+  } else {
+    InvalidateView();
+  }
+}
+
+bool FlutterWebviewHandler::AddMirror(
+    WebviewId mirror_id,
+    std::shared_ptr<FlutterWebviewTextureRing> ring,
+    int width,
+    int height) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (!texture_ring_ || atlas_ || width <= 0 || height <= 0) {
+    return false;
+  }
+  RemoveMirror(mirror_id);
+  Mirror& mirror = mirrors_[mirror_id];
+  mirror = Mirror{std::move(ring), width, height};
+  UpdateHidden();
+
+  // Show the latest view right away, since a static page does not repaint.
+  on_paint_begin_(webview_id_);
+  PaintMirror(mirror, {});
+  on_paint_end_(webview_id_);
+  return true;
+}
+
+bool FlutterWebviewHandler::ResizeMirror(WebviewId mirror_id,
+                                         int width,
+                                         int height) {
+  CEF_REQUIRE_UI_THREAD();
+
+  auto it = mirrors_.find(mirror_id);
+  if (it == mirrors_.end() || width <= 0 || height <= 0) {
+    return false;
+  }
+  if (it->second.width == width && it->second.height == height) {
+    return true;
+  }
+  it->second.width = width;
+  it->second.height = height;
+
+  on_paint_begin_(webview_id_);
+  PaintMirror(it->second, {});
+  on_paint_end_(webview_id_);
+  return true;
+}
+
+void FlutterWebviewHandler::RemoveMirror(WebviewId mirror_id) {
+  CEF_REQUIRE_UI_THREAD();
+
+  auto it = mirrors_.find(mirror_id);
+  if (it == mirrors_.end()) {
+    return;
+  }
+  // The textures are recycled with the FlCustomTextureGL on the platform
+  // thread.
+  on_paint_begin_(webview_id_);
+  it->second.ring->ReleaseFramebuffers();
+  on_paint_end_(webview_id_);
+  mirrors_.erase(it);
+  UpdateHidden();
+}
+
+void FlutterWebviewHandler::SetTextureUploadMode(TextureUploadMode mode) {
+  CEF_REQUIRE_UI_THREAD();
+
+  uploader_.SetMode(mode);
+}
+
+void FlutterWebviewHandler::SetFrameRate(int frame_rate,
+                                         bool adaptive,
+                                         int min_frame_rate) {
+  CEF_REQUIRE_UI_THREAD();
+
+  frame_rate_governor_.SetFrameRate(frame_rate, adaptive, min_frame_rate);
+  ApplyFrameRate();
+
+  if (adaptive && !frame_rate_timer_running_) {
+    frame_rate_timer_running_ = true;
+    CefPostDelayedTask(
+        TID_UI,
+        base::BindOnce(&FlutterWebviewHandler::OnFrameRatePeriodElapsed,
+                       CefRefPtr<FlutterWebviewHandler>(this)),
+        FlutterWebviewFrameRateGovernor::kPeriodMs);
+  }
+}
+
+void FlutterWebviewHandler::SetDamageRefinementEnabled(bool enabled) {
+  CEF_REQUIRE_UI_THREAD();
+
+  damage_refinement_enabled_ = enabled;
+  if (!enabled) {
+    // Frees the copy of the previous frame.
+    damage_refiner_.Reset();
+  }
+}
+
+void FlutterWebviewHandler::OnInputEvent() {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (frame_rate_governor_.OnInput()) {
+    ApplyFrameRate();
+  }
+}
+
+void FlutterWebviewHandler::SetVisible(bool visible, bool mute_audio) {
+  CEF_REQUIRE_UI_THREAD();
+
+  visible_ = visible;
+  mute_audio_when_hidden_ = mute_audio;
+  UpdateHidden();
+}
+
+void FlutterWebviewHandler::SetWindowVisible(bool visible) {
+  CEF_REQUIRE_UI_THREAD();
+
+  window_visible_ = visible;
+  UpdateHidden();
+}
+
+void FlutterWebviewHandler::SendExternalBeginFrame() {
+  CEF_REQUIRE_UI_THREAD();
+
+  // A hidden browser does not paint anyway.
+  if (!external_begin_frame_ || hidden_ || !browser_ ||
+      browser_state_ == BrowserState::kClosing ||
+      browser_state_ == BrowserState::kClosed) {
+    return;
+  }
+
+  // Begin frames come at Flutter's rate, so the frame rate is applied here.
+  // A quarter of the interval is tolerated so that the jitter of Flutter's
+  // frames does not halve a rate that divides it.
+  const int64_t now_ns = FlutterWebviewRenderStats::NowNs();
+  const int64_t interval_ns =
+      kNanosecondsPerSecond / frame_rate_governor_.current_frame_rate();
+  if (last_external_begin_frame_ns_ != 0 &&
+      now_ns - last_external_begin_frame_ns_ < interval_ns - interval_ns / 4) {
+    return;
+  }
+  last_external_begin_frame_ns_ = now_ns;
+  browser_->GetHost()->SendExternalBeginFrame();
+}
+
+bool FlutterWebviewHandler::GetEvictableTextureUsage(
+    WebviewTextureUsage* usage) const {
+  CEF_REQUIRE_UI_THREAD();
+
+  // Flutter keeps showing the frame it took last from a visible texture, so
+  // only the textures of an offscreen view can be released.
+  if (!texture_ring_ || !offscreen_ || textures_evicted_) {
+    return false;
+  }
+  int64_t bytes = texture_ring_->storage_bytes();
+  int64_t last_present_time_ns = texture_ring_->last_present_time_ns();
+  for (const auto& ring : tile_rings_) {
+    bytes += ring->storage_bytes();
+    last_present_time_ns =
+        std::max(last_present_time_ns, ring->last_present_time_ns());
+  }
+  *usage = WebviewTextureUsage{webview_id_, bytes, last_present_time_ns};
+  return true;
+}
+
+void FlutterWebviewHandler::EvictTextures() {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (!texture_ring_ || !offscreen_) {
+    return;
+  }
+  VLOG(1) << __func__ << ": webview_id_=" << webview_id_;
+
+  texture_ring_->CancelDeferral();
+  for (const auto& ring : tile_rings_) {
+    ring->CancelDeferral();
+  }
+  std::vector<FlutterWebviewTextureRing*> shown_rings;
+  on_paint_begin_(webview_id_);
+  for (size_t i = 0; i <= tile_rings_.size(); ++i) {
+    FlutterWebviewTextureRing* ring = GetTileRing(i);
+    if (ring->ReleaseStorage()) {
+      shown_rings.push_back(ring);
+    }
+  }
+  on_paint_end_(webview_id_);
+
+  // The rings hold nothing of the view anymore. UpdateHidden has the view
+  // repainted in full when it is shown.
+  painted_tiles_.clear();
+  deferred_damage_.clear();
+  textures_evicted_ = true;
+
+  // The textures Flutter took last are kept until it takes the cleared frames
+  // published instead, which may not happen before the view is shown again.
+  CefRefPtr<FlutterWebviewHandler> self(this);
+  for (FlutterWebviewTextureRing* ring : shown_rings) {
+    ring->DeferUntilPresented([self]() {
+      // On the raster thread
+      CefPostTask(
+          TID_UI,
+          base::BindOnce(&FlutterWebviewHandler::ReleaseEvictedTextures, self));
+    });
+  }
+}
+
+void FlutterWebviewHandler::ReleaseEvictedTextures() {
+  CEF_REQUIRE_UI_THREAD();
+
+  // The view has been painted since, or is closing.
+  if (!textures_evicted_ || !texture_ring_ ||
+      browser_state_ == BrowserState::kClosing ||
+      browser_state_ == BrowserState::kClosed) {
+    return;
+  }
+
+  on_paint_begin_(webview_id_);
+  texture_ring_->ReleaseStorage();
+  for (const auto& ring : tile_rings_) {
+    ring->ReleaseStorage();
+  }
+  on_paint_end_(webview_id_);
+}
+
+void FlutterWebviewHandler::UpdateHidden() {
+  // A headless browser is never seen. The mirrors of a browser may be shown
+  // without its own widget.
+  const bool offscreen = IsHeadless() || !window_visible_ ||
+                         (!visible_ && mirrors_.empty());
+  // A frame tap or a recorder takes the paints wherever the view is, so the
+  // browser keeps painting for them while offscreen.
+  const bool hidden = offscreen && !HasPaintConsumers();
+  const bool audio_muted = offscreen && mute_audio_when_hidden_;
+  const bool offscreen_changed = offscreen != offscreen_;
+  const bool hidden_changed = hidden != hidden_;
+  const bool audio_muted_changed = audio_muted != audio_muted_;
+  offscreen_ = offscreen;
+  hidden_ = hidden;
+  audio_muted_ = audio_muted;
+
+  if (!browser_ || browser_state_ == BrowserState::kClosing ||
+      browser_state_ == BrowserState::kClosed) {
+    // Applied in OnAfterCreated.
+    return;
+  }
+  VLOG(1) << __func__ << ": webview_id_=" << webview_id_
+          << ", offscreen=" << offscreen << ", hidden=" << hidden
+          << ", audio_muted=" << audio_muted;
+
+  if (offscreen_changed || hidden_changed) {
+    // The view is repainted in full when shown.
+    deferred_damage_.clear();
+  }
+  if (hidden_changed) {
+    // A hidden browser stops painting and lowers the priority of its renderer
+    // process.
+    browser_->GetHost()->WasHidden(hidden);
+  }
+  if ((offscreen_changed && !offscreen) || (hidden_changed && !hidden)) {
+    // The uploads skipped while offscreen left the textures stale, and a new
+    // frame tap or recorder starts from a whole frame.
+    InvalidateView();
+    if (!popup_rect_.IsEmpty()) {
+      browser_->GetHost()->Invalidate(PET_POPUP);
+    }
+  }
+  if (audio_muted_changed) {
+    browser_->GetHost()->SetAudioMuted(audio_muted);
+  }
+}
+
+void FlutterWebviewHandler::InvalidateView() {
+  // The destination needs the whole view, whether or not it has changed since
+  // the previous frame.
+  damage_refiner_.Reset();
+  if (browser_) {
+    browser_->GetHost()->Invalidate(PET_VIEW);
+  }
+}
+
+void FlutterWebviewHandler::ApplyFrameRate() {
+  if (external_begin_frame_) {
+    // Applied in SendExternalBeginFrame(), since the browser ignores
+    // SetWindowlessFrameRate() then.
+    return;
+  }
+  if (!browser_) {
+    // Applied in OnAfterCreated.
+    return;
+  }
+  VLOG(1) << __func__ << ": webview_id_=" << webview_id_ << ", frame_rate="
+          << frame_rate_governor_.current_frame_rate();
+  browser_->GetHost()->SetWindowlessFrameRate(
+      frame_rate_governor_.current_frame_rate());
+}
+
+void FlutterWebviewHandler::OnFrameRatePeriodElapsed() {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (!frame_rate_governor_.adaptive() ||
+      browser_state_ == BrowserState::kClosing ||
+      browser_state_ == BrowserState::kClosed) {
+    frame_rate_timer_running_ = false;
+    return;
+  }
+
+  if (frame_rate_governor_.OnPeriodElapsed()) {
+    ApplyFrameRate();
+  }
+  CefPostDelayedTask(
+      TID_UI,
+      base::BindOnce(&FlutterWebviewHandler::OnFrameRatePeriodElapsed,
+                     CefRefPtr<FlutterWebviewHandler>(this)),
+      FlutterWebviewFrameRateGovernor::kPeriodMs);
+}
+
+WebviewRenderCounters FlutterWebviewHandler::GetRenderCounters() const {
+  CEF_REQUIRE_UI_THREAD();
+
+  const FlutterWebviewRectCoalescer::Counters& counters =
+      coalescer_.counters();
+  const UploadCostModel& cost_model = coalescer_.cost_model();
+  const FlutterWebviewDamageRefiner::Counters& refiner_counters =
+      damage_refiner_.counters();
+  return WebviewRenderCounters{
+      {"partialUpdates", counters.frames},
+      {"dirtyRects", counters.input_rects},
+      {"uploadedRects", counters.output_rects},
+      {"mergedRects", counters.merged_rects},
+      {"boundingBoxUpdates", counters.bounding_box_frames},
+      {"uploadCallCostNs", static_cast<int64_t>(cost_model.per_call_ns)},
+      {"uploadByteCostPs",
+       static_cast<int64_t>(cost_model.per_byte_ns * 1000)},
+      {"frameRate", frame_rate_governor_.current_frame_rate()},
+      {"refinedFrames", refiner_counters.frames},
+      {"unchangedFrames", refiner_counters.unchanged_frames},
+      {"comparedTiles", refiner_counters.compared_tiles},
+      {"unchangedTiles", refiner_counters.unchanged_tiles},
+  };
+}
+
+bool FlutterWebviewHandler::SubscribeFrames(
+    int slot_count,
+    int decimation,
+    const FrameTappedCallback& on_frame_tapped) {
+  CEF_REQUIRE_UI_THREAD();
+
+  std::unique_ptr<FlutterWebviewFrameTap> frame_tap =
+      FlutterWebviewFrameTap::Create(slot_count, decimation, view_width_,
+                                     view_height_);
+  if (!frame_tap) {
+    return false;
+  }
+  frame_tap_ = std::move(frame_tap);
+  on_frame_tapped_ = on_frame_tapped;
+  UpdateHidden();
+  // The subscriber starts with a whole frame, even of a static page.
+  // The paint is taken before its damage is refined, so the textures are not
+  // drawn again where they are up to date.
+  if (browser_) {
+    browser_->GetHost()->Invalidate(PET_VIEW);
+  }
+  return true;
+}
+
+void FlutterWebviewHandler::UnsubscribeFrames() {
+  CEF_REQUIRE_UI_THREAD();
+
+  frame_tap_.reset();
+  on_frame_tapped_ = nullptr;
+  UpdateHidden();
+}
+
+void FlutterWebviewHandler::ReleaseTappedFrame(int64_t generation, int slot) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (frame_tap_) {
+    frame_tap_->Release(generation, slot);
+  }
+}
+
+bool FlutterWebviewHandler::StartRecording(const std::string& path,
+                                           std::string* error) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (recorder_) {
+    *error = "The webview is already being recorded.";
+    return false;
+  }
+  recorder_ = FlutterWebviewRecorder::Start(path, error);
+  if (!recorder_) {
+    return false;
+  }
+  UpdateHidden();
+  // The recording starts with the whole view, even of a static page.
+  // The paint is taken before its damage is refined, so the textures are not
+  // drawn again where they are up to date.
+  if (browser_) {
+    browser_->GetHost()->Invalidate(PET_VIEW);
+  }
+  return true;
+}
+
+bool FlutterWebviewHandler::StopRecording(
+    const FlutterWebviewRecorder::StoppedCallback& on_stopped) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (!recorder_) {
+    return false;
+  }
+  recorder_->Stop(on_stopped);
+  recorder_.reset();
+  UpdateHidden();
+  return true;
+}
+
 void FlutterWebviewHandler::OnLoadingProgressChange(
     CefRefPtr<CefBrowser> browser,
     double progress) {
@@ -311,97 +905,840 @@ void FlutterWebviewHandler::OnPaint(CefRefPtr<CefBrowser> browser,
   CEF_REQUIRE_UI_THREAD();
   // Logics copied from cefclient/browser/osr_renderer.cc
 
+  if (IsHeadless()) {
+    // Nothing to draw to but the frame tap and the recorder. Hardly called
+    // otherwise since the browser is hidden.
+    if (type == PET_VIEW && HasPaintConsumers()) {
+      PublishViewPaint(dirtyRects, buffer, width, height);
+    }
+    return;
+  }
+
+  const bool stats_enabled = FlutterWebviewRenderStats::IsEnabled();
+
+  if (offscreen_) {
+    // A paint for the frame tap or the recorder, or already in flight when the
+    // browser was hidden. Nobody sees the textures, so they are left alone,
+    // and the whole view is uploaded when it is onscreen again.
+    if (type == PET_VIEW && HasPaintConsumers()) {
+      PublishViewPaint(dirtyRects, buffer, width, height);
+    }
+    if (stats_enabled) {
+      render_stats()->RecordSkippedPaint();
+    }
+    return;
+  }
+
+  if (type == PET_VIEW && HasPaintConsumers()) {
+    PublishViewPaint(dirtyRects, buffer, width, height);
+  }
+
+  if (type == PET_VIEW && damage_refinement_enabled_) {
+    // Leave out the dirty tiles whose pixels have not changed.
+    std::vector<WebviewRect> rects;
+    rects.reserve(dirtyRects.size());
+    for (const CefRect& rect : dirtyRects) {
+      rects.push_back(WebviewRect{rect.x, rect.y, rect.width, rect.height});
+    }
+    rects = damage_refiner_.Refine(buffer, width, height, rects);
+    if (rects.empty()) {
+      return;
+    }
+    RectList refined_rects;
+    refined_rects.reserve(rects.size());
+    for (const WebviewRect& rect : rects) {
+      refined_rects.push_back(CefRect(rect.x, rect.y, rect.width, rect.height));
+    }
+    DrawPaint(type, refined_rects, buffer, width, height);
+    return;
+  }
+
+  DrawPaint(type, dirtyRects, buffer, width, height);
+}
+
+void FlutterWebviewHandler::DrawPaint(PaintElementType type,
+                                      const RectList& dirtyRects,
+                                      const void* buffer,
+                                      int width,
+                                      int height) {
+  if (atlas_) {
+    // Drawn by the next flush of the atlas, along with the paints of the other
+    // webviews in it.
+    StageAtlasPaint(type, dirtyRects, buffer, width, height);
+    return;
+  }
+
   on_paint_begin_(webview_id_);
 
-  DCHECK_NE(native_texture_id_, 0U);
-  glBindTexture(GL_TEXTURE_2D, native_texture_id_);
-  VERIFY_NO_ERROR;
+  if (pixel_buffer_) {
+    PaintCpuImage(pixel_buffer_.get(), type, dirtyRects, buffer, width,
+                  height);
+    on_paint_end_(webview_id_);
+    return;
+  }
+  if (staging_buffer_) {
+    // Uploaded by Flutter's raster thread when it takes the frame, so no GL
+    // call is made here.
+    PaintCpuImage(staging_buffer_.get(), type, dirtyRects, buffer, width,
+                  height);
+    on_paint_end_(webview_id_);
+    return;
+  }
 
-  if (type == PET_VIEW) {
-    int old_width = view_width_;
-    int old_height = view_height_;
+  DCHECK(texture_ring_);
 
+  if (type == PET_VIEW) {
     // TODO(Ino): dispatch resizing?
     view_width_ = width;
     view_height_ = height;
 
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, view_width_);
-    VERIFY_NO_ERROR;
-
-    if (old_width != view_width_ || old_height != view_height_ ||
-        (dirtyRects.size() == 1 &&
-         dirtyRects[0] == CefRect(0, 0, view_width_, view_height_))) {
-      // Update/resize the whole texture.
-      glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-      VERIFY_NO_ERROR;
-      glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
-      VERIFY_NO_ERROR;
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, view_width_, view_height_, 0,
-                   GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
-      VERIFY_NO_ERROR;
+    std::vector<WebviewRect> rects;
+    rects.reserve(dirtyRects.size());
+    for (const CefRect& rect : dirtyRects) {
+      DCHECK(rect.x + rect.width <= view_width_);
+      DCHECK(rect.y + rect.height <= view_height_);
+      rects.push_back(WebviewRect{rect.x, rect.y, rect.width, rect.height});
+    }
+
+    if (DeferViewPaintIfBehind(buffer, width, height, rects)) {
+      if (FlutterWebviewRenderStats::IsEnabled()) {
+        render_stats()->RecordDeferredPaint();
+      }
     } else {
-      // Update just the dirty rectangles.
-      CefRenderHandler::RectList::const_iterator i = dirtyRects.begin();
-      for (; i != dirtyRects.end(); ++i) {
-        const CefRect& rect = *i;
-        DCHECK(rect.x + rect.width <= view_width_);
-        DCHECK(rect.y + rect.height <= view_height_);
-        glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.x);
-        VERIFY_NO_ERROR;
-        glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.y);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width,
-                        rect.height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
-                        buffer);
-        VERIFY_NO_ERROR;
+      // The buffer holds the latest pixels of the deferred regions too.
+      rects.insert(rects.end(), deferred_damage_.begin(),
+                   deferred_damage_.end());
+      deferred_damage_.clear();
+      PaintView(buffer, width, height, rects);
+    }
+  } else if (type == PET_POPUP && popup_rect_.width > 0 &&
+             popup_rect_.height > 0) {
+    UploadPopup(buffer, width, height, dirtyRects);
+
+    // Draw the popup over the latest view as a new frame of the tiles it
+    // covers. The last tile is at the bottom-right corner of the view.
+    WebviewRect popup_source;
+    int popup_x, popup_y;
+    if (!painted_tiles_.empty() &&
+        GetVisiblePopupRect(
+            painted_tiles_.back().x + painted_tiles_.back().width,
+            painted_tiles_.back().y + painted_tiles_.back().height,
+            &popup_source, &popup_x, &popup_y)) {
+      const WebviewRect popup_rect{popup_x, popup_y, popup_source.width,
+                                   popup_source.height};
+      for (size_t i = 0; i < painted_tiles_.size(); ++i) {
+        FlutterWebviewTextureRing* ring = GetTileRing(i);
+        WebviewRect overlap;
+        if (ring == nullptr || !ring->HasFrame() ||
+            !FlutterWebviewTileGrid::Intersect(popup_rect, painted_tiles_[i],
+                                               &overlap)) {
+          continue;
+        }
+        FlutterWebviewTextureRing::Frame frame = ring->BeginWrite();
+        WebviewRect tile_rect;
+        CopyPopupToTile(ring, painted_tiles_[i], popup_source, popup_x,
+                        popup_y, &tile_rect);
+        ring->EndWrite(frame.width, frame.height, {tile_rect});
       }
+      PaintMirrors({popup_rect});
     }
+  }
+
+  on_paint_end_(webview_id_);
+}
+
+void FlutterWebviewHandler::PublishViewPaint(const RectList& dirtyRects,
+                                             const void* buffer,
+                                             int width,
+                                             int height) {
+  std::vector<WebviewRect> rects;
+  rects.reserve(dirtyRects.size());
+  for (const CefRect& rect : dirtyRects) {
+    rects.push_back(WebviewRect{rect.x, rect.y, rect.width, rect.height});
+  }
+  if (recorder_) {
+    recorder_->AddFrame(buffer, width, height, rects);
+  }
+  FlutterWebviewFrameTap::Frame frame;
+  if (frame_tap_ && frame_tap_->Publish(buffer, width, height, rects, &frame)) {
+    on_frame_tapped_(frame);
+  }
+}
+
+void FlutterWebviewHandler::PaintView(const void* buffer,
+                                      int width,
+                                      int height,
+                                      const std::vector<WebviewRect>& rects) {
+  const bool stats_enabled = FlutterWebviewRenderStats::IsEnabled();
+  const int64_t paint_start_ns =
+      stats_enabled ? FlutterWebviewRenderStats::NowNs() : 0;
+  if (stats_enabled) {
+    gpu_timer_.CollectResults(&texture_ring_->render_stats());
+    gpu_timer_.Begin();
+  }
+
+  // The cost model is measured on the first paint of the process, when a GL
+  // context is first known to be current.
+  coalescer_.SetCostModel(FlutterWebviewTextureUploader::GetCostModel());
+  const std::vector<WebviewRect> tiles = tile_grid_.GetTiles(width, height);
+  std::vector<WebviewRect> damage;
+  if (!SameRects(tiles, painted_tiles_)) {
+    // Update the whole view, whose size or tiles have changed.
+    damage.push_back(WebviewRect{0, 0, width, height});
+  } else {
+    // Update just the dirty rectangles, merged where fewer calls are cheaper
+    // than the extra bytes.
+    damage = coalescer_.Coalesce(rects);
+  }
+
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    FlutterWebviewTextureRing* ring = GetTileRing(i);
+    if (ring == nullptr) {
+      // The whole view is repainted when the rings of the new tiles are
+      // given.
+      break;
+    }
+    PaintTile(ring, tiles[i], buffer, width, height, damage);
+  }
+  painted_tiles_ = tiles;
+  textures_evicted_ = false;
+  PaintMirrors(damage);
+
+  if (stats_enabled) {
+    gpu_timer_.End();
+  }
+  OnViewPainted(damage, width, height, static_cast<int>(rects.size()),
+                paint_start_ns);
+}
+
+bool FlutterWebviewHandler::DeferViewPaintIfBehind(
+    const void* buffer,
+    int width,
+    int height,
+    const std::vector<WebviewRect>& rects) {
+  if (!deferred_damage_.empty() &&
+      (width != deferred_width_ || height != deferred_height_)) {
+    // Start over at the new size.
+    deferred_damage_.clear();
+  }
+
+  if (deferred_damage_.empty()) {
+    // Start deferring only while Flutter has not taken a frame of the tiles
+    // painted last. The first ring found behind calls back when Flutter
+    // catches up with it.
+    const int deferral_sequence = ++deferral_sequence_;
+    CefRefPtr<FlutterWebviewHandler> self(this);
+    bool behind = false;
+    for (size_t i = 0; i < painted_tiles_.size() && !behind; ++i) {
+      FlutterWebviewTextureRing* ring = GetTileRing(i);
+      behind = ring != nullptr &&
+               ring->DeferUntilPresented([self, deferral_sequence]() {
+                 // On the raster thread
+                 CefPostTask(
+                     TID_UI,
+                     base::BindOnce(&FlutterWebviewHandler::FlushDeferredPaint,
+                                    self, deferral_sequence));
+               });
+    }
+    if (!behind) {
+      return false;
+    }
+    // Flutter may never take the frame, e.g. if it culls the texture out of
+    // its frames, so upload anyway after a while.
+    CefPostDelayedTask(
+        TID_UI,
+        base::BindOnce(&FlutterWebviewHandler::FlushDeferredPaint, self,
+                       deferral_sequence),
+        kMaxPaintDeferralMs);
+
+    // Keep the whole view since |buffer| is only valid during OnPaint. Later
+    // deferred paints copy just their dirty rectangles over it.
+    deferred_pixels_.assign(
+        static_cast<const uint8_t*>(buffer),
+        static_cast<const uint8_t*>(buffer) +
+            static_cast<size_t>(width) * height * kBytesPerPixel);
+    deferred_width_ = width;
+    deferred_height_ = height;
+    deferred_damage_ = rects;
+    return true;
+  }
+
+  const size_t stride = static_cast<size_t>(width) * kBytesPerPixel;
+  const uint8_t* src = static_cast<const uint8_t*>(buffer);
+  for (const WebviewRect& rect : rects) {
+    const size_t offset = rect.y * stride + rect.x * kBytesPerPixel;
+    const size_t row_size = static_cast<size_t>(rect.width) * kBytesPerPixel;
+    for (int row = 0; row < rect.height; ++row) {
+      std::memcpy(deferred_pixels_.data() + offset + row * stride,
+                  src + offset + row * stride, row_size);
+    }
+  }
+  deferred_damage_.insert(deferred_damage_.end(), rects.begin(), rects.end());
+  return true;
+}
+
+void FlutterWebviewHandler::FlushDeferredPaint(int deferral_sequence) {
+  CEF_REQUIRE_UI_THREAD();
+
+  // A later paint has already uploaded the deferred regions, or the view went
+  // offscreen and is uploaded in full when onscreen again.
+  if (deferral_sequence != deferral_sequence_ ||
+      deferred_damage_.empty() || offscreen_ ||
+      browser_state_ == BrowserState::kClosing ||
+      browser_state_ == BrowserState::kClosed) {
+    return;
+  }
+
+  std::vector<WebviewRect> rects;
+  rects.swap(deferred_damage_);
+  on_paint_begin_(webview_id_);
+  PaintView(deferred_pixels_.data(), deferred_width_, deferred_height_, rects);
+  on_paint_end_(webview_id_);
+}
+
+FlutterWebviewTextureRing* FlutterWebviewHandler::GetTileRing(
+    size_t index) const {
+  if (index == 0) {
+    return texture_ring_.get();
+  }
+  return index <= tile_rings_.size() ? tile_rings_[index - 1].get() : nullptr;
+}
+
+void FlutterWebviewHandler::PaintTile(FlutterWebviewTextureRing* ring,
+                                      const WebviewRect& tile,
+                                      const void* buffer,
+                                      int width,
+                                      int height,
+                                      const std::vector<WebviewRect>& damage) {
+  int frame_width, frame_height;
+  ring->GetLatestFrameSize(&frame_width, &frame_height);
+  std::vector<WebviewRect> tile_damage;
+  if (frame_width != tile.width || frame_height != tile.height) {
+    tile_damage.push_back(tile);
+  } else {
+    tile_damage = FlutterWebviewTileGrid::ClipRects(damage, tile);
+    if (tile_damage.empty()) {
+      return;
+    }
+  }
+
+  // The tile is drawn to a texture that Flutter is not sampling, which
+  // already holds the previous frame of the tile.
+  FlutterWebviewTextureRing::Frame frame = ring->BeginWrite();
+  if (frame.width != tile.width || frame.height != tile.height) {
+    // Update the whole texture. Its storage is reallocated only if the new
+    // size does not fit in it.
+    frame = ring->ReserveStorage(tile.width, tile.height);
+  }
+  uploader_.UploadRects(ring->target(), frame.texture, buffer, width, height,
+                        tile_damage, -tile.x, -tile.y);
+
+  // Put the popup back where the view has been drawn over it.
+  WebviewRect popup_source;
+  int popup_x, popup_y;
+  if (GetVisiblePopupRect(width, height, &popup_source, &popup_x, &popup_y)) {
+    const WebviewRect popup_rect{popup_x, popup_y, popup_source.width,
+                                 popup_source.height};
+    for (const WebviewRect& rect : tile_damage) {
+      WebviewRect overlap;
+      if (FlutterWebviewTileGrid::Intersect(rect, popup_rect, &overlap)) {
+        WebviewRect tile_rect;
+        CopyPopupToTile(ring, tile, popup_source, popup_x, popup_y,
+                        &tile_rect);
+        break;
+      }
+    }
+  }
+
+  for (WebviewRect& rect : tile_damage) {
+    rect.x -= tile.x;
+    rect.y -= tile.y;
+  }
+  ring->EndWrite(tile.width, tile.height, tile_damage);
+}
+
+void FlutterWebviewHandler::PaintMirror(
+    const Mirror& mirror,
+    const std::vector<WebviewRect>& damage) {
+  if (painted_tiles_.empty()) {
+    return;
+  }
+  // The last tile is at the bottom-right corner of the view.
+  const int view_width = painted_tiles_.back().x + painted_tiles_.back().width;
+  const int view_height =
+      painted_tiles_.back().y + painted_tiles_.back().height;
+  const bool scaled =
+      mirror.width != view_width || mirror.height != view_height;
+
+  FlutterWebviewTextureRing* ring = mirror.ring.get();
+  int frame_width, frame_height;
+  ring->GetLatestFrameSize(&frame_width, &frame_height);
+  std::vector<WebviewRect> mirror_damage;
+  if (scaled || frame_width != mirror.width || frame_height != mirror.height ||
+      damage.empty()) {
+    // A scaled view is drawn whole, since the filtered edges of partial copies
+    // would not line up.
+    mirror_damage.push_back(WebviewRect{0, 0, mirror.width, mirror.height});
+  } else {
+    mirror_damage = damage;
+  }
+
+  FlutterWebviewTextureRing::Frame frame = ring->BeginWrite();
+  if (frame.width != mirror.width || frame.height != mirror.height) {
+    frame = ring->ReserveStorage(mirror.width, mirror.height);
+  }
+  for (size_t i = 0; i < painted_tiles_.size(); ++i) {
+    const FlutterWebviewTextureRing* tile_ring = GetTileRing(i);
+    const GLuint texture =
+        tile_ring != nullptr ? tile_ring->GetLatestTexture() : 0;
+    if (texture == 0) {
+      continue;
+    }
+    const WebviewRect& tile = painted_tiles_[i];
+    if (scaled) {
+      // Scale the edges rather than the sizes so that the tiles stay adjacent.
+      const int left = static_cast<int>(static_cast<int64_t>(tile.x) *
+                                        mirror.width / view_width);
+      const int top = static_cast<int>(static_cast<int64_t>(tile.y) *
+                                       mirror.height / view_height);
+      const int right =
+          static_cast<int>(static_cast<int64_t>(tile.x + tile.width) *
+                           mirror.width / view_width);
+      const int bottom =
+          static_cast<int>(static_cast<int64_t>(tile.y + tile.height) *
+                           mirror.height / view_height);
+      if (left < right && top < bottom) {
+        ring->ScaleToFrame(texture, WebviewRect{0, 0, tile.width, tile.height},
+                           WebviewRect{left, top, right - left, bottom - top});
+      }
+      continue;
+    }
+    for (const WebviewRect& rect : mirror_damage) {
+      WebviewRect overlap;
+      if (FlutterWebviewTileGrid::Intersect(rect, tile, &overlap)) {
+        ring->CopyToFrame(texture,
+                          WebviewRect{overlap.x - tile.x, overlap.y - tile.y,
+                                      overlap.width, overlap.height},
+                          overlap.x, overlap.y);
+      }
+    }
+  }
+  ring->EndWrite(mirror.width, mirror.height, mirror_damage);
+}
+
+void FlutterWebviewHandler::PaintMirrors(
+    const std::vector<WebviewRect>& damage) {
+  if (damage.empty()) {
+    return;
+  }
+  for (const auto& entry : mirrors_) {
+    PaintMirror(entry.second, damage);
+  }
+}
+
+bool FlutterWebviewHandler::CopyPopupToTile(FlutterWebviewTextureRing* ring,
+                                            const WebviewRect& tile,
+                                            const WebviewRect& popup_source,
+                                            int popup_x,
+                                            int popup_y,
+                                            WebviewRect* tile_rect) {
+  const WebviewRect popup_rect{popup_x, popup_y, popup_source.width,
+                               popup_source.height};
+  WebviewRect overlap;
+  if (!FlutterWebviewTileGrid::Intersect(popup_rect, tile, &overlap)) {
+    return false;
+  }
+  *tile_rect =
+      WebviewRect{overlap.x - tile.x, overlap.y - tile.y, overlap.width,
+                  overlap.height};
+  ring->CopyToFrame(popup_texture_,
+                    WebviewRect{popup_source.x + overlap.x - popup_x,
+                                popup_source.y + overlap.y - popup_y,
+                                overlap.width, overlap.height},
+                    tile_rect->x, tile_rect->y);
+  return true;
+}
+
+template <typename Image>
+void FlutterWebviewHandler::PaintCpuImage(Image* image,
+                                          PaintElementType type,
+                                          const RectList& dirtyRects,
+                                          const void* buffer,
+                                          int width,
+                                          int height) {
+  if (type == PET_VIEW) {
+    const int64_t paint_start_ns = FlutterWebviewRenderStats::IsEnabled()
+                                       ? FlutterWebviewRenderStats::NowNs()
+                                       : 0;
+    view_width_ = width;
+    view_height_ = height;
+
+    // Only the dirty rows are copied. The rest of the image is brought up to
+    // date from the previous frame by the image itself.
+    std::vector<WebviewRect> damage;
+    if (!image->BeginWrite(width, height) || snapshot_drawn_) {
+      // Nothing of the view, or only its snapshot, is in the image yet.
+      damage.push_back(WebviewRect{0, 0, width, height});
+      snapshot_drawn_ = false;
+    } else {
+      damage.reserve(dirtyRects.size());
+      for (const CefRect& rect : dirtyRects) {
+        damage.push_back(WebviewRect{rect.x, rect.y, rect.width, rect.height});
+      }
+    }
+    for (const WebviewRect& rect : damage) {
+      image->CopyFromBGRA(buffer, width, rect, rect.x, rect.y);
+    }
+
+    // Put the popup back where the view has been drawn over it.
+    WebviewRect popup_source;
+    int popup_x, popup_y;
+    if (GetVisiblePopupRect(width, height, &popup_source, &popup_x,
+                            &popup_y)) {
+      const WebviewRect popup_rect{popup_x, popup_y, popup_source.width,
+                                   popup_source.height};
+      for (const WebviewRect& rect : damage) {
+        WebviewRect overlap;
+        if (FlutterWebviewTileGrid::Intersect(rect, popup_rect, &overlap)) {
+          image->CopyFromBGRA(popup_pixels_.data(), popup_texture_width_,
+                              popup_source, popup_x, popup_y);
+          break;
+        }
+      }
+    }
+    image->EndWrite(damage);
+
+    OnViewPainted(damage, width, height, static_cast<int>(dirtyRects.size()),
+                  paint_start_ns);
   } else if (type == PET_POPUP && popup_rect_.width > 0 &&
              popup_rect_.height > 0) {
-    int skip_pixels = 0, x = popup_rect_.x;
-    int skip_rows = 0, y = popup_rect_.y;
-    int w = width;
-    int h = height;
+    // Keep the popup to draw it again over the view paints that cover it.
+    const uint8_t* pixels = static_cast<const uint8_t*>(buffer);
+    popup_pixels_.assign(pixels, pixels + static_cast<size_t>(width) * height *
+                                              kBytesPerPixel);
+    popup_texture_width_ = width;
+    popup_texture_height_ = height;
+
+    // Draw the popup over the latest view as a new frame.
+    WebviewRect popup_source;
+    int popup_x, popup_y;
+    int frame_width, frame_height;
+    image->GetLatestFrameSize(&frame_width, &frame_height);
+    if (image->HasFrame() &&
+        GetVisiblePopupRect(frame_width, frame_height, &popup_source, &popup_x,
+                            &popup_y)) {
+      image->BeginWrite(frame_width, frame_height);
+      image->CopyFromBGRA(popup_pixels_.data(), width, popup_source, popup_x,
+                          popup_y);
+      image->EndWrite({WebviewRect{popup_x, popup_y, popup_source.width,
+                                   popup_source.height}});
+    }
+  }
+}
+
+void FlutterWebviewHandler::LoadSnapshot() {
+  // Called from the constructor, before the creator holds a reference: the
+  // callback holds one until DrawSnapshot() has run.
+  CefRefPtr<FlutterWebviewHandler> self(this);
+  snapshot_cache_->LoadAsync(
+      snapshot_key_,
+      [self](std::vector<uint8_t> pixels, int width, int height) {
+        // On the worker thread of the snapshot cache
+        if (pixels.empty()) {
+          return;
+        }
+        CefPostTask(TID_UI,
+                    base::BindOnce(&FlutterWebviewHandler::DrawSnapshot, self,
+                                   std::move(pixels), width, height));
+      });
+}
+
+void FlutterWebviewHandler::DrawSnapshot(std::vector<uint8_t> pixels,
+                                         int width,
+                                         int height) {
+  CEF_REQUIRE_UI_THREAD();
+
+  // The snapshot only stands in for the first paint.
+  if (browser_state_ == BrowserState::kClosing ||
+      browser_state_ == BrowserState::kClosed || textures_evicted_) {
+    return;
+  }
+  VLOG(1) << __func__ << ": webview_id_=" << webview_id_ << ", " << width
+          << "x" << height;
+
+  // Drawn without touching the size of the view, which the browser is created
+  // with. The first paint is drawn in full over it, since |painted_tiles_| is
+  // empty or |snapshot_drawn_| is set.
+  const std::vector<WebviewRect> damage{WebviewRect{0, 0, width, height}};
+  auto draw_to_image = [&](auto* image) {
+    if (image->HasFrame()) {
+      return;
+    }
+    image->BeginWrite(width, height);
+    image->CopyFromBGRA(pixels.data(), width, damage[0], 0, 0);
+    image->EndWrite(damage);
+    snapshot_drawn_ = true;
+  };
+
+  on_paint_begin_(webview_id_);
+  if (pixel_buffer_) {
+    draw_to_image(pixel_buffer_.get());
+  } else if (staging_buffer_) {
+    draw_to_image(staging_buffer_.get());
+  } else if (texture_ring_ && painted_tiles_.empty() &&
+             tile_grid_.GetTileCount(width, height) == 1) {
+    // A snapshot larger than a texture is not worth the tiles.
+    texture_ring_->BeginWrite();
+    const FlutterWebviewTextureRing::Frame frame =
+        texture_ring_->ReserveStorage(width, height);
+    uploader_.UploadRects(texture_ring_->target(), frame.texture, pixels.data(),
+                          width, height, damage, 0, 0);
+    texture_ring_->EndWrite(width, height, damage);
+  }
+  on_paint_end_(webview_id_);
+}
+
+bool FlutterWebviewHandler::ReadViewPixels(std::vector<uint8_t>* pixels,
+                                           int* width,
+                                           int* height) {
+  if (atlas_) {
+    if (atlas_pixels_.empty()) {
+      return false;
+    }
+    *pixels = atlas_pixels_;
+    *width = atlas_pixels_width_;
+    *height = atlas_pixels_height_;
+    return true;
+  }
+  if (pixel_buffer_) {
+    pixel_buffer_->GetLatestFrameSize(width, height);
+    return pixel_buffer_->ReadLatestFrame(pixels);
+  }
+  if (staging_buffer_) {
+    staging_buffer_->GetLatestFrameSize(width, height);
+    return staging_buffer_->ReadLatestFrame(pixels);
+  }
+  if (!texture_ring_ || textures_evicted_) {
+    return false;
+  }
+
+  on_paint_begin_(webview_id_);
+  bool read = false;
+  if (painted_tiles_.size() <= 1) {
+    texture_ring_->GetLatestFrameSize(width, height);
+    read = texture_ring_->ReadLatestFrame(pixels);
+  } else {
+    // Put the frames of the tiles together.
+    const WebviewRect& last = painted_tiles_.back();
+    *width = last.x + last.width;
+    *height = last.y + last.height;
+    const size_t stride = static_cast<size_t>(*width) * kBytesPerPixel;
+    pixels->assign(stride * *height, 0);
+    std::vector<uint8_t> tile_pixels;
+    read = true;
+    for (size_t i = 0; i < painted_tiles_.size() && read; ++i) {
+      FlutterWebviewTextureRing* ring = GetTileRing(i);
+      int tile_width = 0;
+      int tile_height = 0;
+      if (ring) {
+        ring->GetLatestFrameSize(&tile_width, &tile_height);
+      }
+      const WebviewRect& tile = painted_tiles_[i];
+      read = ring && tile_width == tile.width && tile_height == tile.height &&
+             ring->ReadLatestFrame(&tile_pixels);
+      if (!read) {
+        break;
+      }
+      const size_t row_size = static_cast<size_t>(tile.width) * kBytesPerPixel;
+      for (int row = 0; row < tile.height; ++row) {
+        std::memcpy(pixels->data() + (tile.y + row) * stride +
+                        tile.x * kBytesPerPixel,
+                    tile_pixels.data() + row * row_size, row_size);
+      }
+    }
+  }
+  on_paint_end_(webview_id_);
+  return read;
+}
 
-    // Adjust the popup to fit inside the view.
-    if (x < 0) {
-      skip_pixels = -x;
-      x = 0;
+void FlutterWebviewHandler::StageAtlasPaint(PaintElementType type,
+                                            const RectList& dirtyRects,
+                                            const void* buffer,
+                                            int width,
+                                            int height) {
+  const uint8_t* pixels = static_cast<const uint8_t*>(buffer);
+  if (type == PET_VIEW) {
+    view_width_ = width;
+    view_height_ = height;
+
+    // Keep the whole view since |buffer| is only valid during OnPaint, and the
+    // view is drawn again from there when it moves in the atlas.
+    std::vector<WebviewRect> rects;
+    if (width != atlas_pixels_width_ || height != atlas_pixels_height_) {
+      atlas_pixels_.assign(pixels, pixels + static_cast<size_t>(width) *
+                                                height * kBytesPerPixel);
+      atlas_pixels_width_ = width;
+      atlas_pixels_height_ = height;
+      rects.push_back(WebviewRect{0, 0, width, height});
+    } else {
+      const size_t stride = static_cast<size_t>(width) * kBytesPerPixel;
+      rects.reserve(dirtyRects.size());
+      for (const CefRect& rect : dirtyRects) {
+        const size_t offset = rect.y * stride + rect.x * kBytesPerPixel;
+        const size_t row_size =
+            static_cast<size_t>(rect.width) * kBytesPerPixel;
+        for (int row = 0; row < rect.height; ++row) {
+          std::memcpy(atlas_pixels_.data() + offset + row * stride,
+                      pixels + offset + row * stride, row_size);
+        }
+        rects.push_back(WebviewRect{rect.x, rect.y, rect.width, rect.height});
+      }
     }
-    if (y < 0) {
-      skip_rows = -y;
-      y = 0;
+    atlas_damage_.insert(atlas_damage_.end(), rects.begin(), rects.end());
+    OnViewPainted(rects, width, height, static_cast<int>(dirtyRects.size()),
+                  0);
+  } else if (type == PET_POPUP && popup_rect_.width > 0 &&
+             popup_rect_.height > 0) {
+    // Keep the popup to draw it again over the view paints that cover it.
+    popup_pixels_.assign(pixels, pixels + static_cast<size_t>(width) * height *
+                                              kBytesPerPixel);
+    popup_texture_width_ = width;
+    popup_texture_height_ = height;
+
+    WebviewRect popup_source;
+    int popup_x, popup_y;
+    if (!GetVisiblePopupRect(atlas_pixels_width_, atlas_pixels_height_,
+                             &popup_source, &popup_x, &popup_y)) {
+      return;
     }
-    if (x + w > view_width_)
-      w -= x + w - view_width_;
-    if (y + h > view_height_)
-      h -= y + h - view_height_;
+    atlas_damage_.push_back(WebviewRect{popup_x, popup_y, popup_source.width,
+                                        popup_source.height});
+  } else {
+    return;
+  }
+  QueueAtlasDraw();
+}
 
-    // Update the popup rectangle.
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
-    VERIFY_NO_ERROR;
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, skip_pixels);
-    VERIFY_NO_ERROR;
-    glPixelStorei(GL_UNPACK_SKIP_ROWS, skip_rows);
-    VERIFY_NO_ERROR;
-    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_BGRA,
-                    GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
-    VERIFY_NO_ERROR;
+void FlutterWebviewHandler::QueueAtlasDraw() {
+  CefRefPtr<FlutterWebviewHandler> self(this);
+  if (atlas_->Queue(webview_id_, [self](GLenum target, GLuint texture) {
+        return self->DrawToAtlas(target, texture);
+      })) {
+    // Run after the paints of the other webviews already posted, so that
+    // they are drawn in the same frame of the atlas.
+    CefPostTask(TID_UI, base::BindOnce(&FlutterWebviewHandler::FlushAtlas,
+                                       self, atlas_));
   }
+}
 
-  if (type == PET_VIEW && !popup_rect_.IsEmpty()) {
-    browser->GetHost()->Invalidate(PET_POPUP);
+std::vector<WebviewRect> FlutterWebviewHandler::DrawToAtlas(GLenum target,
+                                                            GLuint texture) {
+  std::vector<WebviewRect> damage;
+  damage.swap(atlas_damage_);
+  if (!atlas_ || atlas_pixels_.empty()) {
+    return {};
   }
 
+  // The region is placed for the size of the latest resize, which the paints
+  // may not have caught up with yet. Only the part that fits is drawn.
+  const WebviewRect visible{0, 0,
+                            std::min(atlas_pixels_width_, atlas_region_.width),
+                            std::min(atlas_pixels_height_,
+                                     atlas_region_.height)};
+  coalescer_.SetCostModel(FlutterWebviewTextureUploader::GetCostModel());
+  std::vector<WebviewRect> rects = FlutterWebviewTileGrid::ClipRects(
+      coalescer_.Coalesce(damage), visible);
+  uploader_.UploadRects(target, texture, atlas_pixels_.data(),
+                        atlas_pixels_width_, atlas_pixels_height_, rects,
+                        atlas_region_.x, atlas_region_.y);
+
+  // Put the popup back where the view has been drawn over it.
+  WebviewRect popup_source;
+  int popup_x, popup_y;
+  if (GetVisiblePopupRect(visible.width, visible.height, &popup_source,
+                          &popup_x, &popup_y)) {
+    const WebviewRect popup_rect{popup_x, popup_y, popup_source.width,
+                                 popup_source.height};
+    for (const WebviewRect& rect : rects) {
+      WebviewRect overlap;
+      if (FlutterWebviewTileGrid::Intersect(rect, popup_rect, &overlap)) {
+        uploader_.UploadRects(
+            target, texture, popup_pixels_.data(), popup_texture_width_,
+            popup_texture_height_, {popup_source},
+            atlas_region_.x + popup_x - popup_source.x,
+            atlas_region_.y + popup_y - popup_source.y);
+        break;
+      }
+    }
+  }
+
+  for (WebviewRect& rect : rects) {
+    rect.x += atlas_region_.x;
+    rect.y += atlas_region_.y;
+  }
+  return rects;
+}
+
+void FlutterWebviewHandler::FlushAtlas(
+    std::shared_ptr<FlutterWebviewTextureAtlas> atlas) {
+  CEF_REQUIRE_UI_THREAD();
+
+  on_paint_begin_(webview_id_);
+  atlas->Flush();
   on_paint_end_(webview_id_);
 }
 
+void FlutterWebviewHandler::OnViewPainted(
+    const std::vector<WebviewRect>& damage,
+    int width,
+    int height,
+    int dirty_rects,
+    int64_t paint_start_ns) {
+  double damaged_area = 0;
+  for (const WebviewRect& rect : damage) {
+    damaged_area += static_cast<double>(rect.width) * rect.height;
+  }
+
+  if (FlutterWebviewRenderStats::IsEnabled() && paint_start_ns > 0) {
+    const int64_t paint_end_ns = FlutterWebviewRenderStats::NowNs();
+    render_stats()->RecordPaint(
+        paint_end_ns - paint_start_ns,
+        last_paint_time_ns_ >= 0 ? paint_start_ns - last_paint_time_ns_ : -1,
+        static_cast<int64_t>(damaged_area) * kBytesPerPixel, dirty_rects,
+        static_cast<int>(damage.size()));
+    last_paint_time_ns_ = paint_start_ns;
+  } else {
+    last_paint_time_ns_ = -1;
+  }
+
+  if (frame_rate_governor_.OnPaint(damaged_area /
+                                   (static_cast<double>(width) * height))) {
+    ApplyFrameRate();
+  }
+}
+
+FlutterWebviewRenderStats* FlutterWebviewHandler::render_stats() {
+  if (pixel_buffer_) {
+    return &pixel_buffer_->render_stats();
+  }
+  if (staging_buffer_) {
+    return &staging_buffer_->render_stats();
+  }
+  return &texture_ring_->render_stats();
+}
+
 void FlutterWebviewHandler::OnPopupShow(CefRefPtr<CefBrowser> browser,
                                         bool show) {
   CEF_REQUIRE_UI_THREAD();
 
   if (!show) {
-    // Clear the popup rectangle.
+    // Clear the popup rectangle, and have the view under it repainted since
+    // the popup is drawn over the view in the textures.
+    const bool had_popup = !popup_rect_.IsEmpty();
     ClearPopupRects();
+    if (had_popup) {
+      InvalidateView();
+    }
   }
 }
 
@@ -411,8 +1748,13 @@ void FlutterWebviewHandler::OnPopupSize(CefRefPtr<CefBrowser> browser,
 
   if (rect.width <= 0 || rect.height <= 0)
     return;
+  const CefRect previous_popup_rect = popup_rect_;
   original_popup_rect_ = rect;
   popup_rect_ = GetPopupRectInWebView(original_popup_rect_);
+  if (!previous_popup_rect.IsEmpty() && previous_popup_rect != popup_rect_) {
+    // Repaint the view uncovered by the popup moved or shrunk.
+    InvalidateView();
+  }
 }
 
 CefRect FlutterWebviewHandler::GetPopupRectInWebView(
@@ -436,6 +1778,73 @@ CefRect FlutterWebviewHandler::GetPopupRectInWebView(
   return rc;
 }
 
+void FlutterWebviewHandler::UploadPopup(const void* buffer,
+                                        int width,
+                                        int height,
+                                        const RectList& dirty_rects) {
+  const GLenum target = texture_ring_->target();
+  std::vector<WebviewRect> rects;
+  if (popup_texture_ == 0 || popup_texture_width_ != width ||
+      popup_texture_height_ != height) {
+    if (popup_texture_ == 0) {
+      glGenTextures(1, &popup_texture_);
+    }
+    glBindTexture(target, popup_texture_);
+    flutter_webview_gl::AllocateTextureImage(target, width, height);
+    popup_texture_width_ = width;
+    popup_texture_height_ = height;
+    rects.push_back(WebviewRect{0, 0, width, height});
+  } else {
+    rects.reserve(dirty_rects.size());
+    for (const CefRect& rect : dirty_rects) {
+      rects.push_back(WebviewRect{rect.x, rect.y, rect.width, rect.height});
+    }
+  }
+  uploader_.UploadRects(target, popup_texture_, buffer, width, height, rects,
+                        0, 0);
+}
+
+bool FlutterWebviewHandler::GetVisiblePopupRect(int frame_width,
+                                                int frame_height,
+                                                WebviewRect* source,
+                                                int* x,
+                                                int* y) const {
+  if (popup_rect_.IsEmpty() || popup_texture_width_ == 0) {
+    return false;
+  }
+
+  int skip_pixels = 0;
+  int skip_rows = 0;
+  *x = popup_rect_.x;
+  *y = popup_rect_.y;
+  int w = popup_texture_width_;
+  int h = popup_texture_height_;
+
+  // Adjust the popup to fit inside the frame.
+  if (*x < 0) {
+    skip_pixels = -*x;
+    w -= skip_pixels;
+    *x = 0;
+  }
+  if (*y < 0) {
+    skip_rows = -*y;
+    h -= skip_rows;
+    *y = 0;
+  }
+  if (*x + w > frame_width)
+    w = frame_width - *x;
+  if (*y + h > frame_height)
+    h = frame_height - *y;
+  if (w <= 0 || h <= 0) {
+    return false;
+  }
+
+  // The visible part of the popup starts at (skip_pixels, skip_rows) of the
+  // popup texture.
+  *source = WebviewRect{skip_pixels, skip_rows, w, h};
+  return true;
+}
+
 void FlutterWebviewHandler::ClearPopupRects() {
   popup_rect_.Set(0, 0, 0, 0);
   original_popup_rect_.Set(0, 0, 0, 0);
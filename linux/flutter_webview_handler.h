@@ -65,9 +65,26 @@
 #include <GL/gl.h>
 
 #include <functional>
+#include <map>
+#include <memory>
 #include <set>
+#include <string>
+#include <vector>
 
 #include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_damage_refiner.h"
+#include "flutter_webview_frame_rate_governor.h"
+#include "flutter_webview_frame_tap.h"
+#include "flutter_webview_pixel_buffer.h"
+#include "flutter_webview_recorder.h"
+#include "flutter_webview_rect_coalescer.h"
+#include "flutter_webview_render_stats.h"
+#include "flutter_webview_snapshot_cache.h"
+#include "flutter_webview_staging_buffer.h"
+#include "flutter_webview_texture_atlas.h"
+#include "flutter_webview_texture_ring.h"
+#include "flutter_webview_texture_uploader.h"
+#include "flutter_webview_tile_grid.h"
 #include "include/cef_client.h"
 
 class FlutterWebviewHandler : public CefClient,
@@ -76,6 +93,10 @@ class FlutterWebviewHandler : public CefClient,
                               public CefLoadHandler,
                               public CefRenderHandler {
  public:
+  // Called on the CEF UI thread with each frame published by the frame tap.
+  using FrameTappedCallback =
+      std::function<void(const FlutterWebviewFrameTap::Frame& frame)>;
+
   FlutterWebviewHandler(
       WebviewId webview_id,
       const WebviewCreationParams& params,
@@ -158,6 +179,99 @@ class FlutterWebviewHandler : public CefClient,
   // Set the OSR resolution
   void SetViewRect(int width, int height);
 
+  // Sets the rings to draw the tiles after the first one to, when the view is
+  // larger than a texture can hold. The view is repainted if they have
+  // changed.
+  void SetTileRings(
+      const std::vector<std::shared_ptr<FlutterWebviewTextureRing>>& rings);
+
+  // Draws the view to |region| of |atlas|, shared with other webviews, instead
+  // of its own textures, or back to its own textures if |atlas| is null. A
+  // view moved to another region is drawn there from its latest paint.
+  void SetAtlasRegion(std::shared_ptr<FlutterWebviewTextureAtlas> atlas,
+                      const WebviewRect& region);
+
+  // Draws the view to |ring| as well, scaled to |width| x |height|, for the
+  // mirror texture |mirror_id|. Replaces the ring of the mirror if it already
+  // exists. The browser keeps painting while it has mirrors, even if its own
+  // widget is hidden. Returns false if the view is not drawn to GL textures of
+  // its own.
+  bool AddMirror(WebviewId mirror_id,
+                 std::shared_ptr<FlutterWebviewTextureRing> ring,
+                 int width,
+                 int height);
+
+  // Changes the size the view is scaled to for the mirror |mirror_id|.
+  // Returns false if the mirror does not exist.
+  bool ResizeMirror(WebviewId mirror_id, int width, int height);
+
+  // Stops drawing the view to the mirror |mirror_id|, if it exists.
+  void RemoveMirror(WebviewId mirror_id);
+
+  // Sets how the painted pixels are uploaded to the texture.
+  void SetTextureUploadMode(TextureUploadMode mode);
+
+  // Sets the windowless frame rate of the browser. If |adaptive| is true, the
+  // rate is lowered down to |min_frame_rate| while the browser paints little
+  // and restored on input or large damage.
+  void SetFrameRate(int frame_rate, bool adaptive, int min_frame_rate);
+
+  // Sets whether the dirty rectangles of the view paints are narrowed down to
+  // the tiles whose pixels have changed before being drawn.
+  void SetDamageRefinementEnabled(bool enabled);
+
+  // Called when an input event is sent to the browser.
+  void OnInputEvent();
+
+  // Sets whether the widget showing the browser is visible. If |mute_audio| is
+  // true, the audio of the browser is also muted while it is hidden.
+  void SetVisible(bool visible, bool mute_audio);
+
+  // Sets whether the window containing the Flutter view is visible, i.e. not
+  // minimized.
+  void SetWindowVisible(bool visible);
+
+  // Makes the browser produce a frame, if it was created with
+  // WebviewCreationParams::external_begin_frame, is not hidden and the last
+  // one is older than the interval of the current frame rate.
+  void SendExternalBeginFrame();
+
+  // Returns the texture memory that EvictTextures would release in |usage|,
+  // or false if the view is shown or has no textures of its own to release.
+  bool GetEvictableTextureUsage(WebviewTextureUsage* usage) const;
+
+  // Shrinks the textures of the hidden view to a 1 x 1 placeholder to save
+  // memory. The view is repainted in full when it is shown again.
+  void EvictTextures();
+
+  // Returns the counters of the texture updates done for this browser.
+  WebviewRenderCounters GetRenderCounters() const;
+
+  // Starts publishing every |decimation|th paint of the view to
+  // |on_frame_tapped| through a frame tap of |slot_count| slots, replacing the
+  // previous one. A headless browser paints while it has a frame tap. Returns
+  // false if the frame tap could not be created.
+  bool SubscribeFrames(int slot_count,
+                       int decimation,
+                       const FrameTappedCallback& on_frame_tapped);
+
+  // Stops publishing the paints of the view and deletes the frame tap.
+  void UnsubscribeFrames();
+
+  // Gives back a frame published by the frame tap. See
+  // FlutterWebviewFrameTap::Release.
+  void ReleaseTappedFrame(int64_t generation, int slot);
+
+  // Starts recording the paints of the view to the file at |path|. A
+  // headless browser paints while it is recorded. Returns false with a
+  // message in |error| if the file could not be created or a recording is
+  // already running.
+  bool StartRecording(const std::string& path, std::string* error);
+
+  // Stops the recording. |on_stopped| is called on the recorder's writer
+  // thread once the file is complete. Returns false if nothing is recorded.
+  bool StopRecording(const FlutterWebviewRecorder::StoppedCallback& on_stopped);
+
  private:
   enum class BrowserState {
     kBeforeCreated,
@@ -170,8 +284,179 @@ class FlutterWebviewHandler : public CefClient,
   };
 
   void ClearPopupRects();
+
+  // Notifies the browser that it was hidden or shown when the widget or the
+  // window visibility, or the consumers of its paints, have changed.
+  void UpdateHidden();
+
+  // Has the whole view repainted, and drawn even where it has not changed.
+  void InvalidateView();
+
+  // Returns whether the webview was created without a texture.
+  bool IsHeadless() const {
+    return !texture_ring_ && !pixel_buffer_ && !staging_buffer_;
+  }
+
+  // Applies the frame rate decided by the governor to the browser.
+  void ApplyFrameRate();
+  // Runs every FlutterWebviewFrameRateGovernor::kPeriodMs while the governor
+  // is adaptive.
+  void OnFrameRatePeriodElapsed();
   CefRect GetPopupRectInWebView(const CefRect& original_rect);
 
+  // Returns the ring of the tile |index|, or nullptr if it has not been given
+  // yet.
+  FlutterWebviewTextureRing* GetTileRing(size_t index) const;
+
+  // Draws the |damage| of a view paint inside |tile| to |ring|. A tile that no
+  // damage touches is neither uploaded nor published.
+  void PaintTile(FlutterWebviewTextureRing* ring,
+                 const WebviewRect& tile,
+                 const void* buffer,
+                 int width,
+                 int height,
+                 const std::vector<WebviewRect>& damage);
+
+  // Copies the part of the visible popup, given as by GetVisiblePopupRect,
+  // that is inside |tile| to the frame of |ring| being written. Returns the
+  // region copied in the coordinates of the tile in |tile_rect|, or false if
+  // the popup is outside the tile.
+  bool CopyPopupToTile(FlutterWebviewTextureRing* ring,
+                       const WebviewRect& tile,
+                       const WebviewRect& popup_source,
+                       int popup_x,
+                       int popup_y,
+                       WebviewRect* tile_rect);
+
+  // A texture showing the view of this browser besides its own, at its own
+  // size.
+  struct Mirror {
+    std::shared_ptr<FlutterWebviewTextureRing> ring;
+    int width;
+    int height;
+  };
+
+  // Draws the view, from the latest frames of its tiles, to |mirror|. Only
+  // |damage| is copied if the mirror has the size of the view and holds the
+  // previous frame; otherwise the whole view is drawn, scaled.
+  void PaintMirror(const Mirror& mirror,
+                   const std::vector<WebviewRect>& damage);
+
+  // Draws |damage| of the view to every mirror.
+  void PaintMirrors(const std::vector<WebviewRect>& damage);
+
+  // Returns whether the paints of the view are taken by a frame tap or a
+  // recorder, besides being drawn.
+  bool HasPaintConsumers() const { return frame_tap_ || recorder_; }
+
+  // Gives a paint of the view to the frame tap and the recorder.
+  void PublishViewPaint(const RectList& dirtyRects,
+                        const void* buffer,
+                        int width,
+                        int height);
+
+  // Draws a paint to the textures or images of the webview, after it has been
+  // given to the paint consumers and its damage refined.
+  void DrawPaint(PaintElementType type,
+                 const RectList& dirtyRects,
+                 const void* buffer,
+                 int width,
+                 int height);
+
+  // Draws a paint without GL to |image|, which is either |pixel_buffer_| or
+  // |staging_buffer_|.
+  template <typename Image>
+  void PaintCpuImage(Image* image,
+                     PaintElementType type,
+                     const RectList& dirtyRects,
+                     const void* buffer,
+                     int width,
+                     int height);
+
+  // Draws a view paint of |rects| to the rings of the tiles.
+  void PaintView(const void* buffer,
+                 int width,
+                 int height,
+                 const std::vector<WebviewRect>& rects);
+
+  // Keeps the |rects| of a view paint in |deferred_pixels_| instead of
+  // uploading them, and returns true, while Flutter has not taken the
+  // previous frame of a tile. The view is drawn from there by
+  // FlushDeferredPaint() once Flutter has caught up.
+  bool DeferViewPaintIfBehind(const void* buffer,
+                              int width,
+                              int height,
+                              const std::vector<WebviewRect>& rects);
+
+  // Draws the view paints deferred since |deferral_sequence| started, unless
+  // a later paint has already drawn them.
+  void FlushDeferredPaint(int deferral_sequence);
+
+  // Releases the textures kept by EvictTextures() while Flutter could still
+  // sample them, once Flutter has taken the placeholders instead.
+  void ReleaseEvictedTextures();
+
+  // Has |snapshot_cache_| decode the snapshot of the view on its worker
+  // thread, and DrawSnapshot() called with it.
+  void LoadSnapshot();
+
+  // Draws the |width| x |height| BGRA |pixels| of the snapshot of the view as
+  // the first frame, to be replaced by the first paint. Does nothing if the
+  // browser has painted or closed meanwhile.
+  void DrawSnapshot(std::vector<uint8_t> pixels, int width, int height);
+
+  // Reads the latest frame of the view back to |pixels| as BGRA, to be stored
+  // as the snapshot when the browser is closed. Returns false if the view has
+  // no frame, or if its textures have been evicted.
+  bool ReadViewPixels(std::vector<uint8_t>* pixels, int* width, int* height);
+
+  // Keeps a paint in |atlas_pixels_| or |popup_pixels_|, and queues the
+  // regions it changed to be drawn by the next flush of the atlas.
+  void StageAtlasPaint(PaintElementType type,
+                       const RectList& dirtyRects,
+                       const void* buffer,
+                       int width,
+                       int height);
+
+  // Queues the draw of |atlas_damage_| to the atlas, and has the atlas flushed
+  // if nothing was queued yet.
+  void QueueAtlasDraw();
+
+  // Draws |atlas_damage_| of the view, and the popup over it, to |texture|,
+  // the frame of the atlas being written. Returns the regions drawn in the
+  // coordinates of the atlas.
+  std::vector<WebviewRect> DrawToAtlas(GLenum target, GLuint texture);
+
+  // Draws the paints queued to |atlas| by all its webviews.
+  void FlushAtlas(std::shared_ptr<FlutterWebviewTextureAtlas> atlas);
+
+  // Updates the frame rate governor and the render stats after a paint of the
+  // view. |paint_start_ns| is 0 if the render stats were disabled.
+  void OnViewPainted(const std::vector<WebviewRect>& damage,
+                     int width,
+                     int height,
+                     int dirty_rects,
+                     int64_t paint_start_ns);
+
+  // The render stats of the texture ring or the pixel buffer.
+  FlutterWebviewRenderStats* render_stats();
+
+  // Uploads the |dirty_rects| of the popup |buffer| to the popup texture,
+  // (re)allocating it if its size differs.
+  void UploadPopup(const void* buffer,
+                   int width,
+                   int height,
+                   const RectList& dirty_rects);
+
+  // Returns the part of the popup texture that is visible in a |frame_width| x
+  // |frame_height| frame in |source| and its position in the frame in |x| and
+  // |y|, or false if no popup is visible.
+  bool GetVisiblePopupRect(int frame_width,
+                           int frame_height,
+                           WebviewRect* source,
+                           int* x,
+                           int* y) const;
+
   std::function<void(WebviewId webview_id)> on_paint_begin_;
   std::function<void(WebviewId webview_id)> on_paint_end_;
 
@@ -192,11 +477,90 @@ class FlutterWebviewHandler : public CefClient,
   WebviewId webview_id_;
   BrowserState browser_state_;
   CefRefPtr<CefBrowser> browser_;
-  GLuint native_texture_id_;
+  // One of them is set, depending on the texture backend.
+  std::shared_ptr<FlutterWebviewTextureRing> texture_ring_;
+  std::shared_ptr<FlutterWebviewPixelBuffer> pixel_buffer_;
+  std::shared_ptr<FlutterWebviewStagingBuffer> staging_buffer_;
+  // The view is drawn to |texture_ring_| as the first tile of |tile_grid_|,
+  // and to |tile_rings_| for the others if it is larger than a texture.
+  FlutterWebviewTileGrid tile_grid_;
+  std::vector<std::shared_ptr<FlutterWebviewTextureRing>> tile_rings_;
+  // The tiles of the latest view paint. Empty if the tiles have to be drawn
+  // from scratch.
+  std::vector<WebviewRect> painted_tiles_;
+  // Whether the rings of the tiles have been shrunk by EvictTextures and not
+  // drawn to since.
+  bool textures_evicted_;
+  // The mirror textures of the view, keyed by their IDs.
+  std::map<WebviewId, Mirror> mirrors_;
+  // Set while the view is drawn to |atlas_region_| of a texture atlas instead
+  // of the rings of the tiles. The latest pixels of the view are kept in
+  // |atlas_pixels_|, and the regions of them not drawn to the atlas yet in
+  // |atlas_damage_|.
+  std::shared_ptr<FlutterWebviewTextureAtlas> atlas_;
+  WebviewRect atlas_region_;
+  std::vector<uint8_t> atlas_pixels_;
+  int atlas_pixels_width_;
+  int atlas_pixels_height_;
+  std::vector<WebviewRect> atlas_damage_;
+  // The view paints held back while Flutter has not taken the previous frame:
+  // the latest pixels of the view and the regions not uploaded yet. Empty
+  // |deferred_damage_| means that no paint is deferred.
+  std::vector<uint8_t> deferred_pixels_;
+  std::vector<WebviewRect> deferred_damage_;
+  int deferred_width_;
+  int deferred_height_;
+  // Counts the deferrals, so that the flushes of the older ones are ignored.
+  int deferral_sequence_;
+  FlutterWebviewTextureUploader uploader_;
+  // Set if the view is shown from a snapshot stored under |snapshot_key_|
+  // before its first paint. The latest frame of the view is read back and
+  // stored under it for the next run when the browser is closed.
+  std::shared_ptr<FlutterWebviewSnapshotCache> snapshot_cache_;
+  std::string snapshot_key_;
+  // Whether the CPU image holds the snapshot rather than a paint.
+  bool snapshot_drawn_;
+  // Set while a subscriber takes the paints of the view.
+  std::unique_ptr<FlutterWebviewFrameTap> frame_tap_;
+  FrameTappedCallback on_frame_tapped_;
+  // Set while the view is recorded.
+  std::unique_ptr<FlutterWebviewRecorder> recorder_;
+  FlutterWebviewRectCoalescer coalescer_;
+  FlutterWebviewDamageRefiner damage_refiner_;
+  bool damage_refinement_enabled_;
+  FlutterWebviewFrameRateGovernor frame_rate_governor_;
+  bool frame_rate_timer_running_;
+  // Whether the browser paints on SendExternalBeginFrame() instead of on its
+  // own timer. The begin frames are then limited to the rate of
+  // |frame_rate_governor_|.
+  bool external_begin_frame_;
+  // The FlutterWebviewRenderStats::NowNs() of the last begin frame sent, or 0.
+  int64_t last_external_begin_frame_ns_;
+  // The textures are offscreen unless both the widget and the window are
+  // visible, and the browser is hidden while they are offscreen unless a frame
+  // tap or a recorder takes its paints. An offscreen view is not uploaded.
+  bool visible_;
+  bool window_visible_;
+  bool offscreen_;
+  bool hidden_;
+  bool mute_audio_when_hidden_;
+  bool audio_muted_;
   int view_width_;
   int view_height_;
   CefRect popup_rect_;
   CefRect original_popup_rect_;
+  // The popup is drawn to its own texture and copied over the view on the GPU,
+  // so that it is uploaded only when its contents change. With the pixel
+  // buffer backend or in an atlas, the popup is kept in |popup_pixels_|
+  // instead.
+  GLuint popup_texture_;
+  std::vector<uint8_t> popup_pixels_;
+  int popup_texture_width_;
+  int popup_texture_height_;
+  // Measures the GPU time of the paints while the render stats are enabled.
+  FlutterWebviewGpuTimer gpu_timer_;
+  // The start of the previous paint of the view, -1 if it was not measured.
+  int64_t last_paint_time_ns_;
 
   // Include the default reference counting implementation.
   IMPLEMENT_REFCOUNTING(FlutterWebviewHandler);
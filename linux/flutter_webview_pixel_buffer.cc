@@ -0,0 +1,345 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_pixel_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_pixel_conversion.h"
+
+namespace {
+
+// Above this number, the stale regions of an image are replaced with their
+// bounding box.
+constexpr size_t kMaxStaleRects = 16;
+
+constexpr int kBytesPerPixel = 4;
+
+// Shown until the first frame is published.
+constexpr uint8_t kTransparentPixel[kBytesPerPixel] = {0, 0, 0, 0};
+
+WebviewRect BoundingBoxOf(const std::vector<WebviewRect>& rects) {
+  int left = rects[0].x;
+  int top = rects[0].y;
+  int right = rects[0].x + rects[0].width;
+  int bottom = rects[0].y + rects[0].height;
+  for (const WebviewRect& rect : rects) {
+    left = std::min(left, rect.x);
+    top = std::min(top, rect.y);
+    right = std::max(right, rect.x + rect.width);
+    bottom = std::max(bottom, rect.y + rect.height);
+  }
+  return WebviewRect{left, top, right - left, bottom - top};
+}
+
+}  // namespace
+
+constexpr int FlutterWebviewPixelBuffer::kNumSlots;
+
+FlutterWebviewPixelBuffer::FlutterWebviewPixelBuffer()
+    : last_sequence_(0),
+      presented_slot_(-1),
+      published_sequence_(0),
+      presented_sequence_(0),
+      frame_available_pending_(false),
+      last_publish_time_ns_(0),
+      writing_slot_(-1),
+      latest_slot_(-1) {}
+
+bool FlutterWebviewPixelBuffer::HasFrame() const {
+  return latest_slot_ >= 0;
+}
+
+bool FlutterWebviewPixelBuffer::BeginWrite(int width, int height) {
+  if (writing_slot_ >= 0) {
+    std::cerr << "Error: FlutterWebviewPixelBuffer::BeginWrite() is called "
+                 "twice without EndWrite()."
+              << std::endl;
+    return false;
+  }
+
+  bool superseded = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Take the free image, or else the published one Flutter has not taken,
+    // which is superseded without being shown. Flutter reads at most one.
+    int slot_index = -1;
+    for (int i = 0; i < kNumSlots; ++i) {
+      const Slot& slot = slots_[i];
+      if (slot.state == SlotState::kFree) {
+        slot_index = i;
+        break;
+      }
+      if (slot.state == SlotState::kPublished &&
+          (slot_index < 0 || slot.sequence < slots_[slot_index].sequence)) {
+        slot_index = i;
+      }
+    }
+
+    Slot& slot = slots_[slot_index];
+    superseded = slot.state == SlotState::kPublished;
+    slot.state = SlotState::kWriting;
+    writing_slot_ = slot_index;
+  }
+
+  if (superseded && FlutterWebviewRenderStats::IsEnabled()) {
+    render_stats_.RecordSupersededFrames(1);
+  }
+
+  // Flutter does not read the image being written, so it can be reallocated.
+  Slot& slot = slots_[writing_slot_];
+  if (slot.width != width || slot.height != height) {
+    slot.pixels.resize(static_cast<size_t>(width) * height * kBytesPerPixel);
+    slot.width = width;
+    slot.height = height;
+    slot.stale_rects.assign(1, WebviewRect{0, 0, width, height});
+  }
+
+  if (latest_slot_ < 0 || slots_[latest_slot_].width != width ||
+      slots_[latest_slot_].height != height) {
+    slot.stale_rects.clear();
+    return false;
+  }
+  CatchUp(&slot);
+  return true;
+}
+
+void FlutterWebviewPixelBuffer::CatchUp(Slot* slot) {
+  if (&slots_[latest_slot_] == slot) {
+    slot->stale_rects.clear();
+    return;
+  }
+  const Slot& latest = slots_[latest_slot_];
+  const size_t stride = static_cast<size_t>(slot->width) * kBytesPerPixel;
+
+  for (const WebviewRect& rect : slot->stale_rects) {
+    const int left = std::max(rect.x, 0);
+    const int top = std::max(rect.y, 0);
+    const int right = std::min(rect.x + rect.width, slot->width);
+    const int bottom = std::min(rect.y + rect.height, slot->height);
+    if (left >= right || top >= bottom) {
+      continue;
+    }
+    const size_t offset = static_cast<size_t>(left) * kBytesPerPixel;
+    const size_t length = static_cast<size_t>(right - left) * kBytesPerPixel;
+    for (int row = top; row < bottom; ++row) {
+      std::memcpy(slot->pixels.data() + row * stride + offset,
+                  latest.pixels.data() + row * stride + offset, length);
+    }
+  }
+  slot->stale_rects.clear();
+}
+
+void FlutterWebviewPixelBuffer::CopyFromBGRA(const void* bgra,
+                                             int source_width,
+                                             const WebviewRect& rect,
+                                             int x,
+                                             int y) {
+  if (writing_slot_ < 0) {
+    std::cerr << "Error: FlutterWebviewPixelBuffer::CopyFromBGRA() is called "
+                 "without BeginWrite()."
+              << std::endl;
+    return;
+  }
+  Slot& slot = slots_[writing_slot_];
+
+  // Clip the destination, moving the source along.
+  const int left = std::max(x, 0);
+  const int top = std::max(y, 0);
+  const int right = std::min(x + rect.width, slot.width);
+  const int bottom = std::min(y + rect.height, slot.height);
+  if (left >= right || top >= bottom) {
+    return;
+  }
+  const int source_x = rect.x + left - x;
+  const int source_y = rect.y + top - y;
+
+  const uint8_t* source = static_cast<const uint8_t*>(bgra);
+  const size_t source_stride =
+      static_cast<size_t>(source_width) * kBytesPerPixel;
+  const size_t stride = static_cast<size_t>(slot.width) * kBytesPerPixel;
+  const int pixels_per_row = right - left;
+  for (int row = 0; row < bottom - top; ++row) {
+    const uint8_t* src = source + (source_y + row) * source_stride +
+                         static_cast<size_t>(source_x) * kBytesPerPixel;
+    uint8_t* dst = slot.pixels.data() + (top + row) * stride +
+                   static_cast<size_t>(left) * kBytesPerPixel;
+    flutter_webview_pixels::ConvertBGRAToRGBA(src, dst, pixels_per_row);
+  }
+}
+
+void FlutterWebviewPixelBuffer::EndWrite(
+    const std::vector<WebviewRect>& damage) {
+  if (writing_slot_ < 0) {
+    std::cerr << "Error: FlutterWebviewPixelBuffer::EndWrite() is called "
+                 "without BeginWrite()."
+              << std::endl;
+    return;
+  }
+
+  int64_t publish_time_ns = 0;
+  if (FlutterWebviewRenderStats::IsEnabled()) {
+    publish_time_ns = FlutterWebviewRenderStats::NowNs();
+    render_stats_.RecordPublishedFrame();
+  }
+
+  for (int i = 0; i < kNumSlots; ++i) {
+    if (i == writing_slot_) {
+      continue;
+    }
+    std::vector<WebviewRect>& stale_rects = slots_[i].stale_rects;
+    stale_rects.insert(stale_rects.end(), damage.begin(), damage.end());
+    if (stale_rects.size() > kMaxStaleRects) {
+      stale_rects.assign(1, BoundingBoxOf(stale_rects));
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slots_[writing_slot_];
+    slot.state = SlotState::kPublished;
+    slot.sequence = ++last_sequence_;
+    slot.publish_time_ns = publish_time_ns;
+    last_publish_time_ns_.store(publish_time_ns);
+    published_sequence_.store(slot.sequence);
+  }
+
+  latest_slot_ = writing_slot_;
+  writing_slot_ = -1;
+}
+
+void FlutterWebviewPixelBuffer::GetLatestFrameSize(int* width,
+                                                   int* height) const {
+  if (latest_slot_ < 0) {
+    *width = 0;
+    *height = 0;
+    return;
+  }
+  *width = slots_[latest_slot_].width;
+  *height = slots_[latest_slot_].height;
+}
+
+bool FlutterWebviewPixelBuffer::ReadLatestFrame(
+    std::vector<uint8_t>* bgra) const {
+  if (latest_slot_ < 0) {
+    return false;
+  }
+  // Swapping the first and third bytes converts RGBA back to BGRA.
+  const Slot& latest = slots_[latest_slot_];
+  bgra->resize(latest.pixels.size());
+  flutter_webview_pixels::ConvertBGRAToRGBA(
+      latest.pixels.data(), bgra->data(),
+      static_cast<size_t>(latest.width) * latest.height);
+  return true;
+}
+
+void FlutterWebviewPixelBuffer::AcquireLatestFrame(const uint8_t** pixels,
+                                                   uint32_t* width,
+                                                   uint32_t* height) {
+  frame_available_pending_.store(false);
+
+  int superseded_frames = 0;
+  int64_t presented_publish_time_ns = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    int newest_slot = -1;
+    for (int i = 0; i < kNumSlots; ++i) {
+      const Slot& slot = slots_[i];
+      if (slot.state == SlotState::kPublished &&
+          (newest_slot < 0 || slot.sequence > slots_[newest_slot].sequence)) {
+        newest_slot = i;
+      }
+    }
+
+    if (newest_slot >= 0) {
+      for (int i = 0; i < kNumSlots; ++i) {
+        Slot& slot = slots_[i];
+        if (i != newest_slot && (slot.state == SlotState::kPublished ||
+                                 slot.state == SlotState::kPresented)) {
+          superseded_frames += slot.state == SlotState::kPublished;
+          slot.state = SlotState::kFree;
+        }
+      }
+      slots_[newest_slot].state = SlotState::kPresented;
+      presented_publish_time_ns = slots_[newest_slot].publish_time_ns;
+      presented_slot_ = newest_slot;
+      presented_sequence_.store(slots_[newest_slot].sequence);
+    }
+
+    if (presented_slot_ >= 0) {
+      const Slot& slot = slots_[presented_slot_];
+      *pixels = slot.pixels.data();
+      *width = slot.width;
+      *height = slot.height;
+    } else {
+      *pixels = kTransparentPixel;
+      *width = 1;
+      *height = 1;
+    }
+  }
+
+  if (FlutterWebviewRenderStats::IsEnabled()) {
+    if (superseded_frames > 0) {
+      render_stats_.RecordSupersededFrames(superseded_frames);
+    }
+    if (presented_publish_time_ns > 0) {
+      render_stats_.RecordPresentLatency(FlutterWebviewRenderStats::NowNs() -
+                                         presented_publish_time_ns);
+    }
+  }
+}
+
+bool FlutterWebviewPixelBuffer::HasUnpresentedFrame() const {
+  return published_sequence_.load() > presented_sequence_.load();
+}
+
+bool FlutterWebviewPixelBuffer::TakeFrameAvailableNotification() {
+  if (!NeedsFrameAvailableNotification()) {
+    return false;
+  }
+  frame_available_pending_.store(true);
+
+  const int64_t publish_time_ns = last_publish_time_ns_.load();
+  if (publish_time_ns > 0 && FlutterWebviewRenderStats::IsEnabled()) {
+    render_stats_.RecordNotifyLatency(FlutterWebviewRenderStats::NowNs() -
+                                      publish_time_ns);
+  }
+  return true;
+}
+
+bool FlutterWebviewPixelBuffer::NeedsFrameAvailableNotification() const {
+  return !frame_available_pending_.load() && HasUnpresentedFrame();
+}
@@ -0,0 +1,149 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_PIXEL_BUFFER_H_
+#define LINUX_FLUTTER_WEBVIEW_PIXEL_BUFFER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_render_stats.h"
+
+// The CPU image of a webview, for the FlPixelBufferTexture backend that works
+// without a GL context. Written by the browser on the CEF UI thread and read
+// by Flutter on the raster thread, which uploads it to a texture itself.
+//
+// The image is double-buffered: the browser writes one image while Flutter
+// reads the other. As in FlutterWebviewTextureRing, a published image that
+// Flutter has not taken yet is written again rather than waiting for Flutter,
+// and an image being reused first gets the rows it missed copied from the
+// latest one, so only the damaged rows of the browser's buffer are converted.
+//
+// The images are RGBA, the format FlPixelBufferTexture expects, while CEF
+// paints BGRA; the conversion is done while copying.
+class FlutterWebviewPixelBuffer {
+ public:
+  static constexpr int kNumSlots = 2;
+
+  FlutterWebviewPixelBuffer();
+
+  // Writer side. Must be called on the CEF UI thread.
+
+  // Returns whether a frame has been published.
+  bool HasFrame() const;
+
+  // Starts drawing a |width| x |height| frame on the image Flutter is not
+  // reading. Returns true if the image already holds the latest frame, or
+  // false if the size has changed, in which case the whole frame must be
+  // drawn. Must be followed by EndWrite.
+  bool BeginWrite(int width, int height);
+
+  // Copies |rect| of |bgra|, a BGRA image |source_width| pixels wide, to (|x|,
+  // |y|) of the image being written, clipped to its bounds.
+  void CopyFromBGRA(const void* bgra,
+                    int source_width,
+                    const WebviewRect& rect,
+                    int x,
+                    int y);
+
+  // Publishes the frame drawn since BeginWrite. |damage| is the region that
+  // differs from the previous frame.
+  void EndWrite(const std::vector<WebviewRect>& damage);
+
+  // Returns the size of the latest published frame, or 0 x 0 if no frame has
+  // been published.
+  void GetLatestFrameSize(int* width, int* height) const;
+
+  // Copies the latest published frame to |bgra| as BGRA, of the size returned
+  // by GetLatestFrameSize. Returns false if no frame has been published.
+  bool ReadLatestFrame(std::vector<uint8_t>* bgra) const;
+
+  // Reader side. Must be called on the raster thread.
+
+  // Returns the newest published image in |pixels|, which stays valid until
+  // the next call. Returns a single transparent pixel until the first frame is
+  // published.
+  void AcquireLatestFrame(const uint8_t** pixels,
+                          uint32_t* width,
+                          uint32_t* height);
+
+  // Returns whether a frame newer than the one last taken by
+  // AcquireLatestFrame has been published. May be called on any thread.
+  bool HasUnpresentedFrame() const;
+
+  // Platform thread side. See FlutterWebviewTextureRing.
+
+  bool TakeFrameAvailableNotification();
+  bool NeedsFrameAvailableNotification() const;
+
+  FlutterWebviewRenderStats& render_stats() { return render_stats_; }
+
+ private:
+  enum class SlotState {
+    kFree,
+    kWriting,
+    kPublished,
+    kPresented,
+  };
+
+  struct Slot {
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+    SlotState state = SlotState::kFree;
+    uint64_t sequence = 0;
+    int64_t publish_time_ns = 0;
+    // Accessed only by the writer.
+    std::vector<WebviewRect> stale_rects;
+  };
+
+  // Copies the stale rows of |slot| from the latest frame.
+  void CatchUp(Slot* slot);
+
+  mutable std::mutex mutex_;
+  std::array<Slot, kNumSlots> slots_;
+  uint64_t last_sequence_;
+  int presented_slot_;
+
+  std::atomic<uint64_t> published_sequence_;
+  std::atomic<uint64_t> presented_sequence_;
+  std::atomic<bool> frame_available_pending_;
+  std::atomic<int64_t> last_publish_time_ns_;
+
+  FlutterWebviewRenderStats render_stats_;
+
+  // Accessed only by the writer.
+  int writing_slot_;
+  int latest_slot_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_PIXEL_BUFFER_H_
@@ -0,0 +1,188 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_pixel_conversion.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define FLUTTER_WEBVIEW_HAS_AVX2_KERNELS
+#endif
+
+namespace flutter_webview_pixels {
+
+namespace {
+
+// Swaps the red and blue channels of a little-endian BGRA pixel.
+inline uint32_t SwapRedAndBlue(uint32_t pixel) {
+  return (pixel & 0xff00ff00u) | ((pixel >> 16) & 0xffu) |
+         ((pixel & 0xffu) << 16);
+}
+
+#if defined(FLUTTER_WEBVIEW_HAS_AVX2_KERNELS)
+// Compares 32 pixels at a time, only testing for a difference once per four
+// registers. Returns the number of pixels found equal, or SIZE_MAX on the
+// first difference.
+__attribute__((target("avx2"))) size_t PixelsEqualAVX2(const uint8_t* a,
+                                                       const uint8_t* b,
+                                                       size_t num_pixels) {
+  size_t i = 0;
+  for (; i + 32 <= num_pixels; i += 32) {
+    __m256i diff = _mm256_setzero_si256();
+    for (int j = 0; j < 4; ++j) {
+      const size_t offset = (i + j * 8) * 4;
+      diff = _mm256_or_si256(
+          diff, _mm256_xor_si256(
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(a + offset)),
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(b + offset))));
+    }
+    if (!_mm256_testz_si256(diff, diff)) {
+      return SIZE_MAX;
+    }
+  }
+  return i;
+}
+#endif  // defined(FLUTTER_WEBVIEW_HAS_AVX2_KERNELS)
+
+// PixelsEqual() with the AVX2 kernel only if |use_avx2|.
+bool PixelsEqualWithKernels(const uint8_t* a,
+                            const uint8_t* b,
+                            size_t num_pixels,
+                            bool use_avx2) {
+  size_t i = 0;
+#if defined(FLUTTER_WEBVIEW_HAS_AVX2_KERNELS)
+  if (use_avx2) {
+    i = PixelsEqualAVX2(a, b, num_pixels);
+    if (i == SIZE_MAX) {
+      return false;
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  // Sixteen pixels at a time, testing for a difference once per four
+  // registers.
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= num_pixels; i += 16) {
+    __m128i diff = zero;
+    for (int j = 0; j < 4; ++j) {
+      const size_t offset = (i + j * 4) * 4;
+      diff = _mm_or_si128(
+          diff,
+          _mm_xor_si128(
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + offset)),
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + offset))));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, zero)) != 0xffff) {
+      return false;
+    }
+  }
+#elif defined(__ARM_NEON)
+  // Sixteen pixels at a time, as with SSE2.
+  for (; i + 16 <= num_pixels; i += 16) {
+    uint8x16_t diff = vdupq_n_u8(0);
+    for (int j = 0; j < 4; ++j) {
+      const size_t offset = (i + j * 4) * 4;
+      diff = vorrq_u8(diff, veorq_u8(vld1q_u8(a + offset),
+                                     vld1q_u8(b + offset)));
+    }
+    const uint64x2_t diff64 = vreinterpretq_u64_u8(diff);
+    if ((vgetq_lane_u64(diff64, 0) | vgetq_lane_u64(diff64, 1)) != 0) {
+      return false;
+    }
+  }
+#endif
+  return std::memcmp(a + i * 4, b + i * 4, (num_pixels - i) * 4) == 0;
+}
+
+}  // namespace
+
+void ConvertBGRAToRGBA(const uint8_t* bgra, uint8_t* rgba, size_t num_pixels) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  // Four pixels at a time, with the same masks and shifts as SwapRedAndBlue().
+  const __m128i green_and_alpha = _mm_set1_epi32(0xff00ff00);
+  const __m128i blue = _mm_set1_epi32(0x000000ff);
+  for (; i + 4 <= num_pixels; i += 4) {
+    const __m128i pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(bgra + i * 4));
+    const __m128i swapped = _mm_or_si128(
+        _mm_and_si128(pixels, green_and_alpha),
+        _mm_or_si128(_mm_and_si128(_mm_srli_epi32(pixels, 16), blue),
+                     _mm_slli_epi32(_mm_and_si128(pixels, blue), 16)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), swapped);
+  }
+#elif defined(__ARM_NEON)
+  // Sixteen pixels at a time, deinterleaved into one register per channel.
+  for (; i + 16 <= num_pixels; i += 16) {
+    uint8x16x4_t pixels = vld4q_u8(bgra + i * 4);
+    const uint8x16_t blue = pixels.val[0];
+    pixels.val[0] = pixels.val[2];
+    pixels.val[2] = blue;
+    vst4q_u8(rgba + i * 4, pixels);
+  }
+#endif
+  for (; i < num_pixels; ++i) {
+    uint32_t pixel;
+    std::memcpy(&pixel, bgra + i * 4, sizeof(pixel));
+    pixel = SwapRedAndBlue(pixel);
+    std::memcpy(rgba + i * 4, &pixel, sizeof(pixel));
+  }
+}
+
+bool PixelsEqual(const uint8_t* a, const uint8_t* b, size_t num_pixels) {
+  return PixelsEqualWithKernels(a, b, num_pixels, UsesAVX2());
+}
+
+bool UsesAVX2() {
+#if defined(FLUTTER_WEBVIEW_HAS_AVX2_KERNELS)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+#else
+  return false;
+#endif
+}
+
+bool PixelsEqualForTesting(const uint8_t* a,
+                           const uint8_t* b,
+                           size_t num_pixels,
+                           bool use_avx2) {
+  return PixelsEqualWithKernels(a, b, num_pixels, use_avx2 && UsesAVX2());
+}
+
+}  // namespace flutter_webview_pixels
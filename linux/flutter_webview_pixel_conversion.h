@@ -0,0 +1,60 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_PIXEL_CONVERSION_H_
+#define LINUX_FLUTTER_WEBVIEW_PIXEL_CONVERSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace flutter_webview_pixels {
+
+// Converts |num_pixels| 32-bit pixels from BGRA to RGBA, i.e. swaps the first
+// and third bytes of each pixel, from |bgra| to |rgba|. The buffers must not
+// overlap. Uses SSE2 or NEON where the target has it.
+void ConvertBGRAToRGBA(const uint8_t* bgra, uint8_t* rgba, size_t num_pixels);
+
+// Returns whether the |num_pixels| 32-bit pixels at |a| and |b| are all
+// equal. Uses AVX2 where the CPU supports it, detected at run time, and SSE2 or
+// NEON otherwise where the target has it.
+bool PixelsEqual(const uint8_t* a, const uint8_t* b, size_t num_pixels);
+
+// Returns whether PixelsEqual() uses AVX2 on this CPU.
+bool UsesAVX2();
+
+// PixelsEqual() without AVX2 unless |use_avx2|, so that the tests can check
+// both kernels on a CPU that has AVX2. |use_avx2| is ignored unless
+// UsesAVX2().
+bool PixelsEqualForTesting(const uint8_t* a,
+                           const uint8_t* b,
+                           size_t num_pixels,
+                           bool use_avx2);
+
+}  // namespace flutter_webview_pixels
+
+#endif  // LINUX_FLUTTER_WEBVIEW_PIXEL_CONVERSION_H_
@@ -0,0 +1,291 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_recorder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_recording_format.h"
+
+namespace {
+
+using flutter_webview_recording::kBytesPerPixel;
+
+// The queue holds at most this many paints, or this many bytes unless it
+// holds a single paint. Enough to absorb a burst of full-view paints while the
+// disk is busy.
+constexpr size_t kMaxQueuedFrames = 8;
+constexpr size_t kMaxQueuedBytes = 64 * 1024 * 1024;
+
+// Above this number, the damage accumulated over dropped paints is replaced
+// with its bounding box.
+constexpr size_t kMaxDamageRects = 16;
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+WebviewRect BoundingBoxOf(const std::vector<WebviewRect>& rects) {
+  int left = rects[0].x;
+  int top = rects[0].y;
+  int right = rects[0].x + rects[0].width;
+  int bottom = rects[0].y + rects[0].height;
+  for (const WebviewRect& rect : rects) {
+    left = std::min(left, rect.x);
+    top = std::min(top, rect.y);
+    right = std::max(right, rect.x + rect.width);
+    bottom = std::max(bottom, rect.y + rect.height);
+  }
+  return WebviewRect{left, top, right - left, bottom - top};
+}
+
+size_t SizeOf(const std::vector<WebviewRect>& rects) {
+  size_t size = 0;
+  for (const WebviewRect& rect : rects) {
+    size += static_cast<size_t>(rect.width) * rect.height * kBytesPerPixel;
+  }
+  return size;
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<FlutterWebviewRecorder> FlutterWebviewRecorder::Start(
+    const std::string& path,
+    std::string* error) {
+  FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    *error = "Failed to create " + path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+  flutter_webview_recording::FileHeader header = {};
+  std::memcpy(header.magic, flutter_webview_recording::kFileMagic,
+              sizeof(header.magic));
+  header.version = flutter_webview_recording::kVersion;
+  if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+    *error = "Failed to write " + path + ": " + std::strerror(errno);
+    std::fclose(file);
+    return nullptr;
+  }
+
+  std::shared_ptr<Shared> shared = std::make_shared<Shared>();
+  shared->file = file;
+  shared->stats.bytes = sizeof(header);
+  // Detached so that stopping never waits for the disk on the CEF UI thread.
+  // The thread exits once it has written the queue after Stop.
+  std::thread(&FlutterWebviewRecorder::WriterMain, shared).detach();
+  return std::unique_ptr<FlutterWebviewRecorder>(
+      new FlutterWebviewRecorder(std::move(shared)));
+}
+
+FlutterWebviewRecorder::FlutterWebviewRecorder(std::shared_ptr<Shared> shared)
+    : shared_(std::move(shared)),
+      stopped_(false),
+      start_ns_(NowNs()),
+      width_(0),
+      height_(0),
+      dropped_frames_(0) {}
+
+FlutterWebviewRecorder::~FlutterWebviewRecorder() {
+  Stop(nullptr);
+}
+
+void FlutterWebviewRecorder::AddFrame(
+    const void* buffer,
+    int width,
+    int height,
+    const std::vector<WebviewRect>& dirty_rects) {
+  if (stopped_) {
+    return;
+  }
+  const int64_t timestamp_us = (NowNs() - start_ns_) / 1000;
+
+  if (width != width_ || height != height_) {
+    width_ = width;
+    height_ = height;
+    pending_damage_.assign(1, WebviewRect{0, 0, width, height});
+  } else {
+    pending_damage_.insert(pending_damage_.end(), dirty_rects.begin(),
+                           dirty_rects.end());
+    if (pending_damage_.size() > kMaxDamageRects) {
+      pending_damage_.assign(1, BoundingBoxOf(pending_damage_));
+    }
+  }
+
+  // Only the writer thread takes paints out of the queue, so there is still
+  // room after the copy below if there is now.
+  const size_t size = SizeOf(pending_damage_);
+  {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    if (!shared_->queue.empty() &&
+        (shared_->queue.size() >= kMaxQueuedFrames ||
+         shared_->queued_bytes + size > kMaxQueuedBytes)) {
+      ++dropped_frames_;
+      ++shared_->stats.dropped_frames;
+      return;
+    }
+  }
+
+  // CEF's buffer holds the whole view, so the damage of the dropped paints is
+  // copied from it too.
+  std::unique_ptr<Frame> frame(new Frame);
+  frame->timestamp_us = timestamp_us;
+  frame->width = width;
+  frame->height = height;
+  frame->dropped_frames = dropped_frames_;
+  frame->rects.swap(pending_damage_);
+  frame->pixels.resize(size);
+  const size_t stride = static_cast<size_t>(width) * kBytesPerPixel;
+  const uint8_t* src = static_cast<const uint8_t*>(buffer);
+  uint8_t* dst = frame->pixels.data();
+  for (const WebviewRect& rect : frame->rects) {
+    const size_t row_size = static_cast<size_t>(rect.width) * kBytesPerPixel;
+    const uint8_t* row = src + rect.y * stride + rect.x * kBytesPerPixel;
+    for (int y = 0; y < rect.height; ++y) {
+      std::memcpy(dst, row, row_size);
+      dst += row_size;
+      row += stride;
+    }
+  }
+  pending_damage_.clear();
+  dropped_frames_ = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    shared_->queued_bytes += size;
+    shared_->queue.push_back(std::move(frame));
+  }
+  shared_->cond.notify_one();
+}
+
+void FlutterWebviewRecorder::Stop(const StoppedCallback& on_stopped) {
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
+  {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    shared_->stopping = true;
+    shared_->on_stopped = on_stopped;
+  }
+  shared_->cond.notify_one();
+}
+
+// static
+void FlutterWebviewRecorder::WriterMain(std::shared_ptr<Shared> shared) {
+  for (;;) {
+    std::unique_ptr<Frame> frame;
+    {
+      std::unique_lock<std::mutex> lock(shared->mutex);
+      shared->cond.wait(lock, [&shared]() {
+        return !shared->queue.empty() || shared->stopping;
+      });
+      if (shared->queue.empty()) {
+        break;
+      }
+      frame = std::move(shared->queue.front());
+      shared->queue.pop_front();
+      shared->queued_bytes -= frame->pixels.size();
+    }
+
+    // After a failure, the queue is only drained.
+    if (shared->failed) {
+      continue;
+    }
+    int64_t bytes = 0;
+    if (!WriteFrame(shared->file, *frame, &bytes)) {
+      std::cerr << "Error: Failed to write the recording: "
+                << std::strerror(errno) << std::endl;
+      shared->failed = true;
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    ++shared->stats.frames;
+    shared->stats.bytes += bytes;
+  }
+
+  if (std::fclose(shared->file) != 0) {
+    shared->failed = true;
+  }
+  shared->file = nullptr;
+
+  Stats stats;
+  StoppedCallback on_stopped;
+  {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    stats = shared->stats;
+    on_stopped = std::move(shared->on_stopped);
+  }
+  if (on_stopped) {
+    on_stopped(!shared->failed, stats);
+  }
+}
+
+// static
+bool FlutterWebviewRecorder::WriteFrame(FILE* file,
+                                        const Frame& frame,
+                                        int64_t* bytes) {
+  flutter_webview_recording::FrameHeader header = {};
+  header.magic = flutter_webview_recording::kFrameMagic;
+  header.rect_count = static_cast<uint32_t>(frame.rects.size());
+  header.timestamp_us = frame.timestamp_us;
+  header.width = frame.width;
+  header.height = frame.height;
+  header.dropped_frames = frame.dropped_frames;
+  if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+    return false;
+  }
+  *bytes += sizeof(header);
+
+  const uint8_t* pixels = frame.pixels.data();
+  for (const WebviewRect& rect : frame.rects) {
+    const flutter_webview_recording::RectHeader rect_header = {
+        rect.x, rect.y, rect.width, rect.height};
+    const size_t size =
+        static_cast<size_t>(rect.width) * rect.height * kBytesPerPixel;
+    if (std::fwrite(&rect_header, sizeof(rect_header), 1, file) != 1 ||
+        (size > 0 && std::fwrite(pixels, size, 1, file) != 1)) {
+      return false;
+    }
+    pixels += size;
+    *bytes += sizeof(rect_header) + size;
+  }
+  return true;
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_RECORDER_H_
+#define LINUX_FLUTTER_WEBVIEW_RECORDER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+// Records the view paints of a webview to a file in the format of
+// flutter_webview_recording_format.h, for QA recordings of kiosk sessions
+// without grabbing the screen.
+//
+// AddFrame copies only the dirty rectangles of a paint on the CEF UI thread
+// and queues them for a writer thread, which writes them to the file. The
+// queue is bounded: a paint that does not fit is dropped instead of blocking
+// the CEF UI thread, and its damage is copied with the next queued paint, so
+// the recording stays correct at a lower frame rate.
+class FlutterWebviewRecorder {
+ public:
+  struct Stats {
+    int64_t frames = 0;
+    int64_t dropped_frames = 0;
+    int64_t bytes = 0;
+  };
+
+  // Called on the writer thread once the file is closed. |succeeded| is false
+  // if writing the file failed.
+  using StoppedCallback =
+      std::function<void(bool succeeded, const Stats& stats)>;
+
+  // Creates the file at |path| and starts the writer thread. Returns nullptr
+  // with a message in |error| if the file could not be created.
+  static std::unique_ptr<FlutterWebviewRecorder> Start(const std::string& path,
+                                                       std::string* error);
+
+  // Stops the recording without waiting for the writer thread, as Stop does.
+  ~FlutterWebviewRecorder();
+
+  // Queues a paint of a |width| x |height| view in |buffer|. Must be called on
+  // the CEF UI thread.
+  void AddFrame(const void* buffer,
+                int width,
+                int height,
+                const std::vector<WebviewRect>& dirty_rects);
+
+  // Stops queuing paints. The writer thread writes the queued ones, closes
+  // the file, calls |on_stopped| and exits. Calling it again does nothing.
+  void Stop(const StoppedCallback& on_stopped);
+
+ private:
+  struct Frame {
+    int64_t timestamp_us;
+    int width;
+    int height;
+    int dropped_frames;
+    std::vector<WebviewRect> rects;
+    // The pixels of |rects|, one after another.
+    std::vector<uint8_t> pixels;
+  };
+
+  // Shared with the writer thread, which outlives the recorder until it has
+  // written the queue.
+  struct Shared {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::unique_ptr<Frame>> queue;
+    size_t queued_bytes = 0;
+    bool stopping = false;
+    StoppedCallback on_stopped;
+    Stats stats;
+    // Accessed only by the writer thread.
+    FILE* file = nullptr;
+    bool failed = false;
+  };
+
+  explicit FlutterWebviewRecorder(std::shared_ptr<Shared> shared);
+
+  static void WriterMain(std::shared_ptr<Shared> shared);
+  static bool WriteFrame(FILE* file, const Frame& frame, int64_t* bytes);
+
+  std::shared_ptr<Shared> shared_;
+  bool stopped_;
+  int64_t start_ns_;
+  int width_;
+  int height_;
+  // The damage of the paints dropped since the last queued one.
+  std::vector<WebviewRect> pending_damage_;
+  int dropped_frames_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_RECORDER_H_
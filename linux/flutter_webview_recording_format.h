@@ -0,0 +1,88 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_RECORDING_FORMAT_H_
+#define LINUX_FLUTTER_WEBVIEW_RECORDING_FORMAT_H_
+
+#include <cstdint>
+
+// The file format written by FlutterWebviewRecorder and read by the offline
+// converter in linux/recorder/. A recording stores only the damage of each
+// paint of the view:
+//
+//   FileHeader
+//   for each frame:
+//     FrameHeader
+//     for each of the |rect_count| rectangles:
+//       RectHeader
+//       |width| * |height| BGRA pixels, top row first, without padding
+//
+// A frame updates the rectangles of the previous one; the first frame and the
+// frames whose size differs cover the whole view. All the fields are in the
+// byte order of the recording machine, which is little-endian on the
+// platforms the plugin supports.
+namespace flutter_webview_recording {
+
+constexpr char kFileMagic[8] = {'F', 'W', 'V', 'R', 'E', 'C', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+// "FRAM" in little-endian, to detect a truncated or corrupted file.
+constexpr uint32_t kFrameMagic = 0x4d415246;
+constexpr int kBytesPerPixel = 4;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+struct FrameHeader {
+  uint32_t magic;
+  uint32_t rect_count;
+  // The time of the paint since the recording started.
+  int64_t timestamp_us;
+  int32_t width;
+  int32_t height;
+  // The paints dropped just before this frame, whose damage it includes.
+  int32_t dropped_frames;
+  uint32_t reserved;
+};
+
+struct RectHeader {
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+};
+
+static_assert(sizeof(FileHeader) == 16, "FileHeader must not be padded");
+static_assert(sizeof(FrameHeader) == 32, "FrameHeader must not be padded");
+static_assert(sizeof(RectHeader) == 16, "RectHeader must not be padded");
+
+}  // namespace flutter_webview_recording
+
+#endif  // LINUX_FLUTTER_WEBVIEW_RECORDING_FORMAT_H_
@@ -0,0 +1,142 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_rect_coalescer.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+namespace {
+
+constexpr double kBytesPerPixel = 4;
+
+// Used until the cost model is calibrated: about 10 us of driver overhead per
+// call and 4 GB/s of copy bandwidth.
+constexpr UploadCostModel kDefaultCostModel = {10000.0, 0.25};
+
+bool IsEmpty(const WebviewRect& rect) {
+  return rect.width <= 0 || rect.height <= 0;
+}
+
+double AreaOf(const WebviewRect& rect) {
+  return static_cast<double>(rect.width) * rect.height;
+}
+
+WebviewRect UnionOf(const WebviewRect& a, const WebviewRect& b) {
+  const int left = std::min(a.x, b.x);
+  const int top = std::min(a.y, b.y);
+  const int right = std::max(a.x + a.width, b.x + b.width);
+  const int bottom = std::max(a.y + a.height, b.y + b.height);
+  return WebviewRect{left, top, right - left, bottom - top};
+}
+
+}  // namespace
+
+constexpr size_t FlutterWebviewRectCoalescer::kMaxRectsToMerge;
+
+FlutterWebviewRectCoalescer::FlutterWebviewRectCoalescer()
+    : cost_model_(kDefaultCostModel) {}
+
+void FlutterWebviewRectCoalescer::SetCostModel(
+    const UploadCostModel& cost_model) {
+  cost_model_ = cost_model;
+}
+
+std::vector<WebviewRect> FlutterWebviewRectCoalescer::Coalesce(
+    const std::vector<WebviewRect>& rects) {
+  std::vector<WebviewRect> result;
+  result.reserve(rects.size());
+  for (const WebviewRect& rect : rects) {
+    if (!IsEmpty(rect)) {
+      result.push_back(rect);
+    }
+  }
+  if (result.empty()) {
+    return result;
+  }
+
+  const size_t num_input_rects = result.size();
+
+  // Merging a and b into u saves one call and costs the bytes of u that are
+  // not in a or b, counting the overlap of a and b as saved since it would
+  // otherwise be uploaded twice. Repeat until no pair is worth merging, since
+  // a grown rectangle may become worth merging with the ones already checked.
+  const double max_extra_area =
+      cost_model_.per_call_ns / (cost_model_.per_byte_ns * kBytesPerPixel);
+  bool merged = result.size() <= kMaxRectsToMerge;
+  while (merged) {
+    merged = false;
+    for (size_t i = 0; i < result.size(); ++i) {
+      for (size_t j = i + 1; j < result.size();) {
+        const WebviewRect united = UnionOf(result[i], result[j]);
+        if (AreaOf(united) - AreaOf(result[i]) - AreaOf(result[j]) <
+            max_extra_area) {
+          result[i] = united;
+          result[j] = result.back();
+          result.pop_back();
+          merged = true;
+        } else {
+          ++j;
+        }
+      }
+    }
+  }
+
+  if (result.size() > 1) {
+    WebviewRect bounding_box = result[0];
+    for (const WebviewRect& rect : result) {
+      bounding_box = UnionOf(bounding_box, rect);
+    }
+    if (CostOf(bounding_box) < CostOf(result)) {
+      result.assign(1, bounding_box);
+      ++counters_.bounding_box_frames;
+    }
+  }
+
+  ++counters_.frames;
+  counters_.input_rects += num_input_rects;
+  counters_.output_rects += result.size();
+  counters_.merged_rects += num_input_rects - result.size();
+  return result;
+}
+
+double FlutterWebviewRectCoalescer::CostOf(
+    const std::vector<WebviewRect>& rects) const {
+  double cost = 0;
+  for (const WebviewRect& rect : rects) {
+    cost += CostOf(rect);
+  }
+  return cost;
+}
+
+double FlutterWebviewRectCoalescer::CostOf(const WebviewRect& rect) const {
+  return cost_model_.per_call_ns +
+         AreaOf(rect) * kBytesPerPixel * cost_model_.per_byte_ns;
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_RECT_COALESCER_H_
+#define LINUX_FLUTTER_WEBVIEW_RECT_COALESCER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+// The estimated cost of a texture update: a call that uploads N bytes costs
+// |per_call_ns| + N * |per_byte_ns| nanoseconds.
+struct UploadCostModel {
+  double per_call_ns;
+  double per_byte_ns;
+};
+
+// Reduces the dirty rectangles of a frame to the set that is cheapest to
+// upload under an UploadCostModel.
+//
+// Two rectangles are merged into their bounding box when the bytes the box
+// adds cost less than the texture update it saves, which also removes the
+// pixels uploaded twice where the rectangles overlap. If uploading the single
+// bounding box of the whole frame is cheaper still, that is used instead.
+class FlutterWebviewRectCoalescer {
+ public:
+  // Statistics accumulated over the calls to Coalesce.
+  struct Counters {
+    // The number of calls with at least one non-empty rectangle.
+    int64_t frames = 0;
+    // The number of non-empty rectangles passed in.
+    int64_t input_rects = 0;
+    // The number of rectangles returned.
+    int64_t output_rects = 0;
+    // input_rects - output_rects.
+    int64_t merged_rects = 0;
+    // The number of frames reduced to their single bounding box.
+    int64_t bounding_box_frames = 0;
+  };
+
+  // Above this number of rectangles the pairwise merging, which is cubic in
+  // the worst case, is skipped and only the bounding box is considered.
+  static constexpr size_t kMaxRectsToMerge = 64;
+
+  FlutterWebviewRectCoalescer();
+
+  void SetCostModel(const UploadCostModel& cost_model);
+  const UploadCostModel& cost_model() const { return cost_model_; }
+
+  // Returns the rectangles to upload instead of |rects|. The result covers
+  // every pixel of |rects| and contains no empty rectangles.
+  std::vector<WebviewRect> Coalesce(const std::vector<WebviewRect>& rects);
+
+  const Counters& counters() const { return counters_; }
+
+ private:
+  // The estimated cost of uploading |rects| one by one.
+  double CostOf(const std::vector<WebviewRect>& rects) const;
+  double CostOf(const WebviewRect& rect) const;
+
+  UploadCostModel cost_model_;
+  Counters counters_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_RECT_COALESCER_H_
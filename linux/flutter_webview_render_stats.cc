@@ -0,0 +1,322 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_render_stats.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+
+#include "flutter_webview_gl_utils.h"
+
+namespace {
+
+constexpr int64_t kNsPerUs = 1000;
+
+std::map<std::string, int64_t> SummarizeInMicroseconds(
+    const FlutterWebviewHistogram& histogram) {
+  std::map<std::string, int64_t> summary = histogram.Summarize();
+  for (auto& entry : summary) {
+    if (entry.first != "count") {
+      entry.second /= kNsPerUs;
+    }
+  }
+  return summary;
+}
+
+}  // namespace
+
+constexpr int FlutterWebviewHistogram::kSubBucketBits;
+constexpr int FlutterWebviewHistogram::kSubBuckets;
+constexpr int FlutterWebviewHistogram::kNumBuckets;
+
+FlutterWebviewHistogram::FlutterWebviewHistogram() {
+  Reset();
+}
+
+void FlutterWebviewHistogram::Record(int64_t value) {
+  value = std::max<int64_t>(value, 0);
+  ++buckets_[BucketOf(value)];
+  min_ = count_ == 0 ? value : std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+  ++count_;
+}
+
+void FlutterWebviewHistogram::Reset() {
+  buckets_.fill(0);
+  count_ = 0;
+  min_ = 0;
+  max_ = 0;
+  sum_ = 0;
+}
+
+std::map<std::string, int64_t> FlutterWebviewHistogram::Summarize() const {
+  return {
+      {"count", count_},
+      {"min", min_},
+      {"max", max_},
+      {"mean", count_ == 0 ? 0 : std::llround(sum_ / count_)},
+      {"p50", ValueAtPercentile(50)},
+      {"p90", ValueAtPercentile(90)},
+      {"p99", ValueAtPercentile(99)},
+      {"p999", ValueAtPercentile(99.9)},
+  };
+}
+
+// static
+int FlutterWebviewHistogram::BucketOf(int64_t value) {
+  if (value < 2 * kSubBuckets) {
+    return static_cast<int>(value);
+  }
+  const int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+  const int sub_bucket =
+      static_cast<int>(value >> (exponent - kSubBucketBits)) &
+      (kSubBuckets - 1);
+  return 2 * kSubBuckets + (exponent - kSubBucketBits - 1) * kSubBuckets +
+         sub_bucket;
+}
+
+// static
+int64_t FlutterWebviewHistogram::ValueOf(int bucket) {
+  if (bucket < 2 * kSubBuckets) {
+    return bucket;
+  }
+  const int exponent =
+      (bucket - 2 * kSubBuckets) / kSubBuckets + kSubBucketBits + 1;
+  const int sub_bucket = (bucket - 2 * kSubBuckets) % kSubBuckets;
+  const int shift = exponent - kSubBucketBits;
+  const int64_t lower = static_cast<int64_t>(kSubBuckets + sub_bucket)
+                        << shift;
+  return lower + ((int64_t{1} << shift) >> 1);
+}
+
+int64_t FlutterWebviewHistogram::ValueAtPercentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  const int64_t rank = std::max<int64_t>(
+      1, static_cast<int64_t>(std::ceil(count_ * percentile / 100)));
+  int64_t seen = 0;
+  for (int bucket = 0; bucket < kNumBuckets; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      // The middle of the bucket may lie outside the recorded values.
+      return std::min(std::max(ValueOf(bucket), min_), max_);
+    }
+  }
+  return max_;
+}
+
+std::atomic<bool> FlutterWebviewRenderStats::enabled_(false);
+
+FlutterWebviewRenderStats::FlutterWebviewRenderStats()
+    : published_frames_(0),
+      presented_frames_(0),
+      superseded_frames_(0),
+      skipped_paints_(0),
+      deferred_paints_(0) {}
+
+// static
+int64_t FlutterWebviewRenderStats::NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void FlutterWebviewRenderStats::RecordPaint(int64_t duration_ns,
+                                            int64_t interval_ns,
+                                            int64_t uploaded_bytes,
+                                            int dirty_rects,
+                                            int uploaded_rects) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  paint_duration_.Record(duration_ns);
+  if (interval_ns >= 0) {
+    paint_interval_.Record(interval_ns);
+  }
+  uploaded_bytes_.Record(uploaded_bytes);
+  dirty_rects_.Record(dirty_rects);
+  uploaded_rects_.Record(uploaded_rects);
+}
+
+void FlutterWebviewRenderStats::RecordSkippedPaint() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++skipped_paints_;
+}
+
+void FlutterWebviewRenderStats::RecordDeferredPaint() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++deferred_paints_;
+}
+
+void FlutterWebviewRenderStats::RecordGpuUploadTime(int64_t ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  gpu_upload_time_.Record(ns);
+}
+
+void FlutterWebviewRenderStats::RecordPublishedFrame() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++published_frames_;
+}
+
+void FlutterWebviewRenderStats::RecordSupersededFrames(int count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  superseded_frames_ += count;
+}
+
+void FlutterWebviewRenderStats::RecordNotifyLatency(int64_t ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  notify_latency_.Record(ns);
+}
+
+void FlutterWebviewRenderStats::RecordPresentLatency(int64_t ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++presented_frames_;
+  present_latency_.Record(ns);
+}
+
+void FlutterWebviewRenderStats::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  paint_duration_.Reset();
+  paint_interval_.Reset();
+  uploaded_bytes_.Reset();
+  dirty_rects_.Reset();
+  uploaded_rects_.Reset();
+  gpu_upload_time_.Reset();
+  notify_latency_.Reset();
+  present_latency_.Reset();
+  published_frames_ = 0;
+  presented_frames_ = 0;
+  superseded_frames_ = 0;
+  skipped_paints_ = 0;
+  deferred_paints_ = 0;
+}
+
+WebviewRenderStats FlutterWebviewRenderStats::Snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return {
+      {"paintDurationUs", SummarizeInMicroseconds(paint_duration_)},
+      {"paintIntervalUs", SummarizeInMicroseconds(paint_interval_)},
+      {"uploadedBytes", uploaded_bytes_.Summarize()},
+      {"dirtyRects", dirty_rects_.Summarize()},
+      {"uploadedRects", uploaded_rects_.Summarize()},
+      {"gpuUploadUs", SummarizeInMicroseconds(gpu_upload_time_)},
+      {"notifyLatencyUs", SummarizeInMicroseconds(notify_latency_)},
+      {"presentLatencyUs", SummarizeInMicroseconds(present_latency_)},
+      {"frames",
+       {
+           {"published", published_frames_},
+           {"presented", presented_frames_},
+           {"superseded", superseded_frames_},
+           {"skippedPaints", skipped_paints_},
+           {"deferredPaints", deferred_paints_},
+       }},
+  };
+}
+
+constexpr int FlutterWebviewGpuTimer::kNumQueries;
+
+FlutterWebviewGpuTimer::FlutterWebviewGpuTimer()
+    : next_query_(0), running_query_(-1) {}
+
+FlutterWebviewGpuTimer::~FlutterWebviewGpuTimer() {
+  for (const Query& query : queries_) {
+    if (query.name != 0) {
+      std::cerr << "Warning: FlutterWebviewGpuTimer is destroyed without "
+                   "releasing its queries. They are leaked."
+                << std::endl;
+      break;
+    }
+  }
+}
+
+void FlutterWebviewGpuTimer::Begin() {
+  if (running_query_ >= 0 ||
+      !flutter_webview_gl::GetCapabilities().has_timer_query) {
+    return;
+  }
+  Query& query = queries_[next_query_];
+  if (query.pending) {
+    return;
+  }
+  if (query.name == 0) {
+    glGenQueries(1, &query.name);
+  }
+  glBeginQuery(GL_TIME_ELAPSED, query.name);
+  VERIFY_GL_NO_ERROR;
+  running_query_ = next_query_;
+}
+
+void FlutterWebviewGpuTimer::End() {
+  if (running_query_ < 0) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED);
+  VERIFY_GL_NO_ERROR;
+  queries_[running_query_].pending = true;
+  next_query_ = (running_query_ + 1) % kNumQueries;
+  running_query_ = -1;
+}
+
+void FlutterWebviewGpuTimer::CollectResults(FlutterWebviewRenderStats* stats) {
+  for (Query& query : queries_) {
+    if (!query.pending) {
+      continue;
+    }
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(query.name, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE) {
+      continue;
+    }
+    GLuint64 elapsed_ns = 0;
+    glGetQueryObjectui64v(query.name, GL_QUERY_RESULT, &elapsed_ns);
+    VERIFY_GL_NO_ERROR;
+    stats->RecordGpuUploadTime(static_cast<int64_t>(elapsed_ns));
+    query.pending = false;
+  }
+}
+
+void FlutterWebviewGpuTimer::ReleaseQueries() {
+  if (running_query_ >= 0) {
+    glEndQuery(GL_TIME_ELAPSED);
+    running_query_ = -1;
+  }
+  for (Query& query : queries_) {
+    if (query.name != 0) {
+      glDeleteQueries(1, &query.name);
+      query = Query();
+    }
+  }
+  next_query_ = 0;
+}
@@ -0,0 +1,187 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_RENDER_STATS_H_
+#define LINUX_FLUTTER_WEBVIEW_RENDER_STATS_H_
+
+#include <GL/gl.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+// A histogram of non-negative values in the spirit of HdrHistogram.
+//
+// Values below 2 * kSubBuckets are counted exactly. Above that, each power of
+// two is split into kSubBuckets buckets of equal width, so a percentile is
+// within 1 / kSubBuckets of the true value while the histogram stays a few
+// kilobytes whatever the range of the values.
+class FlutterWebviewHistogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+
+  FlutterWebviewHistogram();
+
+  // Negative values are counted as 0.
+  void Record(int64_t value);
+  void Reset();
+
+  int64_t count() const { return count_; }
+
+  // Returns the count, min, max, mean, p50, p90, p99 and p999 of the values.
+  // All of them are 0 if nothing has been recorded.
+  std::map<std::string, int64_t> Summarize() const;
+
+ private:
+  static constexpr int kNumBuckets = 2 * kSubBuckets +
+                                     (63 - kSubBucketBits - 1) * kSubBuckets;
+
+  static int BucketOf(int64_t value);
+  // Returns the value at the middle of |bucket|.
+  static int64_t ValueOf(int bucket);
+
+  // Returns the smallest value that at least |percentile| % of the values do
+  // not exceed.
+  int64_t ValueAtPercentile(double percentile) const;
+
+  std::array<int64_t, kNumBuckets> buckets_;
+  int64_t count_;
+  int64_t min_;
+  int64_t max_;
+  double sum_;
+};
+
+// The frame pipeline statistics of a webview: how long the browser's paints
+// take, how much they upload, and how long their frames take to reach the
+// frame-available notification and Flutter.
+//
+// Recording is disabled by default and the callers check IsEnabled() before
+// measuring anything, so that a disabled pipeline costs one relaxed atomic
+// load per step. Thread-safe: the steps run on the CEF UI thread, the
+// platform thread and the raster thread.
+class FlutterWebviewRenderStats {
+ public:
+  FlutterWebviewRenderStats();
+
+  static void SetEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Returns the time of a monotonic clock in nanoseconds.
+  static int64_t NowNs();
+
+  // Records a paint of the view. |interval_ns| is the time since the previous
+  // paint, or negative for the first paint.
+  void RecordPaint(int64_t duration_ns,
+                   int64_t interval_ns,
+                   int64_t uploaded_bytes,
+                   int dirty_rects,
+                   int uploaded_rects);
+  // Records a paint skipped because the webview is hidden.
+  void RecordSkippedPaint();
+  // Records a paint held back because Flutter has not taken the previous
+  // frame.
+  void RecordDeferredPaint();
+  // Records the GPU time of the uploads of a paint.
+  void RecordGpuUploadTime(int64_t ns);
+
+  void RecordPublishedFrame();
+  // Records frames released before Flutter has taken them.
+  void RecordSupersededFrames(int count);
+  // Records the time from the publication of a frame to the notification of
+  // Flutter.
+  void RecordNotifyLatency(int64_t ns);
+  // Records the time from the publication of a frame to Flutter taking it.
+  void RecordPresentLatency(int64_t ns);
+
+  void Reset();
+
+  // Returns a summary of each histogram, in microseconds for the durations,
+  // and the counters under "frames".
+  WebviewRenderStats Snapshot() const;
+
+ private:
+  static std::atomic<bool> enabled_;
+
+  mutable std::mutex mutex_;
+  FlutterWebviewHistogram paint_duration_;
+  FlutterWebviewHistogram paint_interval_;
+  FlutterWebviewHistogram uploaded_bytes_;
+  FlutterWebviewHistogram dirty_rects_;
+  FlutterWebviewHistogram uploaded_rects_;
+  FlutterWebviewHistogram gpu_upload_time_;
+  FlutterWebviewHistogram notify_latency_;
+  FlutterWebviewHistogram present_latency_;
+  int64_t published_frames_;
+  int64_t presented_frames_;
+  int64_t superseded_frames_;
+  int64_t skipped_paints_;
+  int64_t deferred_paints_;
+};
+
+// Measures the GPU time of the commands between Begin and End with
+// GL_TIME_ELAPSED queries. The results are read back without stalling, a few
+// paints later, by CollectResults. Does nothing if timer queries are not
+// supported. Must be used on a single thread with the same GL context current.
+class FlutterWebviewGpuTimer {
+ public:
+  FlutterWebviewGpuTimer();
+  ~FlutterWebviewGpuTimer();
+
+  // Starts a measurement, unless all the queries are still waiting for their
+  // results, in which case this sample is skipped.
+  void Begin();
+  void End();
+
+  // Records the results that have become available in |stats|.
+  void CollectResults(FlutterWebviewRenderStats* stats);
+
+  // Deletes the queries.
+  void ReleaseQueries();
+
+ private:
+  static constexpr int kNumQueries = 4;
+
+  struct Query {
+    GLuint name = 0;
+    bool pending = false;
+  };
+
+  std::array<Query, kNumQueries> queries_;
+  int next_query_;
+  int running_query_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_RENDER_STATS_H_
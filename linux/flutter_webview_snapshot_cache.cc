@@ -0,0 +1,244 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_snapshot_cache.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "flutter_webview_pixel_conversion.h"
+
+namespace {
+
+constexpr int kBytesPerPixel = 4;
+
+}  // namespace
+
+FlutterWebviewSnapshotCache::FlutterWebviewSnapshotCache(
+    const std::string& directory)
+    : directory_(directory), writing_(false), stopping_(false) {}
+
+FlutterWebviewSnapshotCache::~FlutterWebviewSnapshotCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cond_.notify_all();
+  // The worker thread writes the queue before it exits.
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+bool FlutterWebviewSnapshotCache::Load(const std::string& key,
+                                       std::vector<uint8_t>* pixels,
+                                       int* width,
+                                       int* height) const {
+  const std::string path = GetPath(key);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GdkPixbuf) pixbuf = gdk_pixbuf_new_from_file(path.c_str(), &error);
+  if (pixbuf == nullptr) {
+    // No snapshot has been stored for the key yet.
+    if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+      std::cerr << "Warning: the snapshot " << path
+                << " cannot be read: " << error->message << std::endl;
+    }
+    return false;
+  }
+  if (gdk_pixbuf_get_colorspace(pixbuf) != GDK_COLORSPACE_RGB ||
+      gdk_pixbuf_get_bits_per_sample(pixbuf) != 8 ||
+      gdk_pixbuf_get_n_channels(pixbuf) != kBytesPerPixel) {
+    std::cerr << "Warning: the snapshot " << path
+              << " is not an RGBA image. It is ignored." << std::endl;
+    return false;
+  }
+
+  *width = gdk_pixbuf_get_width(pixbuf);
+  *height = gdk_pixbuf_get_height(pixbuf);
+  const int rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  const guint8* rgba = gdk_pixbuf_read_pixels(pixbuf);
+  const size_t stride = static_cast<size_t>(*width) * kBytesPerPixel;
+  pixels->resize(stride * *height);
+  for (int row = 0; row < *height; ++row) {
+    // Swapping the first and third bytes converts RGBA back to BGRA.
+    flutter_webview_pixels::ConvertBGRAToRGBA(rgba + row * rowstride,
+                                              pixels->data() + row * stride,
+                                              *width);
+  }
+  return true;
+}
+
+void FlutterWebviewSnapshotCache::LoadAsync(const std::string& key,
+                                            LoadedCallback callback) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    load_queue_.push_back(LoadRequest{key, std::move(callback)});
+    StartWorker();
+  }
+  cond_.notify_all();
+}
+
+void FlutterWebviewSnapshotCache::Store(const std::string& key,
+                                        std::vector<uint8_t> pixels,
+                                        int width,
+                                        int height) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Snapshot* queued = nullptr;
+    for (Snapshot& snapshot : queue_) {
+      if (snapshot.key == key) {
+        queued = &snapshot;
+        break;
+      }
+    }
+    if (queued != nullptr) {
+      queued->pixels = std::move(pixels);
+      queued->width = width;
+      queued->height = height;
+    } else {
+      queue_.push_back(Snapshot{key, std::move(pixels), width, height});
+    }
+    StartWorker();
+  }
+  cond_.notify_all();
+}
+
+void FlutterWebviewSnapshotCache::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this] { return queue_.empty() && !writing_; });
+}
+
+std::string FlutterWebviewSnapshotCache::GetPath(const std::string& key) const {
+  static constexpr char kHexDigits[] = "0123456789abcdef";
+  std::string name;
+  for (unsigned char c : key) {
+    if (g_ascii_isalnum(c) || c == '-' || c == '_') {
+      name += c;
+    } else {
+      name += '%';
+      name += kHexDigits[c >> 4];
+      name += kHexDigits[c & 0xf];
+    }
+  }
+  return directory_ + "/" + name + ".png";
+}
+
+void FlutterWebviewSnapshotCache::StartWorker() {
+  if (!worker_.joinable()) {
+    worker_ = std::thread(&FlutterWebviewSnapshotCache::WorkerMain, this);
+  }
+}
+
+void FlutterWebviewSnapshotCache::WorkerMain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [this] {
+      return stopping_ || !queue_.empty() || !load_queue_.empty();
+    });
+    // A webview waits for its snapshot, while nobody waits for a write but
+    // the next run of the app.
+    if (!load_queue_.empty()) {
+      LoadRequest request = std::move(load_queue_.front());
+      load_queue_.pop_front();
+
+      lock.unlock();
+      std::vector<uint8_t> pixels;
+      int width = 0;
+      int height = 0;
+      if (!Load(request.key, &pixels, &width, &height)) {
+        pixels.clear();
+      }
+      request.callback(std::move(pixels), width, height);
+      request = LoadRequest();
+      lock.lock();
+      continue;
+    }
+    if (queue_.empty()) {
+      return;
+    }
+    Snapshot snapshot = std::move(queue_.front());
+    queue_.pop_front();
+    writing_ = true;
+
+    lock.unlock();
+    Write(snapshot);
+    lock.lock();
+
+    writing_ = false;
+    cond_.notify_all();
+  }
+}
+
+bool FlutterWebviewSnapshotCache::Write(const Snapshot& snapshot) const {
+  if (g_mkdir_with_parents(directory_.c_str(), 0700) != 0) {
+    std::cerr << "Error: the snapshot directory " << directory_
+              << " cannot be created." << std::endl;
+    return false;
+  }
+
+  // The premultiplied pixels of CEF are stored as they are, since they only
+  // have to come back unchanged.
+  const size_t num_pixels =
+      static_cast<size_t>(snapshot.width) * snapshot.height;
+  std::vector<uint8_t> rgba(num_pixels * kBytesPerPixel);
+  flutter_webview_pixels::ConvertBGRAToRGBA(snapshot.pixels.data(),
+                                            rgba.data(), num_pixels);
+  g_autoptr(GdkPixbuf) pixbuf = gdk_pixbuf_new_from_data(
+      rgba.data(), GDK_COLORSPACE_RGB, /* has_alpha= */ TRUE, 8,
+      snapshot.width, snapshot.height, snapshot.width * kBytesPerPixel,
+      nullptr, nullptr);
+
+  const std::string path = GetPath(snapshot.key);
+  const std::string temp_path = path + ".tmp";
+  g_autoptr(GError) error = nullptr;
+  // The fastest compression, which already shrinks the flat areas of most
+  // pages well.
+  if (!gdk_pixbuf_save(pixbuf, temp_path.c_str(), "png", &error,
+                       "compression", "1", nullptr)) {
+    std::cerr << "Error: the snapshot " << temp_path
+              << " cannot be written: " << error->message << std::endl;
+    g_unlink(temp_path.c_str());
+    return false;
+  }
+  if (g_rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::cerr << "Error: the snapshot " << temp_path << " cannot be renamed to "
+              << path << "." << std::endl;
+    g_unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,130 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_SNAPSHOT_CACHE_H_
+#define LINUX_FLUTTER_WEBVIEW_SNAPSHOT_CACHE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Snapshots of the views of the webviews kept on disk across runs of the app,
+// so that a webview shows the frame it last presented in the previous run
+// while its browser starts up and loads the page, like the snapshots of an
+// app switcher.
+//
+// Each snapshot is stored under a key chosen by the app, as a PNG file in the
+// cache directory. Store queues the snapshot for a worker thread, which
+// compresses it and replaces the file atomically, so that a snapshot being
+// written is never read half-way. LoadAsync has the same thread decode the
+// file, ahead of the snapshots queued to be written.
+class FlutterWebviewSnapshotCache {
+ public:
+  // Called on the worker thread with the |width| x |height| BGRA |pixels| of
+  // the snapshot read by LoadAsync, or with no pixels if there is none.
+  using LoadedCallback =
+      std::function<void(std::vector<uint8_t> pixels, int width, int height)>;
+
+  // Stores the snapshots in |directory|, which is created when the first one
+  // is written.
+  explicit FlutterWebviewSnapshotCache(const std::string& directory);
+
+  // Waits for the queued snapshots to be written.
+  ~FlutterWebviewSnapshotCache();
+
+  const std::string& directory() const { return directory_; }
+
+  // Reads the snapshot stored for |key| to |pixels| as |width| x |height| BGRA
+  // pixels without padding. Returns false if there is none or it cannot be
+  // read. May be called on any thread.
+  bool Load(const std::string& key,
+            std::vector<uint8_t>* pixels,
+            int* width,
+            int* height) const;
+
+  // Reads the snapshot stored for |key| like Load on the worker thread, and
+  // calls |callback| there with it. May be called on any thread.
+  void LoadAsync(const std::string& key, LoadedCallback callback);
+
+  // Queues the |width| x |height| BGRA |pixels| of a view to be written for
+  // |key|, replacing the snapshot queued for it, if any. May be called on any
+  // thread.
+  void Store(const std::string& key,
+             std::vector<uint8_t> pixels,
+             int width,
+             int height);
+
+  // Blocks until the queued snapshots have been written.
+  void Flush();
+
+ private:
+  struct Snapshot {
+    std::string key;
+    std::vector<uint8_t> pixels;
+    int width;
+    int height;
+  };
+
+  struct LoadRequest {
+    std::string key;
+    LoadedCallback callback;
+  };
+
+  // Returns the path of the file of |key|, in which the characters other than
+  // ASCII letters, digits, '-' and '_' are escaped.
+  std::string GetPath(const std::string& key) const;
+
+  // Starts the worker thread if it is not running. Must be called with
+  // |mutex_| locked.
+  void StartWorker();
+
+  void WorkerMain();
+
+  // Writes |snapshot| to a temporary file and renames it over the file of its
+  // key. Returns false if it failed.
+  bool Write(const Snapshot& snapshot) const;
+
+  const std::string directory_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Snapshot> queue_;
+  std::deque<LoadRequest> load_queue_;
+  // Whether the worker thread is writing a snapshot taken from |queue_|.
+  bool writing_;
+  bool stopping_;
+  // Started by the first Store or LoadAsync.
+  std::thread worker_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_SNAPSHOT_CACHE_H_
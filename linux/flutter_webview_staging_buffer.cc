@@ -0,0 +1,364 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_staging_buffer.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_gl_utils.h"
+#include "flutter_webview_texture_format.h"
+
+namespace {
+
+// Above this number, a region is replaced with its bounding box.
+constexpr size_t kMaxPendingRects = 16;
+
+constexpr int kBytesPerPixel = 4;
+
+WebviewRect BoundingBoxOf(const std::vector<WebviewRect>& rects) {
+  int left = rects[0].x;
+  int top = rects[0].y;
+  int right = rects[0].x + rects[0].width;
+  int bottom = rects[0].y + rects[0].height;
+  for (const WebviewRect& rect : rects) {
+    left = std::min(left, rect.x);
+    top = std::min(top, rect.y);
+    right = std::max(right, rect.x + rect.width);
+    bottom = std::max(bottom, rect.y + rect.height);
+  }
+  return WebviewRect{left, top, right - left, bottom - top};
+}
+
+void AddRects(const std::vector<WebviewRect>& rects,
+              std::vector<WebviewRect>* region) {
+  region->insert(region->end(), rects.begin(), rects.end());
+  if (region->size() > kMaxPendingRects) {
+    region->assign(1, BoundingBoxOf(*region));
+  }
+}
+
+}  // namespace
+
+constexpr int FlutterWebviewStagingBuffer::kNumImages;
+
+FlutterWebviewStagingBuffer::FlutterWebviewStagingBuffer()
+    : latest_image_(-1),
+      reading_image_(-1),
+      published_sequence_(0),
+      presented_sequence_(0),
+      frame_available_pending_(false),
+      last_publish_time_ns_(0),
+      writing_image_(-1),
+      texture_(0),
+      texture_width_(0),
+      texture_height_(0) {
+  // The raster thread's GL state is left as the rasterizer expects, so the
+  // pixels are uploaded without a pixel buffer object.
+  uploader_.SetMode(TextureUploadMode::kDirect);
+}
+
+FlutterWebviewStagingBuffer::~FlutterWebviewStagingBuffer() {
+  if (texture_ != 0) {
+    std::cerr << "Warning: FlutterWebviewStagingBuffer is destroyed without "
+                 "ReleaseGLResources(). The texture is leaked."
+              << std::endl;
+  }
+}
+
+bool FlutterWebviewStagingBuffer::HasFrame() const {
+  return published_sequence_.load() > 0;
+}
+
+bool FlutterWebviewStagingBuffer::BeginWrite(int width, int height) {
+  if (writing_image_ >= 0) {
+    std::cerr << "Error: FlutterWebviewStagingBuffer::BeginWrite() is called "
+                 "twice without EndWrite()."
+              << std::endl;
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // At most two images are in use, by the latest frame and by the reader.
+    for (int i = 0; i < kNumImages; ++i) {
+      if (i != latest_image_ && i != reading_image_) {
+        writing_image_ = i;
+        break;
+      }
+    }
+  }
+
+  Image& image = images_[writing_image_];
+  if (image.width != width || image.height != height) {
+    image.pixels.resize(static_cast<size_t>(width) * height * kBytesPerPixel);
+    image.width = width;
+    image.height = height;
+    image.stale_rects.assign(1, WebviewRect{0, 0, width, height});
+  }
+  if (latest_image_ < 0 || images_[latest_image_].width != width ||
+      images_[latest_image_].height != height) {
+    // The whole frame is drawn.
+    image.stale_rects.clear();
+    return false;
+  }
+  CatchUp(&image, images_[latest_image_]);
+  return true;
+}
+
+void FlutterWebviewStagingBuffer::CatchUp(Image* image, const Image& latest) {
+  const size_t stride = static_cast<size_t>(image->width) * kBytesPerPixel;
+  for (const WebviewRect& rect : image->stale_rects) {
+    // The rects of a frame larger than the current one are clipped.
+    const int left = std::max(rect.x, 0);
+    const int top = std::max(rect.y, 0);
+    const int right = std::min(rect.x + rect.width, image->width);
+    const int bottom = std::min(rect.y + rect.height, image->height);
+    if (left >= right || top >= bottom) {
+      continue;
+    }
+    const size_t offset =
+        top * stride + static_cast<size_t>(left) * kBytesPerPixel;
+    const size_t length = static_cast<size_t>(right - left) * kBytesPerPixel;
+    for (int row = 0; row < bottom - top; ++row) {
+      std::memcpy(image->pixels.data() + offset + row * stride,
+                  latest.pixels.data() + offset + row * stride, length);
+    }
+  }
+  image->stale_rects.clear();
+}
+
+void FlutterWebviewStagingBuffer::CopyFromBGRA(const void* bgra,
+                                               int source_width,
+                                               const WebviewRect& rect,
+                                               int x,
+                                               int y) {
+  if (writing_image_ < 0) {
+    std::cerr << "Error: FlutterWebviewStagingBuffer::CopyFromBGRA() is "
+                 "called without BeginWrite()."
+              << std::endl;
+    return;
+  }
+  Image& image = images_[writing_image_];
+
+  // Clip the destination, moving the source along.
+  const int left = std::max(x, 0);
+  const int top = std::max(y, 0);
+  const int right = std::min(x + rect.width, image.width);
+  const int bottom = std::min(y + rect.height, image.height);
+  if (left >= right || top >= bottom) {
+    return;
+  }
+  const int source_x = rect.x + left - x;
+  const int source_y = rect.y + top - y;
+
+  const uint8_t* source = static_cast<const uint8_t*>(bgra);
+  const size_t source_stride =
+      static_cast<size_t>(source_width) * kBytesPerPixel;
+  const size_t stride = static_cast<size_t>(image.width) * kBytesPerPixel;
+  const size_t length = static_cast<size_t>(right - left) * kBytesPerPixel;
+  for (int row = 0; row < bottom - top; ++row) {
+    std::memcpy(image.pixels.data() + (top + row) * stride +
+                    static_cast<size_t>(left) * kBytesPerPixel,
+                source + (source_y + row) * source_stride +
+                    static_cast<size_t>(source_x) * kBytesPerPixel,
+                length);
+  }
+}
+
+void FlutterWebviewStagingBuffer::EndWrite(
+    const std::vector<WebviewRect>& damage) {
+  if (writing_image_ < 0) {
+    std::cerr << "Error: FlutterWebviewStagingBuffer::EndWrite() is called "
+                 "without BeginWrite()."
+              << std::endl;
+    return;
+  }
+
+  if (FlutterWebviewRenderStats::IsEnabled()) {
+    last_publish_time_ns_.store(FlutterWebviewRenderStats::NowNs());
+    render_stats_.RecordPublishedFrame();
+    // The previous frame is merged into this one without being shown.
+    if (HasUnpresentedFrame()) {
+      render_stats_.RecordSupersededFrames(1);
+    }
+  }
+
+  for (int i = 0; i < kNumImages; ++i) {
+    if (i != writing_image_) {
+      AddRects(damage, &images_[i].stale_rects);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AddRects(damage, &pending_damage_);
+    latest_image_ = writing_image_;
+    published_sequence_.fetch_add(1);
+  }
+  writing_image_ = -1;
+}
+
+void FlutterWebviewStagingBuffer::GetLatestFrameSize(int* width,
+                                                     int* height) const {
+  if (latest_image_ < 0) {
+    *width = 0;
+    *height = 0;
+    return;
+  }
+  *width = images_[latest_image_].width;
+  *height = images_[latest_image_].height;
+}
+
+bool FlutterWebviewStagingBuffer::ReadLatestFrame(
+    std::vector<uint8_t>* bgra) const {
+  if (latest_image_ < 0) {
+    return false;
+  }
+  // The reader only reads the latest image, so it is copied without the lock.
+  *bgra = images_[latest_image_].pixels;
+  return true;
+}
+
+bool FlutterWebviewStagingBuffer::UploadLatestFrame(GLenum target,
+                                                    Frame* frame) {
+  frame_available_pending_.store(false);
+
+  uint64_t sequence = 0;
+  int image_index = -1;
+  std::vector<WebviewRect> rects;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sequence = published_sequence_.load();
+    if (sequence == 0) {
+      return false;
+    }
+    if (sequence != presented_sequence_.load()) {
+      // The writer leaves the image alone until the upload is done.
+      reading_image_ = latest_image_;
+      image_index = latest_image_;
+      rects.swap(pending_damage_);
+    }
+  }
+
+  int64_t publish_time_ns = 0;
+  if (image_index >= 0) {
+    const Image& image = images_[image_index];
+    GLint previous_texture = 0;
+    glGetIntegerv(target == GL_TEXTURE_RECTANGLE
+                      ? GL_TEXTURE_BINDING_RECTANGLE
+                      : GL_TEXTURE_BINDING_2D,
+                  &previous_texture);
+    GLint previous_unpack_buffer = 0;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &previous_unpack_buffer);
+    if (previous_unpack_buffer != 0) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    if (texture_ == 0 || texture_width_ != image.width ||
+        texture_height_ != image.height) {
+      if (texture_ == 0) {
+        glGenTextures(1, &texture_);
+      }
+      glBindTexture(target, texture_);
+      flutter_webview_gl::AllocateTextureImage(target, image.width,
+                                               image.height);
+      VERIFY_GL_NO_ERROR;
+      texture_width_ = image.width;
+      texture_height_ = image.height;
+      rects.assign(1, WebviewRect{0, 0, image.width, image.height});
+    }
+    uploader_.UploadRects(target, texture_, image.pixels.data(), image.width,
+                          image.height, rects, 0, 0);
+
+    glBindTexture(target, previous_texture);
+    if (previous_unpack_buffer != 0) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, previous_unpack_buffer);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      reading_image_ = -1;
+    }
+    presented_sequence_.store(sequence);
+    publish_time_ns = last_publish_time_ns_.load();
+  }
+
+  frame->texture = texture_;
+  frame->width = texture_width_;
+  frame->height = texture_height_;
+
+  if (publish_time_ns > 0 && FlutterWebviewRenderStats::IsEnabled()) {
+    render_stats_.RecordPresentLatency(FlutterWebviewRenderStats::NowNs() -
+                                       publish_time_ns);
+  }
+  return true;
+}
+
+bool FlutterWebviewStagingBuffer::HasUnpresentedFrame() const {
+  return published_sequence_.load() > presented_sequence_.load();
+}
+
+void FlutterWebviewStagingBuffer::ReleaseGLResources() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uploader_.ReleaseGLResources();
+  if (texture_ != 0) {
+    glDeleteTextures(1, &texture_);
+    texture_ = 0;
+  }
+  texture_width_ = 0;
+  texture_height_ = 0;
+  // Uploaded again as a whole if the image is ever populated again.
+  presented_sequence_.store(0);
+}
+
+bool FlutterWebviewStagingBuffer::TakeFrameAvailableNotification() {
+  if (!NeedsFrameAvailableNotification()) {
+    return false;
+  }
+  frame_available_pending_.store(true);
+
+  const int64_t publish_time_ns = last_publish_time_ns_.load();
+  if (publish_time_ns > 0 && FlutterWebviewRenderStats::IsEnabled()) {
+    render_stats_.RecordNotifyLatency(FlutterWebviewRenderStats::NowNs() -
+                                      publish_time_ns);
+  }
+  return true;
+}
+
+bool FlutterWebviewStagingBuffer::NeedsFrameAvailableNotification() const {
+  return !frame_available_pending_.load() && HasUnpresentedFrame();
+}
@@ -0,0 +1,173 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_STAGING_BUFFER_H_
+#define LINUX_FLUTTER_WEBVIEW_STAGING_BUFFER_H_
+
+#include <GL/gl.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_render_stats.h"
+#include "flutter_webview_texture_uploader.h"
+
+// The CPU image of a webview for TextureBackend::kRasterUpload, uploaded to
+// its GL texture by Flutter's raster thread instead of the CEF UI thread.
+//
+// The browser copies the damaged rows of each paint into the image on the CEF
+// UI thread without any GL call, and the damage accumulates until Flutter
+// populates the texture. The raster thread, which has its own GL context
+// current there, then uploads the accumulated damage to a single texture and
+// samples it right after on the same context, so neither a ring of textures
+// nor fences are needed.
+//
+// The images are BGRA, as painted by CEF, and converted by the upload in the
+// format of flutter_webview_gl::GetTextureFormat(). There are three of them,
+// like the textures of FlutterWebviewTextureRing, so that the browser never
+// draws the image Flutter is uploading and neither side waits for the other:
+// the lock only guards the bookkeeping. An image being reused is missing the
+// frames published since it was last drawn, so BeginWrite copies those
+// regions from the latest frame first.
+class FlutterWebviewStagingBuffer {
+ public:
+  struct Frame {
+    GLuint texture;
+    int width;
+    int height;
+  };
+
+  FlutterWebviewStagingBuffer();
+  ~FlutterWebviewStagingBuffer();
+
+  // Writer side. Must be called on the CEF UI thread.
+
+  // Returns whether a frame has been published.
+  bool HasFrame() const;
+
+  // Starts drawing a |width| x |height| frame over the latest one, in an image
+  // that Flutter does not read until EndWrite. Returns true if the image
+  // already holds the latest frame, or false if the size has changed, in which
+  // case the whole frame must be drawn.
+  bool BeginWrite(int width, int height);
+
+  // Copies |rect| of |bgra|, a BGRA image |source_width| pixels wide, to (|x|,
+  // |y|) of the frame being drawn, clipped to its bounds.
+  void CopyFromBGRA(const void* bgra,
+                    int source_width,
+                    const WebviewRect& rect,
+                    int x,
+                    int y);
+
+  // Publishes the frame drawn since BeginWrite. |damage| is the region that
+  // differs from the previous frame, which is added to the region to upload.
+  void EndWrite(const std::vector<WebviewRect>& damage);
+
+  // Returns the size of the latest published frame, or 0 x 0 if no frame has
+  // been published.
+  void GetLatestFrameSize(int* width, int* height) const;
+
+  // Copies the latest published frame to |bgra|, of the size returned by
+  // GetLatestFrameSize. Returns false if no frame has been published.
+  bool ReadLatestFrame(std::vector<uint8_t>* bgra) const;
+
+  // Reader side. Must be called on the raster thread.
+
+  // Uploads the region published since the previous call to the texture of
+  // |target|, whose storage is (re)allocated when the frame size changes, and
+  // returns it in |frame|. The GL state changed for the upload is restored,
+  // since the rasterizer keeps track of it. Returns false until the first
+  // frame is published.
+  bool UploadLatestFrame(GLenum target, Frame* frame);
+
+  // Returns whether a frame newer than the one last uploaded by
+  // UploadLatestFrame has been published. May be called on any thread.
+  bool HasUnpresentedFrame() const;
+
+  // Deletes the texture. Must be called with a GL context sharing with the
+  // raster thread's current, once Flutter no longer populates the texture.
+  void ReleaseGLResources();
+
+  // Platform thread side. See FlutterWebviewTextureRing.
+
+  bool TakeFrameAvailableNotification();
+  bool NeedsFrameAvailableNotification() const;
+
+  FlutterWebviewRenderStats& render_stats() { return render_stats_; }
+
+ private:
+  static constexpr int kNumImages = 3;
+
+  struct Image {
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+    // The regions changed by the frames published since this image was last
+    // drawn. Accessed only by the writer.
+    std::vector<WebviewRect> stale_rects;
+  };
+
+  // Copies the stale regions of |image| from the image of the latest frame.
+  void CatchUp(Image* image, const Image& latest);
+
+  // Only the writer draws to the images, and never to the one of the latest
+  // frame or the one being uploaded, which both sides may read without the
+  // lock.
+  std::array<Image, kNumImages> images_;
+
+  mutable std::mutex mutex_;
+  // Guarded by |mutex_|. Written only by the writer, which reads it without
+  // the lock. The image of the latest published frame, or -1.
+  int latest_image_;
+  // Guarded by |mutex_|. The image being uploaded by the reader, or -1.
+  int reading_image_;
+  // Guarded by |mutex_|. The region published but not uploaded yet.
+  std::vector<WebviewRect> pending_damage_;
+
+  std::atomic<uint64_t> published_sequence_;
+  std::atomic<uint64_t> presented_sequence_;
+  std::atomic<bool> frame_available_pending_;
+  std::atomic<int64_t> last_publish_time_ns_;
+
+  FlutterWebviewRenderStats render_stats_;
+
+  // Accessed only by the writer. The image being drawn, or -1.
+  int writing_image_;
+
+  // Accessed only by the reader, except for ReleaseGLResources.
+  GLuint texture_;
+  int texture_width_;
+  int texture_height_;
+  FlutterWebviewTextureUploader uploader_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_STAGING_BUFFER_H_
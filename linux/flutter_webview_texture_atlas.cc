@@ -0,0 +1,78 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_texture_atlas.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+constexpr int FlutterWebviewTextureAtlas::kMaxSize;
+constexpr int FlutterWebviewTextureAtlas::kMaxRegionSize;
+constexpr int FlutterWebviewTextureAtlas::kPadding;
+
+FlutterWebviewTextureAtlas::FlutterWebviewTextureAtlas(
+    std::shared_ptr<FlutterWebviewTextureRing> ring,
+    int width,
+    int height)
+    : ring_(std::move(ring)), width_(width), height_(height) {}
+
+bool FlutterWebviewTextureAtlas::Queue(WebviewId webview_id,
+                                       const DrawCallback& draw) {
+  const bool first = queued_draws_.empty();
+  queued_draws_[webview_id] = draw;
+  return first;
+}
+
+void FlutterWebviewTextureAtlas::Cancel(WebviewId webview_id) {
+  queued_draws_.erase(webview_id);
+}
+
+void FlutterWebviewTextureAtlas::Flush() {
+  if (queued_draws_.empty()) {
+    return;
+  }
+  // A draw may queue another one, which waits for the next flush.
+  std::map<WebviewId, DrawCallback> draws;
+  draws.swap(queued_draws_);
+
+  // The texture being written already holds the regions of the webviews that
+  // have not painted since.
+  FlutterWebviewTextureRing::Frame frame = ring_->BeginWrite();
+  if (frame.width != width_ || frame.height != height_) {
+    frame = ring_->ReserveStorage(width_, height_);
+  }
+  std::vector<WebviewRect> damage;
+  for (const auto& entry : draws) {
+    std::vector<WebviewRect> drawn =
+        entry.second(ring_->target(), frame.texture);
+    damage.insert(damage.end(), drawn.begin(), drawn.end());
+  }
+  ring_->EndWrite(width_, height_, damage);
+}
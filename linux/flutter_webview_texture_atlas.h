@@ -0,0 +1,90 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_TEXTURE_ATLAS_H_
+#define LINUX_FLUTTER_WEBVIEW_TEXTURE_ATLAS_H_
+
+#include <GL/gl.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_texture_ring.h"
+
+// A texture ring shared by small webviews, each drawn to a region of it.
+// Accessed only on the CEF UI thread, apart from the ring.
+//
+// The webviews queue their paints instead of drawing them right away, and
+// Flush() draws all the queued paints as a single frame of the ring, so that
+// the GL context is made current and a frame is published once for all of
+// them. Flutter shows the region of a webview by clipping the whole texture.
+class FlutterWebviewTextureAtlas {
+ public:
+  // The largest width and height of an atlas.
+  static constexpr int kMaxSize = 2048;
+  // The largest width and height of a webview drawn to an atlas.
+  static constexpr int kMaxRegionSize = 512;
+  // The pixels left between the regions.
+  static constexpr int kPadding = 1;
+
+  // Draws to |texture|, the frame of the ring being written, and returns the
+  // regions drawn in the coordinates of the atlas.
+  using DrawCallback =
+      std::function<std::vector<WebviewRect>(GLenum target, GLuint texture)>;
+
+  FlutterWebviewTextureAtlas(std::shared_ptr<FlutterWebviewTextureRing> ring,
+                             int width,
+                             int height);
+
+  FlutterWebviewTextureRing* ring() const { return ring_.get(); }
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+  // Queues |draw| for the next Flush() in place of the one queued for
+  // |webview_id|, if any. Returns true if nothing was queued before, in which
+  // case the caller has to have Flush() called.
+  bool Queue(WebviewId webview_id, const DrawCallback& draw);
+
+  // Drops the draw queued for |webview_id|, if any.
+  void Cancel(WebviewId webview_id);
+
+  // Runs the queued draws on a new frame of the ring and publishes it. Must be
+  // called with the GL context current.
+  void Flush();
+
+ private:
+  std::shared_ptr<FlutterWebviewTextureRing> ring_;
+  int width_;
+  int height_;
+  std::map<WebviewId, DrawCallback> queued_draws_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_TEXTURE_ATLAS_H_
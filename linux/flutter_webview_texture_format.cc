@@ -0,0 +1,249 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_texture_format.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_gl_utils.h"
+#include "flutter_webview_pixel_conversion.h"
+
+namespace flutter_webview_gl {
+
+namespace {
+
+constexpr size_t kBytesPerPixel = 4;
+
+// The size of the scratch texture and the number of uploads used to choose the
+// format. The source image is twice as wide as the texture so that the uploads
+// use a row length, as the dirty rectangles of a view do.
+constexpr int kBenchmarkSize = 256;
+constexpr int kBenchmarkUploads = 8;
+
+void SetUnpackState(int row_length, int skip_pixels, int skip_rows) {
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, skip_pixels);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, skip_rows);
+}
+
+void DiscardErrors() {
+  while (glGetError() != GL_NO_ERROR) {
+  }
+}
+
+std::vector<TextureFormat> GetSupportedFormats(const Capabilities& caps) {
+  // OpenGL ES 2.0 has no sized internal formats.
+  const GLenum rgba_internal_format =
+      caps.is_gles && !caps.IsAtLeast(3, 0) ? GL_RGBA : GL_RGBA8;
+
+  std::vector<TextureFormat> formats;
+  TextureFormat format;
+  if (!caps.is_gles) {
+    format.kind = TextureFormat::Kind::kBGRA;
+    format.name = "bgra";
+    format.internal_format = GL_RGBA8;
+    format.format = GL_BGRA;
+    format.type = GL_UNSIGNED_INT_8_8_8_8_REV;
+    formats.push_back(format);
+  } else if (caps.HasExtension("GL_EXT_texture_format_BGRA8888")) {
+    format.kind = TextureFormat::Kind::kBGRAExt;
+    format.name = "bgra_ext";
+    format.internal_format = GL_BGRA_EXT;
+    format.format = GL_BGRA_EXT;
+    format.type = GL_UNSIGNED_BYTE;
+    formats.push_back(format);
+  }
+  // The texture swizzle cannot swap the red and blue channels instead, since
+  // Skia resets the swizzle of the textures it samples.
+  format.kind = TextureFormat::Kind::kConvert;
+  format.name = "convert";
+  format.internal_format = rgba_internal_format;
+  format.format = GL_RGBA;
+  format.type = GL_UNSIGNED_BYTE;
+  formats.push_back(format);
+  return formats;
+}
+
+void AllocateTextureImage(const TextureFormat& format,
+                          GLenum target,
+                          int width,
+                          int height) {
+  glTexImage2D(target, 0, format.internal_format, width, height, 0,
+               format.format, format.type, nullptr);
+}
+
+void TexSubImageBGRA(const TextureFormat& format,
+                     GLenum target,
+                     int x,
+                     int y,
+                     const uint8_t* buffer,
+                     int width,
+                     const WebviewRect& rect,
+                     std::vector<uint8_t>* scratch) {
+  if (format.kind != TextureFormat::Kind::kConvert) {
+    SetUnpackState(width, rect.x, rect.y);
+    glTexSubImage2D(target, 0, x, y, rect.width, rect.height, format.format,
+                    format.type, buffer);
+    return;
+  }
+
+  // Only the rows of |rect| are converted, into tightly packed rows.
+  const size_t row_pixels = static_cast<size_t>(rect.width);
+  scratch->resize(row_pixels * rect.height * kBytesPerPixel);
+  const size_t src_stride = static_cast<size_t>(width) * kBytesPerPixel;
+  const uint8_t* src = buffer + rect.y * src_stride + rect.x * kBytesPerPixel;
+  uint8_t* dst = scratch->data();
+  if (rect.width == width) {
+    flutter_webview_pixels::ConvertBGRAToRGBA(src, dst,
+                                              row_pixels * rect.height);
+  } else {
+    for (int row = 0; row < rect.height; ++row) {
+      flutter_webview_pixels::ConvertBGRAToRGBA(src, dst, row_pixels);
+      src += src_stride;
+      dst += row_pixels * kBytesPerPixel;
+    }
+  }
+  SetUnpackState(0, 0, 0);
+  glTexSubImage2D(target, 0, x, y, rect.width, rect.height, format.format,
+                  format.type, scratch->data());
+}
+
+// Returns the nanoseconds |format| takes to upload the benchmark image, or a
+// negative value if the context rejects it. A format is rejected if any call
+// fails or if the texture cannot be attached to a framebuffer, which the
+// texture ring needs to copy regions between its textures.
+double MeasureFormat(const TextureFormat& format) {
+  DiscardErrors();
+
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  AllocateTextureImage(format, GL_TEXTURE_2D, kBenchmarkSize, kBenchmarkSize);
+
+  GLuint framebuffer = 0;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                         GL_TEXTURE_2D, texture, 0);
+  const bool attachable = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) ==
+                          GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &framebuffer);
+
+  const int source_width = kBenchmarkSize * 2;
+  std::vector<uint8_t> pixels(source_width * kBenchmarkSize * kBytesPerPixel);
+  std::vector<uint8_t> scratch;
+  const WebviewRect rect{kBenchmarkSize / 2, 0, kBenchmarkSize,
+                         kBenchmarkSize};
+  double elapsed_ns = -1;
+  if (attachable && glGetError() == GL_NO_ERROR) {
+    // Warm up the upload path before measuring it.
+    TexSubImageBGRA(format, GL_TEXTURE_2D, 0, 0, pixels.data(), source_width,
+                    rect, &scratch);
+    glFinish();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kBenchmarkUploads; ++i) {
+      TexSubImageBGRA(format, GL_TEXTURE_2D, 0, 0, pixels.data(), source_width,
+                      rect, &scratch);
+    }
+    glFinish();
+    const auto end = std::chrono::steady_clock::now();
+    if (glGetError() == GL_NO_ERROR) {
+      elapsed_ns =
+          std::chrono::duration<double, std::nano>(end - start).count();
+    }
+  }
+  SetUnpackState(0, 0, 0);
+  glDeleteTextures(1, &texture);
+  DiscardErrors();
+  return elapsed_ns;
+}
+
+TextureFormat ChooseTextureFormat() {
+  GLint previous_texture = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+  GLint previous_framebuffer = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+  const std::vector<TextureFormat> formats =
+      GetSupportedFormats(GetCapabilities());
+  // kConvert only relies on core features, so it is the fallback.
+  TextureFormat chosen = formats.back();
+  double chosen_ns = std::numeric_limits<double>::max();
+  for (const TextureFormat& format : formats) {
+    const double elapsed_ns = MeasureFormat(format);
+#if FLUTTER_WEBVIEW_DEBUG
+    std::cerr << "Texture format " << format.name << ": "
+              << (elapsed_ns < 0 ? "unsupported"
+                                 : std::to_string(elapsed_ns / 1000) + " us")
+              << std::endl;
+#endif  // FLUTTER_WEBVIEW_DEBUG
+    if (elapsed_ns >= 0 && elapsed_ns < chosen_ns) {
+      chosen = format;
+      chosen_ns = elapsed_ns;
+    }
+  }
+
+  glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous_texture));
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER,
+                    static_cast<GLuint>(previous_framebuffer));
+  VERIFY_GL_NO_ERROR;
+  return chosen;
+}
+
+}  // namespace
+
+const TextureFormat& GetTextureFormat() {
+  static const TextureFormat format = ChooseTextureFormat();
+  return format;
+}
+
+void AllocateTextureImage(GLenum target, int width, int height) {
+  AllocateTextureImage(GetTextureFormat(), target, width, height);
+}
+
+void TexSubImageBGRA(GLenum target,
+                     int x,
+                     int y,
+                     const uint8_t* buffer,
+                     int width,
+                     const WebviewRect& rect,
+                     std::vector<uint8_t>* scratch) {
+  TexSubImageBGRA(GetTextureFormat(), target, x, y, buffer, width, rect,
+                  scratch);
+}
+
+}  // namespace flutter_webview_gl
@@ -0,0 +1,92 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_TEXTURE_FORMAT_H_
+#define LINUX_FLUTTER_WEBVIEW_TEXTURE_FORMAT_H_
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+namespace flutter_webview_gl {
+
+// How the BGRA pixels painted by the browser are passed to GL and stored in
+// the webview textures.
+struct TextureFormat {
+  enum class Kind {
+    // GL_BGRA / GL_UNSIGNED_INT_8_8_8_8_REV into GL_RGBA8. Desktop GL only.
+    kBGRA,
+    // GL_BGRA_EXT / GL_UNSIGNED_BYTE into GL_BGRA_EXT textures, with
+    // EXT_texture_format_BGRA8888. OpenGL ES only.
+    kBGRAExt,
+    // The dirty rows converted to RGBA on the CPU and uploaded as GL_RGBA /
+    // GL_UNSIGNED_BYTE.
+    kConvert,
+  };
+
+  Kind kind = Kind::kBGRA;
+  const char* name = "";
+  // The internal format for glTexImage2D, and for glTexStorage2D on desktop
+  // GL where it is sized.
+  GLenum internal_format = GL_RGBA8;
+  // The format and type of the pixels passed to glTexSubImage2D.
+  GLenum format = GL_BGRA;
+  GLenum type = GL_UNSIGNED_INT_8_8_8_8_REV;
+};
+
+// Returns the format of the webview textures. On the first call, which must be
+// made with the GL context of the plugin current, every format the context
+// supports is tried with a scratch texture, and the one that uploads fastest
+// without a GL error is chosen for the process. This waits for the GL and
+// discards its pending errors, so the plugin makes that call when it starts.
+const TextureFormat& GetTextureFormat();
+
+// Allocates the storage of the texture bound to |target| with
+// glTexImage2D, in the format of GetTextureFormat().
+void AllocateTextureImage(GLenum target, int width, int height);
+
+// Updates the texture bound to |target| at (|x|, |y|) with the |rect| of
+// |buffer|, a BGRA image |width| pixels wide, in the format of
+// GetTextureFormat(). For kConvert, the pixels are converted through
+// |scratch|. Leaves GL_UNPACK_ROW_LENGTH, GL_UNPACK_SKIP_PIXELS and
+// GL_UNPACK_SKIP_ROWS set, to be reset to 0 by the caller when done.
+void TexSubImageBGRA(GLenum target,
+                     int x,
+                     int y,
+                     const uint8_t* buffer,
+                     int width,
+                     const WebviewRect& rect,
+                     std::vector<uint8_t>* scratch);
+
+}  // namespace flutter_webview_gl
+
+#endif  // LINUX_FLUTTER_WEBVIEW_TEXTURE_FORMAT_H_
@@ -31,21 +31,45 @@
 #include <GL/gl.h>
 #include <flutter_linux/flutter_linux.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "flutter_linux_webview/fl_custom_texture_gl.h"
+#include "flutter_linux_webview/fl_custom_texture_pixel_buffer.h"
 #include "flutter_linux_webview/flutter_linux_webview_plugin.h"
+#include "flutter_webview_pixel_buffer.h"
+#include "flutter_webview_render_stats.h"
+#include "flutter_webview_staging_buffer.h"
+#include "flutter_webview_texture_ring.h"
 
-FlutterWebviewTextureManager::FlutterWebviewTextureManager() {}
+constexpr size_t FlutterWebviewTextureManager::kMaxPooledTextures;
+constexpr int FlutterWebviewTextureManager::kSizeBucketStep;
+constexpr int FlutterWebviewTextureManager::kReclaimDelayMs;
+
+FlutterWebviewTextureManager::FlutterWebviewTextureManager()
+    : memory_budget_bytes_(0), evictions_(0), checked_storage_bytes_(0) {}
 
 FlCustomTextureGL* FlutterWebviewTextureManager::CreateAndRegisterTexture(
     WebviewId webview_id,
     GdkGLContext* context,
     FlTextureRegistrar* texture_registrar,
     int width,
-    int height) {
+    int height,
+    std::shared_ptr<FlutterWebviewStagingBuffer> staging) {
+  if (pixel_buffer_texture_store_.count(webview_id) > 0) {
+    std::cerr << "Error: a texture for webview_id=" << webview_id
+              << " is already stored." << std::endl;
+    return nullptr;
+  }
   auto it_inserted = texture_store_.emplace(webview_id, nullptr);
   if (!it_inserted.second) {
     std::cerr << "Error: a texture for webview_id=" << webview_id
@@ -53,31 +77,266 @@ FlCustomTextureGL* FlutterWebviewTextureManager::CreateAndRegisterTexture(
     return nullptr;
   }
 
-  gdk_gl_context_make_current(context);
+  FlCustomTextureGL* texture = TakeOrCreateAndRegisterTexture(
+      context, texture_registrar, width, height, std::move(staging));
+  if (texture == nullptr) {
+    texture_store_.erase(it_inserted.first);
+    return nullptr;
+  }
 
-  // Create a native texture
-  GLuint native_texture_id;
-  glGenTextures(1, &native_texture_id);
+  // Store the texture
+  it_inserted.first->second = texture;
+  return texture;
+}
 
-  // Create a custom fl texture
-  g_autoptr(FlCustomTextureGL) flCustomTextureGL =
-      fl_custom_texture_gl_new(GL_TEXTURE_2D, native_texture_id, width, height);
+std::vector<FlCustomTextureGL*>
+FlutterWebviewTextureManager::EnsureTileTextures(
+    WebviewId webview_id,
+    GdkGLContext* context,
+    FlTextureRegistrar* texture_registrar,
+    size_t num_tiles,
+    int tile_size) {
+  auto it = texture_store_.find(webview_id);
+  if (it == texture_store_.end()) {
+    std::cerr << "Error: The FlCustomTextureGL texture for webview_id="
+              << webview_id << " is not found." << std::endl;
+    return {};
+  }
 
-  // Store the created texture
-  it_inserted.first->second =
-      FL_CUSTOM_TEXTURE_GL(g_object_ref(flCustomTextureGL));
+  std::vector<FlCustomTextureGL*> textures{it->second};
+  if (num_tiles <= 1) {
+    return textures;
+  }
+
+  std::vector<FlCustomTextureGL*>& tiles = tile_texture_store_[webview_id];
+  while (tiles.size() + 1 < num_tiles) {
+    FlCustomTextureGL* texture = TakeOrCreateAndRegisterTexture(
+        context, texture_registrar, tile_size, tile_size);
+    if (texture == nullptr) {
+      return {};
+    }
+    tiles.push_back(texture);
+  }
+  textures.insert(textures.end(), tiles.begin(),
+                  tiles.begin() + (num_tiles - 1));
+  return textures;
+}
+
+FlCustomTextureGL* FlutterWebviewTextureManager::TakeOrCreateAndRegisterTexture(
+    GdkGLContext* context,
+    FlTextureRegistrar* texture_registrar,
+    int width,
+    int height,
+    std::shared_ptr<FlutterWebviewStagingBuffer> staging) {
+  FlCustomTextureGL* texture = TakePooledTexture(width, height);
+  if (texture != nullptr) {
+    // Its ring shows its initial texture until the webview paints.
+    texture->width = width;
+    texture->height = height;
+  } else {
+    gdk_gl_context_make_current(context);
+
+    // Create the native textures the browser draws to in turn
+    std::array<GLuint, FlutterWebviewTextureRing::kNumSlots>
+        native_texture_ids;
+    glGenTextures(native_texture_ids.size(), native_texture_ids.data());
+    auto ring = std::make_shared<FlutterWebviewTextureRing>(
+        FlutterWebviewTextureRing::ChooseTarget(), native_texture_ids);
+
+    // Create a custom fl texture
+    texture = fl_custom_texture_gl_new(ring->target(), ring, width, height);
+  }
+  // Flutter may populate the texture as soon as it is registered.
+  texture->staging = std::move(staging);
 
   if (!fl_texture_registrar_register_texture(texture_registrar,
-                                             FL_TEXTURE(flCustomTextureGL))) {
+                                             FL_TEXTURE(texture))) {
     std::cerr << "Error: fl_texture_registrar_register_texture() failed."
               << std::endl;
-    glDeleteTextures(1, &native_texture_id);
-    g_object_unref(it_inserted.first->second);
-    texture_store_.erase(it_inserted.first);
+    // It has never been written nor populated, so it can be pooled as is.
+    texture->staging.reset();
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    pool_.push_back(PooledTexture{texture, GetSizeBucket(width),
+                                  GetSizeBucket(height)});
+    return nullptr;
+  }
+
+  return texture;
+}
+
+FlCustomTexturePixelBuffer*
+FlutterWebviewTextureManager::CreateAndRegisterPixelBufferTexture(
+    WebviewId webview_id,
+    FlTextureRegistrar* texture_registrar) {
+  if (texture_store_.count(webview_id) > 0 ||
+      pixel_buffer_texture_store_.count(webview_id) > 0) {
+    std::cerr << "Error: a texture for webview_id=" << webview_id
+              << " is already stored." << std::endl;
+    return nullptr;
+  }
+
+  FlCustomTexturePixelBuffer* texture = fl_custom_texture_pixel_buffer_new(
+      std::make_shared<FlutterWebviewPixelBuffer>());
+  if (!fl_texture_registrar_register_texture(texture_registrar,
+                                             FL_TEXTURE(texture))) {
+    std::cerr << "Error: fl_texture_registrar_register_texture() failed."
+              << std::endl;
+    g_object_unref(texture);
+    return nullptr;
+  }
+
+  pixel_buffer_texture_store_.emplace(webview_id, texture);
+  return texture;
+}
+
+void FlutterWebviewTextureManager::AddHeadlessWebview(WebviewId webview_id) {
+  headless_webviews_.insert(webview_id);
+}
+
+void FlutterWebviewTextureManager::AddMirror(WebviewId mirror_id,
+                                             WebviewId webview_id) {
+  mirrored_webviews_[mirror_id] = webview_id;
+}
+
+bool FlutterWebviewTextureManager::GetMirroredWebview(
+    WebviewId mirror_id,
+    WebviewId* webview_id) const {
+  auto it = mirrored_webviews_.find(mirror_id);
+  if (it == mirrored_webviews_.end()) {
+    return false;
+  }
+  *webview_id = it->second;
+  return true;
+}
+
+bool FlutterWebviewTextureManager::HasMirrors(WebviewId webview_id) const {
+  for (const auto& entry : mirrored_webviews_) {
+    if (entry.second == webview_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool FlutterWebviewTextureManager::PlaceInAtlas(
+    WebviewId webview_id,
+    GdkGLContext* context,
+    FlTextureRegistrar* texture_registrar,
+    int width,
+    int height,
+    int max_size,
+    AtlasRegion* region,
+    std::vector<std::pair<WebviewId, AtlasRegion>>* moved) {
+  if (texture_store_.count(webview_id) == 0 ||
+      width > FlutterWebviewTextureAtlas::kMaxRegionSize ||
+      height > FlutterWebviewTextureAtlas::kMaxRegionSize) {
+    RemoveFromAtlas(webview_id);
+    return false;
+  }
+
+  // Stay in the current atlas if possible, since moving to another one
+  // changes the texture shown on the Dart side.
+  std::vector<WebviewId> moved_ids;
+  AtlasPage* page = nullptr;
+  auto current_it = atlas_pages_by_webview_.find(webview_id);
+  AtlasPage* current = current_it != atlas_pages_by_webview_.end()
+                           ? current_it->second
+                           : nullptr;
+  if (current != nullptr &&
+      current->packer.Place(webview_id, width, height, &moved_ids)) {
+    page = current;
+  } else {
+    RemoveFromAtlas(webview_id);
+    for (const auto& candidate : atlas_pages_) {
+      moved_ids.clear();
+      if (candidate.get() != current &&
+          candidate->packer.Place(webview_id, width, height, &moved_ids)) {
+        page = candidate.get();
+        break;
+      }
+    }
+  }
+
+  if (page == nullptr) {
+    const int size = std::min(FlutterWebviewTextureAtlas::kMaxSize, max_size);
+    FlutterWebviewAtlasPacker packer(size, size,
+                                     FlutterWebviewTextureAtlas::kPadding);
+    moved_ids.clear();
+    if (!packer.Place(webview_id, width, height, &moved_ids)) {
+      return false;
+    }
+    FlCustomTextureGL* texture = TakeOrCreateAndRegisterTexture(
+        context, texture_registrar, size, size);
+    if (texture == nullptr) {
+      return false;
+    }
+    atlas_pages_.push_back(std::unique_ptr<AtlasPage>(new AtlasPage{
+        texture,
+        std::make_shared<FlutterWebviewTextureAtlas>(texture->ring, size, size),
+        packer}));
+    atlas_textures_.push_back(texture);
+    page = atlas_pages_.back().get();
+  }
+  atlas_pages_by_webview_[webview_id] = page;
+
+  page->packer.GetRegion(webview_id, &region->rect);
+  region->texture = page->texture;
+  region->atlas = page->atlas;
+  for (WebviewId moved_id : moved_ids) {
+    AtlasRegion moved_region{page->texture, page->atlas, WebviewRect{}};
+    page->packer.GetRegion(moved_id, &moved_region.rect);
+    moved->emplace_back(moved_id, moved_region);
+  }
+  return true;
+}
+
+bool FlutterWebviewTextureManager::RemoveFromAtlas(WebviewId webview_id) {
+  auto it = atlas_pages_by_webview_.find(webview_id);
+  if (it == atlas_pages_by_webview_.end()) {
+    return false;
+  }
+  it->second->packer.Remove(webview_id);
+  atlas_pages_by_webview_.erase(it);
+  return true;
+}
+
+const std::vector<FlCustomTextureGL*>&
+FlutterWebviewTextureManager::GetAtlasTextures() const {
+  return atlas_textures_;
+}
+
+FlCustomTextureGL* FlutterWebviewTextureManager::TakePooledTexture(
+    int width,
+    int height) {
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  if (pool_.empty()) {
+    pool_stats_.misses++;
     return nullptr;
   }
 
-  return flCustomTextureGL;
+  // Prefer the newest texture of the same size bucket, whose storage is likely
+  // to be reused as is. Otherwise take the newest one, whose native textures
+  // are reallocated on the first paint.
+  const int bucket_x = GetSizeBucket(width);
+  const int bucket_y = GetSizeBucket(height);
+  auto found = std::prev(pool_.end());
+  for (auto it = pool_.rbegin(); it != pool_.rend(); ++it) {
+    if (it->size_bucket_x == bucket_x && it->size_bucket_y == bucket_y) {
+      found = std::prev(it.base());
+      pool_stats_.size_matched_hits++;
+      break;
+    }
+  }
+  pool_stats_.hits++;
+
+  FlCustomTextureGL* texture = found->texture;
+  pool_.erase(found);
+  return texture;
+}
+
+// static
+int FlutterWebviewTextureManager::GetSizeBucket(int size) {
+  return (size + kSizeBucketStep - 1) / kSizeBucketStep;
 }
 
 FlCustomTextureGL* FlutterWebviewTextureManager::GetTexture(
@@ -90,6 +349,30 @@ FlCustomTextureGL* FlutterWebviewTextureManager::GetTexture(
   return it->second;
 }
 
+const std::unordered_map<WebviewId, FlCustomTextureGL*>&
+FlutterWebviewTextureManager::GetTextures() const {
+  return texture_store_;
+}
+
+FlCustomTexturePixelBuffer* FlutterWebviewTextureManager::GetPixelBufferTexture(
+    WebviewId webview_id) {
+  auto it = pixel_buffer_texture_store_.find(webview_id);
+  if (it == pixel_buffer_texture_store_.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+const std::unordered_map<WebviewId, std::vector<FlCustomTextureGL*>>&
+FlutterWebviewTextureManager::GetTileTextures() const {
+  return tile_texture_store_;
+}
+
+const std::unordered_map<WebviewId, FlCustomTexturePixelBuffer*>&
+FlutterWebviewTextureManager::GetPixelBufferTextures() const {
+  return pixel_buffer_texture_store_;
+}
+
 int64_t FlutterWebviewTextureManager::GetTextureId(FlTexture* fl_texture) {
   static_assert(sizeof(int64_t) >= sizeof(intptr_t),
                 "Must be sizeof(int64_t) >= sizeof(intptr_t)");
@@ -123,6 +406,27 @@ bool FlutterWebviewTextureManager::UnregisterAndDestroyTextureInternal(
     WebviewId webview_id,
     FlTextureRegistrar* texture_registrar,
     bool skip_unregister_texture) {
+  if (headless_webviews_.erase(webview_id) > 0) {
+    return true;
+  }
+  mirrored_webviews_.erase(webview_id);
+  RemoveFromAtlas(webview_id);
+
+  auto pixel_buffer_it = pixel_buffer_texture_store_.find(webview_id);
+  if (pixel_buffer_it != pixel_buffer_texture_store_.end()) {
+    FlCustomTexturePixelBuffer* texture = pixel_buffer_it->second;
+    if (!skip_unregister_texture &&
+        !fl_texture_registrar_unregister_texture(texture_registrar,
+                                                 FL_TEXTURE(texture))) {
+      std::cerr << "Warning: fl_texture_registrar_unregister_texture() failed"
+                << std::endl;
+    }
+    // It holds no GL objects, so it needs no reclamation.
+    pixel_buffer_texture_store_.erase(pixel_buffer_it);
+    g_object_unref(texture);
+    return true;
+  }
+
   auto it = texture_store_.find(webview_id);
   if (it == texture_store_.end()) {
     // Texture not found
@@ -131,24 +435,57 @@ bool FlutterWebviewTextureManager::UnregisterAndDestroyTextureInternal(
     return false;
   }
 
-  FlCustomTextureGL* texture = it->second;
+  std::vector<FlCustomTextureGL*> textures{it->second};
+  texture_store_.erase(it);
+  auto tiles_it = tile_texture_store_.find(webview_id);
+  if (tiles_it != tile_texture_store_.end()) {
+    textures.insert(textures.end(), tiles_it->second.begin(),
+                    tiles_it->second.end());
+    tile_texture_store_.erase(tiles_it);
+  }
 
-  if (!skip_unregister_texture) {
-    if (!fl_texture_registrar_unregister_texture(texture_registrar,
-                                                 FL_TEXTURE(texture))) {
-      std::cerr << "Warning: fl_texture_registrar_unregister_texture() failed"
-                << std::endl;
+  for (FlCustomTextureGL* texture : textures) {
+    if (!skip_unregister_texture) {
+      if (!fl_texture_registrar_unregister_texture(texture_registrar,
+                                                   FL_TEXTURE(texture))) {
+        std::cerr << "Warning: fl_texture_registrar_unregister_texture() failed"
+                  << std::endl;
+      }
     }
   }
 
-  GLuint native_texture_id[1] = {texture->native_texture_id};
-  glDeleteTextures(1, native_texture_id);
-  g_object_unref(texture);
-  texture_store_.erase(it);
+  // The native textures are recycled or deleted later by ReclaimTextures with
+  // the GL context current.
+  QueueForReclamation(textures, skip_unregister_texture);
 
   return true;
 }
 
+void FlutterWebviewTextureManager::QueueForReclamation(
+    const std::vector<FlCustomTextureGL*>& textures,
+    bool unregistered_by_flutter) {
+  const int64_t unregister_time_ns =
+      unregistered_by_flutter ? -1 : FlutterWebviewRenderStats::NowNs();
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  for (FlCustomTextureGL* texture : textures) {
+    reclaim_queue_.push_back(QueuedTexture{texture, unregister_time_ns});
+  }
+}
+
+// static
+bool FlutterWebviewTextureManager::IsReclaimable(const QueuedTexture& queued,
+                                                 int64_t now_ns) {
+  if (queued.unregister_time_ns < 0) {
+    return true;
+  }
+  // Flutter has no reference to the texture once the unregistration is done
+  // on the raster thread, and never populates it afterwards.
+  const int64_t last_use_ns = std::max(
+      queued.unregister_time_ns, queued.texture->last_populate_ns.load());
+  return queued.texture->populating.load() == 0 &&
+         now_ns - last_use_ns >= kReclaimDelayMs * INT64_C(1000000);
+}
+
 void FlutterWebviewTextureManager::UnregisterAndDestroyAllTextures(
     FlTextureRegistrar* texture_registrar,
     bool skip_unregister_texture) {
@@ -156,8 +493,140 @@ void FlutterWebviewTextureManager::UnregisterAndDestroyAllTextures(
   for (auto it = texture_store_.begin(); it != texture_store_.end(); it++) {
     keys.push_back(it->first);
   }
+  for (const auto& entry : pixel_buffer_texture_store_) {
+    keys.push_back(entry.first);
+  }
   for (WebviewId key : keys) {
     UnregisterAndDestroyTextureInternal(key, texture_registrar,
                                         skip_unregister_texture);
   }
+  headless_webviews_.clear();
+  mirrored_webviews_.clear();
+
+  for (FlCustomTextureGL* texture : atlas_textures_) {
+    if (!skip_unregister_texture &&
+        !fl_texture_registrar_unregister_texture(texture_registrar,
+                                                 FL_TEXTURE(texture))) {
+      std::cerr << "Warning: fl_texture_registrar_unregister_texture() failed"
+                << std::endl;
+    }
+  }
+  QueueForReclamation(atlas_textures_, skip_unregister_texture);
+  if (skip_unregister_texture) {
+    // Flutter has dropped all the textures, including the ones unregistered
+    // before.
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    for (QueuedTexture& queued : reclaim_queue_) {
+      queued.unregister_time_ns = -1;
+    }
+  }
+  atlas_pages_by_webview_.clear();
+  atlas_pages_.clear();
+  atlas_textures_.clear();
+}
+
+bool FlutterWebviewTextureManager::ReclaimTextures(bool keep_pooled) {
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+
+  const int64_t now_ns = FlutterWebviewRenderStats::NowNs();
+  std::vector<QueuedTexture> waiting;
+  for (const QueuedTexture& queued : reclaim_queue_) {
+    if (!IsReclaimable(queued, now_ns)) {
+      waiting.push_back(queued);
+      continue;
+    }
+    FlCustomTextureGL* texture = queued.texture;
+    if (texture->staging) {
+      // The staging buffer is never taken from a texture Flutter may
+      // populate, so the whole texture is deleted. The staging buffer goes
+      // with it when it is finalized.
+      texture->staging->ReleaseGLResources();
+      texture->ring->ReleaseTextures();
+      g_object_unref(texture);
+      continue;
+    }
+    int width, height;
+    texture->ring->GetLatestFrameSize(&width, &height);
+    texture->ring->Recycle();
+    pool_.push_back(
+        PooledTexture{texture, GetSizeBucket(width), GetSizeBucket(height)});
+  }
+  reclaim_queue_.swap(waiting);
+
+  // Over the memory budget, the pooled textures go before the textures of any
+  // webview.
+  const size_t max_pooled = keep_pooled ? kMaxPooledTextures : 0;
+  while (pool_.size() > max_pooled ||
+         (!pool_.empty() && IsOverMemoryBudget())) {
+    FlCustomTextureGL* texture = pool_.front().texture;
+    pool_.pop_front();
+    texture->ring->ReleaseTextures();
+    g_object_unref(texture);
+    pool_stats_.deleted++;
+  }
+  return !reclaim_queue_.empty();
+}
+
+FlutterWebviewTextureManager::PoolStats
+FlutterWebviewTextureManager::GetPoolStats() const {
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  PoolStats stats = pool_stats_;
+  stats.pooled = pool_.size();
+  stats.pending = reclaim_queue_.size();
+  return stats;
+}
+
+void FlutterWebviewTextureManager::SetMemoryBudget(int64_t bytes) {
+  memory_budget_bytes_.store(bytes);
+}
+
+bool FlutterWebviewTextureManager::IsOverMemoryBudget() const {
+  const int64_t budget = memory_budget_bytes_.load();
+  return budget > 0 &&
+         FlutterWebviewTextureRing::GetTotalStorageBytes() > budget;
+}
+
+bool FlutterWebviewTextureManager::HasGrownOverMemoryBudget() {
+  const int64_t total = FlutterWebviewTextureRing::GetTotalStorageBytes();
+  const int64_t previous = checked_storage_bytes_.exchange(total);
+  const int64_t budget = memory_budget_bytes_.load();
+  return budget > 0 && total > budget && total > previous;
+}
+
+std::vector<WebviewId> FlutterWebviewTextureManager::ChooseEvictions(
+    const std::vector<WebviewTextureUsage>& usages) {
+  const int64_t budget = memory_budget_bytes_.load();
+  int64_t excess = FlutterWebviewTextureRing::GetTotalStorageBytes() - budget;
+  if (budget <= 0 || excess <= 0) {
+    return {};
+  }
+
+  std::vector<WebviewTextureUsage> candidates = usages;
+  std::sort(candidates.begin(), candidates.end(),
+            [](const WebviewTextureUsage& a, const WebviewTextureUsage& b) {
+              return a.last_present_time_ns < b.last_present_time_ns;
+            });
+  std::vector<WebviewId> evictions;
+  for (const WebviewTextureUsage& candidate : candidates) {
+    if (excess <= 0) {
+      break;
+    }
+    if (candidate.bytes <= 0) {
+      continue;
+    }
+    evictions.push_back(candidate.webview_id);
+    excess -= candidate.bytes;
+  }
+  evictions_.fetch_add(evictions.size());
+  return evictions;
+}
+
+FlutterWebviewTextureManager::MemoryStats
+FlutterWebviewTextureManager::GetMemoryStats() const {
+  MemoryStats stats;
+  stats.current_bytes = FlutterWebviewTextureRing::GetTotalStorageBytes();
+  stats.peak_bytes = FlutterWebviewTextureRing::GetPeakStorageBytes();
+  stats.budget_bytes = memory_budget_bytes_.load();
+  stats.evictions = evictions_.load();
+  return stats;
 }
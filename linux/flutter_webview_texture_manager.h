@@ -32,21 +32,110 @@
 #include <flutter_linux/flutter_linux.h>
 #include <gtk/gtk.h>
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "flutter_linux_webview/fl_custom_texture_gl.h"
+#include "flutter_linux_webview/fl_custom_texture_pixel_buffer.h"
 #include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_atlas_packer.h"
+#include "flutter_webview_texture_atlas.h"
 
 // A utility class regarding fl_texture_gl. Accessed only on the platform plugin
-// thread.
+// thread, except for ReclaimTextures and the memory budget methods.
+//
+// The textures of disposed webviews are recycled: their FlCustomTextureGL goes
+// to a reclamation queue, which is drained with the plugin's GL context current
+// by ReclaimTextures. A texture stays in the queue until Flutter has not
+// populated it for kReclaimDelayMs since it was unregistered, since the
+// unregistration completes asynchronously. Then it is either prepared for
+// reuse and kept in a pool, or deleted if the pool is full. A new webview
+// takes a pooled texture of the same size bucket if any, or else any pooled
+// texture, before creating new native textures.
+//
+// A webview larger than a texture can hold has a texture per tile. The first
+// tile is drawn to the webview's texture and the others to tile textures taken
+// from the same pool, which are recycled along with it.
+//
+// Webviews drawn without a GL context use a FlCustomTexturePixelBuffer
+// instead, which holds only CPU memory and is released right away.
+//
+// Webviews uploaded by Flutter's raster thread also take a FlCustomTextureGL,
+// with a staging buffer that the raster thread reads without a lock. So the
+// staging buffer is set before the texture is registered and never changed,
+// and ReclaimTextures deletes such a texture instead of pooling it.
+//
+// A small webview may also be drawn to a region of a texture atlas shared with
+// other small webviews, while its own texture is left unused. The atlases are
+// created as needed and kept until all the textures are destroyed.
+//
+// The storage of the native textures may be kept within a memory budget. Over
+// the budget, the pooled textures are deleted first, and then the hidden
+// webviews that Flutter presented least recently shrink their textures until
+// they are shown again.
 class FlutterWebviewTextureManager {
  public:
+  // The maximum number of textures kept in the pool. Each has
+  // FlutterWebviewTextureRing::kNumSlots native textures.
+  static constexpr size_t kMaxPooledTextures = 8;
+  // The granularity in pixels of the size buckets of the pool.
+  static constexpr int kSizeBucketStep = 128;
+  // How long an unregistered texture must go without being populated before
+  // it is reclaimed. Flutter unregisters a texture on the raster thread some
+  // time after fl_texture_registrar_unregister_texture() returns, and may
+  // populate it until then.
+  static constexpr int kReclaimDelayMs = 250;
+
+  // The statistics of the texture pool.
+  struct PoolStats {
+    // The number of textures taken from the pool, out of which
+    // |size_matched_hits| had the same size bucket as requested.
+    int64_t hits = 0;
+    int64_t size_matched_hits = 0;
+    // The number of textures created because the pool was empty.
+    int64_t misses = 0;
+    // The number of textures deleted because the pool was full or the plugin
+    // was shutting down.
+    int64_t deleted = 0;
+    // The number of textures currently in the pool and waiting to be
+    // reclaimed.
+    int64_t pooled = 0;
+    int64_t pending = 0;
+  };
+
+  // The memory held by the native textures of the webviews.
+  struct MemoryStats {
+    // The bytes of texture storage, now and at most since the plugin started.
+    int64_t current_bytes = 0;
+    int64_t peak_bytes = 0;
+    // The budget set by SetMemoryBudget, 0 if unlimited.
+    int64_t budget_bytes = 0;
+    // The number of times a webview shrank its textures to meet the budget.
+    int64_t evictions = 0;
+  };
+
+  // Where a webview is drawn in a texture atlas.
+  struct AtlasRegion {
+    FlCustomTextureGL* texture;
+    std::shared_ptr<FlutterWebviewTextureAtlas> atlas;
+    WebviewRect rect;
+  };
+
   FlutterWebviewTextureManager();
 
   ///
-  /// For a given |webview_id|, creates a native texture, creates a
-  /// FlCustomTextureGL from it, registers it with the engine, and stores it.
+  /// For a given |webview_id|, takes a texture from the pool or creates a ring
+  /// of native textures and a FlCustomTextureGL from it, registers it with the
+  /// engine, and stores it. |staging|, if set, is given to the texture before
+  /// it is registered and kept until the texture is finalized; such a texture
+  /// is deleted instead of pooled when it is reclaimed.
   ///
   /// @return (transfer none): Returns the newly created FlCustomTextureGL* on
   /// success, nullptr otherwise.
@@ -56,7 +145,92 @@ class FlutterWebviewTextureManager {
       GdkGLContext* context,
       FlTextureRegistrar* texture_registrar,
       int width,
-      int height);
+      int height,
+      std::shared_ptr<FlutterWebviewStagingBuffer> staging = nullptr);
+
+  ///
+  /// Makes |num_tiles| textures available to draw the tiles of the webview
+  /// |webview_id| to. The first is its texture created by
+  /// CreateAndRegisterTexture; the others are taken from the pool or created
+  /// with room for |tile_size| x |tile_size| pixels, and registered, as
+  /// needed. The tile textures are kept until the webview is disposed, even
+  /// when fewer are needed.
+  ///
+  /// @return (transfer none): Returns the |num_tiles| textures in tile order
+  /// on success, an empty vector otherwise.
+  ///
+  std::vector<FlCustomTextureGL*> EnsureTileTextures(
+      WebviewId webview_id,
+      GdkGLContext* context,
+      FlTextureRegistrar* texture_registrar,
+      size_t num_tiles,
+      int tile_size);
+
+  ///
+  /// For a given |webview_id|, creates a FlCustomTexturePixelBuffer, registers
+  /// it with the engine, and stores it.
+  ///
+  /// @return (transfer none): Returns the newly created
+  /// FlCustomTexturePixelBuffer* on success, nullptr otherwise.
+  ///
+  FlCustomTexturePixelBuffer* CreateAndRegisterPixelBufferTexture(
+      WebviewId webview_id,
+      FlTextureRegistrar* texture_registrar);
+
+  ///
+  /// Records that the headless webview |webview_id| has no texture, so that
+  /// UnregisterAndDestroyTexture succeeds for it without doing anything.
+  ///
+  void AddHeadlessWebview(WebviewId webview_id);
+
+  ///
+  /// Records that the texture created for |mirror_id| by
+  /// CreateAndRegisterTexture mirrors the webview |webview_id|. The record is
+  /// dropped with the texture.
+  ///
+  void AddMirror(WebviewId mirror_id, WebviewId webview_id);
+
+  ///
+  /// Returns whether |mirror_id| is a mirror texture, and if so, the webview
+  /// it mirrors in |webview_id|.
+  ///
+  bool GetMirroredWebview(WebviewId mirror_id, WebviewId* webview_id) const;
+
+  ///
+  /// Returns whether a mirror texture mirrors the webview |webview_id|.
+  ///
+  bool HasMirrors(WebviewId webview_id) const;
+
+  ///
+  /// Places the webview |webview_id|, which must have a texture created by
+  /// CreateAndRegisterTexture, in a texture atlas as a |width| x |height|
+  /// region, or resizes its region. An atlas no larger than |max_size| is
+  /// created and registered if none has room. The other webviews moved to make
+  /// room are added to |moved| with their new regions.
+  ///
+  /// @return Returns true with the region in |region| on success. Otherwise,
+  /// returns false and the webview is no longer in an atlas.
+  ///
+  bool PlaceInAtlas(WebviewId webview_id,
+                    GdkGLContext* context,
+                    FlTextureRegistrar* texture_registrar,
+                    int width,
+                    int height,
+                    int max_size,
+                    AtlasRegion* region,
+                    std::vector<std::pair<WebviewId, AtlasRegion>>* moved);
+
+  ///
+  /// Removes the webview |webview_id| from its texture atlas.
+  ///
+  /// @return Returns whether it was in an atlas.
+  ///
+  bool RemoveFromAtlas(WebviewId webview_id);
+
+  ///
+  /// Returns all the texture atlases.
+  ///
+  const std::vector<FlCustomTextureGL*>& GetAtlasTextures() const;
 
   ///
   /// Get a stored texture for a given |webview_id|
@@ -75,26 +249,168 @@ class FlutterWebviewTextureManager {
   int64_t GetTextureId(FlTexture* fl_texture);
 
   ///
-  /// Unregister and delete a texture for a given |webview_id|.
+  /// Returns all the stored textures keyed by their webview IDs.
+  ///
+  const std::unordered_map<WebviewId, FlCustomTextureGL*>& GetTextures() const;
+
   ///
-  /// @return Returns if the native texture was successfully deleted.
+  /// Returns the textures of the tiles after the first one, keyed by the IDs
+  /// of the webviews split into tiles.
+  ///
+  const std::unordered_map<WebviewId, std::vector<FlCustomTextureGL*>>&
+  GetTileTextures() const;
+
+  ///
+  /// Get a stored pixel buffer texture for a given |webview_id|
+  ///
+  /// @return (transfer none): Returns a FlCustomTexturePixelBuffer*. Returns
+  /// nullptr if a texture is not found.
+  ///
+  FlCustomTexturePixelBuffer* GetPixelBufferTexture(WebviewId webview_id);
+
+  ///
+  /// Returns all the stored pixel buffer textures keyed by their webview IDs.
+  ///
+  const std::unordered_map<WebviewId, FlCustomTexturePixelBuffer*>&
+  GetPixelBufferTextures() const;
+
+  ///
+  /// Unregister a texture for a given |webview_id|, along with its tile
+  /// textures if any, and queue them for reclamation. The caller must have ReclaimTextures called later.
+  ///
+  /// @return Returns if the texture was found.
   ///
   bool UnregisterAndDestroyTexture(WebviewId webview_id,
                                    FlTextureRegistrar* texture_registrar);
 
-  /// Unregisters and deletes all registered textures.
+  /// Unregisters all registered textures and queues them for reclamation.
   /// If |skip_unregister_texture| is true, it skips calling
-  /// fl_texture_unregister_texture().
+  /// fl_texture_unregister_texture() since Flutter has dropped the textures
+  /// already, and the queued textures are reclaimed without waiting.
   void UnregisterAndDestroyAllTextures(FlTextureRegistrar* texture_registrar,
                                        bool skip_unregister_texture);
 
+  ///
+  /// Recycles or deletes the textures queued for reclamation that Flutter has
+  /// stopped populating (see kReclaimDelayMs). If |keep_pooled| is false,
+  /// deletes them and the pooled textures as well. Must be called with the GL
+  /// context given to CreateAndRegisterTexture current. May be called on any
+  /// thread.
+  ///
+  /// @return Returns whether some textures are still queued, in which case
+  /// ReclaimTextures should be called again after kReclaimDelayMs.
+  ///
+  bool ReclaimTextures(bool keep_pooled);
+
+  ///
+  /// Returns the statistics of the texture pool. May be called on any thread.
+  ///
+  PoolStats GetPoolStats() const;
+
+  ///
+  /// Sets the bytes of texture storage to stay within, or 0 for no limit. The
+  /// caller has the webviews evicted with ChooseEvictions afterwards. May be
+  /// called on any thread.
+  ///
+  void SetMemoryBudget(int64_t bytes);
+
+  ///
+  /// Returns whether the texture storage exceeds the budget. May be called on
+  /// any thread.
+  ///
+  bool IsOverMemoryBudget() const;
+
+  ///
+  /// Returns whether the texture storage exceeds the budget and has grown
+  /// since the previous call, i.e. whether a paint may have made more
+  /// evictions necessary. May be called on any thread.
+  ///
+  bool HasGrownOverMemoryBudget();
+
+  ///
+  /// Picks the webviews of |usages| that should shrink their textures to bring
+  /// the texture storage within the budget, the least recently presented
+  /// first, and counts them as evictions. May be called on any thread.
+  ///
+  std::vector<WebviewId> ChooseEvictions(
+      const std::vector<WebviewTextureUsage>& usages);
+
+  ///
+  /// Returns the texture memory statistics. May be called on any thread.
+  ///
+  MemoryStats GetMemoryStats() const;
+
  private:
+  struct PooledTexture {
+    FlCustomTextureGL* texture;
+    int size_bucket_x;
+    int size_bucket_y;
+  };
+
   bool UnregisterAndDestroyTextureInternal(
       WebviewId webview_id,
       FlTextureRegistrar* texture_registrar,
       bool skip_unregister_texture);
 
+  // Takes a texture from the pool or creates one, gives it |staging| and
+  // registers it. Returns nullptr if it could not be registered.
+  FlCustomTextureGL* TakeOrCreateAndRegisterTexture(
+      GdkGLContext* context,
+      FlTextureRegistrar* texture_registrar,
+      int width,
+      int height,
+      std::shared_ptr<FlutterWebviewStagingBuffer> staging = nullptr);
+
+  // Takes a texture from the pool. Returns nullptr if the pool is empty.
+  FlCustomTextureGL* TakePooledTexture(int width, int height);
+
+  static int GetSizeBucket(int size);
+
+  // A texture waiting for Flutter to stop populating it.
+  struct QueuedTexture {
+    FlCustomTextureGL* texture;
+    // When it was unregistered, or -1 if Flutter has dropped it already.
+    int64_t unregister_time_ns;
+  };
+
+  // Queues |textures| for reclamation.
+  void QueueForReclamation(const std::vector<FlCustomTextureGL*>& textures,
+                           bool unregistered_by_flutter);
+
+  // Returns whether Flutter has stopped populating |queued|.
+  static bool IsReclaimable(const QueuedTexture& queued, int64_t now_ns);
+
+  struct AtlasPage {
+    FlCustomTextureGL* texture;
+    std::shared_ptr<FlutterWebviewTextureAtlas> atlas;
+    FlutterWebviewAtlasPacker packer;
+  };
+
   std::unordered_map<WebviewId, FlCustomTextureGL*> texture_store_;
+  std::unordered_map<WebviewId, std::vector<FlCustomTextureGL*>>
+      tile_texture_store_;
+  std::unordered_map<WebviewId, FlCustomTexturePixelBuffer*>
+      pixel_buffer_texture_store_;
+  std::unordered_set<WebviewId> headless_webviews_;
+  // The webviews mirrored by the mirror textures, keyed by the mirror IDs.
+  std::unordered_map<WebviewId, WebviewId> mirrored_webviews_;
+  std::vector<std::unique_ptr<AtlasPage>> atlas_pages_;
+  // The textures of |atlas_pages_|, in the same order.
+  std::vector<FlCustomTextureGL*> atlas_textures_;
+  // The atlases the webviews are drawn to, keyed by the webview IDs.
+  std::unordered_map<WebviewId, AtlasPage*> atlas_pages_by_webview_;
+
+  // Guards the members below, which are shared with ReclaimTextures.
+  mutable std::mutex pool_mutex_;
+  std::vector<QueuedTexture> reclaim_queue_;
+  // The oldest pooled texture first.
+  std::deque<PooledTexture> pool_;
+  PoolStats pool_stats_;
+
+  std::atomic<int64_t> memory_budget_bytes_;
+  std::atomic<int64_t> evictions_;
+  // The texture storage seen by the previous HasGrownOverMemoryBudget.
+  std::atomic<int64_t> checked_storage_bytes_;
 };
 
 #endif  // LINUX_FLUTTER_WEBVIEW_TEXTURE_MANAGER_H_
@@ -0,0 +1,786 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_texture_ring.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_gl_utils.h"
+#include "flutter_webview_pixel_conversion.h"
+#include "flutter_webview_texture_format.h"
+
+namespace {
+
+// Above this number, the stale regions of a texture are replaced with their
+// bounding box.
+constexpr size_t kMaxStaleRects = 16;
+
+// The size of a texel of the formats the textures are allocated with.
+constexpr int64_t kBytesPerTexel = 4;
+
+// The storage of all the rings.
+std::atomic<int64_t> g_total_storage_bytes{0};
+std::atomic<int64_t> g_peak_storage_bytes{0};
+
+bool IsSignaled(GLsync fence) {
+  if (fence == nullptr) {
+    // Fences are not supported. The texture is used as soon as it is published
+    // as it was before the ring was introduced.
+    return true;
+  }
+  const GLenum result = glClientWaitSync(fence, 0, 0);
+  return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+GLsync CreateFence() {
+  if (!flutter_webview_gl::GetCapabilities().has_sync) {
+    return nullptr;
+  }
+  GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  VERIFY_GL_NO_ERROR;
+  return fence;
+}
+
+void DeleteFence(GLsync* fence) {
+  if (*fence != nullptr) {
+    glDeleteSync(*fence);
+    *fence = nullptr;
+  }
+}
+
+WebviewRect BoundingBoxOf(const std::vector<WebviewRect>& rects) {
+  int left = rects[0].x;
+  int top = rects[0].y;
+  int right = rects[0].x + rects[0].width;
+  int bottom = rects[0].y + rects[0].height;
+  for (const WebviewRect& rect : rects) {
+    left = std::min(left, rect.x);
+    top = std::min(top, rect.y);
+    right = std::max(right, rect.x + rect.width);
+    bottom = std::max(bottom, rect.y + rect.height);
+  }
+  return WebviewRect{left, top, right - left, bottom - top};
+}
+
+}  // namespace
+
+constexpr int FlutterWebviewTextureRing::kNumSlots;
+constexpr int FlutterWebviewTextureRing::kCapacityStep;
+
+FlutterWebviewTextureRing::FlutterWebviewTextureRing(
+    GLenum target,
+    const std::array<GLuint, kNumSlots>& textures)
+    : target_(target),
+      last_sequence_(0),
+      presented_slot_(-1),
+      published_sequence_(0),
+      presented_sequence_(0),
+      frame_available_pending_(false),
+      last_publish_time_ns_(0),
+      last_present_time_ns_(0),
+      storage_bytes_(0),
+      writing_slot_(-1),
+      latest_slot_(-1),
+      initial_texture_(0),
+      read_framebuffer_(0),
+      draw_framebuffer_(0) {
+  for (int i = 0; i < kNumSlots; ++i) {
+    slots_[i].texture = textures[i];
+  }
+
+  // Shown until the first frame is taken. Nothing writes it afterwards, so it
+  // needs no fence.
+  glGenTextures(1, &initial_texture_);
+  glBindTexture(target_, initial_texture_);
+  flutter_webview_gl::AllocateTextureImage(target_, 1, 1);
+  VERIFY_GL_NO_ERROR;
+  ClearTexture(initial_texture_);
+  glFlush();
+}
+
+FlutterWebviewTextureRing::~FlutterWebviewTextureRing() {
+  if (read_framebuffer_ != 0 || slots_[0].texture != 0) {
+    std::cerr << "Warning: FlutterWebviewTextureRing is destroyed without "
+                 "releasing its GL objects. They are leaked."
+              << std::endl;
+  }
+}
+
+// static
+GLenum FlutterWebviewTextureRing::ChooseTarget() {
+  return flutter_webview_gl::GetCapabilities().has_texture_rectangle
+             ? GL_TEXTURE_RECTANGLE
+             : GL_TEXTURE_2D;
+}
+
+// static
+int64_t FlutterWebviewTextureRing::GetTotalStorageBytes() {
+  return g_total_storage_bytes.load();
+}
+
+// static
+int64_t FlutterWebviewTextureRing::GetPeakStorageBytes() {
+  return g_peak_storage_bytes.load();
+}
+
+// static
+int FlutterWebviewTextureRing::GetMaxFrameSize(GLenum target) {
+  const flutter_webview_gl::Capabilities& caps =
+      flutter_webview_gl::GetCapabilities();
+  return target == GL_TEXTURE_RECTANGLE ? caps.max_rectangle_texture_size
+                                        : caps.max_texture_size;
+}
+
+bool FlutterWebviewTextureRing::HasFrame() const {
+  return latest_slot_ >= 0;
+}
+
+FlutterWebviewTextureRing::Frame FlutterWebviewTextureRing::BeginWrite() {
+  if (writing_slot_ >= 0) {
+    std::cerr << "Error: FlutterWebviewTextureRing::BeginWrite() is called "
+                 "twice without EndWrite()."
+              << std::endl;
+    const Slot& slot = slots_[writing_slot_];
+    return Frame{slot.texture, slot.width, slot.height};
+  }
+
+  GLsync write_fence = nullptr;
+  GLsync read_fence = nullptr;
+  bool superseded = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Take a free slot, or else the oldest published frame. At most one slot
+    // is presented, so if none is free, at least two frames are published and
+    // the oldest one has been superseded without being shown.
+    int slot_index = -1;
+    for (int i = 0; i < kNumSlots; ++i) {
+      const Slot& slot = slots_[i];
+      if (slot.state == SlotState::kFree) {
+        slot_index = i;
+        break;
+      }
+      if (slot.state == SlotState::kPublished &&
+          (slot_index < 0 || slot.sequence < slots_[slot_index].sequence)) {
+        slot_index = i;
+      }
+    }
+
+    Slot& slot = slots_[slot_index];
+    superseded = slot.state == SlotState::kPublished;
+    slot.state = SlotState::kWriting;
+    std::swap(write_fence, slot.write_fence);
+    std::swap(read_fence, slot.read_fence);
+    writing_slot_ = slot_index;
+  }
+
+  if (superseded && FlutterWebviewRenderStats::IsEnabled()) {
+    render_stats_.RecordSupersededFrames(1);
+  }
+
+  DeleteFence(&write_fence);
+  if (read_fence != nullptr) {
+    // Make the GPU wait until the raster thread has finished sampling this
+    // texture before writing it. This does not block the calling thread.
+    glWaitSync(read_fence, 0, GL_TIMEOUT_IGNORED);
+    DeleteFence(&read_fence);
+  }
+
+  Slot& slot = slots_[writing_slot_];
+  CatchUp(&slot);
+  return Frame{slot.texture, slot.width, slot.height};
+}
+
+FlutterWebviewTextureRing::Frame FlutterWebviewTextureRing::ReserveStorage(
+    int width,
+    int height) {
+  if (writing_slot_ < 0) {
+    std::cerr << "Error: FlutterWebviewTextureRing::ReserveStorage() is called "
+                 "without BeginWrite()."
+              << std::endl;
+    return Frame{0, 0, 0};
+  }
+
+  Slot& slot = slots_[writing_slot_];
+  AllocateStorage(&slot, width, height);
+  return Frame{slot.texture, slot.width, slot.height};
+}
+
+void FlutterWebviewTextureRing::AllocateStorage(Slot* slot,
+                                                int width,
+                                                int height) {
+  int capacity_width = width;
+  int capacity_height = height;
+  bool fits = width == slot->capacity_width && height == slot->capacity_height;
+  if (target_ == GL_TEXTURE_RECTANGLE) {
+    const int max_size =
+        flutter_webview_gl::GetCapabilities().max_rectangle_texture_size;
+    auto round_up = [max_size](int size) {
+      const int rounded = (size + kCapacityStep - 1) / kCapacityStep *
+                          kCapacityStep;
+      return std::max(size, std::min(rounded, max_size));
+    };
+    capacity_width = round_up(width);
+    capacity_height = round_up(height);
+    // Shrink the storage only when it is more than twice as large as needed,
+    // so that going back and forth across a step does not reallocate.
+    fits = width <= slot->capacity_width && height <= slot->capacity_height &&
+           slot->capacity_width <= capacity_width * 2 &&
+           slot->capacity_height <= capacity_height * 2;
+  }
+  if (fits) {
+    return;
+  }
+  ReplaceStorage(slot, capacity_width, capacity_height);
+}
+
+void FlutterWebviewTextureRing::ReplaceStorage(Slot* slot,
+                                               int capacity_width,
+                                               int capacity_height) {
+  if (target_ == GL_TEXTURE_RECTANGLE &&
+      flutter_webview_gl::GetCapabilities().has_texture_storage) {
+    // Immutable storage cannot be reallocated, so replace the texture. The
+    // raster thread does not sample the texture being written.
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(target_, texture);
+    glTexStorage2D(target_, 1,
+                   flutter_webview_gl::GetTextureFormat().internal_format,
+                   capacity_width, capacity_height);
+    VERIFY_GL_NO_ERROR;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::swap(texture, slot->texture);
+    }
+    glDeleteTextures(1, &texture);
+  } else {
+    glBindTexture(target_, slot->texture);
+    flutter_webview_gl::AllocateTextureImage(target_, capacity_width,
+                                             capacity_height);
+    VERIFY_GL_NO_ERROR;
+  }
+  SetCapacity(slot, capacity_width, capacity_height);
+}
+
+void FlutterWebviewTextureRing::SetCapacity(Slot* slot,
+                                            int capacity_width,
+                                            int capacity_height) {
+  const int64_t delta =
+      (static_cast<int64_t>(capacity_width) * capacity_height -
+       static_cast<int64_t>(slot->capacity_width) * slot->capacity_height) *
+      kBytesPerTexel;
+  slot->capacity_width = capacity_width;
+  slot->capacity_height = capacity_height;
+  storage_bytes_.fetch_add(delta);
+  const int64_t total = g_total_storage_bytes.fetch_add(delta) + delta;
+  int64_t peak = g_peak_storage_bytes.load();
+  while (total > peak &&
+         !g_peak_storage_bytes.compare_exchange_weak(peak, total)) {
+  }
+}
+
+void FlutterWebviewTextureRing::EndWrite(
+    int width,
+    int height,
+    const std::vector<WebviewRect>& damage) {
+  if (writing_slot_ < 0) {
+    std::cerr << "Error: FlutterWebviewTextureRing::EndWrite() is called "
+                 "without BeginWrite()."
+              << std::endl;
+    return;
+  }
+
+  // Submit the upload so that the raster thread sees the fence signaled as soon
+  // as the GPU has completed it.
+  GLsync write_fence = CreateFence();
+  glFlush();
+
+  int64_t publish_time_ns = 0;
+  if (FlutterWebviewRenderStats::IsEnabled()) {
+    publish_time_ns = FlutterWebviewRenderStats::NowNs();
+    render_stats_.RecordPublishedFrame();
+  }
+
+  for (int i = 0; i < kNumSlots; ++i) {
+    if (i == writing_slot_) {
+      continue;
+    }
+    std::vector<WebviewRect>& stale_rects = slots_[i].stale_rects;
+    stale_rects.insert(stale_rects.end(), damage.begin(), damage.end());
+    if (stale_rects.size() > kMaxStaleRects) {
+      stale_rects.assign(1, BoundingBoxOf(stale_rects));
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slots_[writing_slot_];
+    slot.width = width;
+    slot.height = height;
+    slot.state = SlotState::kPublished;
+    slot.sequence = ++last_sequence_;
+    slot.write_fence = write_fence;
+    slot.publish_time_ns = publish_time_ns;
+    slot.stale_rects.clear();
+    last_publish_time_ns_.store(publish_time_ns);
+    published_sequence_.store(slot.sequence);
+  }
+
+  latest_slot_ = writing_slot_;
+  writing_slot_ = -1;
+}
+
+void FlutterWebviewTextureRing::CatchUp(Slot* slot) {
+  if (latest_slot_ < 0 || &slots_[latest_slot_] == slot) {
+    slot->stale_rects.clear();
+    return;
+  }
+  const Slot& latest = slots_[latest_slot_];
+
+  if (slot->width != latest.width || slot->height != latest.height) {
+    // Copy the whole frame, reallocating the storage if it does not fit.
+    AllocateStorage(slot, latest.width, latest.height);
+    slot->width = latest.width;
+    slot->height = latest.height;
+    slot->stale_rects.assign(1, WebviewRect{0, 0, latest.width, latest.height});
+  }
+
+  if (slot->stale_rects.empty()) {
+    return;
+  }
+
+  if (read_framebuffer_ == 0) {
+    glGenFramebuffers(1, &read_framebuffer_);
+    glGenFramebuffers(1, &draw_framebuffer_);
+  }
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer_);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                         target_, latest.texture, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer_);
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                         target_, slot->texture, 0);
+  VERIFY_GL_NO_ERROR;
+
+  for (const WebviewRect& rect : slot->stale_rects) {
+    // The rects of a frame larger than the current one are clipped.
+    const int left = std::max(rect.x, 0);
+    const int top = std::max(rect.y, 0);
+    const int right = std::min(rect.x + rect.width, slot->width);
+    const int bottom = std::min(rect.y + rect.height, slot->height);
+    if (left >= right || top >= bottom) {
+      continue;
+    }
+    glBlitFramebuffer(left, top, right, bottom, left, top, right, bottom,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+  }
+  VERIFY_GL_NO_ERROR;
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  slot->stale_rects.clear();
+}
+
+void FlutterWebviewTextureRing::CopyToFrame(GLuint texture,
+                                            const WebviewRect& rect,
+                                            int x,
+                                            int y) {
+  if (writing_slot_ < 0) {
+    std::cerr << "Error: FlutterWebviewTextureRing::CopyToFrame() is called "
+                 "without BeginWrite()."
+              << std::endl;
+    return;
+  }
+  BlitToFrame(texture, rect, WebviewRect{x, y, rect.width, rect.height},
+              GL_NEAREST);
+}
+
+void FlutterWebviewTextureRing::ScaleToFrame(GLuint texture,
+                                             const WebviewRect& source,
+                                             const WebviewRect& destination) {
+  if (writing_slot_ < 0) {
+    std::cerr << "Error: FlutterWebviewTextureRing::ScaleToFrame() is called "
+                 "without BeginWrite()."
+              << std::endl;
+    return;
+  }
+  BlitToFrame(texture, source, destination, GL_LINEAR);
+}
+
+void FlutterWebviewTextureRing::BlitToFrame(GLuint texture,
+                                            const WebviewRect& source,
+                                            const WebviewRect& destination,
+                                            GLenum filter) {
+  if (read_framebuffer_ == 0) {
+    glGenFramebuffers(1, &read_framebuffer_);
+    glGenFramebuffers(1, &draw_framebuffer_);
+  }
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer_);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target_,
+                         texture, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer_);
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target_,
+                         slots_[writing_slot_].texture, 0);
+  VERIFY_GL_NO_ERROR;
+
+  glBlitFramebuffer(source.x, source.y, source.x + source.width,
+                    source.y + source.height, destination.x, destination.y,
+                    destination.x + destination.width,
+                    destination.y + destination.height, GL_COLOR_BUFFER_BIT,
+                    filter);
+  VERIFY_GL_NO_ERROR;
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+}
+
+void FlutterWebviewTextureRing::ReleaseFramebuffers() {
+  if (read_framebuffer_ != 0) {
+    glDeleteFramebuffers(1, &read_framebuffer_);
+    glDeleteFramebuffers(1, &draw_framebuffer_);
+    read_framebuffer_ = 0;
+    draw_framebuffer_ = 0;
+  }
+}
+
+void FlutterWebviewTextureRing::GetLatestFrameSize(int* width,
+                                                   int* height) const {
+  if (latest_slot_ < 0) {
+    *width = 0;
+    *height = 0;
+    return;
+  }
+  *width = slots_[latest_slot_].width;
+  *height = slots_[latest_slot_].height;
+}
+
+GLuint FlutterWebviewTextureRing::GetLatestTexture() const {
+  return latest_slot_ >= 0 ? slots_[latest_slot_].texture : 0;
+}
+
+bool FlutterWebviewTextureRing::ReadLatestFrame(std::vector<uint8_t>* bgra) {
+  if (latest_slot_ < 0) {
+    return false;
+  }
+  const Slot& latest = slots_[latest_slot_];
+
+  if (read_framebuffer_ == 0) {
+    glGenFramebuffers(1, &read_framebuffer_);
+    glGenFramebuffers(1, &draw_framebuffer_);
+  }
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer_);
+  glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target_,
+                         latest.texture, 0);
+  // GL_RGBA / GL_UNSIGNED_BYTE is the combination every context can read.
+  bgra->resize(static_cast<size_t>(latest.width) * latest.height *
+               kBytesPerTexel);
+  glReadPixels(0, 0, latest.width, latest.height, GL_RGBA, GL_UNSIGNED_BYTE,
+               bgra->data());
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  VERIFY_GL_NO_ERROR;
+
+  // Swapping the first and third bytes converts RGBA back to BGRA.
+  flutter_webview_pixels::ConvertBGRAToRGBA(
+      bgra->data(), bgra->data(),
+      static_cast<size_t>(latest.width) * latest.height);
+  return true;
+}
+
+void FlutterWebviewTextureRing::Recycle() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Slot& slot : slots_) {
+      DeleteFence(&slot.write_fence);
+      if (slot.read_fence != nullptr) {
+        glWaitSync(slot.read_fence, 0, GL_TIMEOUT_IGNORED);
+        DeleteFence(&slot.read_fence);
+      }
+      slot.state = SlotState::kFree;
+      slot.sequence = 0;
+      slot.publish_time_ns = 0;
+      slot.stale_rects.clear();
+    }
+    last_sequence_ = 0;
+    presented_slot_ = -1;
+    on_presented_ = nullptr;
+    published_sequence_.store(0);
+    presented_sequence_.store(0);
+    frame_available_pending_.store(false);
+    last_publish_time_ns_.store(0);
+  }
+  writing_slot_ = -1;
+  latest_slot_ = -1;
+  render_stats_.Reset();
+  last_present_time_ns_.store(0);
+}
+
+bool FlutterWebviewTextureRing::ReleaseStorage() {
+  if (writing_slot_ >= 0) {
+    std::cerr << "Error: FlutterWebviewTextureRing::ReleaseStorage() is called "
+                 "between BeginWrite() and EndWrite()."
+              << std::endl;
+    return false;
+  }
+
+  // The texture Flutter populated last. Its image may still be drawn until
+  // Flutter populates the texture again. None if Flutter still shows the
+  // initial texture.
+  int shown_slot = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shown_slot = presented_slot_;
+    for (int i = 0; i < kNumSlots; ++i) {
+      if (i == shown_slot) {
+        continue;
+      }
+      Slot& slot = slots_[i];
+      DeleteFence(&slot.write_fence);
+      if (slot.read_fence != nullptr) {
+        glWaitSync(slot.read_fence, 0, GL_TIMEOUT_IGNORED);
+        DeleteFence(&slot.read_fence);
+      }
+      slot.width = 0;
+      slot.height = 0;
+      slot.state = SlotState::kFree;
+      slot.sequence = 0;
+      slot.publish_time_ns = 0;
+      slot.stale_rects.clear();
+    }
+  }
+  latest_slot_ = -1;
+
+  for (int i = 0; i < kNumSlots; ++i) {
+    Slot& slot = slots_[i];
+    if (i != shown_slot &&
+        (slot.capacity_width > 1 || slot.capacity_height > 1)) {
+      ReplaceStorage(&slot, 1, 1);
+    }
+  }
+
+  if (shown_slot < 0 || (slots_[shown_slot].capacity_width <= 1 &&
+                         slots_[shown_slot].capacity_height <= 1)) {
+    // Flutter shows the initial texture or a released texture already. Forget
+    // the frames dropped above so that Flutter is not asked for them.
+    std::lock_guard<std::mutex> lock(mutex_);
+    presented_sequence_.store(published_sequence_.load());
+    frame_available_pending_.store(false);
+    return false;
+  }
+
+  // Have Flutter move to a cleared frame so that the shown texture can be
+  // released afterwards.
+  Slot& cleared = slots_[(shown_slot + 1) % kNumSlots];
+  if (cleared.capacity_width == 0 || cleared.capacity_height == 0) {
+    ReplaceStorage(&cleared, 1, 1);
+  }
+  ClearTexture(cleared.texture);
+  GLsync write_fence = CreateFence();
+  glFlush();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cleared.width = 1;
+    cleared.height = 1;
+    cleared.state = SlotState::kPublished;
+    cleared.sequence = ++last_sequence_;
+    cleared.write_fence = write_fence;
+    cleared.publish_time_ns = 0;
+    published_sequence_.store(cleared.sequence);
+  }
+  return true;
+}
+
+void FlutterWebviewTextureRing::ClearTexture(GLuint texture) {
+  GLuint framebuffer = 0;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target_,
+                         texture, 0);
+  glClearColor(0, 0, 0, 0);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &framebuffer);
+  VERIFY_GL_NO_ERROR;
+}
+
+bool FlutterWebviewTextureRing::AcquireLatestFrame(Frame* frame) {
+  // Flutter is consuming the notified frame, so the next one is worth a new
+  // notification.
+  frame_available_pending_.store(false);
+
+  bool created_read_fence = false;
+  bool has_frame = false;
+  int superseded_frames = 0;
+  int64_t presented_publish_time_ns = 0;
+  std::function<void()> on_presented;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Find the newest published frame whose upload has completed.
+    int completed_slot = -1;
+    for (int i = 0; i < kNumSlots; ++i) {
+      const Slot& slot = slots_[i];
+      if (slot.state != SlotState::kPublished ||
+          (completed_slot >= 0 &&
+           slot.sequence < slots_[completed_slot].sequence)) {
+        continue;
+      }
+      if (IsSignaled(slot.write_fence)) {
+        completed_slot = i;
+      }
+    }
+
+    if (completed_slot >= 0) {
+      // Release the frames superseded by the completed one. They have never
+      // been sampled.
+      for (Slot& slot : slots_) {
+        if (slot.state == SlotState::kPublished &&
+            slot.sequence < slots_[completed_slot].sequence) {
+          slot.state = SlotState::kFree;
+          ++superseded_frames;
+        }
+      }
+      if (presented_slot_ >= 0) {
+        // The commands sampling the previous texture have been issued by now.
+        // The writer waits for this fence before reusing it.
+        Slot& previous = slots_[presented_slot_];
+        previous.read_fence = CreateFence();
+        previous.state = SlotState::kFree;
+        created_read_fence = true;
+      }
+      slots_[completed_slot].state = SlotState::kPresented;
+      presented_publish_time_ns = slots_[completed_slot].publish_time_ns;
+      presented_slot_ = completed_slot;
+      presented_sequence_.store(slots_[completed_slot].sequence);
+      last_present_time_ns_.store(FlutterWebviewRenderStats::NowNs());
+      if (slots_[completed_slot].sequence == last_sequence_) {
+        on_presented = std::move(on_presented_);
+        on_presented_ = nullptr;
+      }
+    }
+
+    if (presented_slot_ >= 0) {
+      const Slot& slot = slots_[presented_slot_];
+      *frame = Frame{slot.texture, slot.width, slot.height};
+      has_frame = true;
+    }
+  }
+
+  if (created_read_fence) {
+    // Submit the fence so that the writer's wait can complete.
+    glFlush();
+  }
+
+  if (on_presented) {
+    on_presented();
+  }
+
+  // A frame published while the stats were disabled has no publish time.
+  if (FlutterWebviewRenderStats::IsEnabled()) {
+    if (superseded_frames > 0) {
+      render_stats_.RecordSupersededFrames(superseded_frames);
+    }
+    if (presented_publish_time_ns > 0) {
+      render_stats_.RecordPresentLatency(FlutterWebviewRenderStats::NowNs() -
+                                         presented_publish_time_ns);
+    }
+  }
+  return has_frame;
+}
+
+bool FlutterWebviewTextureRing::DeferUntilPresented(
+    std::function<void()> on_presented) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Checked under the lock so that the frame cannot be taken in between.
+  if (presented_sequence_.load() >= last_sequence_) {
+    return false;
+  }
+  on_presented_ = std::move(on_presented);
+  return true;
+}
+
+void FlutterWebviewTextureRing::CancelDeferral() {
+  std::function<void()> on_presented;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    on_presented = std::move(on_presented_);
+    on_presented_ = nullptr;
+  }
+  // Destroyed outside the lock, since it may hold the last reference to the
+  // writer.
+}
+
+bool FlutterWebviewTextureRing::HasUnpresentedFrame() const {
+  return published_sequence_.load() > presented_sequence_.load();
+}
+
+bool FlutterWebviewTextureRing::TakeFrameAvailableNotification() {
+  if (!NeedsFrameAvailableNotification()) {
+    return false;
+  }
+  frame_available_pending_.store(true);
+
+  const int64_t publish_time_ns = last_publish_time_ns_.load();
+  if (publish_time_ns > 0 && FlutterWebviewRenderStats::IsEnabled()) {
+    render_stats_.RecordNotifyLatency(FlutterWebviewRenderStats::NowNs() -
+                                      publish_time_ns);
+  }
+  return true;
+}
+
+bool FlutterWebviewTextureRing::NeedsFrameAvailableNotification() const {
+  return !frame_available_pending_.load() && HasUnpresentedFrame();
+}
+
+GLuint FlutterWebviewTextureRing::GetInitialTexture() const {
+  return initial_texture_;
+}
+
+void FlutterWebviewTextureRing::ReleaseTextures() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Slot& slot : slots_) {
+    DeleteFence(&slot.write_fence);
+    DeleteFence(&slot.read_fence);
+    if (slot.texture != 0) {
+      glDeleteTextures(1, &slot.texture);
+      slot.texture = 0;
+    }
+    SetCapacity(&slot, 0, 0);
+  }
+  if (initial_texture_ != 0) {
+    glDeleteTextures(1, &initial_texture_);
+    initial_texture_ = 0;
+  }
+}
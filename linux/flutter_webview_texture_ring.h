@@ -0,0 +1,319 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_TEXTURE_RING_H_
+#define LINUX_FLUTTER_WEBVIEW_TEXTURE_RING_H_
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_render_stats.h"
+
+// The textures of a webview, written by the browser on the CEF UI thread and
+// sampled by Flutter on the raster thread.
+//
+// The webview is drawn to a ring of three textures so that the browser never
+// writes the texture Flutter is sampling. Each published frame carries a fence
+// signaled when its upload has completed on the GPU; the raster thread takes
+// the newest frame whose fence is signaled and keeps showing the previous one
+// otherwise. When the raster thread moves to a newer frame, it leaves a fence
+// after its last read of the older texture, and the writer makes the GPU wait
+// for that fence before reusing the texture. Neither thread blocks on the
+// other: the lock only guards the bookkeeping and all the waits are on the GPU.
+//
+// A texture being reused is missing the frames published since it was last
+// written. BeginWrite copies those regions from the latest frame on the GPU, so
+// the browser only uploads its own dirty rectangles.
+//
+// Where available, the textures are GL_TEXTURE_RECTANGLE textures whose
+// storage is allocated in steps of kCapacityStep pixels, with immutable storage
+// if possible. A frame is drawn at the top-left corner of the storage and
+// Flutter samples rectangle textures in texel coordinates, so only the frame
+// region is shown and resizing within the capacity costs no reallocation.
+// GL_TEXTURE_2D textures are sampled in normalized coordinates, so their
+// storage always has the exact size of the frame.
+//
+// The storage of all the rings is accounted in a process-wide counter, so that
+// the texture memory can be kept within a budget by releasing the storage of
+// the rings that are not shown.
+class FlutterWebviewTextureRing {
+ public:
+  static constexpr int kNumSlots = 3;
+  static constexpr int kCapacityStep = 256;
+
+  struct Frame {
+    GLuint texture;
+    // The size of the frame drawn to the texture, 0 if nothing is drawn yet.
+    // The texture storage may be larger.
+    int width;
+    int height;
+  };
+
+  // Takes the ownership of |textures|, which must be created in the share
+  // group of the writer and the raster GL contexts and not be bound yet.
+  // |target| is the target the textures are used with. Must be called with
+  // the GL context of the plugin current, since the initial texture is
+  // created here.
+  FlutterWebviewTextureRing(GLenum target,
+                            const std::array<GLuint, kNumSlots>& textures);
+  ~FlutterWebviewTextureRing();
+
+  // Returns GL_TEXTURE_RECTANGLE if the GL context current on the calling
+  // thread supports it, GL_TEXTURE_2D otherwise.
+  static GLenum ChooseTarget();
+
+  // Returns the largest width and height of a frame that a texture of |target|
+  // can hold with the GL context current on the calling thread. Larger views
+  // are split into tiles of this size.
+  static int GetMaxFrameSize(GLenum target);
+
+  // Returns the bytes of texture storage held by all the rings, now and at
+  // most since the process started. May be called on any thread.
+  static int64_t GetTotalStorageBytes();
+  static int64_t GetPeakStorageBytes();
+
+  GLenum target() const { return target_; }
+
+  // Returns the bytes of texture storage held by this ring. May be called on
+  // any thread.
+  int64_t storage_bytes() const { return storage_bytes_.load(); }
+
+  // Returns when AcquireLatestFrame last took a frame of this ring, in the
+  // clock of FlutterWebviewRenderStats::NowNs(), or 0 if it never did. May be
+  // called on any thread.
+  int64_t last_present_time_ns() const { return last_present_time_ns_.load(); }
+
+  // The statistics of the frames going through this ring. The ring records the
+  // publication and presentation of the frames; the writer records its paints.
+  FlutterWebviewRenderStats& render_stats() { return render_stats_; }
+
+  // Writer side. Must be called on the CEF UI thread with the GL context of
+  // the plugin current.
+
+  // Returns whether a frame has been published.
+  bool HasFrame() const;
+
+  // Returns the texture to draw the next frame to, which already holds the
+  // latest published frame. Must be followed by EndWrite.
+  Frame BeginWrite();
+
+  // Makes the storage of the texture returned by BeginWrite large enough for
+  // a |width| x |height| frame. Returns the texture, which is replaced if its
+  // immutable storage had to be reallocated, and whose contents are undefined
+  // after a reallocation.
+  Frame ReserveStorage(int width, int height);
+
+  // Copies |rect| of |texture|, which must have the same target as the ring,
+  // to (|x|, |y|) of the texture returned by BeginWrite on the GPU.
+  void CopyToFrame(GLuint texture, const WebviewRect& rect, int x, int y);
+
+  // Draws |source| of |texture|, which must have the same target as the ring,
+  // to |destination| of the texture returned by BeginWrite on the GPU, scaled
+  // with linear filtering.
+  void ScaleToFrame(GLuint texture,
+                    const WebviewRect& source,
+                    const WebviewRect& destination);
+
+  // Publishes the frame drawn since BeginWrite. |width| x |height| is the size
+  // of the frame and |damage| is the region that differs from the previous
+  // frame.
+  void EndWrite(int width, int height, const std::vector<WebviewRect>& damage);
+
+  // If a published frame has not been taken by AcquireLatestFrame yet, stores
+  // |on_presented| to be called on the raster thread once the latest frame is
+  // taken, and returns true. Otherwise returns false and does not store it.
+  // Replaces the callback stored before, if any. Lets the writer hold back its
+  // uploads while Flutter is behind.
+  bool DeferUntilPresented(std::function<void()> on_presented);
+
+  // Drops the callback stored by DeferUntilPresented, if any.
+  void CancelDeferral();
+
+  // Deletes the framebuffers used to copy between the textures.
+  void ReleaseFramebuffers();
+
+  // Returns the size of the latest published frame, or 0 x 0 if no frame has
+  // been published.
+  void GetLatestFrameSize(int* width, int* height) const;
+
+  // Returns the texture of the latest published frame, or 0 if no frame has
+  // been published. It may be read until the next BeginWrite.
+  GLuint GetLatestTexture() const;
+
+  // Reads the latest published frame back to |bgra| as BGRA, of the size
+  // returned by GetLatestFrameSize, waiting for the GPU. Returns false if no
+  // frame has been published.
+  bool ReadLatestFrame(std::vector<uint8_t>* bgra);
+
+  // Shrinks the storage of the textures to 1 x 1 and forgets the frames, so
+  // that the ring holds almost no memory until the next frame reallocates it.
+  // The next frame has to be drawn in full.
+  //
+  // The texture Flutter took last is kept as it is since Flutter may still
+  // sample it. Instead, a cleared 1 x 1 frame is published for Flutter to take
+  // the next time it populates the texture, and true is returned.
+  // ReleaseStorage should then be called again once that frame is presented
+  // (see DeferUntilPresented) to release the texture Flutter has left. If
+  // Flutter has taken no frame, it shows the initial texture and all the
+  // textures are released at once.
+  bool ReleaseStorage();
+
+  // Makes the ring reusable for another webview after both sides have
+  // finished with it. The textures keep their storage, and the previous
+  // contents are never shown since no frame is published.
+  void Recycle();
+
+  // Reader side. Must be called on the raster thread with the GL context of
+  // Flutter current.
+
+  // Returns the newest frame whose upload has completed in |frame|, or false
+  // if no frame has completed yet.
+  bool AcquireLatestFrame(Frame* frame);
+
+  // Returns the texture to show until AcquireLatestFrame has taken a frame: a
+  // transparent 1 x 1 texture that the writer never touches, unlike the
+  // textures of the frames. May be called on any thread.
+  GLuint GetInitialTexture() const;
+
+  // Returns whether a frame newer than the one last taken by
+  // AcquireLatestFrame has been published. May be called on any thread.
+  bool HasUnpresentedFrame() const;
+
+  // Platform thread side.
+
+  // Returns whether Flutter should be told that a new frame is available, and
+  // if so, records that it has been told. No more notifications are needed
+  // until Flutter calls AcquireLatestFrame, which takes the newest frame
+  // anyway.
+  bool TakeFrameAvailableNotification();
+
+  // Returns whether TakeFrameAvailableNotification would return true.
+  bool NeedsFrameAvailableNotification() const;
+
+  // Deletes the textures and the fences. Must be called with a GL context of
+  // the share group current after both sides have finished.
+  void ReleaseTextures();
+
+ private:
+  enum class SlotState {
+    kFree,
+    kWriting,
+    // Published and not yet taken by the raster thread.
+    kPublished,
+    // Taken by the raster thread and possibly being sampled.
+    kPresented,
+  };
+
+  struct Slot {
+    GLuint texture = 0;
+    // The size of the frame drawn to the texture.
+    int width = 0;
+    int height = 0;
+    // The size of the texture storage.
+    int capacity_width = 0;
+    int capacity_height = 0;
+    SlotState state = SlotState::kFree;
+    // The order in which the frames were published.
+    uint64_t sequence = 0;
+    // When the frame was published, if the render stats are enabled.
+    int64_t publish_time_ns = 0;
+    // Signaled when the upload of this frame has completed.
+    GLsync write_fence = nullptr;
+    // Signaled when the raster thread has finished sampling this texture.
+    GLsync read_fence = nullptr;
+    // The regions changed by the frames published since this texture was last
+    // written. Accessed only by the writer.
+    std::vector<WebviewRect> stale_rects;
+  };
+
+  // Blits |source| of |texture| to |destination| of the texture being
+  // written.
+  void BlitToFrame(GLuint texture,
+                   const WebviewRect& source,
+                   const WebviewRect& destination,
+                   GLenum filter);
+
+  // Copies the stale regions of |slot| from the latest frame.
+  void CatchUp(Slot* slot);
+
+  // (Re)allocates the storage of |slot| if a |width| x |height| frame does not
+  // fit in it, or if it is much larger than needed.
+  void AllocateStorage(Slot* slot, int width, int height);
+
+  // Replaces the storage of |slot| with |capacity_width| x |capacity_height|
+  // texels of undefined contents.
+  void ReplaceStorage(Slot* slot, int capacity_width, int capacity_height);
+
+  // Records the new storage size of |slot| in the byte counters.
+  void SetCapacity(Slot* slot, int capacity_width, int capacity_height);
+
+  // Clears |texture|, which must have storage.
+  void ClearTexture(GLuint texture);
+
+  const GLenum target_;
+
+  mutable std::mutex mutex_;
+  std::array<Slot, kNumSlots> slots_;
+  uint64_t last_sequence_;
+  int presented_slot_;
+  // Set by DeferUntilPresented and called by AcquireLatestFrame.
+  std::function<void()> on_presented_;
+
+  std::atomic<uint64_t> published_sequence_;
+  std::atomic<uint64_t> presented_sequence_;
+  // Whether Flutter has been told about a frame and has not acquired a frame
+  // since.
+  std::atomic<bool> frame_available_pending_;
+  // When the latest frame was published, if the render stats are enabled.
+  std::atomic<int64_t> last_publish_time_ns_;
+  std::atomic<int64_t> last_present_time_ns_;
+  // The sum of the storage of |slots_|. Written only by the writer, and by
+  // ReleaseTextures.
+  std::atomic<int64_t> storage_bytes_;
+
+  FlutterWebviewRenderStats render_stats_;
+
+  // Created with the ring and never written afterwards.
+  GLuint initial_texture_;
+
+  // Accessed only by the writer.
+  int writing_slot_;
+  int latest_slot_;
+  GLuint read_framebuffer_;
+  GLuint draw_framebuffer_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_TEXTURE_RING_H_
@@ -0,0 +1,498 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_texture_uploader.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_gl_utils.h"
+#include "flutter_webview_pixel_conversion.h"
+#include "flutter_webview_texture_format.h"
+
+namespace {
+
+constexpr size_t kBytesPerPixel = 4;
+
+// PBOs are allocated in multiples of this size so that small changes in the
+// size of the dirty regions do not reallocate them.
+constexpr size_t kPixelBufferGranularity = 256 * 1024;
+
+constexpr GLbitfield kPersistentMapFlags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+size_t RoundUpPixelBufferSize(size_t size) {
+  return (size + kPixelBufferGranularity - 1) / kPixelBufferGranularity *
+         kPixelBufferGranularity;
+}
+
+// The size of the scratch texture and the number of calls used to measure the
+// cost model.
+constexpr int kCalibrationSize = 256;
+constexpr int kCalibrationSmallUploads = 64;
+constexpr int kCalibrationLargeUploads = 4;
+
+// The size of the frames and the number of frames uploaded through each path
+// to choose the path of TextureUploadMode::kAuto.
+constexpr int kModeCalibrationSize = 512;
+constexpr int kModeCalibrationFrames = 8;
+
+void SetUnpackState(int row_length, int skip_pixels, int skip_rows) {
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, skip_pixels);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, skip_rows);
+  VERIFY_GL_NO_ERROR;
+}
+
+// Returns the nanoseconds elapsed while running |uploads| and waiting for the
+// GL to finish them.
+template <typename F>
+double MeasureNanoseconds(const F& uploads) {
+  glFinish();
+  const auto start = std::chrono::steady_clock::now();
+  uploads();
+  glFinish();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+UploadCostModel MeasureCostModel() {
+  GLint previous_texture = 0;
+  glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  flutter_webview_gl::AllocateTextureImage(GL_TEXTURE_2D, kCalibrationSize,
+                                           kCalibrationSize);
+  std::vector<uint8_t> pixels(kCalibrationSize * kCalibrationSize *
+                              kBytesPerPixel);
+  // The cost of the conversion of kConvert counts as the cost of the upload.
+  std::vector<uint8_t> scratch;
+  const WebviewRect full_rect{0, 0, kCalibrationSize, kCalibrationSize};
+
+  // Warm up the upload path before measuring it.
+  flutter_webview_gl::TexSubImageBGRA(GL_TEXTURE_2D, 0, 0, pixels.data(),
+                                      kCalibrationSize, full_rect, &scratch);
+
+  const double small_ns = MeasureNanoseconds([&pixels, &scratch]() {
+    for (int i = 0; i < kCalibrationSmallUploads; ++i) {
+      flutter_webview_gl::TexSubImageBGRA(GL_TEXTURE_2D, i, 0, pixels.data(),
+                                          kCalibrationSize,
+                                          WebviewRect{0, 0, 1, 1}, &scratch);
+    }
+  });
+  const double large_ns = MeasureNanoseconds([&pixels, &scratch, &full_rect]() {
+    for (int i = 0; i < kCalibrationLargeUploads; ++i) {
+      flutter_webview_gl::TexSubImageBGRA(GL_TEXTURE_2D, 0, 0, pixels.data(),
+                                          kCalibrationSize, full_rect,
+                                          &scratch);
+    }
+  });
+
+  SetUnpackState(0, 0, 0);
+  glDeleteTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous_texture));
+  VERIFY_GL_NO_ERROR;
+
+  // Each measurement includes one wait for the GL, so the per-call cost is
+  // slightly overestimated, which only makes merging more eager.
+  UploadCostModel cost_model;
+  cost_model.per_call_ns = small_ns / kCalibrationSmallUploads;
+  cost_model.per_byte_ns =
+      std::max(large_ns / kCalibrationLargeUploads - cost_model.per_call_ns,
+               1.0) /
+      pixels.size();
+  return cost_model;
+}
+
+}  // namespace
+
+// static
+const UploadCostModel& FlutterWebviewTextureUploader::GetCostModel() {
+  static const UploadCostModel cost_model = MeasureCostModel();
+  return cost_model;
+}
+
+// static
+bool FlutterWebviewTextureUploader::ArePixelBuffersFaster() {
+  static const bool faster = []() {
+    if (!flutter_webview_gl::GetCapabilities().has_pixel_buffer_object) {
+      return false;
+    }
+    GLint previous_texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    flutter_webview_gl::AllocateTextureImage(
+        GL_TEXTURE_2D, kModeCalibrationSize, kModeCalibrationSize);
+    const std::vector<uint8_t> pixels(
+        kModeCalibrationSize * kModeCalibrationSize * kBytesPerPixel);
+    const std::vector<WebviewRect> frame{
+        {0, 0, kModeCalibrationSize, kModeCalibrationSize}};
+
+    // The frames are uploaded back to back, as while scrolling or playing a
+    // video, so the PBOs can overlap the copies with the transfers.
+    auto measure = [texture, &pixels, &frame](TextureUploadMode mode) {
+      FlutterWebviewTextureUploader uploader;
+      uploader.SetMode(mode);
+      // Warm up the path, which allocates the PBOs.
+      uploader.UploadRects(GL_TEXTURE_2D, texture, pixels.data(),
+                           kModeCalibrationSize, kModeCalibrationSize, frame,
+                           0, 0);
+      const double ns = MeasureNanoseconds([&uploader, texture, &pixels,
+                                            &frame]() {
+        for (int i = 0; i < kModeCalibrationFrames; ++i) {
+          uploader.UploadRects(GL_TEXTURE_2D, texture, pixels.data(),
+                               kModeCalibrationSize, kModeCalibrationSize,
+                               frame, 0, 0);
+        }
+      });
+      uploader.ReleaseGLResources();
+      return ns;
+    };
+    const double direct_ns = measure(TextureUploadMode::kDirect);
+    const double pixel_buffer_ns =
+        measure(TextureUploadMode::kPixelBufferObject);
+
+    glDeleteTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous_texture));
+    VERIFY_GL_NO_ERROR;
+    return pixel_buffer_ns < direct_ns;
+  }();
+  return faster;
+}
+
+FlutterWebviewTextureUploader::FlutterWebviewTextureUploader()
+    : requested_mode_(TextureUploadMode::kAuto),
+      mode_resolved_(false),
+      use_pixel_buffers_(false),
+      use_persistent_mapping_(false),
+      next_pixel_buffer_(0) {}
+
+FlutterWebviewTextureUploader::~FlutterWebviewTextureUploader() {
+  for (const PixelBuffer& pixel_buffer : pixel_buffers_) {
+    if (pixel_buffer.name != 0) {
+      std::cerr << "Warning: FlutterWebviewTextureUploader is destroyed "
+                   "without ReleaseGLResources(). The pixel buffer objects "
+                   "are leaked."
+                << std::endl;
+      break;
+    }
+  }
+}
+
+void FlutterWebviewTextureUploader::SetMode(TextureUploadMode mode) {
+  if (mode == requested_mode_) {
+    return;
+  }
+  requested_mode_ = mode;
+  mode_resolved_ = false;
+}
+
+void FlutterWebviewTextureUploader::UploadRects(
+    GLenum target,
+    GLuint texture,
+    const void* buffer,
+    int width,
+    int height,
+    const std::vector<WebviewRect>& rects,
+    int offset_x,
+    int offset_y) {
+  // Never read outside |buffer|. The rects are copied only if one sticks out.
+  std::vector<WebviewRect> clipped_rects;
+  const bool needs_clip =
+      std::any_of(rects.begin(), rects.end(), [&](const WebviewRect& rect) {
+        return rect.x < 0 || rect.y < 0 || rect.width <= 0 ||
+               rect.height <= 0 || rect.x + rect.width > width ||
+               rect.y + rect.height > height;
+      });
+  if (needs_clip) {
+    for (const WebviewRect& rect : rects) {
+      const int left = std::max(rect.x, 0);
+      const int top = std::max(rect.y, 0);
+      const int right = std::min(rect.x + rect.width, width);
+      const int bottom = std::min(rect.y + rect.height, height);
+      if (left < right && top < bottom) {
+        clipped_rects.push_back(
+            WebviewRect{left, top, right - left, bottom - top});
+      }
+    }
+  }
+  const std::vector<WebviewRect>& upload_rects =
+      needs_clip ? clipped_rects : rects;
+  if (upload_rects.empty()) {
+    return;
+  }
+
+  glBindTexture(target, texture);
+  VERIFY_GL_NO_ERROR;
+
+  const uint8_t* pixels = static_cast<const uint8_t*>(buffer);
+  std::vector<size_t> offsets;
+  PixelBuffer* pixel_buffer =
+      ShouldUsePixelBuffers()
+          ? StageRects(pixels, width, upload_rects, &offsets)
+          : nullptr;
+  if (!pixel_buffer) {
+    UploadRectsDirect(target, pixels, width, upload_rects, offset_x, offset_y);
+    return;
+  }
+
+  // The rows of each rect are tightly packed in the PBO, and already converted
+  // for kConvert.
+  const flutter_webview_gl::TextureFormat& format =
+      flutter_webview_gl::GetTextureFormat();
+  SetUnpackState(0, 0, 0);
+  for (size_t i = 0; i < upload_rects.size(); ++i) {
+    const WebviewRect& rect = upload_rects[i];
+    glTexSubImage2D(target, 0, rect.x + offset_x, rect.y + offset_y,
+                    rect.width, rect.height, format.format, format.type,
+                    reinterpret_cast<const void*>(offsets[i]));
+    VERIFY_GL_NO_ERROR;
+  }
+
+  FinishPixelBufferUpload(pixel_buffer);
+}
+
+void FlutterWebviewTextureUploader::ReleaseGLResources() {
+  for (PixelBuffer& pixel_buffer : pixel_buffers_) {
+    DeletePixelBuffer(&pixel_buffer);
+  }
+  next_pixel_buffer_ = 0;
+}
+
+bool FlutterWebviewTextureUploader::ShouldUsePixelBuffers() {
+  if (mode_resolved_) {
+    return use_pixel_buffers_;
+  }
+
+  ReleaseGLResources();
+  mode_resolved_ = true;
+
+  const flutter_webview_gl::Capabilities& caps =
+      flutter_webview_gl::GetCapabilities();
+  // kAuto takes the path measured to be faster on this GL implementation.
+  use_pixel_buffers_ =
+      caps.has_pixel_buffer_object &&
+      (requested_mode_ == TextureUploadMode::kPixelBufferObject ||
+       (requested_mode_ == TextureUploadMode::kAuto &&
+        ArePixelBuffersFaster()));
+  use_persistent_mapping_ =
+      use_pixel_buffers_ && caps.has_buffer_storage && caps.has_sync;
+
+  if (requested_mode_ == TextureUploadMode::kPixelBufferObject &&
+      !use_pixel_buffers_) {
+    std::cerr << "Warning: Pixel buffer objects are not supported by the GL "
+                 "context. Textures are uploaded directly."
+              << std::endl;
+  }
+  return use_pixel_buffers_;
+}
+
+FlutterWebviewTextureUploader::PixelBuffer*
+FlutterWebviewTextureUploader::StageRects(const uint8_t* buffer,
+                                          int width,
+                                          const std::vector<WebviewRect>& rects,
+                                          std::vector<size_t>* offsets) {
+  offsets->clear();
+  offsets->reserve(rects.size());
+  size_t total_size = 0;
+  for (const WebviewRect& rect : rects) {
+    offsets->push_back(total_size);
+    total_size += static_cast<size_t>(rect.width) * rect.height * kBytesPerPixel;
+  }
+  if (total_size == 0) {
+    return nullptr;
+  }
+
+  PixelBuffer* pixel_buffer = &pixel_buffers_[next_pixel_buffer_];
+  uint8_t* dest = MapPixelBuffer(pixel_buffer, total_size);
+  if (!dest) {
+    return nullptr;
+  }
+  next_pixel_buffer_ = (next_pixel_buffer_ + 1) % kNumPixelBuffers;
+
+  // For kConvert, the pixels are converted while being copied, so the PBO
+  // path costs no extra pass over them.
+  const bool convert = flutter_webview_gl::GetTextureFormat().kind ==
+                       flutter_webview_gl::TextureFormat::Kind::kConvert;
+  auto copy_pixels = [convert](const uint8_t* src, uint8_t* dst,
+                               size_t num_pixels) {
+    if (convert) {
+      flutter_webview_pixels::ConvertBGRAToRGBA(src, dst, num_pixels);
+    } else {
+      std::memcpy(dst, src, num_pixels * kBytesPerPixel);
+    }
+  };
+  const size_t src_stride = static_cast<size_t>(width) * kBytesPerPixel;
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const WebviewRect& rect = rects[i];
+    const size_t row_size = static_cast<size_t>(rect.width) * kBytesPerPixel;
+    const uint8_t* src =
+        buffer + rect.y * src_stride + rect.x * kBytesPerPixel;
+    uint8_t* dst = dest + (*offsets)[i];
+    if (rect.width == width) {
+      // Whole rows are contiguous in the source too.
+      copy_pixels(src, dst, static_cast<size_t>(rect.width) * rect.height);
+      continue;
+    }
+    for (int row = 0; row < rect.height; ++row) {
+      copy_pixels(src, dst, rect.width);
+      dst += row_size;
+      src += src_stride;
+    }
+  }
+
+  if (!pixel_buffer->mapped &&
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+    // The contents of the buffer have been corrupted, e.g. by a display mode
+    // change. Upload this frame directly.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return nullptr;
+  }
+  return pixel_buffer;
+}
+
+uint8_t* FlutterWebviewTextureUploader::MapPixelBuffer(
+    PixelBuffer* pixel_buffer,
+    size_t size) {
+  if (use_persistent_mapping_) {
+    if (pixel_buffer->fence) {
+      GLenum wait_result = glClientWaitSync(pixel_buffer->fence,
+                                            GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if (wait_result == GL_TIMEOUT_EXPIRED) {
+        // The GPU is still reading this buffer. Rather than stalling the
+        // calling thread, upload this frame directly.
+        return nullptr;
+      }
+      glDeleteSync(pixel_buffer->fence);
+      pixel_buffer->fence = nullptr;
+    }
+
+    if (pixel_buffer->size >= size) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer->name);
+      return static_cast<uint8_t*>(pixel_buffer->mapped);
+    }
+
+    // The storage of a persistently mapped buffer is immutable, so a larger
+    // buffer is created instead.
+    DeletePixelBuffer(pixel_buffer);
+    const size_t capacity = RoundUpPixelBufferSize(size);
+    glGenBuffers(1, &pixel_buffer->name);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer->name);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr,
+                    kPersistentMapFlags);
+    pixel_buffer->mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                            capacity, kPersistentMapFlags);
+    if (!pixel_buffer->mapped) {
+      DisablePixelBuffers("glMapBufferRange() failed for a persistent buffer.");
+      return nullptr;
+    }
+    pixel_buffer->size = capacity;
+    return static_cast<uint8_t*>(pixel_buffer->mapped);
+  }
+
+  if (pixel_buffer->name == 0) {
+    glGenBuffers(1, &pixel_buffer->name);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer->name);
+  if (pixel_buffer->size < size) {
+    pixel_buffer->size = RoundUpPixelBufferSize(size);
+  }
+  // Orphan the previous storage so that mapping does not wait for the GPU to
+  // finish reading it.
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, pixel_buffer->size, nullptr,
+               GL_STREAM_DRAW);
+  void* mapped =
+      glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!mapped) {
+    DisablePixelBuffers("glMapBufferRange() failed.");
+    return nullptr;
+  }
+  return static_cast<uint8_t*>(mapped);
+}
+
+void FlutterWebviewTextureUploader::FinishPixelBufferUpload(
+    PixelBuffer* pixel_buffer) {
+  if (use_persistent_mapping_) {
+    pixel_buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  VERIFY_GL_NO_ERROR;
+}
+
+void FlutterWebviewTextureUploader::DeletePixelBuffer(
+    PixelBuffer* pixel_buffer) {
+  if (pixel_buffer->fence) {
+    glDeleteSync(pixel_buffer->fence);
+    pixel_buffer->fence = nullptr;
+  }
+  if (pixel_buffer->name != 0) {
+    // Deleting a buffer also unmaps it.
+    glDeleteBuffers(1, &pixel_buffer->name);
+    pixel_buffer->name = 0;
+  }
+  pixel_buffer->size = 0;
+  pixel_buffer->mapped = nullptr;
+}
+
+void FlutterWebviewTextureUploader::DisablePixelBuffers(const char* reason) {
+  std::cerr << "Warning: " << reason
+            << " Falling back to direct texture uploads." << std::endl;
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  ReleaseGLResources();
+  // Stay in the direct mode until another mode is requested with SetMode().
+  use_pixel_buffers_ = false;
+}
+
+void FlutterWebviewTextureUploader::UploadRectsDirect(
+    GLenum target,
+    const uint8_t* buffer,
+    int width,
+    const std::vector<WebviewRect>& rects,
+    int offset_x,
+    int offset_y) {
+  for (const WebviewRect& rect : rects) {
+    flutter_webview_gl::TexSubImageBGRA(target, rect.x + offset_x,
+                                        rect.y + offset_y, buffer, width, rect,
+                                        &conversion_buffer_);
+    VERIFY_GL_NO_ERROR;
+  }
+  SetUnpackState(0, 0, 0);
+}
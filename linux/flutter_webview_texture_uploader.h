@@ -0,0 +1,150 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_TEXTURE_UPLOADER_H_
+#define LINUX_FLUTTER_WEBVIEW_TEXTURE_UPLOADER_H_
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_rect_coalescer.h"
+
+// Uploads the BGRA pixel buffers painted by the browser to GL textures, either
+// directly from the client memory or streamed through a ring of pixel buffer
+// objects (PBOs), in the format chosen by
+// flutter_webview_gl::GetTextureFormat().
+//
+// In the PBO mode, the dirty regions are copied into a mapped buffer and the
+// texture update is issued from the bound buffer, so the calling thread
+// returns as soon as the commands are queued instead of waiting for the driver
+// to copy the pixels. If ARB_buffer_storage is available, the buffers are
+// persistently mapped and guarded by fences.
+//
+// All the methods must be called on the thread on which the GL context is
+// current, i.e. between on_paint_begin and on_paint_end on the CEF UI thread.
+class FlutterWebviewTextureUploader {
+ public:
+  FlutterWebviewTextureUploader();
+  ~FlutterWebviewTextureUploader();
+
+  // Requests |mode| for the following uploads. The GL objects of the previous
+  // mode are released on the next upload.
+  void SetMode(TextureUploadMode mode);
+
+  // Uploads the |rects| of |buffer|, whose size is |width| x |height|, to
+  // |texture| of |target|, whose storage must be allocated. Each rect is
+  // clipped to |buffer| and written to the texture at its position in
+  // |buffer| translated by (|offset_x|, |offset_y|).
+  void UploadRects(GLenum target,
+                   GLuint texture,
+                   const void* buffer,
+                   int width,
+                   int height,
+                   const std::vector<WebviewRect>& rects,
+                   int offset_x,
+                   int offset_y);
+
+  // Returns the cost of texture updates on this GL implementation. The cost is
+  // measured with a scratch texture on the first call, which must be made with
+  // the GL context of the plugin current, and cached for the process afterwards.
+  static const UploadCostModel& GetCostModel();
+
+  // Returns whether uploading through PBOs is faster than uploading directly on
+  // this GL implementation, which decides the path of TextureUploadMode::kAuto.
+  // Measured and cached like GetCostModel.
+  static bool ArePixelBuffersFaster();
+
+  // Deletes the GL objects owned by this uploader. The destructor does not
+  // touch GL, so this must be called with the GL context current before this
+  // uploader is destroyed.
+  void ReleaseGLResources();
+
+ private:
+  struct PixelBuffer {
+    GLuint name = 0;
+    size_t size = 0;
+    // The address of the buffer while it is persistently mapped.
+    void* mapped = nullptr;
+    // Signaled when the GPU has consumed the last upload from this buffer.
+    GLsync fence = nullptr;
+  };
+
+  // The number of PBOs in the ring. A buffer is reused three uploads later, by
+  // which time the GPU has normally finished reading it.
+  static constexpr int kNumPixelBuffers = 3;
+
+  // Resolves the requested mode if it has changed. Returns whether the next
+  // upload goes through the PBOs.
+  bool ShouldUsePixelBuffers();
+
+  // Copies the |rects| of |buffer| into the next PBO in the ring, packing the
+  // rows of each rect tightly, and leaves the PBO bound to
+  // GL_PIXEL_UNPACK_BUFFER. The byte offset of each rect in the PBO is stored
+  // in |offsets|. Returns nullptr if no PBO is available for this upload, in
+  // which case the caller uses the direct path.
+  PixelBuffer* StageRects(const uint8_t* buffer,
+                          int width,
+                          const std::vector<WebviewRect>& rects,
+                          std::vector<size_t>* offsets);
+
+  // Returns a writable address of |pixel_buffer| with at least |size| bytes
+  // after binding it to GL_PIXEL_UNPACK_BUFFER, or nullptr on failure.
+  uint8_t* MapPixelBuffer(PixelBuffer* pixel_buffer, size_t size);
+
+  // Unbinds the PBO after the texture update has been issued from it.
+  void FinishPixelBufferUpload(PixelBuffer* pixel_buffer);
+
+  void DeletePixelBuffer(PixelBuffer* pixel_buffer);
+
+  // Gives up the PBO path after an unrecoverable error.
+  void DisablePixelBuffers(const char* reason);
+
+  void UploadRectsDirect(GLenum target,
+                         const uint8_t* buffer,
+                         int width,
+                         const std::vector<WebviewRect>& rects,
+                         int offset_x,
+                         int offset_y);
+
+  TextureUploadMode requested_mode_;
+  bool mode_resolved_;
+  bool use_pixel_buffers_;
+  bool use_persistent_mapping_;
+  std::array<PixelBuffer, kNumPixelBuffers> pixel_buffers_;
+  int next_pixel_buffer_;
+  // The dirty rows converted to RGBA by the direct path with kConvert.
+  std::vector<uint8_t> conversion_buffer_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_TEXTURE_UPLOADER_H_
@@ -0,0 +1,96 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_tile_grid.h"
+
+#include <algorithm>
+#include <vector>
+
+FlutterWebviewTileGrid::FlutterWebviewTileGrid(int tile_size)
+    : tile_size_(tile_size) {}
+
+int FlutterWebviewTileGrid::GetTileCountAlong(int size) const {
+  if (tile_size_ <= 0 || size <= tile_size_) {
+    return 1;
+  }
+  return (size + tile_size_ - 1) / tile_size_;
+}
+
+int FlutterWebviewTileGrid::GetTileCount(int width, int height) const {
+  return GetTileCountAlong(width) * GetTileCountAlong(height);
+}
+
+std::vector<WebviewRect> FlutterWebviewTileGrid::GetTiles(int width,
+                                                          int height) const {
+  const int columns = GetTileCountAlong(width);
+  const int rows = GetTileCountAlong(height);
+  if (columns == 1 && rows == 1) {
+    return {WebviewRect{0, 0, width, height}};
+  }
+
+  std::vector<WebviewRect> tiles;
+  tiles.reserve(columns * rows);
+  for (int row = 0; row < rows; ++row) {
+    const int y = row * tile_size_;
+    for (int column = 0; column < columns; ++column) {
+      const int x = column * tile_size_;
+      tiles.push_back(WebviewRect{x, y, std::min(tile_size_, width - x),
+                                  std::min(tile_size_, height - y)});
+    }
+  }
+  return tiles;
+}
+
+// static
+std::vector<WebviewRect> FlutterWebviewTileGrid::ClipRects(
+    const std::vector<WebviewRect>& rects,
+    const WebviewRect& tile) {
+  std::vector<WebviewRect> clipped;
+  for (const WebviewRect& rect : rects) {
+    WebviewRect part;
+    if (Intersect(rect, tile, &part)) {
+      clipped.push_back(part);
+    }
+  }
+  return clipped;
+}
+
+// static
+bool FlutterWebviewTileGrid::Intersect(const WebviewRect& a,
+                                       const WebviewRect& b,
+                                       WebviewRect* intersection) {
+  const int left = std::max(a.x, b.x);
+  const int top = std::max(a.y, b.y);
+  const int right = std::min(a.x + a.width, b.x + b.width);
+  const int bottom = std::min(a.y + a.height, b.y + b.height);
+  if (left >= right || top >= bottom) {
+    return false;
+  }
+  *intersection = WebviewRect{left, top, right - left, bottom - top};
+  return true;
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_FLUTTER_WEBVIEW_TILE_GRID_H_
+#define LINUX_FLUTTER_WEBVIEW_TILE_GRID_H_
+
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+// Splits a webview larger than a texture can hold into a grid of tiles, each
+// drawn to a texture ring of its own.
+//
+// The tiles are |tile_size| squares laid out in rows from the top-left corner
+// of the view; the last column and row are narrower where the view size is not
+// a multiple of the tile size. A view that fits in a single tile is not split.
+class FlutterWebviewTileGrid {
+ public:
+  // A |tile_size| of 0 or less means that the view is never split.
+  explicit FlutterWebviewTileGrid(int tile_size);
+
+  int tile_size() const { return tile_size_; }
+
+  // Returns the number of tiles covering a |width| x |height| view.
+  int GetTileCount(int width, int height) const;
+
+  // Returns the tiles covering a |width| x |height| view in row-major order,
+  // in the coordinates of the view.
+  std::vector<WebviewRect> GetTiles(int width, int height) const;
+
+  // Returns the parts of |rects| inside |tile|. The parts stay in the
+  // coordinates of the view.
+  static std::vector<WebviewRect> ClipRects(
+      const std::vector<WebviewRect>& rects,
+      const WebviewRect& tile);
+
+  // Returns whether |a| and |b| overlap, and if so, their overlap in
+  // |intersection|.
+  static bool Intersect(const WebviewRect& a,
+                        const WebviewRect& b,
+                        WebviewRect* intersection);
+
+ private:
+  // Returns the number of tiles needed to cover |size| pixels in a row or a
+  // column.
+  int GetTileCountAlong(int size) const;
+
+  int tile_size_;
+};
+
+#endif  // LINUX_FLUTTER_WEBVIEW_TILE_GRID_H_
@@ -33,7 +33,12 @@
 #include <flutter_linux/flutter_linux.h>
 #include <glib-object.h>
 
+#include <atomic>
 #include <cstdint>
+#include <memory>
+
+class FlutterWebviewStagingBuffer;
+class FlutterWebviewTextureRing;
 
 G_DECLARE_FINAL_TYPE(FlCustomTextureGL,
                      fl_custom_texture_gl,
@@ -45,14 +50,27 @@ struct _FlCustomTextureGL {
   FlTextureGL parent_instance;
 
   uint32_t target;
-  GLuint native_texture_id;
+  // The textures the webview is drawn to. Shared with the FlutterWebviewHandler
+  // that writes them.
+  std::shared_ptr<FlutterWebviewTextureRing> ring;
+  // Set for TextureBackend::kRasterUpload, in which case the webview is
+  // uploaded from it by populate instead of being drawn to |ring|.
+  std::shared_ptr<FlutterWebviewStagingBuffer> staging;
+  // The size reported for the initial texture of |ring|, which is transparent
+  // all over, until the first frame is taken.
   uint32_t width;
   uint32_t height;
+  // The number of populate calls in progress, and when the last one returned,
+  // in the clock of FlutterWebviewRenderStats::NowNs(). Flutter unregisters a
+  // texture asynchronously, so these tell when it has stopped using one.
+  std::atomic<int> populating;
+  std::atomic<int64_t> last_populate_ns;
 };
 
-FlCustomTextureGL* fl_custom_texture_gl_new(uint32_t target,
-                                            uint32_t name,
-                                            uint32_t width,
-                                            uint32_t height);
+FlCustomTextureGL* fl_custom_texture_gl_new(
+    uint32_t target,
+    std::shared_ptr<FlutterWebviewTextureRing> ring,
+    uint32_t width,
+    uint32_t height);
 
 #endif  // LINUX_INCLUDE_FLUTTER_LINUX_WEBVIEW_FL_CUSTOM_TEXTURE_GL_H_
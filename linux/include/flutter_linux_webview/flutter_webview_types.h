@@ -31,12 +31,85 @@
 
 #include <cstdint>
 #include <functional>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <utility>
 
 using WebviewId = int64_t;
 
+class FlutterWebviewPixelBuffer;
+class FlutterWebviewSnapshotCache;
+class FlutterWebviewStagingBuffer;
+class FlutterWebviewTextureRing;
+
+// A rectangle in pixels, such as a dirty region of a browser frame.
+struct WebviewRect {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// Named counters describing the rendering of a webview, such as the number of
+// dirty rectangles painted.
+using WebviewRenderCounters = std::map<std::string, int64_t>;
+
+// Named totals of a finished recording of a webview, such as the number of
+// frames written.
+using WebviewRecordingStats = std::map<std::string, int64_t>;
+
+// The texture memory held by a webview that may release it to keep the
+// textures within the memory budget.
+struct WebviewTextureUsage {
+  WebviewId webview_id;
+  // The bytes of texture storage the webview would release.
+  int64_t bytes;
+  // When Flutter last took a frame of the webview, in the clock of
+  // FlutterWebviewRenderStats::NowNs(), or 0 if it never did.
+  int64_t last_present_time_ns;
+};
+
+// Summaries of the frame pipeline statistics of a webview, keyed by the name of
+// the measured quantity, such as "paintDurationUs".
+using WebviewRenderStats =
+    std::map<std::string, std::map<std::string, int64_t>>;
+
+// Specifies how the pixel buffers painted by the browser are uploaded to the
+// textures. The values must match the indices of the Dart enum
+// TextureUploadMode.
+enum class TextureUploadMode {
+  // Uses kPixelBufferObject if it is measured to be faster than kDirect on the
+  // GL implementation (see FlutterWebviewTextureUploader::
+  // ArePixelBuffersFaster), kDirect otherwise.
+  kAuto = 0,
+  // Calls glTexImage2D/glTexSubImage2D with the browser's pixel buffer, which
+  // blocks until the driver has copied the pixels.
+  kDirect = 1,
+  // Copies the dirty regions into a ring of pixel buffer objects and updates
+  // the texture from the bound buffer, so that the transfer is performed
+  // asynchronously by the driver.
+  kPixelBufferObject = 2,
+};
+
+// Specifies what the webviews created afterwards are drawn to. The values must
+// match the indices of the Dart enum TextureBackend.
+enum class TextureBackend {
+  // Uses kGL if the plugin has a GL context, kPixelBuffer otherwise.
+  kAuto = 0,
+  // Uploads the browser rendering to GL textures with the plugin's GL context
+  // on the CEF UI thread.
+  kGL = 1,
+  // Copies the browser rendering to a CPU image, which Flutter uploads itself.
+  // Needs no GL context in the plugin.
+  kPixelBuffer = 2,
+  // Copies the browser rendering to a CPU image on the CEF UI thread, which
+  // is uploaded to a GL texture on Flutter's raster thread when Flutter takes
+  // the frame. Needs the plugin's GL context only to create the textures.
+  kRasterUpload = 3,
+};
+
 struct WebviewError {
  public:
   static constexpr char kInvalidWebviewId[] = "Invalid Webview ID";
@@ -104,7 +177,13 @@ struct WebviewCreationParams {
                                                       bool is_undefined)>;
 
   WebviewCreationParams(
-      uint32_t native_texture_id,
+      std::shared_ptr<FlutterWebviewTextureRing> texture_ring,
+      std::shared_ptr<FlutterWebviewPixelBuffer> pixel_buffer,
+      std::shared_ptr<FlutterWebviewStagingBuffer> staging_buffer,
+      int tile_size,
+      bool external_begin_frame,
+      std::shared_ptr<FlutterWebviewSnapshotCache> snapshot_cache,
+      std::string snapshot_key,
       int width,
       int height,
       std::function<void(WebviewId webview_id)> on_paint_begin,
@@ -116,7 +195,13 @@ struct WebviewCreationParams {
       PageLoadingCallback on_progress,
       WebResourceErrorCallback on_web_resource_error,
       JavascriptResultCallback on_javascript_result)
-      : native_texture_id(native_texture_id),
+      : texture_ring(texture_ring),
+        pixel_buffer(pixel_buffer),
+        staging_buffer(staging_buffer),
+        tile_size(tile_size),
+        external_begin_frame(external_begin_frame),
+        snapshot_cache(snapshot_cache),
+        snapshot_key(snapshot_key),
         width(width),
         height(height),
         on_paint_begin(on_paint_begin),
@@ -129,8 +214,32 @@ struct WebviewCreationParams {
         on_web_resource_error(on_web_resource_error),
         on_javascript_result(on_javascript_result) {}
 
-  // ID of the OpenGL texture to which the browser rendering will be drawn.
-  uint32_t native_texture_id;
+  // The OpenGL textures to which the browser rendering will be drawn.
+  std::shared_ptr<FlutterWebviewTextureRing> texture_ring;
+
+  // The CPU image to which the browser rendering will be drawn instead, when
+  // |texture_ring| is null. All three are null for a headless webview, which
+  // is never drawn.
+  std::shared_ptr<FlutterWebviewPixelBuffer> pixel_buffer;
+
+  // The CPU image staged for uploads on Flutter's raster thread, to which the
+  // browser rendering is drawn instead of the other two.
+  std::shared_ptr<FlutterWebviewStagingBuffer> staging_buffer;
+
+  // The largest width and height of the part of the view drawn to
+  // |texture_ring|. A larger view is split into tiles of this size, each drawn
+  // to its own ring given later. 0 if the view is never split.
+  int tile_size;
+
+  // Whether the browser paints only when it is sent a begin frame, following
+  // Flutter's frames, instead of on its own timer.
+  bool external_begin_frame;
+
+  // Where the view is shown from before the first paint, and saved to when
+  // the browser is closed, under |snapshot_key|. Null if the view has no
+  // snapshot.
+  std::shared_ptr<FlutterWebviewSnapshotCache> snapshot_cache;
+  std::string snapshot_key;
 
   // initial width of the browser
   int width;
@@ -0,0 +1,362 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Converts a recording written by FlutterWebviewRecorder to a YUV4MPEG2 (.y4m)
+// video at a constant frame rate, which ffmpeg and most players read
+// directly. See CMakeLists.txt for how to build it.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "flutter_webview_recording_format.h"
+
+namespace {
+
+using flutter_webview_recording::FileHeader;
+using flutter_webview_recording::FrameHeader;
+using flutter_webview_recording::kBytesPerPixel;
+using flutter_webview_recording::RectHeader;
+
+// Reads the frames of a recording one by one.
+class RecordingReader {
+ public:
+  explicit RecordingReader(const std::string& path) : path_(path) {}
+
+  ~RecordingReader() {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+    }
+  }
+
+  bool Open() {
+    file_ = std::fopen(path_.c_str(), "rb");
+    if (file_ == nullptr) {
+      std::cerr << "Error: Could not open " << path_ << std::endl;
+      return false;
+    }
+    FileHeader header;
+    if (std::fread(&header, sizeof(header), 1, file_) != 1 ||
+        std::memcmp(header.magic, flutter_webview_recording::kFileMagic,
+                    sizeof(header.magic)) != 0) {
+      std::cerr << "Error: " << path_ << " is not a webview recording."
+                << std::endl;
+      return false;
+    }
+    if (header.version != flutter_webview_recording::kVersion) {
+      std::cerr << "Error: Unsupported recording version " << header.version
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Reads the next frame header. Returns false at the end of the recording,
+  // including a frame truncated by a crash of the recording app.
+  bool ReadFrameHeader(FrameHeader* header) {
+    if (std::fread(header, sizeof(*header), 1, file_) != 1) {
+      return false;
+    }
+    if (header->magic != flutter_webview_recording::kFrameMagic ||
+        header->width <= 0 || header->height <= 0) {
+      std::cerr << "Warning: Corrupted frame; ignoring the rest of " << path_
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // Reads the next rectangle of the current frame, and its pixels into
+  // |pixels| unless it is null.
+  bool ReadRect(RectHeader* rect, std::vector<uint8_t>* pixels) {
+    if (std::fread(rect, sizeof(*rect), 1, file_) != 1 || rect->x < 0 ||
+        rect->y < 0 || rect->width < 0 || rect->height < 0) {
+      return false;
+    }
+    const size_t size =
+        static_cast<size_t>(rect->width) * rect->height * kBytesPerPixel;
+    if (pixels == nullptr) {
+      return std::fseek(file_, static_cast<long>(size), SEEK_CUR) == 0;
+    }
+    pixels->resize(size);
+    return size == 0 || std::fread(pixels->data(), size, 1, file_) == 1;
+  }
+
+ private:
+  const std::string path_;
+  FILE* file_ = nullptr;
+};
+
+struct RecordingInfo {
+  int frames = 0;
+  int dropped_frames = 0;
+  int max_width = 0;
+  int max_height = 0;
+  int64_t duration_us = 0;
+};
+
+// Scans the frame headers, skipping the pixels. Optionally writes the damage
+// of each frame to |pattern|, in the --pattern-file format of the upload
+// benchmark.
+bool Scan(const std::string& path, RecordingInfo* info, std::ostream* pattern) {
+  RecordingReader reader(path);
+  if (!reader.Open()) {
+    return false;
+  }
+  FrameHeader frame;
+  while (reader.ReadFrameHeader(&frame)) {
+    std::string line;
+    bool complete = true;
+    for (uint32_t i = 0; i < frame.rect_count && complete; ++i) {
+      RectHeader rect;
+      complete = reader.ReadRect(&rect, nullptr);
+      line += (i == 0 ? "" : " ") + std::to_string(rect.x) + "," +
+              std::to_string(rect.y) + "," + std::to_string(rect.width) +
+              "," + std::to_string(rect.height);
+    }
+    if (!complete) {
+      break;
+    }
+    if (pattern != nullptr) {
+      *pattern << line << "\n";
+    }
+    ++info->frames;
+    info->dropped_frames += frame.dropped_frames;
+    info->max_width = std::max(info->max_width, static_cast<int>(frame.width));
+    info->max_height =
+        std::max(info->max_height, static_cast<int>(frame.height));
+    info->duration_us = frame.timestamp_us;
+  }
+  return true;
+}
+
+// Writes the BGRA |canvas| as a 4:2:0 frame with BT.601 limited-range colors.
+void WriteY4mFrame(const std::vector<uint8_t>& canvas,
+                   int width,
+                   int height,
+                   std::vector<uint8_t>* yuv,
+                   FILE* out) {
+  uint8_t* y_plane = yuv->data();
+  uint8_t* u_plane = y_plane + width * height;
+  uint8_t* v_plane = u_plane + (width / 2) * (height / 2);
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* row = canvas.data() + static_cast<size_t>(y) * width * 4;
+    for (int x = 0; x < width; ++x) {
+      const int b = row[x * 4];
+      const int g = row[x * 4 + 1];
+      const int r = row[x * 4 + 2];
+      y_plane[y * width + x] =
+          static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+  }
+  for (int y = 0; y < height / 2; ++y) {
+    for (int x = 0; x < width / 2; ++x) {
+      int r = 0;
+      int g = 0;
+      int b = 0;
+      for (int dy = 0; dy < 2; ++dy) {
+        const uint8_t* pixel =
+            canvas.data() +
+            (static_cast<size_t>(y * 2 + dy) * width + x * 2) * 4;
+        b += pixel[0] + pixel[4];
+        g += pixel[1] + pixel[5];
+        r += pixel[2] + pixel[6];
+      }
+      r /= 4;
+      g /= 4;
+      b /= 4;
+      u_plane[y * (width / 2) + x] =
+          static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+      v_plane[y * (width / 2) + x] =
+          static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+  }
+  std::fputs("FRAME\n", out);
+  std::fwrite(yuv->data(), yuv->size(), 1, out);
+}
+
+// Replays the frames onto a canvas of the largest frame size and writes it
+// every 1/|fps| seconds of the recording.
+bool Convert(const std::string& path,
+             const RecordingInfo& info,
+             int fps,
+             const std::string& out_path) {
+  RecordingReader reader(path);
+  if (!reader.Open()) {
+    return false;
+  }
+  FILE* out = std::fopen(out_path.c_str(), "wb");
+  if (out == nullptr) {
+    std::cerr << "Error: Could not create " << out_path << std::endl;
+    return false;
+  }
+
+  // 4:2:0 needs even dimensions.
+  const int width = (info.max_width + 1) & ~1;
+  const int height = (info.max_height + 1) & ~1;
+  std::fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width,
+               height, fps);
+  std::vector<uint8_t> canvas(static_cast<size_t>(width) * height * 4, 0);
+  std::vector<uint8_t> yuv(static_cast<size_t>(width) * height * 3 / 2);
+  std::vector<uint8_t> pixels;
+
+  const int64_t output_frames = info.duration_us * fps / 1000000 + 1;
+  int frame_width = 0;
+  int frame_height = 0;
+  FrameHeader frame;
+  bool has_frame = reader.ReadFrameHeader(&frame);
+  for (int64_t i = 0; i < output_frames; ++i) {
+    const int64_t time_us = i * 1000000 / fps;
+    for (; has_frame && frame.timestamp_us <= time_us;
+         has_frame = reader.ReadFrameHeader(&frame)) {
+      if (frame.width != frame_width || frame.height != frame_height) {
+        // The area outside a smaller view is black.
+        std::fill(canvas.begin(), canvas.end(), 0);
+        frame_width = frame.width;
+        frame_height = frame.height;
+      }
+      for (uint32_t r = 0; r < frame.rect_count; ++r) {
+        RectHeader rect;
+        if (!reader.ReadRect(&rect, &pixels)) {
+          has_frame = false;
+          break;
+        }
+        const int copy_width = std::min(rect.width, width - rect.x);
+        for (int y = 0; y < rect.height && rect.y + y < height; ++y) {
+          if (copy_width <= 0) {
+            break;
+          }
+          std::memcpy(
+              canvas.data() +
+                  (static_cast<size_t>(rect.y + y) * width + rect.x) * 4,
+              pixels.data() + static_cast<size_t>(y) * rect.width * 4,
+              static_cast<size_t>(copy_width) * 4);
+        }
+      }
+      if (!has_frame) {
+        break;
+      }
+    }
+    WriteY4mFrame(canvas, width, height, &yuv, out);
+  }
+  if (std::fclose(out) != 0) {
+    std::cerr << "Error: Could not write " << out_path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void PrintUsage(const char* program) {
+  std::cerr
+      << "Usage: " << program << " [options] RECORDING\n"
+      << "  --output=F        Write a YUV4MPEG2 video to F, e.g. for\n"
+      << "                    `ffmpeg -i F out.mp4`.\n"
+      << "  --fps=N           The frame rate of the video. Default: 30.\n"
+      << "  --pattern-file=F  Write the dirty rectangles of each frame to F,\n"
+      << "                    for the --pattern-file of the upload "
+         "benchmark.\n"
+      << "Prints the frame count, size and duration of the recording.\n";
+}
+
+bool ParseIntFlag(const std::string& arg, const char* flag, int* value) {
+  const std::string prefix = std::string(flag) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = std::atoi(arg.c_str() + prefix.size());
+  return true;
+}
+
+bool ParseStringFlag(const std::string& arg,
+                     const char* flag,
+                     std::string* value) {
+  const std::string prefix = std::string(flag) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string output;
+  std::string pattern_file;
+  int fps = 30;
+  std::string input;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (ParseStringFlag(arg, "--output", &output) ||
+        ParseStringFlag(arg, "--pattern-file", &pattern_file) ||
+        ParseIntFlag(arg, "--fps", &fps)) {
+      continue;
+    }
+    if (arg.compare(0, 2, "--") != 0 && input.empty()) {
+      input = arg;
+      continue;
+    }
+    PrintUsage(argv[0]);
+    return arg == "--help" ? 0 : 1;
+  }
+  if (input.empty() || fps <= 0) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  std::ofstream pattern;
+  if (!pattern_file.empty()) {
+    pattern.open(pattern_file);
+    if (!pattern) {
+      std::cerr << "Error: Could not create " << pattern_file << std::endl;
+      return 1;
+    }
+  }
+  RecordingInfo info;
+  if (!Scan(input, &info, pattern_file.empty() ? nullptr : &pattern)) {
+    return 1;
+  }
+  std::printf("frames=%d dropped=%d size=%dx%d duration=%.3fs\n", info.frames,
+              info.dropped_frames, info.max_width, info.max_height,
+              info.duration_us / 1e6);
+  if (info.frames == 0) {
+    std::cerr << "Error: No frame in " << input << std::endl;
+    return 1;
+  }
+
+  if (!output.empty() && !Convert(input, info, fps, output)) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,233 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_atlas_packer.h"
+
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_test.h"
+
+namespace {
+
+// Returns the region of |webview_id|, or an empty rectangle if it has none.
+WebviewRect RegionOf(const FlutterWebviewAtlasPacker& packer,
+                     WebviewId webview_id) {
+  WebviewRect rect{0, 0, 0, 0};
+  packer.GetRegion(webview_id, &rect);
+  return rect;
+}
+
+}  // namespace
+
+TEST(AtlasPackerPlacesRegionsAtTheLowestSpot) {
+  FlutterWebviewAtlasPacker packer(100, 100, 0);
+  std::vector<WebviewId> moved;
+  ASSERT_TRUE(packer.Place(1, 30, 20, &moved));
+  ASSERT_TRUE(packer.Place(2, 30, 20, &moved));
+  // Too wide for the space left beside them.
+  ASSERT_TRUE(packer.Place(3, 50, 10, &moved));
+  ASSERT_TRUE(packer.Place(4, 60, 10, &moved));
+  EXPECT_EQ((WebviewRect{0, 0, 30, 20}), RegionOf(packer, 1));
+  EXPECT_EQ((WebviewRect{30, 0, 30, 20}), RegionOf(packer, 2));
+  EXPECT_EQ((WebviewRect{0, 20, 50, 10}), RegionOf(packer, 3));
+  EXPECT_EQ((WebviewRect{0, 30, 60, 10}), RegionOf(packer, 4));
+  EXPECT_TRUE(moved.empty());
+  EXPECT_FALSE(packer.empty());
+}
+
+TEST(AtlasPackerPadsRegions) {
+  FlutterWebviewAtlasPacker packer(100, 100, 2);
+  std::vector<WebviewId> moved;
+  ASSERT_TRUE(packer.Place(1, 30, 20, &moved));
+  ASSERT_TRUE(packer.Place(2, 30, 20, &moved));
+  EXPECT_EQ((WebviewRect{0, 0, 30, 20}), RegionOf(packer, 1));
+  EXPECT_EQ((WebviewRect{32, 0, 30, 20}), RegionOf(packer, 2));
+
+  // The padding must fit in the atlas too.
+  EXPECT_FALSE(packer.Place(3, 99, 10, &moved));
+  EXPECT_TRUE(packer.Place(3, 98, 10, &moved));
+  EXPECT_EQ((WebviewRect{0, 22, 98, 10}), RegionOf(packer, 3));
+}
+
+TEST(AtlasPackerRejectsInvalidSizes) {
+  FlutterWebviewAtlasPacker packer(100, 100, 0);
+  std::vector<WebviewId> moved;
+  EXPECT_FALSE(packer.Place(1, 0, 10, &moved));
+  EXPECT_FALSE(packer.Place(1, 10, -1, &moved));
+  EXPECT_FALSE(packer.Place(1, 101, 10, &moved));
+  EXPECT_FALSE(packer.Place(1, 10, 101, &moved));
+  WebviewRect rect;
+  EXPECT_FALSE(packer.GetRegion(1, &rect));
+  EXPECT_TRUE(packer.empty());
+}
+
+TEST(AtlasPackerKeepsAResizedRegionInItsSpace) {
+  FlutterWebviewAtlasPacker packer(100, 100, 0);
+  std::vector<WebviewId> moved;
+  ASSERT_TRUE(packer.Place(1, 40, 40, &moved));
+  ASSERT_TRUE(packer.Place(2, 40, 40, &moved));
+
+  // Shrinking, and growing back to the size the space was made for.
+  ASSERT_TRUE(packer.Place(1, 20, 30, &moved));
+  EXPECT_EQ((WebviewRect{0, 0, 20, 30}), RegionOf(packer, 1));
+  ASSERT_TRUE(packer.Place(1, 40, 40, &moved));
+  EXPECT_EQ((WebviewRect{0, 0, 40, 40}), RegionOf(packer, 1));
+
+  // Outgrowing the space moves the region to the remaining space.
+  ASSERT_TRUE(packer.Place(1, 50, 40, &moved));
+  EXPECT_EQ((WebviewRect{0, 40, 50, 40}), RegionOf(packer, 1));
+  EXPECT_EQ((WebviewRect{40, 0, 40, 40}), RegionOf(packer, 2));
+  EXPECT_TRUE(moved.empty());
+}
+
+TEST(AtlasPackerReusesRemovedSpaceOnlyByRepacking) {
+  FlutterWebviewAtlasPacker packer(100, 100, 0);
+  std::vector<WebviewId> moved;
+  ASSERT_TRUE(packer.Place(1, 100, 50, &moved));
+  ASSERT_TRUE(packer.Place(2, 100, 50, &moved));
+
+  // The space of a removed region is not reused by itself.
+  packer.Remove(1);
+  WebviewRect rect;
+  EXPECT_FALSE(packer.GetRegion(1, &rect));
+  EXPECT_FALSE(packer.empty());
+  EXPECT_EQ((WebviewRect{0, 50, 100, 50}), RegionOf(packer, 2));
+
+  // The atlas is packed again for the next region, which moves the others.
+  ASSERT_TRUE(packer.Place(3, 100, 50, &moved));
+  EXPECT_EQ((WebviewRect{0, 0, 100, 50}), RegionOf(packer, 2));
+  EXPECT_EQ((WebviewRect{0, 50, 100, 50}), RegionOf(packer, 3));
+  ASSERT_EQ(1u, moved.size());
+  EXPECT_EQ(2, moved[0]);
+
+  // Removing a region that has none does nothing.
+  packer.Remove(4);
+  EXPECT_EQ((WebviewRect{0, 0, 100, 50}), RegionOf(packer, 2));
+}
+
+TEST(AtlasPackerStartsOverOnceEmpty) {
+  FlutterWebviewAtlasPacker packer(100, 100, 0);
+  std::vector<WebviewId> moved;
+  ASSERT_TRUE(packer.Place(1, 60, 60, &moved));
+  ASSERT_TRUE(packer.Place(2, 30, 30, &moved));
+  packer.Remove(2);
+  packer.Remove(1);
+  EXPECT_TRUE(packer.empty());
+  ASSERT_TRUE(packer.Place(3, 100, 100, &moved));
+  EXPECT_EQ((WebviewRect{0, 0, 100, 100}), RegionOf(packer, 3));
+  EXPECT_TRUE(moved.empty());
+}
+
+TEST(AtlasPackerRepacksWhenARegionOutgrowsTheRemainingSpace) {
+  FlutterWebviewAtlasPacker packer(100, 100, 0);
+  std::vector<WebviewId> moved;
+  ASSERT_TRUE(packer.Place(1, 50, 30, &moved));
+  ASSERT_TRUE(packer.Place(2, 50, 60, &moved));
+  ASSERT_TRUE(packer.Place(3, 50, 40, &moved));
+  EXPECT_EQ((WebviewRect{0, 0, 50, 30}), RegionOf(packer, 1));
+  EXPECT_EQ((WebviewRect{50, 0, 50, 60}), RegionOf(packer, 2));
+  EXPECT_EQ((WebviewRect{0, 30, 50, 40}), RegionOf(packer, 3));
+
+  // Growing region 1 to 50 x 60 leaves no room for it on the skyline. Packed
+  // again tallest first, regions 1 and 2 share the top row and region 3 goes
+  // below them; region 2 stays where it was.
+  ASSERT_TRUE(packer.Place(1, 50, 60, &moved));
+  EXPECT_EQ((WebviewRect{0, 0, 50, 60}), RegionOf(packer, 1));
+  EXPECT_EQ((WebviewRect{50, 0, 50, 60}), RegionOf(packer, 2));
+  EXPECT_EQ((WebviewRect{0, 60, 50, 40}), RegionOf(packer, 3));
+  ASSERT_EQ(1u, moved.size());
+  EXPECT_EQ(3, moved[0]);
+}
+
+TEST(AtlasPackerLeavesTheRegionsUnchangedOnFailure) {
+  // |packer| and |reference| get the same regions, but only |packer| is asked
+  // for the ones that do not fit.
+  FlutterWebviewAtlasPacker packer(100, 100, 0);
+  FlutterWebviewAtlasPacker reference(100, 100, 0);
+  std::vector<WebviewId> moved;
+  for (FlutterWebviewAtlasPacker* atlas : {&packer, &reference}) {
+    ASSERT_TRUE(atlas->Place(1, 60, 60, &moved));
+    ASSERT_TRUE(atlas->Place(2, 40, 40, &moved));
+    ASSERT_TRUE(atlas->Place(3, 40, 40, &moved));
+  }
+  moved.clear();
+
+  // A new region that does not fit even after packing again.
+  EXPECT_FALSE(packer.Place(4, 60, 60, &moved));
+  // A region resized beyond what the others leave.
+  EXPECT_FALSE(packer.Place(2, 90, 90, &moved));
+  EXPECT_TRUE(moved.empty());
+  WebviewRect rect;
+  EXPECT_FALSE(packer.GetRegion(4, &rect));
+  for (WebviewId webview_id = 1; webview_id <= 3; ++webview_id) {
+    EXPECT_EQ(RegionOf(reference, webview_id), RegionOf(packer, webview_id));
+  }
+
+  // The skyline is unchanged too: the next regions land at the same spots.
+  std::vector<WebviewId> reference_moved;
+  ASSERT_TRUE(packer.Place(5, 40, 20, &moved));
+  ASSERT_TRUE(reference.Place(5, 40, 20, &reference_moved));
+  EXPECT_EQ(RegionOf(reference, 5), RegionOf(packer, 5));
+  EXPECT_TRUE(moved.empty());
+  EXPECT_TRUE(reference_moved.empty());
+}
+
+TEST(AtlasPackerNeverOverlapsRegions) {
+  FlutterWebviewAtlasPacker packer(256, 256, 1);
+  std::vector<WebviewId> moved;
+  std::vector<WebviewId> placed;
+  // A deterministic mix of sizes, resizes and removals.
+  for (int step = 0; step < 400; ++step) {
+    const WebviewId webview_id = step * 7 % 23;
+    if (step % 5 == 4) {
+      packer.Remove(webview_id);
+    } else {
+      const int width = 8 + step * 37 % 90;
+      const int height = 8 + step * 53 % 70;
+      packer.Place(webview_id, width, height, &moved);
+    }
+    std::vector<WebviewRect> regions;
+    for (WebviewId id = 0; id < 23; ++id) {
+      WebviewRect rect;
+      if (packer.GetRegion(id, &rect)) {
+        EXPECT_TRUE(rect.x >= 0 && rect.y >= 0 && rect.x + rect.width < 256 &&
+                    rect.y + rect.height < 256);
+        regions.push_back(rect);
+      }
+    }
+    for (size_t i = 0; i < regions.size(); ++i) {
+      for (size_t j = i + 1; j < regions.size(); ++j) {
+        const WebviewRect& a = regions[i];
+        const WebviewRect& b = regions[j];
+        EXPECT_TRUE(a.x + a.width + 1 <= b.x || b.x + b.width + 1 <= a.x ||
+                    a.y + a.height + 1 <= b.y || b.y + b.height + 1 <= a.y);
+      }
+    }
+  }
+}
@@ -0,0 +1,283 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_damage_refiner.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_test.h"
+
+namespace {
+
+constexpr int kTileSize = FlutterWebviewDamageRefiner::kTileSize;
+
+// A BGRA frame of |width| x |height| pixels.
+struct Frame {
+  Frame(int width, int height)
+      : width(width),
+        height(height),
+        pixels(static_cast<size_t>(width) * height * 4, 0x80) {}
+
+  // Changes one byte of the pixel at (|x|, |y|).
+  void Touch(int x, int y) {
+    pixels[(static_cast<size_t>(y) * width + x) * 4 + (x + y) % 4] ^= 0x01;
+  }
+
+  int width;
+  int height;
+  std::vector<uint8_t> pixels;
+};
+
+std::vector<WebviewRect> Refine(FlutterWebviewDamageRefiner* refiner,
+                                const Frame& frame,
+                                const std::vector<WebviewRect>& dirty_rects) {
+  return refiner->Refine(frame.pixels.data(), frame.width, frame.height,
+                         dirty_rects);
+}
+
+bool Contains(const WebviewRect& rect, int x, int y) {
+  return rect.x <= x && x < rect.x + rect.width && rect.y <= y &&
+         y < rect.y + rect.height;
+}
+
+}  // namespace
+
+TEST(DamageRefinerPassesTheFirstFrameThrough) {
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(200, 150);
+  // Returned as reported, even where it lies outside of the frame.
+  const std::vector<WebviewRect> dirty_rects = {WebviewRect{-10, 0, 50, 50},
+                                                WebviewRect{100, 100, 200, 80}};
+  const std::vector<WebviewRect> result = Refine(&refiner, frame, dirty_rects);
+  ASSERT_EQ(2u, result.size());
+  EXPECT_EQ(dirty_rects[0], result[0]);
+  EXPECT_EQ(dirty_rects[1], result[1]);
+  EXPECT_EQ(0, refiner.counters().frames);
+}
+
+TEST(DamageRefinerDropsAnUnchangedFrame) {
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(200, 150);
+  Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}});
+  EXPECT_TRUE(Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}}).empty());
+  EXPECT_EQ(1, refiner.counters().frames);
+  EXPECT_EQ(1, refiner.counters().unchanged_frames);
+  // 4 x 3 tiles.
+  EXPECT_EQ(12, refiner.counters().compared_tiles);
+  EXPECT_EQ(12, refiner.counters().unchanged_tiles);
+}
+
+TEST(DamageRefinerReturnsTheChangedTiles) {
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(200, 150);
+  Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}});
+
+  frame.Touch(70, 10);
+  std::vector<WebviewRect> result =
+      Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{kTileSize, 0, kTileSize, kTileSize}), result[0]);
+
+  // The tiles at the right and bottom edges are cut by the frame.
+  frame.Touch(199, 149);
+  result = Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{3 * kTileSize, 2 * kTileSize, 200 - 3 * kTileSize,
+                         150 - 2 * kTileSize}),
+            result[0]);
+  EXPECT_EQ(0, refiner.counters().unchanged_frames);
+}
+
+TEST(DamageRefinerClipsTilesToTheDirtyRects) {
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(200, 150);
+  Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}});
+
+  // The dirty rectangle covers parts of four tiles, and the change is in the
+  // bottom right one.
+  frame.Touch(70, 70);
+  std::vector<WebviewRect> result =
+      Refine(&refiner, frame, {WebviewRect{30, 40, 50, 50}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{kTileSize, kTileSize, 30 + 50 - kTileSize,
+                         40 + 50 - kTileSize}),
+            result[0]);
+  EXPECT_EQ(4, refiner.counters().compared_tiles);
+  EXPECT_EQ(3, refiner.counters().unchanged_tiles);
+
+  // A change outside of the dirty rectangles is neither returned nor kept, so
+  // it is found when it is reported.
+  frame.Touch(10, 10);
+  EXPECT_TRUE(Refine(&refiner, frame, {WebviewRect{30, 40, 50, 50}}).empty());
+  result = Refine(&refiner, frame, {WebviewRect{0, 0, 20, 20}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 20, 20}), result[0]);
+
+  // The dirty rectangles are clipped to the frame, and the part of the second
+  // one left of the tile edge at 192 is unchanged.
+  frame.Touch(199, 0);
+  result = Refine(&refiner, frame,
+                  {WebviewRect{-50, -50, 20, 20}, WebviewRect{190, -5, 40, 15}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{3 * kTileSize, 0, 200 - 3 * kTileSize, 10}),
+            result[0]);
+}
+
+TEST(DamageRefinerMergesChangedTilesIntoHorizontalRuns) {
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(5 * kTileSize, 2 * kTileSize);
+  Refine(&refiner, frame, {WebviewRect{0, 0, frame.width, frame.height}});
+
+  // Tiles 0, 1 and 3 of the first row, and tile 4 of the second one.
+  frame.Touch(1, 1);
+  frame.Touch(kTileSize + 1, kTileSize - 1);
+  frame.Touch(3 * kTileSize, 0);
+  frame.Touch(5 * kTileSize - 1, kTileSize);
+  const std::vector<WebviewRect> result =
+      Refine(&refiner, frame, {WebviewRect{0, 0, frame.width, frame.height}});
+  ASSERT_EQ(3u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 2 * kTileSize, kTileSize}), result[0]);
+  EXPECT_EQ((WebviewRect{3 * kTileSize, 0, kTileSize, kTileSize}), result[1]);
+  EXPECT_EQ((WebviewRect{4 * kTileSize, kTileSize, kTileSize, kTileSize}),
+            result[2]);
+}
+
+TEST(DamageRefinerKeepsTheChangedRows) {
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(kTileSize, kTileSize);
+  Refine(&refiner, frame, {WebviewRect{0, 0, kTileSize, kTileSize}});
+
+  // Changes in the middle and in the last row of a tile are both copied,
+  // although the tile is found changed at the first of them.
+  frame.Touch(5, 20);
+  frame.Touch(5, kTileSize - 1);
+  EXPECT_EQ(1u,
+            Refine(&refiner, frame, {WebviewRect{0, 0, kTileSize, kTileSize}})
+                .size());
+  EXPECT_TRUE(
+      Refine(&refiner, frame, {WebviewRect{0, 0, kTileSize, kTileSize}})
+          .empty());
+}
+
+TEST(DamageRefinerPassesAFrameThroughAfterAResize) {
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(200, 150);
+  Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}});
+  Frame resized(150, 200);
+  std::vector<WebviewRect> result =
+      Refine(&refiner, resized, {WebviewRect{0, 0, 150, 200}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 150, 200}), result[0]);
+  // Compared with the resized frame from then on.
+  EXPECT_TRUE(Refine(&refiner, resized, {WebviewRect{0, 0, 150, 200}}).empty());
+}
+
+TEST(DamageRefinerPassesAFrameThroughAfterReset) {
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(200, 150);
+  Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}});
+  refiner.Reset();
+  std::vector<WebviewRect> result =
+      Refine(&refiner, frame, {WebviewRect{10, 20, 30, 40}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{10, 20, 30, 40}), result[0]);
+  EXPECT_TRUE(Refine(&refiner, frame, {WebviewRect{0, 0, 200, 150}}).empty());
+  EXPECT_EQ(1, refiner.counters().frames);
+}
+
+TEST(DamageRefinerMatchesTheReference) {
+  // Random frames, each with a few changed pixels and dirty rectangles, are
+  // checked against a scalar comparison of the tiles: every changed pixel in
+  // the dirty rectangles is returned, and every returned tile has changed.
+  constexpr int kWidth = 300;
+  constexpr int kHeight = 200;
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int> x_distribution(0, kWidth - 1);
+  std::uniform_int_distribution<int> y_distribution(0, kHeight - 1);
+  FlutterWebviewDamageRefiner refiner;
+  Frame frame(kWidth, kHeight);
+  Refine(&refiner, frame, {WebviewRect{0, 0, kWidth, kHeight}});
+  Frame previous = frame;
+  for (int step = 0; step < 100; ++step) {
+    for (int i = step % 7; i > 0; --i) {
+      frame.Touch(x_distribution(random), y_distribution(random));
+    }
+    std::vector<WebviewRect> dirty_rects;
+    for (int i = 1 + step % 3; i > 0; --i) {
+      const int x = x_distribution(random);
+      const int y = y_distribution(random);
+      dirty_rects.push_back(WebviewRect{x - 20, y - 20, 1 + step * 3 % 250,
+                                        1 + step * 5 % 180});
+    }
+    const std::vector<WebviewRect> result =
+        Refine(&refiner, frame, dirty_rects);
+
+    // The scalar comparison with the copy the refiner should keep.
+    std::vector<bool> changed(static_cast<size_t>(kWidth) * kHeight, false);
+    for (int y = 0; y < kHeight; ++y) {
+      for (int x = 0; x < kWidth; ++x) {
+        bool dirty = false;
+        for (const WebviewRect& rect : dirty_rects) {
+          dirty = dirty || Contains(rect, x, y);
+        }
+        const size_t offset = (static_cast<size_t>(y) * kWidth + x) * 4;
+        if (!dirty || std::memcmp(&frame.pixels[offset],
+                                  &previous.pixels[offset], 4) == 0) {
+          continue;
+        }
+        changed[static_cast<size_t>(y) * kWidth + x] = true;
+        std::memcpy(&previous.pixels[offset], &frame.pixels[offset], 4);
+        bool returned = false;
+        for (const WebviewRect& rect : result) {
+          returned = returned || Contains(rect, x, y);
+        }
+        EXPECT_TRUE(returned);
+      }
+    }
+    for (const WebviewRect& rect : result) {
+      for (int tile_left = rect.x; tile_left < rect.x + rect.width;
+           tile_left = (tile_left / kTileSize + 1) * kTileSize) {
+        const int tile_right = std::min((tile_left / kTileSize + 1) * kTileSize,
+                                        rect.x + rect.width);
+        bool tile_changed = false;
+        for (int y = rect.y; y < rect.y + rect.height; ++y) {
+          for (int x = tile_left; x < tile_right; ++x) {
+            tile_changed =
+                tile_changed || changed[static_cast<size_t>(y) * kWidth + x];
+          }
+        }
+        EXPECT_TRUE(tile_changed);
+      }
+    }
+  }
+}
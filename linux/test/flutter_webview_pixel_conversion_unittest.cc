@@ -0,0 +1,148 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_pixel_conversion.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "flutter_webview_test.h"
+
+namespace {
+
+// The scalar references of the kernels.
+bool ReferencePixelsEqual(const uint8_t* a,
+                          const uint8_t* b,
+                          size_t num_pixels) {
+  for (size_t i = 0; i < num_pixels * 4; ++i) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ReferenceConvertBGRAToRGBA(const uint8_t* bgra,
+                                uint8_t* rgba,
+                                size_t num_pixels) {
+  for (size_t i = 0; i < num_pixels; ++i) {
+    rgba[i * 4] = bgra[i * 4 + 2];
+    rgba[i * 4 + 1] = bgra[i * 4 + 1];
+    rgba[i * 4 + 2] = bgra[i * 4];
+    rgba[i * 4 + 3] = bgra[i * 4 + 3];
+  }
+}
+
+// The lengths around the widths of the AVX2 (32 pixels) and SSE2 or NEON (16
+// pixels) kernels, and their combinations with the scalar tail.
+std::vector<size_t> GetLengths() {
+  std::vector<size_t> lengths;
+  for (size_t length = 0; length <= 100; ++length) {
+    lengths.push_back(length);
+  }
+  lengths.push_back(127);
+  lengths.push_back(128);
+  lengths.push_back(129);
+  lengths.push_back(1920);
+  lengths.push_back(1937);
+  return lengths;
+}
+
+// Checks PixelsEqualForTesting() against the reference for every length, at
+// every misalignment of the buffers, with no difference and with a difference
+// in each pixel.
+void CheckPixelsEqual(bool use_avx2) {
+  for (size_t length : GetLengths()) {
+    for (size_t misalignment = 0; misalignment < 4; ++misalignment) {
+      std::vector<uint8_t> a_storage(length * 4 + 4);
+      std::vector<uint8_t> b_storage(length * 4 + 4);
+      uint8_t* a = a_storage.data() + misalignment;
+      uint8_t* b = b_storage.data() + 3 - misalignment;
+      for (size_t i = 0; i < length * 4; ++i) {
+        a[i] = static_cast<uint8_t>(i * 7 + 1);
+      }
+      std::memcpy(b, a, length * 4);
+      EXPECT_TRUE(flutter_webview_pixels::PixelsEqualForTesting(a, b, length,
+                                                                use_avx2));
+      for (size_t pixel = 0; pixel < length; ++pixel) {
+        // A single bit of a different channel each time.
+        const size_t byte = pixel * 4 + pixel % 4;
+        b[byte] ^= static_cast<uint8_t>(1u << (pixel % 8));
+        const bool expected = ReferencePixelsEqual(a, b, length);
+        const bool actual = flutter_webview_pixels::PixelsEqualForTesting(
+            a, b, length, use_avx2);
+        if (expected != actual) {
+          std::cerr << "  length=" << length << " pixel=" << pixel
+                    << " misalignment=" << misalignment << std::endl;
+          EXPECT_EQ(expected, actual);
+          return;
+        }
+        b[byte] ^= static_cast<uint8_t>(1u << (pixel % 8));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(PixelsEqualMatchesTheReferenceWithoutAVX2) {
+  CheckPixelsEqual(false);
+}
+
+TEST(PixelsEqualMatchesTheReferenceWithAVX2) {
+  if (!flutter_webview_pixels::UsesAVX2()) {
+    std::cout << "  skipped: the CPU does not support AVX2" << std::endl;
+    return;
+  }
+  CheckPixelsEqual(true);
+}
+
+TEST(PixelsEqualIgnoresThePixelsPastTheLength) {
+  std::vector<uint8_t> a(100 * 4, 0);
+  std::vector<uint8_t> b(100 * 4, 0);
+  b[64 * 4] = 1;
+  EXPECT_TRUE(flutter_webview_pixels::PixelsEqual(a.data(), b.data(), 64));
+  EXPECT_FALSE(flutter_webview_pixels::PixelsEqual(a.data(), b.data(), 65));
+}
+
+TEST(ConvertBGRAToRGBAMatchesTheReference) {
+  for (size_t length : GetLengths()) {
+    std::vector<uint8_t> bgra(length * 4);
+    for (size_t i = 0; i < bgra.size(); ++i) {
+      bgra[i] = static_cast<uint8_t>(i * 13 + 5);
+    }
+    std::vector<uint8_t> expected(length * 4);
+    ReferenceConvertBGRAToRGBA(bgra.data(), expected.data(), length);
+    std::vector<uint8_t> actual(length * 4);
+    flutter_webview_pixels::ConvertBGRAToRGBA(bgra.data(), actual.data(),
+                                              length);
+    EXPECT_TRUE(expected == actual);
+  }
+}
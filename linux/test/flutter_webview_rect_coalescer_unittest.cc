@@ -0,0 +1,257 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_rect_coalescer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+#include "flutter_webview_test.h"
+
+namespace {
+
+// A call costs as much as uploading 1000 pixels, so two rectangles are merged
+// when their bounding box adds fewer than 1000 pixels.
+constexpr UploadCostModel kCostModel = {1000.0, 0.25};
+
+FlutterWebviewRectCoalescer MakeCoalescer() {
+  FlutterWebviewRectCoalescer coalescer;
+  coalescer.SetCostModel(kCostModel);
+  return coalescer;
+}
+
+// Whether every pixel of |rects| is in |coalesced|, checked on a bitmap of
+// |width| x |height| pixels.
+bool Covers(const std::vector<WebviewRect>& coalesced,
+            const std::vector<WebviewRect>& rects,
+            int width,
+            int height) {
+  std::vector<bool> covered(static_cast<size_t>(width) * height, false);
+  for (const WebviewRect& rect : coalesced) {
+    for (int y = rect.y; y < rect.y + rect.height; ++y) {
+      for (int x = rect.x; x < rect.x + rect.width; ++x) {
+        covered[static_cast<size_t>(y) * width + x] = true;
+      }
+    }
+  }
+  for (const WebviewRect& rect : rects) {
+    for (int y = rect.y; y < rect.y + rect.height; ++y) {
+      for (int x = rect.x; x < rect.x + rect.width; ++x) {
+        if (!covered[static_cast<size_t>(y) * width + x]) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(RectCoalescerMergesAdjacentRects) {
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  const std::vector<WebviewRect> result =
+      coalescer.Coalesce({WebviewRect{0, 0, 10, 10}, WebviewRect{10, 0, 10, 10}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 20, 10}), result[0]);
+}
+
+TEST(RectCoalescerMergesWhenTheAddedAreaCostsLessThanACall) {
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  // The bounding box adds 900 pixels.
+  const std::vector<WebviewRect> result = coalescer.Coalesce(
+      {WebviewRect{0, 0, 10, 10}, WebviewRect{100, 0, 10, 10}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 110, 10}), result[0]);
+}
+
+TEST(RectCoalescerKeepsRectsWhenTheAddedAreaCostsMoreThanACall) {
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  // The bounding box adds 1100 pixels.
+  const std::vector<WebviewRect> result = coalescer.Coalesce(
+      {WebviewRect{0, 0, 10, 10}, WebviewRect{120, 0, 10, 10}});
+  ASSERT_EQ(2u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 10, 10}), result[0]);
+  EXPECT_EQ((WebviewRect{120, 0, 10, 10}), result[1]);
+}
+
+TEST(RectCoalescerFollowsTheCostModel) {
+  // The same rectangles as above, merged when calls are ten times dearer.
+  FlutterWebviewRectCoalescer coalescer;
+  coalescer.SetCostModel(UploadCostModel{10000.0, 0.25});
+  const std::vector<WebviewRect> result = coalescer.Coalesce(
+      {WebviewRect{0, 0, 10, 10}, WebviewRect{120, 0, 10, 10}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 130, 10}), result[0]);
+}
+
+TEST(RectCoalescerCountsTheOverlapAsSaved) {
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  // The bounding box is 3600 pixels and the rectangles 1600 each, but 400 of
+  // them are uploaded twice when the rectangles are kept.
+  std::vector<WebviewRect> result = coalescer.Coalesce(
+      {WebviewRect{0, 0, 40, 40}, WebviewRect{20, 20, 40, 40}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 60, 60}), result[0]);
+
+  // A rectangle inside another one is merged into it.
+  result = coalescer.Coalesce(
+      {WebviewRect{0, 0, 200, 200}, WebviewRect{50, 50, 10, 10}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 200, 200}), result[0]);
+
+  // Overlapping rectangles are merged even when the overlap is all the
+  // bounding box adds.
+  result = coalescer.Coalesce(
+      {WebviewRect{0, 0, 1000, 10}, WebviewRect{0, 5, 1000, 10}});
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 1000, 15}), result[0]);
+}
+
+TEST(RectCoalescerMergesAGrownRectWithTheOnesAlreadyChecked) {
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  // Merging the first rectangle with either of the two small ones would add
+  // 1200 pixels, but merging it with both of them adds only 800.
+  const std::vector<WebviewRect> result = coalescer.Coalesce(
+      {WebviewRect{0, 0, 40, 40}, WebviewRect{60, 0, 20, 20},
+       WebviewRect{60, 20, 20, 20}, WebviewRect{300, 300, 10, 10}});
+  ASSERT_EQ(2u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 80, 40}), result[0]);
+  EXPECT_EQ((WebviewRect{300, 300, 10, 10}), result[1]);
+}
+
+TEST(RectCoalescerFallsBackToTheBoundingBox) {
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  // The border of a 40 x 40 box, e.g. a focus ring: no two sides are worth
+  // merging, since each pair adds more than 1400 pixels, but the whole box
+  // adds 1444 pixels and saves three calls.
+  const std::vector<WebviewRect> border = {
+      WebviewRect{0, 0, 40, 1}, WebviewRect{0, 39, 40, 1},
+      WebviewRect{0, 1, 1, 38}, WebviewRect{39, 1, 1, 38}};
+  const std::vector<WebviewRect> result = coalescer.Coalesce(border);
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, 40, 40}), result[0]);
+  EXPECT_EQ(1, coalescer.counters().bounding_box_frames);
+
+  // Without the fallback, two sides would be the cheapest.
+  const std::vector<WebviewRect> two_sides =
+      coalescer.Coalesce({border[0], border[1]});
+  EXPECT_EQ(2u, two_sides.size());
+  EXPECT_EQ(1, coalescer.counters().bounding_box_frames);
+}
+
+TEST(RectCoalescerOnlyConsidersTheBoundingBoxAboveTheCutoff) {
+  const int cutoff =
+      static_cast<int>(FlutterWebviewRectCoalescer::kMaxRectsToMerge);
+  // Two rows of adjacent 1 x 1 rectangles, too far apart for their bounding
+  // box to pay off.
+  std::vector<WebviewRect> rects;
+  for (int i = 0; i < cutoff; ++i) {
+    rects.push_back(i % 2 == 0 ? WebviewRect{i, 0, 1, 1}
+                               : WebviewRect{i, 1000, 1, 1});
+  }
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  std::vector<WebviewRect> result = coalescer.Coalesce(rects);
+  ASSERT_EQ(2u, result.size());
+
+  // One more rectangle is not merged with any other.
+  rects.push_back(WebviewRect{cutoff, 0, 1, 1});
+  result = coalescer.Coalesce(rects);
+  EXPECT_EQ(rects.size(), result.size());
+  EXPECT_EQ(0, coalescer.counters().bounding_box_frames);
+
+  // The bounding box is still used when it is cheaper.
+  for (WebviewRect& rect : rects) {
+    rect.y = 0;
+  }
+  result = coalescer.Coalesce(rects);
+  ASSERT_EQ(1u, result.size());
+  EXPECT_EQ((WebviewRect{0, 0, cutoff + 1, 1}), result[0]);
+  EXPECT_EQ(1, coalescer.counters().bounding_box_frames);
+}
+
+TEST(RectCoalescerDropsEmptyRects) {
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  EXPECT_TRUE(coalescer
+                  .Coalesce({WebviewRect{0, 0, 0, 10}, WebviewRect{0, 0, 10, 0},
+                             WebviewRect{5, 5, -1, 3}})
+                  .empty());
+  EXPECT_TRUE(coalescer.Coalesce({}).empty());
+  EXPECT_EQ(0, coalescer.counters().frames);
+  EXPECT_EQ(0, coalescer.counters().input_rects);
+}
+
+TEST(RectCoalescerCountsFramesAndRects) {
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  // 2 rectangles merged into 1.
+  coalescer.Coalesce({WebviewRect{0, 0, 10, 10}, WebviewRect{10, 0, 10, 10},
+                      WebviewRect{0, 0, 0, 0}});
+  // 2 rectangles kept.
+  coalescer.Coalesce({WebviewRect{0, 0, 10, 10}, WebviewRect{500, 500, 10, 10}});
+  // 4 rectangles reduced to their bounding box.
+  coalescer.Coalesce({WebviewRect{0, 0, 40, 1}, WebviewRect{0, 39, 40, 1},
+                      WebviewRect{0, 1, 1, 38}, WebviewRect{39, 1, 1, 38}});
+  // Nothing to upload.
+  coalescer.Coalesce({WebviewRect{0, 0, 0, 0}});
+
+  const FlutterWebviewRectCoalescer::Counters& counters = coalescer.counters();
+  EXPECT_EQ(3, counters.frames);
+  EXPECT_EQ(8, counters.input_rects);
+  EXPECT_EQ(4, counters.output_rects);
+  EXPECT_EQ(4, counters.merged_rects);
+  EXPECT_EQ(1, counters.bounding_box_frames);
+}
+
+TEST(RectCoalescerCoversEveryDirtyPixel) {
+  constexpr int kWidth = 256;
+  constexpr int kHeight = 256;
+  std::mt19937 random(1);
+  std::uniform_int_distribution<int> position(0, kWidth - 1);
+  std::uniform_int_distribution<int> count(1, 80);
+  FlutterWebviewRectCoalescer coalescer = MakeCoalescer();
+  for (int frame = 0; frame < 200; ++frame) {
+    std::vector<WebviewRect> rects;
+    const int num_rects = count(random);
+    for (int i = 0; i < num_rects; ++i) {
+      const int x = position(random);
+      const int y = position(random);
+      const int size = 1 + position(random) / (frame % 4 == 0 ? 2 : 16);
+      rects.push_back(WebviewRect{x, y, std::min(size, kWidth - x),
+                                  std::min(size, kHeight - y)});
+    }
+    const std::vector<WebviewRect> result = coalescer.Coalesce(rects);
+    EXPECT_TRUE(!result.empty() && result.size() <= rects.size());
+    EXPECT_TRUE(Covers(result, rects, kWidth, kHeight));
+    for (const WebviewRect& rect : result) {
+      EXPECT_TRUE(rect.width > 0 && rect.height > 0);
+    }
+  }
+}
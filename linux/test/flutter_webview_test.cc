@@ -0,0 +1,102 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "flutter_webview_test.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace flutter_webview_test {
+
+namespace {
+
+struct Test {
+  const char* name;
+  TestFunction function;
+};
+
+std::vector<Test>& GetTests() {
+  static std::vector<Test> tests;
+  return tests;
+}
+
+int g_failures_of_test = 0;
+
+}  // namespace
+
+TestRegistration::TestRegistration(const char* name, TestFunction function) {
+  GetTests().push_back(Test{name, function});
+}
+
+void AddFailure(const char* file, int line, const char* message) {
+  std::cerr << file << ":" << line << ": Failure: " << message << std::endl;
+  ++g_failures_of_test;
+}
+
+int RunAllTests(const char* filter) {
+  int failed_tests = 0;
+  int run_tests = 0;
+  for (const Test& test : GetTests()) {
+    if (filter[0] != '\0' && !std::strstr(test.name, filter)) {
+      continue;
+    }
+    std::cout << "[ RUN  ] " << test.name << std::endl;
+    g_failures_of_test = 0;
+    test.function();
+    ++run_tests;
+    if (g_failures_of_test > 0) {
+      ++failed_tests;
+      std::cout << "[ FAIL ] " << test.name << std::endl;
+    } else {
+      std::cout << "[  OK  ] " << test.name << std::endl;
+    }
+  }
+  std::cout << run_tests - failed_tests << " of " << run_tests
+            << " tests passed" << std::endl;
+  return failed_tests;
+}
+
+}  // namespace flutter_webview_test
+
+// Usage: flutter_webview_unittests [--filter=SUBSTRING]
+int main(int argc, char** argv) {
+  std::string filter;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.compare(0, 9, "--filter=") == 0) {
+      filter = arg.substr(9);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--filter=SUBSTRING]"
+                << std::endl;
+      return 2;
+    }
+  }
+  return flutter_webview_test::RunAllTests(filter.c_str()) == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2023 ACCESS CO., LTD. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of ACCESS CO., LTD. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LINUX_TEST_FLUTTER_WEBVIEW_TEST_H_
+#define LINUX_TEST_FLUTTER_WEBVIEW_TEST_H_
+
+#include <iostream>
+
+#include "flutter_linux_webview/flutter_webview_types.h"
+
+// A minimal test harness for the unit tests of the plugin, which have no
+// dependency to install.
+//
+// TEST(Name) { ... } defines a test that the main function runs. The EXPECT_*
+// macros report a failed check with its location and let the test go on,
+// while the ASSERT_* macros also return from the test.
+namespace flutter_webview_test {
+
+using TestFunction = void (*)();
+
+// Adds a test to the list run by RunAllTests(). Used by TEST().
+struct TestRegistration {
+  TestRegistration(const char* name, TestFunction function);
+};
+
+// Counts a failed check of the running test.
+void AddFailure(const char* file, int line, const char* message);
+
+// Runs the tests whose name contains |filter|, or all of them if it is empty,
+// and returns the number of failed tests.
+int RunAllTests(const char* filter);
+
+}  // namespace flutter_webview_test
+
+// Lets the checks compare rectangles and print them.
+inline bool operator==(const WebviewRect& a, const WebviewRect& b) {
+  return a.x == b.x && a.y == b.y && a.width == b.width &&
+         a.height == b.height;
+}
+
+inline std::ostream& operator<<(std::ostream& stream, const WebviewRect& rect) {
+  return stream << "{" << rect.x << ", " << rect.y << ", " << rect.width
+                << ", " << rect.height << "}";
+}
+
+#define TEST(name)                                                      \
+  static void name();                                                   \
+  static const flutter_webview_test::TestRegistration name##_registration( \
+      #name, name);                                                     \
+  static void name()
+
+#define EXPECT_TRUE(condition)                                            \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      flutter_webview_test::AddFailure(__FILE__, __LINE__, #condition);   \
+    }                                                                     \
+  } while (false)
+
+#define EXPECT_FALSE(condition) EXPECT_TRUE(!(condition))
+
+#define EXPECT_EQ(expected, actual)                                        \
+  do {                                                                     \
+    const auto& expected_value = (expected);                               \
+    const auto& actual_value = (actual);                                   \
+    if (!(expected_value == actual_value)) {                               \
+      std::cerr << "  expected " << expected_value << ", got "             \
+                << actual_value << std::endl;                              \
+      flutter_webview_test::AddFailure(__FILE__, __LINE__,                 \
+                                       #expected " == " #actual);          \
+    }                                                                      \
+  } while (false)
+
+#define ASSERT_TRUE(condition)                                            \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      flutter_webview_test::AddFailure(__FILE__, __LINE__, #condition);   \
+      return;                                                             \
+    }                                                                     \
+  } while (false)
+
+#define ASSERT_EQ(expected, actual)                                        \
+  do {                                                                     \
+    const auto& expected_value = (expected);                               \
+    const auto& actual_value = (actual);                                   \
+    if (!(expected_value == actual_value)) {                               \
+      std::cerr << "  expected " << expected_value << ", got "             \
+                << actual_value << std::endl;                              \
+      flutter_webview_test::AddFailure(__FILE__, __LINE__,                 \
+                                       #expected " == " #actual);          \
+      return;                                                              \
+    }                                                                      \
+  } while (false)
+
+#endif  // LINUX_TEST_FLUTTER_WEBVIEW_TEST_H_